@@ -0,0 +1,537 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ext2.h"
+#include "journal.h"
+
+/* asynchronous file operations
+ *
+ * ext2_aio_read, ext2_aio_write and ext2_aio_lookup queue the operation and
+ * return at once; its callback runs later from ext2_aio_poll, on the thread
+ * that polls. One thread can keep thousands of operations going this way.
+ *
+ * A read is split in two. A helper thread maps the file blocks, which may
+ * read the inode and indirect blocks, and hands the data blocks to the disk
+ * submission queue, merging blocks that are contiguous on disk into one
+ * request. Full blocks are read straight into the caller's buffer, partial
+ * first and last blocks into a bounce buffer. The helper then moves on, so
+ * the data I/O of many reads is in flight at the same time without a thread
+ * waiting for each. A reaper thread collects the disk completions.
+ *
+ * Writes allocate blocks and go through the journal, which are blocking
+ * paths, so a helper thread runs ext2_write as a whole. A lookup that hits
+ * the dentry cache completes without leaving the caller's thread, a miss is
+ * run by a helper. Disks without submit run reads on the helpers as well.
+ *
+ * The context reaps the disk's completion queue, so only one context may be
+ * created per disk and nothing else may call complete on it meanwhile.
+ *
+ * Data is transferred after the inode lock is released. The helper records
+ * the inode version when it maps the blocks, and once the data is in, the
+ * reaper checks it again under the inode lock. If the inode changed, a block
+ * may have been freed and handed to another file meanwhile, so the read is
+ * queued again and a helper runs it as a whole with ext2_read. A read thus
+ * never returns data of blocks the file no longer owns. */
+
+#define AIO_READ			0
+#define AIO_WRITE			1
+#define AIO_LOOKUP			2
+#define AIO_REAP_BATCH		64
+
+typedef struct aio_op {
+	struct aio_op*	next;
+	EXT2_AIO*	aio;
+	int			type;
+	EXT2_NODE*	node;
+	EXT2_NODE*	retEntry;
+	char*		buffer;
+	unsigned long offset;
+	unsigned long length;
+	char		name[MAX_NAME_LENGTH];
+	EXT2_AIO_DONE done;
+	void*		arg;
+	int			result;
+	UINT32		pending;			/* disk requests not reaped yet */
+	UINT32		failed;				/* a disk request failed */
+	DISK_REQUEST*	requests;
+	BYTE*		bounce;				/* partial first and last block */
+	UINT32		head;				/* first block went to bounce */
+	UINT32		tail;				/* last block went to bounce + blockSize */
+	UINT32		version;			/* inode version when the blocks were mapped */
+	UINT32		retry;				/* the inode changed, read with ext2_read */
+} AIO_OP;
+
+struct ext2_aio {
+	EXT2_FILESYSTEM*	fs;
+	pthread_mutex_t lock;
+	pthread_cond_t work;			/* jobs queued, or stop */
+	pthread_cond_t done;			/* finished operations queued */
+	pthread_cond_t reap;			/* disk requests in flight, or stop */
+	AIO_OP*		jobHead;
+	AIO_OP*		jobTail;
+	AIO_OP*		doneHead;
+	AIO_OP*		doneTail;
+	UINT32		outstanding;		/* operations whose callback has not run */
+	int			inflight;			/* disk requests submitted and not reaped, briefly negative */
+	UINT32		stop;
+	UINT32		threadCount;
+	UINT32		reaping;			/* reaper thread started */
+	pthread_t	reaper;
+	pthread_t	threads[EXT2_AIO_MAX_THREADS];
+};
+
+static void post_done(AIO_OP* op)
+{
+	EXT2_AIO* aio = op->aio;
+
+	op->next = NULL;
+	pthread_mutex_lock(&aio->lock);
+	if (aio->doneTail)
+		aio->doneTail->next = op;
+	else
+		aio->doneHead = op;
+	aio->doneTail = op;
+	pthread_cond_signal(&aio->done);
+	pthread_mutex_unlock(&aio->lock);
+}
+
+static void post_job(AIO_OP* op)
+{
+	EXT2_AIO* aio = op->aio;
+
+	op->next = NULL;
+	pthread_mutex_lock(&aio->lock);
+	if (aio->jobTail)
+		aio->jobTail->next = op;
+	else
+		aio->jobHead = op;
+	aio->jobTail = op;
+	pthread_cond_signal(&aio->work);
+	pthread_mutex_unlock(&aio->lock);
+}
+
+/* bounce  κ   ۷ ϰ Ϸ ó */
+static void finish_read(AIO_OP* op)
+{
+	UINT32 blockSize = op->aio->fs->sb_info.blockSize;
+	unsigned long end = op->offset + op->result;
+	unsigned long start, lastStart;
+
+	if (op->failed)
+		op->result = EXT2_ERROR;
+	else if (op->result > 0 && ext2_map_changed(op->node, op->version))
+	{
+		// д   Ǿ Ǿ  Ƿ helper inode lock  ٽ 
+		free(op->requests);
+		free(op->bounce);
+		op->requests = NULL;
+		op->bounce = NULL;
+		op->head = 0;
+		op->tail = 0;
+		op->retry = 1;
+		post_job(op);
+		return;
+	}
+	else
+	{
+		if (op->head)
+		{
+			start = op->offset % blockSize;
+			memcpy(op->buffer, &op->bounce[start], MIN(blockSize - start, end - op->offset));
+		}
+		if (op->tail)
+		{
+			lastStart = (end - 1) / blockSize * blockSize;
+			memcpy(op->buffer + (lastStart - op->offset), &op->bounce[blockSize], end - lastStart);
+		}
+	}
+
+	free(op->requests);
+	free(op->bounce);
+	op->requests = NULL;
+	op->bounce = NULL;
+	post_done(op);
+}
+
+/*   ϰ   б⸦ disk , Ϸ reaper ó */
+static void start_read(AIO_OP* op)
+{
+	EXT2_AIO* aio = op->aio;
+	EXT2_FILESYSTEM* fs = aio->fs;
+	DISK_OPERATIONS* disk = fs->disk;
+	UINT32 blockSize = fs->sb_info.blockSize;
+	UINT32 sectorsPerBlock = fs->sb_info.sectorsPerBlock;
+	DISK_REQUEST** batch = NULL;
+	DISK_REQUEST* last = NULL;
+	UINT32* blocks = NULL;
+	UINT32 first, count, i, requestCount = 0, sectorCount = 0;
+	unsigned long blockStart, end;
+	BYTE* dest;
+	int length;
+
+	if (op->length == 0)
+	{
+		op->result = 0;
+		post_done(op);
+		return;
+	}
+
+	first = op->offset / blockSize;
+	count = (op->offset + op->length - 1) / blockSize - first + 1;
+	blocks = (UINT32 *)malloc(sizeof(UINT32) * count);
+	op->requests = (DISK_REQUEST *)malloc(sizeof(DISK_REQUEST) * count);
+	batch = (DISK_REQUEST **)malloc(sizeof(DISK_REQUEST *) * count);
+	op->bounce = (BYTE *)malloc(blockSize * 2);
+	if (blocks == NULL || op->requests == NULL || batch == NULL || op->bounce == NULL)
+	{
+		op->failed = 1;
+		goto done;
+	}
+
+	length = ext2_map_read(op->node, op->offset, op->length, blocks, &op->version);
+	if (length <= 0)
+	{
+		op->result = length;
+		goto done;
+	}
+	op->result = length;
+	end = op->offset + length;
+	count = (end - 1) / blockSize - first + 1;
+
+	for (i = 0; i < count; i++)
+	{
+		blockStart = (unsigned long)(first + i) * blockSize;
+		if (blockStart >= op->offset && blockStart + blockSize <= end)
+			dest = (BYTE *)op->buffer + (blockStart - op->offset);
+		else if (i == 0)
+		{
+			dest = op->bounce;
+			op->head = 1;
+		}
+		else
+		{
+			dest = op->bounce + blockSize;
+			op->tail = 1;
+		}
+
+		if (blocks[i] == 0) // Ҵ   0 
+		{
+			ZeroMemory(dest, blockSize);
+			continue;
+		}
+
+		if (fs->journal != NULL && journal_read_block(fs->journal, blocks[i], dest)) //  log ִ 
+			continue;
+
+		// ũ ̾ ۿ ̾  û 
+		if (last != NULL && last->sector + last->count == blocks[i] * sectorsPerBlock &&
+			(BYTE *)last->data + (size_t)last->count * disk->bytesPerSector == dest)
+		{
+			last->count += sectorsPerBlock;
+			continue;
+		}
+
+		last = &op->requests[requestCount];
+		last->opcode = DISK_READ;
+		last->sector = blocks[i] * sectorsPerBlock;
+		last->count = sectorsPerBlock;
+		last->data = dest;
+		last->result = 0;
+		last->param = op;
+		batch[requestCount++] = last;
+	}
+
+	if (requestCount == 0)
+		goto done;
+
+	// submit ڿ reaper op  requests   Ƿ ̸ 
+	for (i = 0; i < requestCount; i++)
+		sectorCount += batch[i]->count;
+
+	op->pending = requestCount;
+	if (disk->submit(disk, batch, requestCount) != (int)requestCount)
+	{
+		op->failed = 1;
+		goto done;
+	}
+	ext2_count_io(&fs->ioStats[EXT2_OP_READ], 0, sectorCount / sectorsPerBlock, sectorCount);
+
+	pthread_mutex_lock(&aio->lock);
+	aio->inflight += requestCount;
+	pthread_cond_signal(&aio->reap);
+	pthread_mutex_unlock(&aio->lock);
+
+	free(batch);
+	free(blocks);
+	return;
+
+done:
+	free(batch);
+	free(blocks);
+	finish_read(op);
+}
+
+static void* aio_worker(void* arg)
+{
+	EXT2_AIO* aio = (EXT2_AIO *)arg;
+	AIO_OP* op;
+
+	pthread_mutex_lock(&aio->lock);
+	for (;;)
+	{
+		while (aio->jobHead == NULL && !aio->stop)
+			pthread_cond_wait(&aio->work, &aio->lock);
+		if (aio->jobHead == NULL)
+			break;
+
+		op = aio->jobHead;
+		aio->jobHead = op->next;
+		if (aio->jobHead == NULL)
+			aio->jobTail = NULL;
+		pthread_mutex_unlock(&aio->lock);
+
+		switch (op->type)
+		{
+		case AIO_READ:
+			if (aio->fs->disk->submit != NULL && !op->retry)
+				start_read(op);
+			else
+			{
+				op->result = ext2_read(op->node, op->offset, op->length, op->buffer);
+				post_done(op);
+			}
+			break;
+		case AIO_WRITE:
+			op->result = ext2_write(op->node, op->offset, op->length, op->buffer);
+			post_done(op);
+			break;
+		case AIO_LOOKUP:
+			op->result = ext2_lookup(op->node, op->name, op->retEntry);
+			post_done(op);
+			break;
+		}
+
+		pthread_mutex_lock(&aio->lock);
+	}
+	pthread_mutex_unlock(&aio->lock);
+
+	return NULL;
+}
+
+/* disk Ϸ ť  û   read Ϸ ó */
+static void* aio_reaper(void* arg)
+{
+	EXT2_AIO* aio = (EXT2_AIO *)arg;
+	DISK_OPERATIONS* disk = aio->fs->disk;
+	DISK_REQUEST* done[AIO_REAP_BATCH];
+	AIO_OP* op;
+	int count, i;
+
+	pthread_mutex_lock(&aio->lock);
+	for (;;)
+	{
+		while (aio->inflight <= 0 && !aio->stop)
+			pthread_cond_wait(&aio->reap, &aio->lock);
+		if (aio->inflight <= 0)
+			break;
+		pthread_mutex_unlock(&aio->lock);
+
+		count = disk->complete(disk, done, AIO_REAP_BATCH, 1);
+		for (i = 0; i < count; i++)
+		{
+			op = (AIO_OP *)done[i]->param;
+			if (done[i]->result != 0)
+				op->failed = 1;
+			if (--op->pending == 0)
+				finish_read(op);
+		}
+
+		pthread_mutex_lock(&aio->lock);
+		if (count > 0)
+			aio->inflight -= count;
+	}
+	pthread_mutex_unlock(&aio->lock);
+
+	return NULL;
+}
+
+EXT2_AIO* ext2_aio_create(EXT2_FILESYSTEM* fs, UINT32 threadCount)
+{
+	EXT2_AIO* aio;
+
+	if (threadCount == 0)
+		threadCount = EXT2_AIO_THREADS;
+	if (threadCount > EXT2_AIO_MAX_THREADS)
+		threadCount = EXT2_AIO_MAX_THREADS;
+
+	aio = (EXT2_AIO *)calloc(1, sizeof(EXT2_AIO));
+	if (aio == NULL)
+		return NULL;
+
+	aio->fs = fs;
+	pthread_mutex_init(&aio->lock, NULL);
+	pthread_cond_init(&aio->work, NULL);
+	pthread_cond_init(&aio->done, NULL);
+	pthread_cond_init(&aio->reap, NULL);
+
+	if (fs->disk->submit != NULL)
+	{
+		if (pthread_create(&aio->reaper, NULL, aio_reaper, aio) != 0)
+		{
+			ext2_aio_destroy(aio);
+			return NULL;
+		}
+		aio->reaping = 1;
+	}
+
+	for (; aio->threadCount < threadCount; aio->threadCount++)
+	{
+		if (pthread_create(&aio->threads[aio->threadCount], NULL, aio_worker, aio) != 0)
+			break;
+	}
+
+	if (aio->threadCount == 0)
+	{
+		ext2_aio_destroy(aio);
+		return NULL;
+	}
+
+	return aio;
+}
+
+/*  ۾   callback ȣ   */
+void ext2_aio_destroy(EXT2_AIO* aio)
+{
+	UINT32 i;
+
+	while (ext2_aio_poll(aio, 1) > 0)
+		;
+
+	pthread_mutex_lock(&aio->lock);
+	aio->stop = 1;
+	pthread_cond_broadcast(&aio->work);
+	pthread_cond_broadcast(&aio->reap);
+	pthread_mutex_unlock(&aio->lock);
+
+	for (i = 0; i < aio->threadCount; i++)
+		pthread_join(aio->threads[i], NULL);
+	if (aio->reaping)
+		pthread_join(aio->reaper, NULL);
+
+	pthread_cond_destroy(&aio->reap);
+	pthread_cond_destroy(&aio->done);
+	pthread_cond_destroy(&aio->work);
+	pthread_mutex_destroy(&aio->lock);
+	free(aio);
+}
+
+static AIO_OP* new_op(EXT2_AIO* aio, int type, EXT2_NODE* node, EXT2_AIO_DONE done, void* arg)
+{
+	AIO_OP* op;
+
+	op = (AIO_OP *)calloc(1, sizeof(AIO_OP));
+	if (op == NULL)
+		return NULL;
+
+	op->aio = aio;
+	op->type = type;
+	op->node = node;
+	op->done = done;
+	op->arg = arg;
+
+	pthread_mutex_lock(&aio->lock);
+	aio->outstanding++;
+	pthread_mutex_unlock(&aio->lock);
+
+	return op;
+}
+
+int ext2_aio_read(EXT2_AIO* aio, EXT2_NODE* file, unsigned long offset, unsigned long length, char* buffer, EXT2_AIO_DONE done, void* arg)
+{
+	AIO_OP* op;
+
+	op = new_op(aio, AIO_READ, file, done, arg);
+	if (op == NULL)
+		return EXT2_ERROR;
+
+	op->offset = offset;
+	op->length = length;
+	op->buffer = buffer;
+	post_job(op);
+
+	return EXT2_SUCCESS;
+}
+
+int ext2_aio_write(EXT2_AIO* aio, EXT2_NODE* file, unsigned long offset, unsigned long length, const char* buffer, EXT2_AIO_DONE done, void* arg)
+{
+	AIO_OP* op;
+
+	op = new_op(aio, AIO_WRITE, file, done, arg);
+	if (op == NULL)
+		return EXT2_ERROR;
+
+	op->offset = offset;
+	op->length = length;
+	op->buffer = (char *)buffer;
+	post_job(op);
+
+	return EXT2_SUCCESS;
+}
+
+int ext2_aio_lookup(EXT2_AIO* aio, EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry, EXT2_AIO_DONE done, void* arg)
+{
+	AIO_OP* op;
+
+	op = new_op(aio, AIO_LOOKUP, parent, done, arg);
+	if (op == NULL)
+		return EXT2_ERROR;
+
+	op->retEntry = retEntry;
+	strncpy(op->name, entryName, MAX_NAME_LENGTH - 1);
+
+	// ĳÿ  helper ġ ʰ ٷ Ϸ
+	if (ext2_lookup_cached(parent, op->name, retEntry) == EXT2_SUCCESS)
+	{
+		op->result = EXT2_SUCCESS;
+		post_done(op);
+	}
+	else
+		post_job(op);
+
+	return EXT2_SUCCESS;
+}
+
+/*  ۾ callback ȣ, wait̸ ϳ    */
+/* return : ȣ callback ,  ۾  0 */
+int ext2_aio_poll(EXT2_AIO* aio, int wait)
+{
+	AIO_OP* list;
+	AIO_OP* op;
+	int count = 0;
+
+	pthread_mutex_lock(&aio->lock);
+	if (wait)
+	{
+		while (aio->doneHead == NULL && aio->outstanding > 0)
+			pthread_cond_wait(&aio->done, &aio->lock);
+	}
+	list = aio->doneHead;
+	aio->doneHead = NULL;
+	aio->doneTail = NULL;
+	for (op = list; op != NULL; op = op->next)
+		count++;
+	aio->outstanding -= count;
+	pthread_mutex_unlock(&aio->lock);
+
+	while (list != NULL)
+	{
+		op = list;
+		list = op->next;
+		if (op->done)
+			op->done(op->arg, op->result);
+		free(op);
+	}
+
+	return count;
+}
@@ -0,0 +1,1764 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "ext2.h"
+#include "disk.h"
+#include "disksim.h"
+#include "diskfile.h"
+#include "shell.h"
+
+/* ext2 benchmark driver : runs the named workloads against a memory disk
+ * and prints one "key=value" line per result to stdout. Diagnostics that
+ * ext2.c prints are sent to /dev/null so they do not distort timings.
+ * A workload takes parameters as "name:key=value,key=value", list values
+ * are separated by '/', e.g. "seqio:mb=32,io=4096/65536". */
+
+#define BENCH_SECTOR_SIZE		512
+#define BENCH_MAX_LIST			16
+#define BENCH_IMAGE				"bench.img"	/* image file of workloads run with file=1 */
+
+typedef struct
+{
+	const char*	name;
+	int			( *run )( void );
+	const char*	help;
+} BENCH_WORKLOAD;
+
+static FILE*			g_out;			/* result stream */
+static unsigned long	g_sectorReads;
+static unsigned long	g_sectorWrites;
+static unsigned long	g_writeSeeks;	/* writes not following the previous written sector */
+static SECTOR			g_lastWrite;
+static int				( *g_readSector )( DISK_OPERATIONS*, SECTOR, void* );
+static int				( *g_writeSector )( DISK_OPERATIONS*, SECTOR, const void* );
+static const char*		g_params;		/* "key=value,..." of the running workload, NULL : defaults */
+
+/* one measured run : per operation latencies and the sector I/O it did */
+typedef struct
+{
+	double*			samples;		/* ns */
+	unsigned int	count;
+	unsigned int	size;
+	unsigned long	sectorReads;	/* counters when the run began */
+	unsigned long	sectorWrites;
+	double			start;
+} BENCH_RUN;
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( double )ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int count_read( DISK_OPERATIONS* disk, SECTOR sector, void* data )
+{
+	__atomic_fetch_add( &g_sectorReads, 1, __ATOMIC_RELAXED ); /* check workers read concurrently */
+	return g_readSector( disk, sector, data );
+}
+
+static int count_write( DISK_OPERATIONS* disk, SECTOR sector, const void* data )
+{
+	__atomic_fetch_add( &g_sectorWrites, 1, __ATOMIC_RELAXED );
+	if( __atomic_exchange_n( &g_lastWrite, sector, __ATOMIC_RELAXED ) + 1 != sector )
+		__atomic_fetch_add( &g_writeSeeks, 1, __ATOMIC_RELAXED );
+	return g_writeSector( disk, sector, data );
+}
+
+static void count_disk( DISK_OPERATIONS* disk )
+{
+	g_readSector = disk->read_sector;
+	g_writeSector = disk->write_sector;
+	disk->read_sector = count_read;
+	disk->write_sector = count_write;
+}
+
+/* memory disk of the given size whose sector I/O is counted */
+static int open_disk( unsigned int megaBytes, DISK_OPERATIONS* disk )
+{
+	if( disksim_init( ( SECTOR )megaBytes * ( 1024 * 1024 / BENCH_SECTOR_SIZE ), BENCH_SECTOR_SIZE, disk ) < 0 )
+		return -1;
+
+	count_disk( disk );
+	return 0;
+}
+
+/* disk on the image file BENCH_IMAGE when file=1, otherwise a memory disk */
+static int open_disk_backend( unsigned int megaBytes, int file, DISK_OPERATIONS* disk )
+{
+	if( !file )
+		return open_disk( megaBytes, disk );
+
+	unlink( BENCH_IMAGE );
+	if( diskfile_init( BENCH_IMAGE, ( SECTOR )megaBytes * ( 1024 * 1024 / BENCH_SECTOR_SIZE ), BENCH_SECTOR_SIZE, disk ) < 0 )
+		return -1;
+
+	count_disk( disk );
+	return 0;
+}
+
+static void close_disk_backend( int file, DISK_OPERATIONS* disk )
+{
+	if( !file )
+	{
+		disksim_uninit( disk );
+		return;
+	}
+
+	diskfile_uninit( disk );
+	unlink( BENCH_IMAGE );
+}
+
+static int format_disk( DISK_OPERATIONS* disk, UINT32 logBlockSize, UINT32 sparseSuper, UINT32 journalBlocks )
+{
+	EXT2_FORMAT_OPTION option;
+
+	ZeroMemory( &option, sizeof( option ) );
+	option.logBlockSize = logBlockSize;
+	option.sparseSuper = sparseSuper;
+	option.journalBlocks = journalBlocks;
+
+	return ext2_format( disk, &option );
+}
+
+/* value of key in the workload parameters */
+static const char* find_param( const char* key )
+{
+	const char* p = g_params;
+	size_t length = strlen( key );
+
+	while( p != NULL && *p )
+	{
+		if( strncmp( p, key, length ) == 0 && p[length] == '=' )
+			return p + length + 1;
+		p = strchr( p, ',' );
+		if( p )
+			p++;
+	}
+
+	return NULL;
+}
+
+static unsigned long param( const char* key, unsigned long value )
+{
+	const char* p = find_param( key );
+
+	return p ? strtoul( p, NULL, 0 ) : value;
+}
+
+/* '/' separated list, the defaults when the parameter is not given */
+static unsigned int param_list( const char* key, const unsigned long* values, unsigned int count, unsigned long* list )
+{
+	const char* p = find_param( key );
+	char* end;
+	unsigned int i;
+
+	if( p == NULL )
+	{
+		for( i = 0; i < count; i++ )
+			list[i] = values[i];
+		return count;
+	}
+
+	for( i = 0; i < BENCH_MAX_LIST; )
+	{
+		list[i++] = strtoul( p, &end, 0 );
+		if( *end != '/' )
+			break;
+		p = end + 1;
+	}
+
+	return i;
+}
+
+static int run_begin( BENCH_RUN* run, unsigned int ops )
+{
+	run->samples = ( double* )malloc( sizeof( double ) * ( ops ? ops : 1 ) );
+	if( run->samples == NULL )
+		return -1;
+
+	run->count = 0;
+	run->size = ops;
+	run->sectorReads = g_sectorReads;
+	run->sectorWrites = g_sectorWrites;
+	run->start = now_ns();
+
+	return 0;
+}
+
+static void run_sample( BENCH_RUN* run, double opStart )
+{
+	if( run->count < run->size )
+		run->samples[run->count++] = now_ns() - opStart;
+}
+
+static int compare_sample( const void* a, const void* b )
+{
+	double x = *( const double* )a, y = *( const double* )b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double percentile( const BENCH_RUN* run, double p )
+{
+	unsigned int rank;
+
+	if( run->count == 0 )
+		return 0;
+
+	rank = ( unsigned int )( p / 100 * run->count + 0.999999 );
+	return run->samples[( rank ? rank : 1 ) - 1];
+}
+
+/* "bench=<name> <params> ops=.. ops_per_s=.. p50_us=.. ... sector_writes=.." */
+static void run_report( BENCH_RUN* run, const char* name, const char* params )
+{
+	double elapsed = now_ns() - run->start;
+
+	qsort( run->samples, run->count, sizeof( double ), compare_sample );
+	fprintf( g_out, "bench=%s %s ops=%u ops_per_s=%.0f p50_us=%.3f p90_us=%.3f p99_us=%.3f max_us=%.3f "
+		"sector_reads=%lu sector_writes=%lu\n",
+		name, params, run->count, run->count / ( elapsed / 1e9 ),
+		percentile( run, 50 ) / 1e3, percentile( run, 90 ) / 1e3, percentile( run, 99 ) / 1e3, percentile( run, 100 ) / 1e3,
+		g_sectorReads - run->sectorReads, g_sectorWrites - run->sectorWrites );
+
+	free( run->samples );
+	run->samples = NULL;
+}
+
+static int mount_disk( DISK_OPERATIONS* disk, EXT2_FILESYSTEM* fs, EXT2_NODE* root )
+{
+	ZeroMemory( fs, sizeof( EXT2_FILESYSTEM ) );
+	fs->disk = disk;
+
+	return ext2_read_superblock( fs, root );
+}
+
+/* format then mount/umount repeatedly */
+static int bench_mount( void )
+{
+	static const unsigned int sizes[] = { 512, 2048 };
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	unsigned int i, s, rounds = 200;
+	unsigned long reads;
+	double start, elapsed;
+
+	for( s = 0; s < sizeof( sizes ) / sizeof( sizes[0] ); s++ )
+	{
+		if( open_disk( sizes[s], &disk ) < 0 || format_disk( &disk, 0, 0, 0 ) != EXT2_SUCCESS )
+			return -1;
+
+		g_sectorReads = 0;
+		start = now_ns();
+		for( i = 0; i < rounds; i++ )
+		{
+			ZeroMemory( &fs, sizeof( fs ) );
+			fs.disk = &disk;
+			if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+				return -1;
+			ext2_umount( &fs );
+		}
+		elapsed = now_ns() - start;
+		reads = g_sectorReads;
+
+		fprintf( g_out, "bench=mount size_mb=%u groups=%u rounds=%u us_per_op=%.2f sector_reads_per_op=%.1f\n",
+			sizes[s], fs.sb_info.groupCount, rounds, elapsed / rounds / 1e3, ( double )reads / rounds );
+
+		disksim_uninit( &disk );
+	}
+
+	return 0;
+}
+
+/* inode number -> inode table block, block number -> (group, offset) */
+static int bench_translate( void )
+{
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	EXT2_DIR_ENTRY_LOCATION location;
+	UINT32 i, block, inodeCount, blockCount, group;
+	UINT32 rounds = 20;
+	UINT64 sum = 0;
+	double start, elapsed;
+	UINT32 r;
+
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+		return -1;
+
+	ZeroMemory( &fs, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	inodeCount = fs.sb.inodeCount;
+	blockCount = fs.sb.blockCount;
+
+	start = now_ns();
+	for( r = 0; r < rounds; r++ )
+	{
+		for( i = 1; i <= inodeCount; i++ )
+		{
+			get_block_of_inode( &fs, i, &block );
+			sum += block;
+		}
+	}
+	elapsed = now_ns() - start;
+	fprintf( g_out, "bench=translate op=get_block_of_inode ops=%lu ns_per_op=%.2f\n",
+		( unsigned long )inodeCount * rounds, elapsed / ( ( double )inodeCount * rounds ) );
+
+	start = now_ns();
+	for( r = 0; r < rounds; r++ )
+	{
+		for( i = fs.sb.firstDataBlock; i < blockCount; i++ )
+		{
+			get_location_of_block( &fs, i, &location );
+			sum += location.group + location.block;
+		}
+	}
+	elapsed = now_ns() - start;
+	fprintf( g_out, "bench=translate op=get_location_of_block ops=%lu ns_per_op=%.2f\n",
+		( unsigned long )( blockCount - fs.sb.firstDataBlock ) * rounds, elapsed / ( ( double )( blockCount - fs.sb.firstDataBlock ) * rounds ) );
+
+	start = now_ns();
+	for( r = 0; r < rounds; r++ )
+	{
+		for( i = fs.sb.firstDataBlock; i < blockCount; i++ )
+		{
+			get_group_of_block( &fs, i, &group );
+			sum += group;
+		}
+	}
+	elapsed = now_ns() - start;
+	fprintf( g_out, "bench=translate op=get_group_of_block ops=%lu ns_per_op=%.2f\n",
+		( unsigned long )( blockCount - fs.sb.firstDataBlock ) * rounds, elapsed / ( ( double )( blockCount - fs.sb.firstDataBlock ) * rounds ) );
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return sum == 0;
+}
+
+/* create many files in one directory, with and without the metadata journal */
+static int bench_create( void )
+{
+	static const UINT32 journals[] = { 0, 1024 };
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i, j, files = 2000;
+	unsigned long writes, seeks;
+	double start, elapsed;
+
+	for( j = 0; j < sizeof( journals ) / sizeof( journals[0] ); j++ )
+	{
+		if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, journals[j] ) != EXT2_SUCCESS )
+			return -1;
+
+		ZeroMemory( &fs, sizeof( fs ) );
+		fs.disk = &disk;
+		if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+			return -1;
+
+		g_sectorWrites = g_writeSeeks = 0;
+		start = now_ns();
+		for( i = 0; i < files; i++ )
+		{
+			sprintf( name, "f%u", i );
+			if( ext2_create( &root, name, &node ) != EXT2_SUCCESS )
+				return -1;
+		}
+		elapsed = now_ns() - start;
+		writes = g_sectorWrites;
+		seeks = g_writeSeeks;
+
+		ext2_umount( &fs ); /* journal : remaining checkpoint */
+
+		fprintf( g_out, "bench=create journal_blocks=%u files=%u us_per_op=%.2f sector_writes_per_op=%.2f "
+			"write_seeks_per_op=%.2f sector_writes_with_umount=%lu write_seeks_with_umount=%lu\n",
+			journals[j], files, elapsed / files / 1e3, ( double )writes / files, ( double )seeks / files,
+			g_sectorWrites, g_writeSeeks );
+
+		disksim_uninit( &disk );
+	}
+
+	return 0;
+}
+
+/* mount after a crash that left open, removed files : only the orphan list is processed */
+static int bench_orphan( void )
+{
+	static const unsigned int sizes[] = { 512, 2048 };
+	static char data[64 * 1024];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i, s, files = 100;
+	unsigned long reads, writes;
+	double start, elapsed;
+
+	for( s = 0; s < sizeof( sizes ) / sizeof( sizes[0] ); s++ )
+	{
+		if( open_disk( sizes[s], &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+			return -1;
+
+		ZeroMemory( &fs, sizeof( fs ) );
+		fs.disk = &disk;
+		if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+			return -1;
+
+		for( i = 0; i < files; i++ )
+		{
+			sprintf( name, "o%u", i );
+			if( ext2_create( &root, name, &node ) != EXT2_SUCCESS ||
+				ext2_write( &node, 0, sizeof( data ), data ) != sizeof( data ) ||
+				ext2_open( &node ) != EXT2_SUCCESS || ext2_remove( &node ) != EXT2_SUCCESS )
+				return -1;
+		}
+
+		/* crash : drop the in-memory state without umount */
+		free( fs.openInodes );
+		release_cache( &fs );
+		release_locks( &fs );
+		release_bitmap_summary( &fs );
+		release_group_base( &fs );
+
+		g_sectorReads = g_sectorWrites = 0;
+		ZeroMemory( &fs, sizeof( fs ) );
+		fs.disk = &disk;
+		start = now_ns();
+		if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS || fs.sb.orphanList != 0 )
+			return -1;
+		elapsed = now_ns() - start;
+		reads = g_sectorReads;
+		writes = g_sectorWrites;
+
+		fprintf( g_out, "bench=orphan size_mb=%u groups=%u orphans=%u mount_us=%.2f sector_reads=%lu sector_writes=%lu\n",
+			sizes[s], fs.sb_info.groupCount, files, elapsed / 1e3, reads, writes );
+
+		ext2_umount( &fs );
+		disksim_uninit( &disk );
+	}
+
+	return 0;
+}
+
+/* consistency check of a 2GB volume with files, 1 to 4 workers */
+static int bench_check( void )
+{
+	static char data[64 * 1024];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	EXT2_CHECK_REPORT report;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i, threads, files = 1000;
+	double start, elapsed;
+
+	if( open_disk( 2048, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+		return -1;
+
+	ZeroMemory( &fs, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	for( i = 0; i < files; i++ )
+	{
+		sprintf( name, "c%u", i );
+		if( ext2_create( &root, name, &node ) != EXT2_SUCCESS ||
+			ext2_write( &node, 0, sizeof( data ), data ) != sizeof( data ) )
+			return -1;
+	}
+
+	for( threads = 1; threads <= 4; threads *= 2 )
+	{
+		g_sectorReads = 0;
+		start = now_ns();
+		if( ext2_check( &fs, threads, &report ) != EXT2_SUCCESS || report.errors != 0 )
+			return -1;
+		elapsed = now_ns() - start;
+
+		fprintf( g_out, "bench=check size_mb=2048 groups=%u files=%u threads=%u ms=%.2f sector_reads=%lu\n",
+			fs.sb_info.groupCount, files, threads, elapsed / 1e6, g_sectorReads );
+	}
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+/* files created and written by each thread of bench_parallel */
+typedef struct
+{
+	EXT2_NODE*		root;
+	unsigned int	id;
+	unsigned int	files;
+	int				result;
+} PARALLEL_WORKER;
+
+static void* parallel_worker( void* arg )
+{
+	static char data[16 * 1024];
+	PARALLEL_WORKER* worker = ( PARALLEL_WORKER* )arg;
+	EXT2_NODE node;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i;
+
+	for( i = 0; i < worker->files; i++ )
+	{
+		sprintf( name, "p%ux%u", worker->id, i );
+		if( ext2_create( worker->root, name, &node ) != EXT2_SUCCESS ||
+			ext2_write( &node, 0, sizeof( data ), data ) != sizeof( data ) )
+		{
+			worker->result = -1;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* create and write 16KB files from 1, 2 and 4 threads at once, then check the volume */
+static int bench_parallel( void )
+{
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	EXT2_CHECK_REPORT report;
+	PARALLEL_WORKER workers[4];
+	pthread_t threads[4];
+	unsigned int i, count, files = 2000;
+	double start, elapsed;
+
+	for( count = 1; count <= 4; count *= 2 )
+	{
+		if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+			return -1;
+
+		ZeroMemory( &fs, sizeof( fs ) );
+		fs.disk = &disk;
+		if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+			return -1;
+
+		g_sectorWrites = 0;
+		start = now_ns();
+		for( i = 0; i < count; i++ )
+		{
+			workers[i].root = &root;
+			workers[i].id = i;
+			workers[i].files = files / count;
+			workers[i].result = 0;
+			if( pthread_create( &threads[i], NULL, parallel_worker, &workers[i] ) != 0 )
+				return -1;
+		}
+		for( i = 0; i < count; i++ )
+			pthread_join( threads[i], NULL );
+		elapsed = now_ns() - start;
+
+		for( i = 0; i < count; i++ )
+		{
+			if( workers[i].result != 0 )
+				return -1;
+		}
+
+		if( ext2_check( &fs, 1, &report ) != EXT2_SUCCESS || report.errors != 0 )
+			return -1;
+
+		fprintf( g_out, "bench=parallel threads=%u files=%u us_per_op=%.2f sector_writes_per_op=%.2f\n",
+			count, files, elapsed / files / 1e3, ( double )g_sectorWrites / files );
+
+		ext2_umount( &fs );
+		disksim_uninit( &disk );
+	}
+
+	return 0;
+}
+
+/* names looked up by each thread of bench_lookup */
+typedef struct
+{
+	EXT2_NODE*		root;
+	unsigned int	id;
+	unsigned int	files;
+	unsigned int	lookups;
+	int				result;
+} LOOKUP_WORKER;
+
+static void* lookup_worker( void* arg )
+{
+	LOOKUP_WORKER* worker = ( LOOKUP_WORKER* )arg;
+	EXT2_NODE node;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i;
+
+	for( i = 0; i < worker->lookups; i++ )
+	{
+		sprintf( name, "l%u", ( i * 7919 + worker->id * 131 ) % worker->files );
+		if( ext2_lookup( worker->root, name, &node ) != EXT2_SUCCESS )
+		{
+			worker->result = -1;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* look up names of one directory from 1, 2 and 4 threads, without and with the lookup cache */
+static int bench_lookup( void )
+{
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	LOOKUP_WORKER workers[4];
+	pthread_t threads[4];
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i, count, cache, files = 1000, lookups = 200000;
+	double start, elapsed;
+
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+		return -1;
+
+	ZeroMemory( &fs, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	for( i = 0; i < files; i++ )
+	{
+		sprintf( name, "l%u", i );
+		if( ext2_create( &root, name, &node ) != EXT2_SUCCESS )
+			return -1;
+	}
+
+	for( cache = 0; cache <= 1; cache++ )
+	{
+		if( cache ? init_cache( &fs ) != EXT2_SUCCESS : ( release_cache( &fs ), 0 ) )
+			return -1;
+
+		for( count = 1; count <= 4; count *= 2 )
+		{
+			g_sectorReads = 0;
+			start = now_ns();
+			for( i = 0; i < count; i++ )
+			{
+				workers[i].root = &root;
+				workers[i].id = i;
+				workers[i].files = files;
+				workers[i].lookups = lookups / count;
+				workers[i].result = 0;
+				if( pthread_create( &threads[i], NULL, lookup_worker, &workers[i] ) != 0 )
+					return -1;
+			}
+			for( i = 0; i < count; i++ )
+				pthread_join( threads[i], NULL );
+			elapsed = now_ns() - start;
+
+			for( i = 0; i < count; i++ )
+			{
+				if( workers[i].result != 0 )
+					return -1;
+			}
+
+			fprintf( g_out, "bench=lookup cache=%u threads=%u lookups=%u us_per_op=%.3f lookups_per_s=%.0f sector_reads_per_op=%.2f\n",
+				cache, count, lookups, elapsed / lookups / 1e3, lookups / ( elapsed / 1e9 ), ( double )g_sectorReads / lookups );
+		}
+	}
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+static int count_entry( const EXT2_WALK_ENTRY* entry, void* arg )
+{
+	( ( unsigned long* )arg )[entry->worker * 8]++; /* one cache line per worker */
+	return EXT2_SUCCESS;
+}
+
+/* walk a tree of 32 x 8 directories with 50 files each from 1, 2 and 4 threads */
+static int bench_walk( void )
+{
+	static unsigned long counts[EXT2_WALK_MAX_THREADS * 8];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, top, dir, node;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i, j, k, count, entries = 0;
+	unsigned long visited;
+	double start, elapsed;
+
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+		return -1;
+
+	ZeroMemory( &fs, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	for( i = 0; i < 32; i++ )
+	{
+		sprintf( name, "t%u", i );
+		if( ext2_mkdir( &root, name, &top ) != EXT2_SUCCESS )
+			return -1;
+		entries++;
+		for( j = 0; j < 8; j++ )
+		{
+			sprintf( name, "d%u", j );
+			if( ext2_mkdir( &top, name, &dir ) != EXT2_SUCCESS )
+				return -1;
+			entries++;
+			for( k = 0; k < 50; k++ )
+			{
+				sprintf( name, "f%u", k );
+				if( ext2_create( &dir, name, &node ) != EXT2_SUCCESS )
+					return -1;
+				entries++;
+			}
+		}
+	}
+
+	for( count = 1; count <= 4; count *= 2 )
+	{
+		/* start every run with empty lookup caches */
+		if( init_cache( &fs ) != EXT2_SUCCESS )
+			return -1;
+
+		ZeroMemory( counts, sizeof( counts ) );
+		g_sectorReads = 0;
+		start = now_ns();
+		if( ext2_walk( &root, count, count_entry, counts ) != EXT2_SUCCESS )
+			return -1;
+		elapsed = now_ns() - start;
+
+		for( visited = 0, i = 0; i < EXT2_WALK_MAX_THREADS; i++ )
+			visited += counts[i * 8];
+		if( visited != entries )
+			return -1;
+
+		fprintf( g_out, "bench=walk threads=%u entries=%u ms=%.2f entries_per_s=%.0f sector_reads_per_entry=%.2f\n",
+			count, entries, elapsed / 1e6, entries / ( elapsed / 1e9 ), ( double )g_sectorReads / entries );
+	}
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+/* read a whole memory disk in 4KB requests, synchronously and through the
+ * submission queue with 1, 8 and 32 requests in flight */
+static int bench_queue( void )
+{
+	static const unsigned int depths[] = { 1, 8, 32 };
+	static DISK_REQUEST requests[32];
+	DISK_REQUEST* batch[32];
+	DISK_REQUEST* done[32];
+	DISK_OPERATIONS disk;
+	char* buffer;
+	SECTOR sector, next;
+	unsigned int d, depth, i, inflight;
+	int count;
+	double start, elapsed;
+
+	if( open_disk( 64, &disk ) < 0 )
+		return -1;
+
+	buffer = ( char* )malloc( sizeof( requests ) / sizeof( requests[0] ) * 8 * BENCH_SECTOR_SIZE );
+	if( buffer == NULL )
+		return -1;
+
+	g_sectorReads = 0;
+	start = now_ns();
+	for( sector = 0; sector < disk.numberOfSectors; sector++ )
+	{
+		if( disk.read_sector( &disk, sector, buffer ) < 0 )
+			return -1;
+	}
+	elapsed = now_ns() - start;
+
+	fprintf( g_out, "bench=queue depth=sync ms=%.2f mb_per_s=%.1f sector_reads=%lu\n",
+		elapsed / 1e6, disk.numberOfSectors * ( double )BENCH_SECTOR_SIZE / ( 1024 * 1024 ) / ( elapsed / 1e9 ), g_sectorReads );
+
+	for( d = 0; d < sizeof( depths ) / sizeof( depths[0] ); d++ )
+	{
+		depth = depths[d];
+		for( i = 0; i < depth; i++ )
+		{
+			requests[i].opcode = DISK_READ;
+			requests[i].count = 8;
+			requests[i].data = buffer + ( size_t )i * 8 * BENCH_SECTOR_SIZE;
+		}
+
+		g_sectorReads = 0;
+		next = 0;
+		inflight = 0;
+		count = depth;
+		for( i = 0; i < depth; i++ )
+			done[i] = &requests[i];
+
+		start = now_ns();
+		for( ;; )
+		{
+			/* resubmit every finished slot at the next 4KB */
+			for( i = 0; i < ( unsigned int )count; i++ )
+			{
+				if( done[i]->result != 0 )
+					return -1;
+				if( next >= disk.numberOfSectors )
+					continue;
+				done[i]->sector = next;
+				next += 8;
+				batch[inflight++] = done[i];
+			}
+
+			if( inflight > 0 && disk.submit( &disk, batch, inflight ) < 0 )
+				return -1;
+			inflight = 0;
+
+			count = disk.complete( &disk, done, depth, 1 );
+			if( count <= 0 )
+				break;
+		}
+		elapsed = now_ns() - start;
+
+		if( g_sectorReads != disk.numberOfSectors )
+			return -1;
+
+		fprintf( g_out, "bench=queue depth=%u ms=%.2f mb_per_s=%.1f sector_reads=%lu\n",
+			depth, elapsed / 1e6, disk.numberOfSectors * ( double )BENCH_SECTOR_SIZE / ( 1024 * 1024 ) / ( elapsed / 1e9 ), g_sectorReads );
+	}
+
+	free( buffer );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+static void count_done( void* arg, int result )
+{
+	if( result != ( int )( 16 * 1024 - 100 ) )
+		( ( unsigned int* )arg )[1]++;
+	( ( unsigned int* )arg )[0]++;
+}
+
+/* read 512 files of 16KB from one thread, one read at a time with ext2_read
+ * and all at once through the asynchronous API */
+static int bench_aio( void )
+{
+	static EXT2_NODE nodes[512];
+	static char data[16 * 1024];
+	static char buffers[512][16 * 1024];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	EXT2_AIO* aio;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i, j, files = 512, length = 16 * 1024 - 100, counts[2];
+	double start, elapsed;
+
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+		return -1;
+
+	ZeroMemory( &fs, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	for( i = 0; i < files; i++ )
+	{
+		for( j = 0; j < sizeof( data ); j++ )
+			data[j] = ( char )( i * 7 + j );
+		sprintf( name, "a%u", i );
+		if( ext2_create( &root, name, &nodes[i] ) != EXT2_SUCCESS ||
+			ext2_write( &nodes[i], 0, sizeof( data ), data ) != sizeof( data ) )
+			return -1;
+	}
+
+	/* the read starts and ends inside a block */
+	g_sectorReads = 0;
+	start = now_ns();
+	for( i = 0; i < files; i++ )
+	{
+		if( ext2_read( &nodes[i], 100, length, buffers[i] ) != ( int )length )
+			return -1;
+	}
+	elapsed = now_ns() - start;
+
+	fprintf( g_out, "bench=aio mode=sync files=%u ms=%.2f reads_per_s=%.0f sector_reads=%lu\n",
+		files, elapsed / 1e6, files / ( elapsed / 1e9 ), g_sectorReads );
+
+	aio = ext2_aio_create( &fs, 0 );
+	if( aio == NULL )
+		return -1;
+
+	ZeroMemory( buffers, sizeof( buffers ) );
+	ZeroMemory( counts, sizeof( counts ) );
+	g_sectorReads = 0;
+	start = now_ns();
+	for( i = 0; i < files; i++ )
+	{
+		if( ext2_aio_read( aio, &nodes[i], 100, length, buffers[i], count_done, counts ) != EXT2_SUCCESS )
+			return -1;
+	}
+	while( ext2_aio_poll( aio, 1 ) > 0 )
+		;
+	elapsed = now_ns() - start;
+	ext2_aio_destroy( aio );
+
+	if( counts[0] != files || counts[1] != 0 )
+		return -1;
+	for( i = 0; i < files; i++ )
+	{
+		for( j = 0; j < length; j++ )
+		{
+			if( buffers[i][j] != ( char )( i * 7 + j + 100 ) )
+				return -1;
+		}
+	}
+
+	fprintf( g_out, "bench=aio mode=async files=%u ms=%.2f reads_per_s=%.0f sector_reads=%lu\n",
+		files, elapsed / 1e6, files / ( elapsed / 1e9 ), g_sectorReads );
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+/* read and rewrite a 4MB file in 1KB pieces, by node and through a file handle */
+static int bench_handle( void )
+{
+	static char data[4 * 1024 * 1024];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	char buffer[1024];
+	unsigned long offset;
+	int fd, mode;
+	double start, readTime, writeTime;
+
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 2, 1, 0 ) != EXT2_SUCCESS )
+		return -1;
+
+	ZeroMemory( &fs, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS ||
+		ext2_create( &root, "handle", &node ) != EXT2_SUCCESS ||
+		ext2_write( &node, 0, sizeof( data ), data ) != sizeof( data ) )
+		return -1;
+
+	for( mode = 0; mode <= 1; mode++ )
+	{
+		fd = mode ? ext2_file_open( &node ) : 0;
+		if( fd < 0 )
+			return -1;
+
+		g_sectorReads = 0;
+		start = now_ns();
+		for( offset = 0; offset < sizeof( data ); offset += sizeof( buffer ) )
+		{
+			if( ( mode ? ext2_file_read( &fs, fd, sizeof( buffer ), buffer ) : ext2_read( &node, offset, sizeof( buffer ), buffer ) ) != sizeof( buffer ) )
+				return -1;
+		}
+		readTime = now_ns() - start;
+
+		fprintf( g_out, "bench=handle mode=%s op=read ms=%.2f us_per_op=%.3f sector_reads=%lu\n",
+			mode ? "fd" : "node", readTime / 1e6, readTime / ( sizeof( data ) / sizeof( buffer ) ) / 1e3, g_sectorReads );
+
+		if( mode )
+			ext2_file_seek( &fs, fd, 0 );
+
+		g_sectorReads = 0;
+		g_sectorWrites = 0;
+		start = now_ns();
+		for( offset = 0; offset < sizeof( data ); offset += sizeof( buffer ) )
+		{
+			if( ( mode ? ext2_file_write( &fs, fd, sizeof( buffer ), buffer ) : ext2_write( &node, offset, sizeof( buffer ), buffer ) ) != sizeof( buffer ) )
+				return -1;
+		}
+		writeTime = now_ns() - start;
+
+		fprintf( g_out, "bench=handle mode=%s op=write ms=%.2f us_per_op=%.3f sector_reads=%lu sector_writes=%lu\n",
+			mode ? "fd" : "node", writeTime / 1e6, writeTime / ( sizeof( data ) / sizeof( buffer ) ) / 1e3, g_sectorReads, g_sectorWrites );
+
+		if( mode && ext2_file_close( &fs, fd ) != EXT2_SUCCESS )
+			return -1;
+	}
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+/* create N files in one directory */
+static int bench_files( void )
+{
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	BENCH_RUN run;
+	char name[MAX_ENTRY_NAME_LENGTH], params[64];
+	unsigned int i, files = param( "files", 2000 );
+	double start;
+
+	if( open_disk( param( "mb", 512 ), &disk ) < 0 || format_disk( &disk, 0, 1, param( "journal", 0 ) ) != EXT2_SUCCESS ||
+		mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS || run_begin( &run, files ) < 0 )
+		return -1;
+
+	for( i = 0; i < files; i++ )
+	{
+		sprintf( name, "f%u", i );
+		start = now_ns();
+		if( ext2_create( &root, name, &node ) != EXT2_SUCCESS )
+			return -1;
+		run_sample( &run, start );
+	}
+
+	sprintf( params, "op=create files=%u journal_blocks=%lu", files, param( "journal", 0 ) );
+	run_report( &run, "files", params );
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+static int make_tree( EXT2_NODE* parent, unsigned int depth, unsigned int width, BENCH_RUN* run )
+{
+	EXT2_NODE dir;
+	char name[MAX_ENTRY_NAME_LENGTH];
+	unsigned int i;
+	double start;
+
+	for( i = 0; i < width; i++ )
+	{
+		sprintf( name, "d%u", i );
+		start = now_ns();
+		if( ext2_mkdir( parent, name, &dir ) != EXT2_SUCCESS )
+			return -1;
+		run_sample( run, start );
+
+		if( depth > 1 && make_tree( &dir, depth - 1, width, run ) < 0 )
+			return -1;
+	}
+
+	return 0;
+}
+
+/* mkdir of a tree, width directories per level */
+static int bench_fanout( void )
+{
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	BENCH_RUN run;
+	char params[64];
+	unsigned int i, dirs = 0, level = 1;
+	unsigned int depth = param( "depth", 3 ), width = param( "width", 8 );
+
+	for( i = 0; i < depth; i++ )
+	{
+		level *= width;
+		dirs += level;
+	}
+
+	if( open_disk( param( "mb", 512 ), &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS ||
+		mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS || run_begin( &run, dirs ) < 0 )
+		return -1;
+
+	if( make_tree( &root, depth, width, &run ) < 0 )
+		return -1;
+
+	sprintf( params, "op=mkdir depth=%u width=%u", depth, width );
+	run_report( &run, "fanout", params );
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+/* lookups of names that exist and of names that do not */
+static int bench_hitmiss( void )
+{
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	BENCH_RUN run;
+	char name[MAX_ENTRY_NAME_LENGTH], params[64];
+	unsigned int i, miss, files = param( "files", 1000 ), lookups = param( "lookups", 20000 );
+	double start;
+
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS ||
+		mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	for( i = 0; i < files; i++ )
+	{
+		sprintf( name, "h%u", i );
+		if( ext2_create( &root, name, &node ) != EXT2_SUCCESS )
+			return -1;
+	}
+
+	if( !param( "cache", 1 ) )
+		release_cache( &fs );
+
+	for( miss = 0; miss <= 1; miss++ )
+	{
+		if( run_begin( &run, lookups ) < 0 )
+			return -1;
+
+		for( i = 0; i < lookups; i++ )
+		{
+			sprintf( name, miss ? "m%u" : "h%u", ( i * 7919 ) % files );
+			start = now_ns();
+			if( ( ext2_lookup( &root, name, &node ) == EXT2_SUCCESS ) == miss )
+				return -1;
+			run_sample( &run, start );
+		}
+
+		sprintf( params, "op=%s files=%u cache=%lu", miss ? "miss" : "hit", files, param( "cache", 1 ) );
+		run_report( &run, "hitmiss", params );
+	}
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+/* write then read a file in io sized pieces, in order or at random aligned offsets */
+static int file_io( const char* name, int random )
+{
+	static const unsigned long defaults[] = { 4096, 65536, 1048576 };
+	unsigned long sizes[BENCH_MAX_LIST];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, node;
+	BENCH_RUN run;
+	char fileName[MAX_ENTRY_NAME_LENGTH], params[96];
+	char* buffer;
+	unsigned long fileSize = param( "mb", 16 ) * 1024 * 1024, offset;
+	unsigned int s, count, i, ops, write;
+	double start;
+
+	count = param_list( "io", defaults, sizeof( defaults ) / sizeof( defaults[0] ), sizes );
+	srand( 1 );
+
+	for( s = 0; s < count; s++ )
+	{
+		if( sizes[s] == 0 || sizes[s] > fileSize )
+			return -1;
+
+		buffer = ( char* )malloc( sizes[s] );
+		if( buffer == NULL || open_disk( param( "disk_mb", 512 ), &disk ) < 0 ||
+			format_disk( &disk, param( "log_block", 2 ), 1, param( "journal", 0 ) ) != EXT2_SUCCESS ||
+			mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS )
+			return -1;
+
+		memset( buffer, 'b', sizes[s] );
+		sprintf( fileName, "io%u", s );
+		if( ext2_create( &root, fileName, &node ) != EXT2_SUCCESS )
+			return -1;
+
+		/* random I/O runs on a file written in full beforehand */
+		if( random )
+		{
+			for( offset = 0; offset < fileSize; offset += sizes[s] )
+			{
+				if( ext2_write( &node, offset, sizes[s], buffer ) != ( int )sizes[s] )
+					return -1;
+			}
+		}
+
+		ops = random ? param( "ops", 1000 ) : fileSize / sizes[s];
+		for( write = 1; ; write = 0 )
+		{
+			if( run_begin( &run, ops ) < 0 )
+				return -1;
+
+			for( i = 0; i < ops; i++ )
+			{
+				offset = random ? ( unsigned long )( rand() % ( fileSize / sizes[s] ) ) * sizes[s] : ( unsigned long )i * sizes[s];
+				start = now_ns();
+				if( ( write ? ext2_write( &node, offset, sizes[s], buffer ) : ext2_read( &node, offset, sizes[s], buffer ) ) != ( int )sizes[s] )
+					return -1;
+				run_sample( &run, start );
+			}
+
+			sprintf( params, "op=%s io_bytes=%lu file_mb=%lu mb_per_s=%.1f", write ? "write" : "read", sizes[s], fileSize >> 20,
+				( double )ops * sizes[s] / ( 1024 * 1024 ) / ( ( now_ns() - run.start ) / 1e9 ) );
+			run_report( &run, name, params );
+
+			if( !write )
+				break;
+		}
+
+		ext2_umount( &fs );
+		disksim_uninit( &disk );
+		free( buffer );
+	}
+
+	return 0;
+}
+
+static int bench_seqio( void )
+{
+	return file_io( "seqio", 0 );
+}
+
+static int bench_randio( void )
+{
+	return file_io( "randio", 1 );
+}
+
+static int count_dir_entry( EXT2_FILESYSTEM* fs, void* list, EXT2_NODE* entry )
+{
+	( *( unsigned long* )list )++;
+	return EXT2_SUCCESS;
+}
+
+/* read_dir of directories with entries files each */
+static int bench_readdir( void )
+{
+	static const unsigned long defaults[] = { 100, 1000, 5000 };
+	unsigned long sizes[BENCH_MAX_LIST];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, dir, node;
+	BENCH_RUN run;
+	char name[MAX_ENTRY_NAME_LENGTH], params[64];
+	unsigned int s, count, i, rounds = param( "rounds", 20 );
+	unsigned long entries;
+	double start;
+
+	count = param_list( "entries", defaults, sizeof( defaults ) / sizeof( defaults[0] ), sizes );
+
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS ||
+		mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	for( s = 0; s < count; s++ )
+	{
+		sprintf( name, "r%u", s );
+		if( ext2_mkdir( &root, name, &dir ) != EXT2_SUCCESS )
+			return -1;
+
+		for( i = 0; i < sizes[s]; i++ )
+		{
+			sprintf( name, "e%u", i );
+			if( ext2_create( &dir, name, &node ) != EXT2_SUCCESS )
+				return -1;
+		}
+
+		if( run_begin( &run, rounds ) < 0 )
+			return -1;
+
+		for( i = 0; i < rounds; i++ )
+		{
+			entries = 0;
+			start = now_ns();
+			if( ext2_read_dir( &dir, count_dir_entry, &entries ) != EXT2_SUCCESS || entries < sizes[s] )
+				return -1;
+			run_sample( &run, start );
+		}
+
+		sprintf( params, "op=read_dir entries=%lu entries_per_s=%.0f", sizes[s],
+			( double )rounds * sizes[s] / ( ( now_ns() - run.start ) / 1e9 ) );
+		run_report( &run, "readdir", params );
+	}
+
+	ext2_umount( &fs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+extern void shell_register_filesystem( SHELL_FILESYSTEM* );
+
+/* directory listing the way the shell does it : read_dir through the shell
+ * adapter into a SHELL_ENTRY_LIST, reporting the memory the list took.
+ * log=level sets g_logLevel for the run.
+ * debug logging is compiled out unless LOG_LEVEL_MAX is raised */
+static int bench_ls( void )
+{
+	static const unsigned long defaults[] = { 100, 1000, 5000 };
+	unsigned long sizes[BENCH_MAX_LIST];
+	DISK_OPERATIONS disk;
+	SHELL_FILESYSTEM shellFs;
+	SHELL_FS_OPERATIONS fsOprs;
+	SHELL_ENTRY root, dir, entry;
+	SHELL_ENTRY_LIST list;
+	BENCH_RUN run;
+	char name[MAX_ENTRY_NAME_LENGTH], params[128];
+	unsigned int s, count, i, rounds = param( "rounds", 20 );
+	int logLevel = g_logLevel;
+	unsigned long listBytes = 0;
+	double start;
+
+	count = param_list( "entries", defaults, sizeof( defaults ) / sizeof( defaults[0] ), sizes );
+
+	memset( &fsOprs, 0, sizeof( fsOprs ) );
+	shell_register_filesystem( &shellFs );
+	if( open_disk( 512, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS ||
+		shellFs.mount( &disk, &fsOprs, &root ) != EXT2_SUCCESS )
+		return -1;
+
+	g_logLevel = param( "log", LOG_LEVEL_INFO );
+	for( s = 0; s < count; s++ )
+	{
+		sprintf( name, "l%u", s );
+		if( fsOprs.mkdir( &disk, &fsOprs, &root, name, &dir ) != EXT2_SUCCESS )
+			return -1;
+
+		for( i = 0; i < sizes[s]; i++ )
+		{
+			sprintf( name, "e%u", i );
+			if( fsOprs.fileOprs->create( &disk, &fsOprs, &dir, name, &entry ) != EXT2_SUCCESS )
+				return -1;
+		}
+
+		if( run_begin( &run, rounds ) < 0 )
+			return -1;
+
+		for( i = 0; i < rounds; i++ )
+		{
+			init_entry_list( &list );
+			start = now_ns();
+			if( fsOprs.read_dir( &disk, &fsOprs, &dir, &list ) != EXT2_SUCCESS || list.count < sizes[s] )
+				return -1;
+			run_sample( &run, start );
+			listBytes = list.capacity * sizeof( SHELL_ENTRY_LIST_ITEM ) + list.namesSize;
+			release_entry_list( &list );
+		}
+
+		sprintf( params, "op=read_dir log=%d log_level_max=%d entries=%lu entries_per_s=%.0f list_bytes=%lu", g_logLevel,
+			LOG_LEVEL_MAX, sizes[s], ( double )rounds * sizes[s] / ( ( now_ns() - run.start ) / 1e9 ), listBytes );
+		run_report( &run, "ls", params );
+	}
+	g_logLevel = logLevel;
+
+	shellFs.umount( &disk, &fsOprs );
+	disksim_uninit( &disk );
+
+	return 0;
+}
+
+/* block I/O of one call against an upper bound, a failed bound makes the run fail */
+static EXT2_IO_STATS	g_budgetStart[EXT2_OP_COUNT];
+static int				g_budgetFailed;
+
+static void budget_begin( EXT2_FILESYSTEM* fs )
+{
+	ext2_io_stats( fs, g_budgetStart, 0 );
+}
+
+static void budget_check( EXT2_FILESYSTEM* fs, const char* name, int op, UINT64 maxReads, UINT64 maxWrites )
+{
+	EXT2_IO_STATS stats[EXT2_OP_COUNT];
+	UINT64 reads, writes;
+	int passed;
+
+	ext2_io_stats( fs, stats, 0 );
+	reads = stats[op].blockReads - g_budgetStart[op].blockReads;
+	writes = stats[op].blockWrites - g_budgetStart[op].blockWrites;
+	passed = reads <= maxReads && writes <= maxWrites;
+
+	fprintf( g_out, "bench=budget case=%s op=%s block_reads=%llu max_block_reads=%llu block_writes=%llu max_block_writes=%llu "
+		"sector_reads=%llu sector_writes=%llu result=%s\n",
+		name, ext2_op_name( op ), ( unsigned long long )reads, ( unsigned long long )maxReads,
+		( unsigned long long )writes, ( unsigned long long )maxWrites,
+		( unsigned long long )( stats[op].sectorReads - g_budgetStart[op].sectorReads ),
+		( unsigned long long )( stats[op].sectorWrites - g_budgetStart[op].sectorWrites ), passed ? "ok" : "over" );
+
+	if( !passed )
+		g_budgetFailed = 1;
+}
+
+/* upper bounds of the block I/O of single calls on a fresh 1KB block file system */
+static int bench_budget( void )
+{
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, dir, file, node;
+	char buffer[1024];
+	int cached;
+
+	g_budgetFailed = 0;
+	memset( buffer, 'g', sizeof( buffer ) );
+
+	if( open_disk( 64, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS )
+		return -1;
+
+	if( mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS )
+		return -1;
+	ZeroMemory( g_budgetStart, sizeof( g_budgetStart ) );	/* mount resets the counters */
+	budget_check( &fs, "mount", EXT2_OP_MOUNT, 2, 0 );
+
+	budget_begin( &fs );
+	if( ext2_create( &root, "file", &file ) != EXT2_SUCCESS )
+		return -1;
+	budget_check( &fs, "create_in_one_block_dir", EXT2_OP_CREATE, 10, 5 );
+
+	budget_begin( &fs );
+	if( ext2_mkdir( &root, "dir", &dir ) != EXT2_SUCCESS )
+		return -1;
+	budget_check( &fs, "mkdir", EXT2_OP_MKDIR, 25, 11 );
+
+	budget_begin( &fs );
+	if( ext2_write( &file, 0, sizeof( buffer ), buffer ) != sizeof( buffer ) )
+		return -1;
+	budget_check( &fs, "write_first_block", EXT2_OP_WRITE, 7, 6 );
+
+	budget_begin( &fs );
+	if( ext2_write( &file, 0, sizeof( buffer ), buffer ) != sizeof( buffer ) )
+		return -1;
+	budget_check( &fs, "overwrite_block", EXT2_OP_WRITE, 2, 3 );
+
+	budget_begin( &fs );
+	if( ext2_read( &file, 0, sizeof( buffer ), buffer ) != sizeof( buffer ) )
+		return -1;
+	budget_check( &fs, "read_block", EXT2_OP_READ, 1, 0 );
+
+	/* without the cache every lookup reads the directory inode and its block */
+	for( cached = 1; cached >= 0; cached-- )
+	{
+		if( !cached )
+			release_cache( &fs );
+
+		budget_begin( &fs );
+		if( ext2_lookup( &root, "file", &node ) != EXT2_SUCCESS )
+			return -1;
+		budget_check( &fs, cached ? "lookup_cached" : "lookup_one_block_dir", EXT2_OP_LOOKUP, cached ? 0 : 2, 0 );
+
+		budget_begin( &fs );
+		if( ext2_lookup( &root, "none", &node ) == EXT2_SUCCESS )
+			return -1;
+		budget_check( &fs, cached ? "lookup_miss_cached" : "lookup_miss_one_block_dir", EXT2_OP_LOOKUP, cached ? 1 : 2, 0 );
+	}
+
+	budget_begin( &fs );
+	if( ext2_remove( &file ) != EXT2_SUCCESS )
+		return -1;
+	budget_check( &fs, "remove_one_block_file", EXT2_OP_REMOVE, 17, 12 );
+
+	budget_begin( &fs );
+	if( ext2_rmdir( &dir ) != EXT2_SUCCESS )
+		return -1;
+	budget_check( &fs, "rmdir", EXT2_OP_RMDIR, 15, 8 );
+
+	budget_begin( &fs );
+	ext2_umount( &fs );
+	budget_check( &fs, "umount", EXT2_OP_UMOUNT, 0, 1 );
+
+	disksim_uninit( &disk );
+
+	return g_budgetFailed ? -1 : 0;
+}
+
+/* marks free blocks used directly in the bitmaps until perMille of the data
+ * blocks are used. uniform leaves the free blocks spread over every group,
+ * otherwise groups are filled in order and the free space is at the end.
+ * The blocks belong to no file; the volume is only used for allocation. */
+static int fill_volume( EXT2_FILESYSTEM* fs, unsigned int perMille, int uniform )
+{
+	BYTE bitmap[EXT2_MAX_BLOCK_SIZE];
+	EXT2_GROUP_DESC desc;
+	UINT32 group, bit, blocks, freeBlocks, keep, total = 0, left;
+	UINT32 dataBlocks = fs->sb.blockCount - fs->sb.firstDataBlock;
+
+	left = ( UINT32 )( ( UINT64 )dataBlocks * ( 1000 - perMille ) / 1000 );	/* free blocks to leave */
+	for( group = 0; group < fs->sb_info.groupCount; group++ )
+	{
+		blocks = MIN( fs->sb.blocksPerGroup, dataBlocks - group * fs->sb.blocksPerGroup );
+		if( read_block_bitmap( fs, group, bitmap ) != EXT2_SUCCESS || read_desc( fs, group, ( BYTE* )&desc ) != EXT2_SUCCESS )
+			return -1;
+
+		if( uniform )
+			keep = ( UINT32 )( ( UINT64 )left * blocks / dataBlocks );
+		else
+			keep = group == fs->sb_info.groupCount - 1 ? left : 0;
+
+		freeBlocks = desc.bg_freeBlockCount;
+		for( bit = 0; bit < blocks && freeBlocks > keep; bit++ )
+		{
+			/* uniform : skip free bits with a fixed stride so what is left is scattered */
+			if( bitmap[bit >> 3] & ( 1 << ( bit & 7 ) ) || ( uniform && keep != 0 && bit % ( blocks / keep + 1 ) == 0 ) )
+				continue;
+			bitmap[bit >> 3] |= 1 << ( bit & 7 );
+			freeBlocks--;
+		}
+
+		total += desc.bg_freeBlockCount - freeBlocks;
+		desc.bg_freeBlockCount = ( UINT16 )freeBlocks;
+		if( write_block( fs, fs->groupBase[group].blockBitmap, bitmap ) != EXT2_SUCCESS || write_desc( fs, group, ( BYTE* )&desc ) != EXT2_SUCCESS )
+			return -1;
+		if( !uniform )
+			left -= MIN( left, freeBlocks );
+	}
+
+	fs->sb.freeBlockCount -= total;
+	return sync_super_block( fs ) == EXT2_SUCCESS ? 0 : -1;
+}
+
+/* latency of single block allocations on a volume that is 90, 99 and 99.9%
+ * full, with the free blocks spread over all groups and left at the end,
+ * without and with the bitmap summaries. Each allocation is the first block
+ * of a new file in the root directory, so the search starts in group 0. */
+static int bench_alloc( void )
+{
+	static const unsigned long defaults[] = { 900, 990, 999 };
+	unsigned long full[BENCH_MAX_LIST];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	EXT2_NODE* files;
+	BENCH_RUN run;
+	char params[96], name[16];
+	unsigned int f, count, i, ops = param( "ops", 300 ), mb = param( "mb", 512 );
+	int uniform, summary;
+	double start;
+
+	if( ( files = ( EXT2_NODE* )malloc( sizeof( EXT2_NODE ) * ( ops ? ops : 1 ) ) ) == NULL )
+		return -1;
+
+	count = param_list( "full", defaults, sizeof( defaults ) / sizeof( defaults[0] ), full );
+
+	for( f = 0; f < count; f++ )
+	{
+		for( uniform = 1; uniform >= 0; uniform-- )
+		{
+			for( summary = 0; summary <= 1; summary++ )
+			{
+				/* a fresh volume per run, allocations of the previous run would fill it further */
+				if( open_disk( mb, &disk ) < 0 || format_disk( &disk, 0, 1, 0 ) != EXT2_SUCCESS ||
+					mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS || fill_volume( &fs, full[f], uniform ) < 0 )
+					return -1;
+				ext2_umount( &fs );
+
+				/* remount so the summaries are built from the filled bitmaps */
+				if( mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS )
+					return -1;
+				for( i = 0; i < ops; i++ )
+				{
+					sprintf( name, "a%u", i );
+					if( ext2_create( &root, name, &files[i] ) != EXT2_SUCCESS )
+						return -1;
+				}
+				if( !summary )
+					release_bitmap_summary( &fs );
+
+				if( run_begin( &run, ops ) < 0 )
+					return -1;
+				for( i = 0; i < ops; i++ )
+				{
+					start = now_ns();
+					if( alloc_block( &fs, &files[i] ) != EXT2_SUCCESS )
+						return -1;
+					run_sample( &run, start );
+				}
+
+				sprintf( params, "size_mb=%u full_permille=%lu layout=%s summary=%d", mb, full[f], uniform ? "uniform" : "tail", summary );
+				run_report( &run, "alloc", params );
+
+				ext2_umount( &fs );
+				disksim_uninit( &disk );
+			}
+		}
+	}
+
+	free( files );
+	return 0;
+}
+
+/* format and mount of disks of several sizes. lazy=1 formats with
+ * uninitialized inode tables and also times initializing them afterwards */
+static int bench_formatmount( void )
+{
+	static const unsigned long defaults[] = { 64, 512, 2048 };
+	static const unsigned long lazyDefaults[] = { 0 };
+	static const unsigned long threadDefaults[] = { 1 };
+	unsigned long sizes[BENCH_MAX_LIST], lazy[BENCH_MAX_LIST], threads[BENCH_MAX_LIST];
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	EXT2_FORMAT_OPTION option;
+	BENCH_RUN run;
+	char params[64];
+	unsigned int s, l, t, count, lazyCount, threadCount, i, formats = param( "formats", 3 ), mounts = param( "mounts", 50 );
+	int file = param( "file", 0 ) != 0;
+	double start;
+
+	count = param_list( "mb", defaults, sizeof( defaults ) / sizeof( defaults[0] ), sizes );
+	lazyCount = param_list( "lazy", lazyDefaults, sizeof( lazyDefaults ) / sizeof( lazyDefaults[0] ), lazy );
+	threadCount = param_list( "threads", threadDefaults, sizeof( threadDefaults ) / sizeof( threadDefaults[0] ), threads );
+
+	for( s = 0; s < count; s++ )
+	{
+		for( l = 0; l < lazyCount; l++ )
+		{
+			ZeroMemory( &option, sizeof( option ) );
+			option.sparseSuper = 1;
+			option.journalBlocks = param( "journal", 0 );
+			option.lazyItableInit = lazy[l] != 0;
+
+			if( open_disk_backend( sizes[s], file, &disk ) < 0 )
+				return -1;
+
+			for( t = 0; t < threadCount; t++ )
+			{
+				option.threadCount = ( UINT32 )threads[t];
+				if( run_begin( &run, formats ) < 0 )
+					return -1;
+
+				for( i = 0; i < formats; i++ )
+				{
+					start = now_ns();
+					if( ext2_format( &disk, &option ) != EXT2_SUCCESS )
+						return -1;
+					run_sample( &run, start );
+				}
+
+				sprintf( params, "op=format size_mb=%lu file=%d lazy=%lu threads=%lu", sizes[s], file, lazy[l], threads[t] );
+				run_report( &run, "formatmount", params );
+			}
+
+			if( run_begin( &run, mounts ) < 0 )
+				return -1;
+
+			for( i = 0; i < mounts; i++ )
+			{
+				start = now_ns();
+				if( mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS )
+					return -1;
+				ext2_umount( &fs );
+				run_sample( &run, start );
+			}
+
+			sprintf( params, "op=mount size_mb=%lu file=%d lazy=%lu", sizes[s], file, lazy[l] );
+			run_report( &run, "formatmount", params );
+
+			if( lazy[l] )
+			{	/* the inode tables format left to mount time, all at once */
+				if( mount_disk( &disk, &fs, &root ) != EXT2_SUCCESS || run_begin( &run, 1 ) < 0 )
+					return -1;
+				start = now_ns();
+				if( ext2_init_inode_tables( &fs, 0 ) < 0 )
+					return -1;
+				run_sample( &run, start );
+				ext2_umount( &fs );
+
+				sprintf( params, "op=itable_init size_mb=%lu file=%d lazy=%lu", sizes[s], file, lazy[l] );
+				run_report( &run, "formatmount", params );
+			}
+
+			close_disk_backend( file, &disk );
+		}
+	}
+
+	return 0;
+}
+
+static BENCH_WORKLOAD g_workloads[] =
+{
+	{ "mount",		bench_mount,		"mount/umount of formatted 512MB and 2GB disks" },
+	{ "translate",	bench_translate,	"inode and block number translation" },
+	{ "create",		bench_create,		"create files in one directory with and without journal" },
+	{ "orphan",		bench_orphan,		"mount after a crash with open, removed files" },
+	{ "check",		bench_check,		"consistency check of a 2GB volume with 1, 2 and 4 workers" },
+	{ "parallel",	bench_parallel,		"create and write files from 1, 2 and 4 threads" },
+	{ "lookup",		bench_lookup,		"look up names from 1, 2 and 4 threads without and with the cache" },
+	{ "walk",		bench_walk,			"walk a directory tree from 1, 2 and 4 threads" },
+	{ "queue",		bench_queue,		"read a disk through the submission queue at depth 1, 8 and 32" },
+	{ "aio",		bench_aio,			"read files from one thread with ext2_read and with ext2_aio_read" },
+	{ "handle",		bench_handle,		"read and write a file in 1KB pieces by node and through a file handle" },
+	{ "files",		bench_files,		"create files in one directory (files, mb, journal)" },
+	{ "fanout",		bench_fanout,		"mkdir of a directory tree (depth, width, mb)" },
+	{ "hitmiss",	bench_hitmiss,		"lookups of existing and missing names (files, lookups, cache)" },
+	{ "seqio",		bench_seqio,		"sequential write and read of a file (io, mb, log_block, journal)" },
+	{ "randio",		bench_randio,		"random write and read of a file (io, ops, mb, log_block, journal)" },
+	{ "readdir",	bench_readdir,		"read_dir of large directories (entries, rounds)" },
+	{ "ls",			bench_ls,			"shell directory listing (entries, rounds, log)" },
+	{ "formatmount",	bench_formatmount,	"format and mount of disks (mb, formats, mounts, journal, lazy, threads, file)" },
+	{ "alloc",		bench_alloc,		"single block allocation on nearly full volumes (full, ops, mb)" },
+	{ "budget",		bench_budget,		"fail when single calls do more block I/O than their bound" },
+};
+
+#define WORKLOAD_COUNT	( sizeof( g_workloads ) / sizeof( g_workloads[0] ) )
+
+static void usage( const char* name )
+{
+	unsigned int i;
+
+	fprintf( stderr, "usage : %s [workload[:key=value,...]...]\n", name );
+	for( i = 0; i < WORKLOAD_COUNT; i++ )
+		fprintf( stderr, "  %-12s %s\n", g_workloads[i].name, g_workloads[i].help );
+}
+
+static int run_workload( const BENCH_WORKLOAD* workload, const char* params )
+{
+	g_params = params;
+	if( workload->run() != 0 )
+	{
+		fprintf( stderr, "bench %s failed\n", workload->name );
+		return -1;
+	}
+
+	fflush( g_out );
+	return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+	const char* params;
+	size_t length;
+	unsigned int i;
+	int arg, result = 0;
+
+	/* results go to the original stdout, ext2 diagnostics are discarded */
+	g_out = fdopen( dup( fileno( stdout ) ), "w" );
+	if( g_out == NULL || freopen( "/dev/null", "w", stdout ) == NULL )
+		return 1;
+
+	if( argc == 1 )
+	{
+		for( i = 0; i < WORKLOAD_COUNT; i++ )
+			result |= run_workload( &g_workloads[i], NULL );
+
+		return result ? 1 : 0;
+	}
+
+	for( arg = 1; arg < argc; arg++ )
+	{
+		params = strchr( argv[arg], ':' );
+		length = params ? ( size_t )( params - argv[arg] ) : strlen( argv[arg] );
+		for( i = 0; i < WORKLOAD_COUNT; i++ )
+		{
+			if( strlen( g_workloads[i].name ) == length && strncmp( argv[arg], g_workloads[i].name, length ) == 0 )
+				break;
+		}
+
+		if( i == WORKLOAD_COUNT )
+		{
+			usage( argv[0] );
+			return 1;
+		}
+
+		result |= run_workload( &g_workloads[i], params ? params + 1 : NULL );
+	}
+
+	return result ? 1 : 0;
+}
@@ -33,6 +33,49 @@
 
 #define STEP( a )				{ PRINTF( "%s(%d): %s;\n", __FILE__, __LINE__, # a ); a; }
 
+/* leveled diagnostics. a level above LOG_LEVEL_MAX is removed by the
+ * preprocessor, arguments included, so debug prints in hot paths cost
+ * nothing unless the build asks for them (-DLOG_LEVEL_MAX=4). the levels
+ * that are compiled in are printed when they are at most g_logLevel,
+ * which can be changed at run time */
+#define LOG_LEVEL_NONE			0
+#define LOG_LEVEL_ERROR			1
+#define LOG_LEVEL_WARN			2
+#define LOG_LEVEL_INFO			3
+#define LOG_LEVEL_DEBUG			4
+
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX			LOG_LEVEL_INFO
+#endif
+
+extern int g_logLevel;
+
+#define LOG( level, ... )		do { if( ( level ) <= g_logLevel ) PRINTF( __VA_ARGS__ ); } while( 0 )
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_ERROR
+#define LOG_ERROR( ... )		LOG( LOG_LEVEL_ERROR, __VA_ARGS__ )
+#else
+#define LOG_ERROR( ... )		do { } while( 0 )
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_WARN
+#define LOG_WARN( ... )			LOG( LOG_LEVEL_WARN, __VA_ARGS__ )
+#else
+#define LOG_WARN( ... )			do { } while( 0 )
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_INFO
+#define LOG_INFO( ... )			LOG( LOG_LEVEL_INFO, __VA_ARGS__ )
+#else
+#define LOG_INFO( ... )			do { } while( 0 )
+#endif
+
+#if LOG_LEVEL_MAX >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG( ... )		LOG( LOG_LEVEL_DEBUG, __VA_ARGS__ )
+#else
+#define LOG_DEBUG( ... )		do { } while( 0 )
+#endif
+
 #define EXT2_ERROR				-1
 #define EXT2_SUCCESS			0
 
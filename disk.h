@@ -3,13 +3,53 @@
 
 #include "common.h"
 
+#define DISK_READ		0
+#define DISK_WRITE		1
+
+/* one asynchronous transfer of count consecutive sectors. the request and its
+ * data buffer belong to the backend from submit until complete hands the
+ * request back; result is then 0 on success and -1 on failure */
+typedef struct DISK_REQUEST
+{
+	int		opcode;
+	SECTOR	sector;
+	unsigned int	count;
+	void*	data;
+	int		result;
+	void*	param;		/* caller's cookie, untouched by the backend */
+	struct DISK_REQUEST*	next;	/* backend queue link */
+} DISK_REQUEST;
+
+struct DISK_OPERATIONS;
+
+/* trace hook, called by the backend for every transfer it performs : each
+ * read_sector/write_sector, and each request a backend hands to the kernel
+ * itself. it may be called from several threads at once */
+typedef void ( *DISK_TRACE )( struct DISK_OPERATIONS*, int opcode, SECTOR sector, unsigned int count );
+
+#define DISK_TRACE_IO( disk, opcode, sector, count ) \
+	do { \
+		DISK_TRACE hook = __atomic_load_n( &( disk )->trace, __ATOMIC_ACQUIRE ); \
+		if( hook ) \
+			hook( ( disk ), ( opcode ), ( sector ), ( count ) ); \
+	} while( 0 )
+
+/* backends must allow read_sector/write_sector on different sectors from several threads.
+ * submit queues requests without waiting for them (all or none, -1 if any request is
+ * out of range); complete returns up to max finished requests and, with wait set,
+ * blocks until at least one finishes unless nothing is in flight. complete is called
+ * from one thread at a time. backends without a queue leave both NULL */
 typedef struct DISK_OPERATIONS
 {
 	int		( *read_sector	)( struct DISK_OPERATIONS*, SECTOR, void* );
 	int		( *write_sector	)( struct DISK_OPERATIONS*, SECTOR, const void* );
+	int		( *submit		)( struct DISK_OPERATIONS*, DISK_REQUEST**, int );
+	int		( *complete		)( struct DISK_OPERATIONS*, DISK_REQUEST**, int, int );
 	SECTOR	numberOfSectors;
 	int		bytesPerSector;
 	void*	pdata;
+	DISK_TRACE	trace;		/* NULL : not traced */
+	void*	traceParam;
 } DISK_OPERATIONS;
 
 #endif
@@ -0,0 +1,391 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <memory.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+#include "ext2.h"
+#include "disk.h"
+#include "diskfile.h"
+#include "diskqueue.h"
+
+#define DISKFILE_RING_ENTRIES	64
+
+#if defined( __NR_io_uring_setup ) && defined( IO_URING_OP_SUPPORTED )
+#define DISKFILE_URING
+#endif
+
+#ifdef DISKFILE_URING
+/* io_uring submission and completion rings, driven with raw system calls.
+ * requests that do not fit in the ring wait on the pending list until
+ * complete frees slots */
+typedef struct
+{
+	int		fd;
+	unsigned int	entries;
+	unsigned int	inflight;		/* handed to the kernel, not reaped yet */
+	unsigned int*	sqHead;
+	unsigned int*	sqTail;
+	unsigned int*	sqMask;
+	unsigned int*	sqArray;
+	struct io_uring_sqe*	sqes;
+	unsigned int*	cqHead;
+	unsigned int*	cqTail;
+	unsigned int*	cqMask;
+	struct io_uring_cqe*	cqes;
+	void*	sqRing;
+	size_t	sqRingSize;
+	void*	cqRing;
+	size_t	cqRingSize;
+	size_t	sqesSize;
+	DISK_REQUEST*	pendingHead;
+	DISK_REQUEST*	pendingTail;
+	pthread_mutex_t	lock;
+} DISK_URING;
+#else
+typedef struct DISK_URING DISK_URING;
+#endif
+
+/* disk image file backend : pread/pwrite are positional, so sectors can be
+ * read and written from several threads at once without a lock. submit goes
+ * to io_uring when the kernel has it, to a pread/pwrite worker pool otherwise */
+typedef struct
+{
+	int		fd;
+	DISK_URING*	ring;
+	struct DISK_QUEUE*	queue;
+} DISK_FILE;
+
+int diskfile_read( DISK_OPERATIONS* this, SECTOR sector, void* data );
+int diskfile_write( DISK_OPERATIONS* this, SECTOR sector, const void* data );
+int diskfile_submit( DISK_OPERATIONS* this, DISK_REQUEST** requests, int count );
+int diskfile_complete( DISK_OPERATIONS* this, DISK_REQUEST** done, int max, int wait );
+
+#ifdef DISKFILE_URING
+static void uring_destroy( DISK_URING* ring )
+{
+	if( ring->sqes && ring->sqes != MAP_FAILED )
+		munmap( ring->sqes, ring->sqesSize );
+	if( ring->cqRing && ring->cqRing != MAP_FAILED )
+		munmap( ring->cqRing, ring->cqRingSize );
+	if( ring->sqRing && ring->sqRing != MAP_FAILED )
+		munmap( ring->sqRing, ring->sqRingSize );
+	if( ring->fd >= 0 )
+		close( ring->fd );
+
+	pthread_mutex_destroy( &ring->lock );
+	free( ring );
+}
+
+/* IORING_OP_READ/WRITE came after io_uring itself (together with the probe), so ask the kernel */
+static int uring_probe( int fd )
+{
+	struct io_uring_probe* probe;
+	int supported = 0;
+
+	probe = ( struct io_uring_probe* )calloc( 1, sizeof( struct io_uring_probe ) + 256 * sizeof( struct io_uring_probe_op ) );
+	if( probe == NULL )
+		return 0;
+
+	if( syscall( __NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256 ) == 0 &&
+		probe->last_op >= IORING_OP_WRITE &&
+		( probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED ) &&
+		( probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED ) )
+		supported = 1;
+
+	free( probe );
+
+	return supported;
+}
+
+static DISK_URING* uring_create( unsigned int entries )
+{
+	struct io_uring_params params;
+	DISK_URING* ring;
+
+	ring = ( DISK_URING* )calloc( 1, sizeof( DISK_URING ) );
+	if( ring == NULL )
+		return NULL;
+
+	pthread_mutex_init( &ring->lock, NULL );
+	memset( &params, 0, sizeof( params ) );
+	ring->fd = syscall( __NR_io_uring_setup, entries, &params );
+	if( ring->fd < 0 || !uring_probe( ring->fd ) ) {
+		uring_destroy( ring );
+		return NULL;
+	}
+
+	ring->entries = params.sq_entries;
+	ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof( unsigned int );
+	ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+	ring->sqesSize = params.sq_entries * sizeof( struct io_uring_sqe );
+
+	ring->sqRing = mmap( NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+	ring->cqRing = mmap( NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+	ring->sqes = ( struct io_uring_sqe* )mmap( NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES );
+	if( ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED ) {
+		uring_destroy( ring );
+		return NULL;
+	}
+
+	ring->sqHead = ( unsigned int* )( ( char* )ring->sqRing + params.sq_off.head );
+	ring->sqTail = ( unsigned int* )( ( char* )ring->sqRing + params.sq_off.tail );
+	ring->sqMask = ( unsigned int* )( ( char* )ring->sqRing + params.sq_off.ring_mask );
+	ring->sqArray = ( unsigned int* )( ( char* )ring->sqRing + params.sq_off.array );
+	ring->cqHead = ( unsigned int* )( ( char* )ring->cqRing + params.cq_off.head );
+	ring->cqTail = ( unsigned int* )( ( char* )ring->cqRing + params.cq_off.tail );
+	ring->cqMask = ( unsigned int* )( ( char* )ring->cqRing + params.cq_off.ring_mask );
+	ring->cqes = ( struct io_uring_cqe* )( ( char* )ring->cqRing + params.cq_off.cqes );
+
+	return ring;
+}
+
+/* moves pending requests into free ring slots and hands every queued slot to
+ * the kernel. at most entries requests are in flight, so the completion ring
+ * (twice as large) can never overflow. called with ring->lock held */
+static void uring_flush( DISK_OPERATIONS* this, DISK_URING* ring )
+{
+	DISK_REQUEST* request;
+	struct io_uring_sqe* sqe;
+	unsigned int tail = *ring->sqTail;
+	unsigned int index;
+
+	while( ring->pendingHead && ring->inflight < ring->entries ) {
+		request = ring->pendingHead;
+		ring->pendingHead = request->next;
+		if( ring->pendingHead == NULL )
+			ring->pendingTail = NULL;
+
+		index = tail & *ring->sqMask;
+		sqe = &ring->sqes[index];
+		memset( sqe, 0, sizeof( struct io_uring_sqe ) );
+		sqe->opcode = request->opcode == DISK_READ ? IORING_OP_READ : IORING_OP_WRITE;
+		sqe->fd = ( ( DISK_FILE* )this->pdata )->fd;
+		sqe->off = ( uint64_t )request->sector * this->bytesPerSector;
+		sqe->addr = ( uint64_t )( uintptr_t )request->data;
+		sqe->len = request->count * this->bytesPerSector;
+		sqe->user_data = ( uint64_t )( uintptr_t )request;
+		ring->sqArray[index] = index;
+
+		tail++;
+		ring->inflight++;
+	}
+	__atomic_store_n( ring->sqTail, tail, __ATOMIC_RELEASE );
+
+	/* slots the kernel has not consumed yet, including ones left over from an
+	 * earlier call that was interrupted */
+	if( tail != __atomic_load_n( ring->sqHead, __ATOMIC_ACQUIRE ) )
+		syscall( __NR_io_uring_enter, ring->fd, tail - __atomic_load_n( ring->sqHead, __ATOMIC_ACQUIRE ), 0, 0, NULL, 0 );
+}
+
+static int uring_submit( DISK_OPERATIONS* this, DISK_URING* ring, DISK_REQUEST** requests, int count )
+{
+	int i;
+
+	pthread_mutex_lock( &ring->lock );
+	for( i = 0; i < count; i++ ) {
+		requests[i]->next = NULL;
+		if( ring->pendingTail )
+			ring->pendingTail->next = requests[i];
+		else
+			ring->pendingHead = requests[i];
+		ring->pendingTail = requests[i];
+	}
+	uring_flush( this, ring );
+	pthread_mutex_unlock( &ring->lock );
+
+	return count;
+}
+
+static int uring_complete( DISK_OPERATIONS* this, DISK_URING* ring, DISK_REQUEST** done, int max, int wait )
+{
+	struct io_uring_cqe* cqe;
+	DISK_REQUEST* request;
+	unsigned int head, tail;
+	int count = 0;
+	int idle;
+
+	for( ;; ) {
+		pthread_mutex_lock( &ring->lock );
+		head = *ring->cqHead;
+		tail = __atomic_load_n( ring->cqTail, __ATOMIC_ACQUIRE );
+		while( head != tail && count < max ) {
+			cqe = &ring->cqes[head & *ring->cqMask];
+			request = ( DISK_REQUEST* )( uintptr_t )cqe->user_data;
+			request->result = cqe->res == ( int )( request->count * this->bytesPerSector ) ? 0 : -1;
+			done[count++] = request;
+			ring->inflight--;
+			head++;
+		}
+		__atomic_store_n( ring->cqHead, head, __ATOMIC_RELEASE );
+
+		/* reaped slots make room for pending requests */
+		uring_flush( this, ring );
+		idle = ring->inflight == 0;
+		pthread_mutex_unlock( &ring->lock );
+
+		if( count > 0 || !wait || idle )
+			return count;
+
+		if( syscall( __NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0 ) < 0 && errno != EINTR )
+			return -1;
+	}
+}
+#endif
+
+/* numberOfSectors is the size of a new image. An existing image is never
+ * shrunk : a larger file keeps its size, a shorter one is extended. The size
+ * in use is returned in disk->numberOfSectors. */
+int diskfile_init( const char* path, SECTOR numberOfSectors, unsigned int bytesPerSector, DISK_OPERATIONS* disk )
+{
+	struct stat st;
+
+	if( disk == NULL || path == NULL ) return -1;
+
+	disk->pdata = calloc( 1, sizeof( DISK_FILE ) );
+
+	if( disk->pdata == NULL )
+		return -1;
+
+	( ( DISK_FILE* )disk->pdata )->fd = open( path, O_RDWR | O_CREAT, 0644 );
+
+	if( ( ( DISK_FILE* )disk->pdata )->fd < 0 ) {
+		free( disk->pdata );
+		disk->pdata = NULL;
+		return -1;
+	}
+
+	if( fstat( ( ( DISK_FILE* )disk->pdata )->fd, &st ) < 0 ) {
+		diskfile_uninit( disk );
+		return -1;
+	}
+
+	if( ( SECTOR )( st.st_size / bytesPerSector ) >= numberOfSectors )
+		numberOfSectors = ( SECTOR )( st.st_size / bytesPerSector );
+	else if( ftruncate( ( ( DISK_FILE* )disk->pdata )->fd, ( off_t )bytesPerSector * numberOfSectors ) < 0 ) {
+		diskfile_uninit( disk );
+		return -1;
+	}
+
+	disk->read_sector = diskfile_read;
+	disk->write_sector = diskfile_write;
+	disk->trace = NULL;
+	disk->traceParam = NULL;
+	disk->numberOfSectors = numberOfSectors;
+	disk->bytesPerSector = bytesPerSector;
+
+#ifdef DISKFILE_URING
+	( ( DISK_FILE* )disk->pdata )->ring = uring_create( DISKFILE_RING_ENTRIES );
+#endif
+	if( ( ( DISK_FILE* )disk->pdata )->ring == NULL ) {
+		( ( DISK_FILE* )disk->pdata )->queue = diskqueue_create( disk, DISK_QUEUE_WORKERS );
+		if( ( ( DISK_FILE* )disk->pdata )->queue == NULL ) {
+			diskfile_uninit( disk );
+			return -1;
+		}
+	}
+
+	disk->submit = diskfile_submit;
+	disk->complete = diskfile_complete;
+
+	return 0;
+}
+
+void diskfile_uninit( DISK_OPERATIONS* this )
+{
+	DISK_REQUEST* done[DISKFILE_RING_ENTRIES];
+
+	if( this ) {
+		if( this->pdata ) {
+			diskqueue_destroy( ( ( DISK_FILE* )this->pdata )->queue );
+#ifdef DISKFILE_URING
+			/* the kernel may still be writing into caller buffers */
+			if( ( ( DISK_FILE* )this->pdata )->ring ) {
+				while( uring_complete( this, ( ( DISK_FILE* )this->pdata )->ring, done, DISKFILE_RING_ENTRIES, 1 ) > 0 )
+					;
+				uring_destroy( ( ( DISK_FILE* )this->pdata )->ring );
+			}
+#endif
+			if( ( ( DISK_FILE* )this->pdata )->fd >= 0 )
+				close( ( ( DISK_FILE* )this->pdata )->fd );
+
+			free( this->pdata );
+			this->pdata = NULL;
+		}
+	}
+}
+
+int diskfile_read( DISK_OPERATIONS* this, SECTOR sector, void* data )
+{
+	int fd = ( ( DISK_FILE* )this->pdata )->fd;
+
+	if( sector >= this->numberOfSectors )
+		return -1;
+
+	if( pread( fd, data, this->bytesPerSector, ( off_t )sector * this->bytesPerSector ) != this->bytesPerSector )
+		return -1;
+	DISK_TRACE_IO( this, DISK_READ, sector, 1 );
+
+	return 0;
+}
+
+int diskfile_write( DISK_OPERATIONS* this, SECTOR sector, const void* data )
+{
+	int fd = ( ( DISK_FILE* )this->pdata )->fd;
+
+	if( sector >= this->numberOfSectors )
+		return -1;
+
+	if( pwrite( fd, data, this->bytesPerSector, ( off_t )sector * this->bytesPerSector ) != this->bytesPerSector )
+		return -1;
+	DISK_TRACE_IO( this, DISK_WRITE, sector, 1 );
+
+	return 0;
+}
+
+int diskfile_submit( DISK_OPERATIONS* this, DISK_REQUEST** requests, int count )
+{
+	DISK_FILE* file = ( DISK_FILE* )this->pdata;
+#ifdef DISKFILE_URING
+	int i;
+#endif
+
+	if( file->queue )
+		return diskqueue_submit( file->queue, this, requests, count );
+
+#ifdef DISKFILE_URING
+	for( i = 0; i < count; i++ ) {
+		if( requests[i]->sector >= this->numberOfSectors || requests[i]->count > this->numberOfSectors - requests[i]->sector )
+			return -1;
+	}
+
+	/* the kernel does these transfers, so they are traced here and not in diskfile_read/write */
+	for( i = 0; i < count; i++ )
+		DISK_TRACE_IO( this, requests[i]->opcode, requests[i]->sector, requests[i]->count );
+
+	return uring_submit( this, file->ring, requests, count );
+#else
+	return -1;
+#endif
+}
+
+int diskfile_complete( DISK_OPERATIONS* this, DISK_REQUEST** done, int max, int wait )
+{
+	DISK_FILE* file = ( DISK_FILE* )this->pdata;
+
+	if( file->queue )
+		return diskqueue_complete( file->queue, done, max, wait );
+
+#ifdef DISKFILE_URING
+	return uring_complete( this, file->ring, done, max, wait );
+#else
+	return -1;
+#endif
+}
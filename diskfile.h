@@ -0,0 +1,9 @@
+#ifndef _DISKFILE_H_
+#define _DISKFILE_H_
+
+#include "common.h"
+
+int diskfile_init( const char*, SECTOR, unsigned int, DISK_OPERATIONS* );
+void diskfile_uninit( DISK_OPERATIONS* );
+
+#endif
@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "ext2.h"
+#include "disk.h"
+#include "diskqueue.h"
+
+/* thread pool behind the asynchronous disk interface : workers take requests
+ * off the submission queue, run them through the backend's own read_sector /
+ * write_sector and append them to the completion queue */
+typedef struct DISK_QUEUE
+{
+	DISK_OPERATIONS*	disk;
+	pthread_mutex_t		lock;
+	pthread_cond_t		work;		/* submission queue not empty, or stop */
+	pthread_cond_t		done;		/* completion queue not empty */
+	DISK_REQUEST*		sqHead;
+	DISK_REQUEST*		sqTail;
+	DISK_REQUEST*		cqHead;
+	DISK_REQUEST*		cqTail;
+	unsigned int		inflight;	/* submitted, not handed back by complete yet */
+	int					stop;
+	unsigned int		workerCount;
+	pthread_t			workers[DISK_QUEUE_MAX_WORKERS];
+} DISK_QUEUE;
+
+static int run_request( DISK_OPERATIONS* disk, DISK_REQUEST* request )
+{
+	char* data = ( char* )request->data;
+	unsigned int i;
+
+	for( i = 0; i < request->count; i++ ) {
+		if( request->opcode == DISK_READ ) {
+			if( disk->read_sector( disk, request->sector + i, data + ( size_t )i * disk->bytesPerSector ) < 0 )
+				return -1;
+		}
+		else if( disk->write_sector( disk, request->sector + i, data + ( size_t )i * disk->bytesPerSector ) < 0 )
+			return -1;
+	}
+
+	return 0;
+}
+
+static void* queue_worker( void* arg )
+{
+	DISK_QUEUE* queue = ( DISK_QUEUE* )arg;
+	DISK_REQUEST* request;
+
+	pthread_mutex_lock( &queue->lock );
+	for( ;; ) {
+		while( queue->sqHead == NULL && !queue->stop )
+			pthread_cond_wait( &queue->work, &queue->lock );
+		/* stop only once the submission queue is drained */
+		if( queue->sqHead == NULL )
+			break;
+
+		request = queue->sqHead;
+		queue->sqHead = request->next;
+		if( queue->sqHead == NULL )
+			queue->sqTail = NULL;
+		pthread_mutex_unlock( &queue->lock );
+
+		request->result = run_request( queue->disk, request );
+		request->next = NULL;
+
+		pthread_mutex_lock( &queue->lock );
+		if( queue->cqTail )
+			queue->cqTail->next = request;
+		else
+			queue->cqHead = request;
+		queue->cqTail = request;
+		pthread_cond_signal( &queue->done );
+	}
+	pthread_mutex_unlock( &queue->lock );
+
+	return NULL;
+}
+
+DISK_QUEUE* diskqueue_create( DISK_OPERATIONS* disk, unsigned int workerCount )
+{
+	DISK_QUEUE* queue;
+
+	if( workerCount == 0 )
+		workerCount = DISK_QUEUE_WORKERS;
+	if( workerCount > DISK_QUEUE_MAX_WORKERS )
+		workerCount = DISK_QUEUE_MAX_WORKERS;
+
+	queue = ( DISK_QUEUE* )calloc( 1, sizeof( DISK_QUEUE ) );
+	if( queue == NULL )
+		return NULL;
+
+	queue->disk = disk;
+	pthread_mutex_init( &queue->lock, NULL );
+	pthread_cond_init( &queue->work, NULL );
+	pthread_cond_init( &queue->done, NULL );
+
+	for( ; queue->workerCount < workerCount; queue->workerCount++ ) {
+		if( pthread_create( &queue->workers[queue->workerCount], NULL, queue_worker, queue ) != 0 )
+			break;
+	}
+
+	if( queue->workerCount == 0 ) {
+		diskqueue_destroy( queue );
+		return NULL;
+	}
+
+	return queue;
+}
+
+/* runs whatever is still queued, then stops the workers. requests that were
+ * completed but never handed back are simply dropped, they belong to the caller */
+void diskqueue_destroy( DISK_QUEUE* queue )
+{
+	unsigned int i;
+
+	if( queue == NULL )
+		return;
+
+	pthread_mutex_lock( &queue->lock );
+	queue->stop = 1;
+	pthread_cond_broadcast( &queue->work );
+	pthread_mutex_unlock( &queue->lock );
+
+	for( i = 0; i < queue->workerCount; i++ )
+		pthread_join( queue->workers[i], NULL );
+
+	pthread_cond_destroy( &queue->done );
+	pthread_cond_destroy( &queue->work );
+	pthread_mutex_destroy( &queue->lock );
+	free( queue );
+}
+
+int diskqueue_submit( DISK_QUEUE* queue, DISK_OPERATIONS* disk, DISK_REQUEST** requests, int count )
+{
+	int i;
+
+	for( i = 0; i < count; i++ ) {
+		if( requests[i]->sector >= disk->numberOfSectors || requests[i]->count > disk->numberOfSectors - requests[i]->sector )
+			return -1;
+	}
+
+	pthread_mutex_lock( &queue->lock );
+	for( i = 0; i < count; i++ ) {
+		requests[i]->next = NULL;
+		if( queue->sqTail )
+			queue->sqTail->next = requests[i];
+		else
+			queue->sqHead = requests[i];
+		queue->sqTail = requests[i];
+	}
+	queue->inflight += count;
+
+	if( count == 1 )
+		pthread_cond_signal( &queue->work );
+	else if( count > 1 )
+		pthread_cond_broadcast( &queue->work );
+	pthread_mutex_unlock( &queue->lock );
+
+	return count;
+}
+
+int diskqueue_complete( DISK_QUEUE* queue, DISK_REQUEST** done, int max, int wait )
+{
+	int count = 0;
+
+	pthread_mutex_lock( &queue->lock );
+	if( wait ) {
+		while( queue->cqHead == NULL && queue->inflight > 0 )
+			pthread_cond_wait( &queue->done, &queue->lock );
+	}
+
+	while( queue->cqHead && count < max ) {
+		done[count++] = queue->cqHead;
+		queue->cqHead = queue->cqHead->next;
+	}
+	if( queue->cqHead == NULL )
+		queue->cqTail = NULL;
+	queue->inflight -= count;
+	pthread_mutex_unlock( &queue->lock );
+
+	return count;
+}
@@ -0,0 +1,16 @@
+#ifndef _DISKQUEUE_H_
+#define _DISKQUEUE_H_
+
+#include "common.h"
+
+#define DISK_QUEUE_WORKERS		4
+#define DISK_QUEUE_MAX_WORKERS	64
+
+struct DISK_QUEUE;
+
+struct DISK_QUEUE* diskqueue_create( DISK_OPERATIONS*, unsigned int );
+void diskqueue_destroy( struct DISK_QUEUE* );
+int diskqueue_submit( struct DISK_QUEUE*, DISK_OPERATIONS*, DISK_REQUEST**, int );
+int diskqueue_complete( struct DISK_QUEUE*, DISK_REQUEST**, int, int );
+
+#endif
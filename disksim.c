@@ -3,14 +3,18 @@
 #include "ext2.h"
 #include "disk.h"
 #include "disksim.h"
+#include "diskqueue.h"
 
 typedef struct
 {
 	char*	address;
+	struct DISK_QUEUE*	queue;	/* worker pool for submit/complete */
 } DISK_MEMORY;
 
 int disksim_read( DISK_OPERATIONS* this, SECTOR sector, void* data );
 int disksim_write( DISK_OPERATIONS* this, SECTOR sector, const void* data );
+int disksim_submit( DISK_OPERATIONS* this, DISK_REQUEST** requests, int count );
+int disksim_complete( DISK_OPERATIONS* this, DISK_REQUEST** done, int max, int wait );
 
 int disksim_init( SECTOR numberOfSectors, unsigned int bytesPerSector, DISK_OPERATIONS* disk )
 {
@@ -23,7 +27,8 @@ int disksim_init( SECTOR numberOfSectors, unsigned int bytesPerSector, DISK_OPER
 		return -1;
 	}
 
-	( ( DISK_MEMORY* )disk->pdata )->address = ( char* )malloc( bytesPerSector * numberOfSectors );
+	( ( DISK_MEMORY* )disk->pdata )->queue = NULL;
+	( ( DISK_MEMORY* )disk->pdata )->address = ( char* )malloc( ( size_t )bytesPerSector * numberOfSectors );
 
 	if( ( ( DISK_MEMORY* )disk->pdata )->address == NULL ) {
 		disksim_uninit( disk );
@@ -32,9 +37,20 @@ int disksim_init( SECTOR numberOfSectors, unsigned int bytesPerSector, DISK_OPER
 
 	disk->read_sector = disksim_read;
 	disk->write_sector = disksim_write;
+	disk->trace = NULL;
+	disk->traceParam = NULL;
 	disk->numberOfSectors = numberOfSectors;
 	disk->bytesPerSector = bytesPerSector;
 
+	( ( DISK_MEMORY* )disk->pdata )->queue = diskqueue_create( disk, DISK_QUEUE_WORKERS );
+	if( ( ( DISK_MEMORY* )disk->pdata )->queue == NULL ) {
+		disksim_uninit( disk );
+		return -1;
+	}
+
+	disk->submit = disksim_submit;
+	disk->complete = disksim_complete;
+
 	return 0;
 }
 
@@ -42,6 +58,9 @@ void disksim_uninit( DISK_OPERATIONS* this )
 {
 	if( this ) {
 		if( this->pdata ) {
+			/* drains the queue, so workers no longer touch the memory */
+			diskqueue_destroy( ( ( DISK_MEMORY* )this->pdata )->queue );
+
 			if( ( ( DISK_MEMORY* )this->pdata )->address ) 
 				free( ( ( DISK_MEMORY* )this->pdata )->address );
 
@@ -57,7 +76,8 @@ int disksim_read( DISK_OPERATIONS* this, SECTOR sector, void* data )
 	if( sector < 0 || sector >= this->numberOfSectors )
 		return -1;
 
-	memcpy( data, &disk[sector * this->bytesPerSector], this->bytesPerSector );
+	memcpy( data, &disk[( size_t )sector * this->bytesPerSector], this->bytesPerSector );
+	DISK_TRACE_IO( this, DISK_READ, sector, 1 );
 
 	return 0;
 }
@@ -69,8 +89,19 @@ int disksim_write( DISK_OPERATIONS* this, SECTOR sector, const void* data )
 	if( sector < 0 || sector >= this->numberOfSectors )
 		return -1;
 
-	memcpy( &disk[sector * this->bytesPerSector], data, this->bytesPerSector ); 
+	memcpy( &disk[( size_t )sector * this->bytesPerSector], data, this->bytesPerSector ); 
+	DISK_TRACE_IO( this, DISK_WRITE, sector, 1 );
 
 	return 0;
 }
 
+int disksim_submit( DISK_OPERATIONS* this, DISK_REQUEST** requests, int count )
+{
+	return diskqueue_submit( ( ( DISK_MEMORY* )this->pdata )->queue, this, requests, count );
+}
+
+int disksim_complete( DISK_OPERATIONS* this, DISK_REQUEST** done, int max, int wait )
+{
+	return diskqueue_complete( ( ( DISK_MEMORY* )this->pdata )->queue, done, max, wait );
+}
+
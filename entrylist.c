@@ -5,54 +5,70 @@
 #define NULL	( ( void* )0 )
 #endif
 
+#define ENTRY_LIST_MIN_ITEMS		64
+#define ENTRY_LIST_MIN_NAMES		1024
+
 int init_entry_list( SHELL_ENTRY_LIST* list )
 {
 	memset( list, 0, sizeof( SHELL_ENTRY_LIST ) );
 	return 0;
 }
 
-int add_entry_list( SHELL_ENTRY_LIST* list, SHELL_ENTRY* entry )
+int add_entry_list( SHELL_ENTRY_LIST* list, const char* name, unsigned int nameLength, unsigned int inode, unsigned int size, int isDirectory )
 {
-	SHELL_ENTRY_LIST_ITEM*	newItem;
+	SHELL_ENTRY_LIST_ITEM*	item;
+
+	if( nameLength > 255 )
+		nameLength = 255;
 
-printf("entry->size : %d\n", entry->size);
+	if( list->count == list->capacity )
+	{
+		unsigned int	capacity = list->capacity ? list->capacity * 2 : ENTRY_LIST_MIN_ITEMS;
+		SHELL_ENTRY_LIST_ITEM*	items = ( SHELL_ENTRY_LIST_ITEM* )realloc( list->items, capacity * sizeof( SHELL_ENTRY_LIST_ITEM ) );
 
-	newItem = ( SHELL_ENTRY_LIST_ITEM* )malloc( sizeof( SHELL_ENTRY_LIST_ITEM ) );
-	newItem->entry	= *entry;
-	newItem->next	= NULL;
+		if( items == NULL )
+			return -1;
+		list->items = items;
+		list->capacity = capacity;
+	}
 
-	if( list->count == 0 )
-		list->first = list->last = newItem;
-	else
+	if( list->namesUsed + nameLength + 1 > list->namesSize )
 	{
-		list->last->next = newItem;
-		list->last = newItem;
+		unsigned int	namesSize = list->namesSize ? list->namesSize : ENTRY_LIST_MIN_NAMES;
+		char*			names;
+
+		while( list->namesUsed + nameLength + 1 > namesSize )
+			namesSize *= 2;
+		names = ( char* )realloc( list->names, namesSize );
+		if( names == NULL )
+			return -1;
+		list->names = names;
+		list->namesSize = namesSize;
 	}
 
-	list->count++;
+	item = &list->items[list->count++];
+	item->inode			= inode;
+	item->size			= size;
+	item->nameOffset	= list->namesUsed;
+	item->nameLength	= ( unsigned char )nameLength;
+	item->isDirectory	= isDirectory != 0;
+
+	memcpy( list->names + list->namesUsed, name, nameLength );
+	list->names[list->namesUsed + nameLength] = 0;
+	list->namesUsed += nameLength + 1;
 
 	return 0;
 }
 
-void release_entry_list( SHELL_ENTRY_LIST* list )
+/* valid until the next add_entry_list, which may move the arena */
+const char* entry_list_name( const SHELL_ENTRY_LIST* list, const SHELL_ENTRY_LIST_ITEM* item )
 {
-	SHELL_ENTRY_LIST_ITEM*	currentItem;
-	SHELL_ENTRY_LIST_ITEM*	nextItem;
-
-	if( list->count == 0 )
-		return;
-
-	nextItem = list->first;
-
-	do
-	{
-		currentItem = nextItem;
-		nextItem = currentItem->next;
-		free( currentItem );
-	} while( nextItem );
-
-	list->count	= 0;
-	list->first	= NULL;
-	list->last	= NULL;
+	return list->names + item->nameOffset;
 }
 
+void release_entry_list( SHELL_ENTRY_LIST* list )
+{
+	free( list->items );
+	free( list->names );
+	memset( list, 0, sizeof( SHELL_ENTRY_LIST ) );
+}
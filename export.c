@@ -0,0 +1,394 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "ext2.h"
+
+/* bulk export
+ *
+ * ext2_export copies the tree below a directory to a host directory in two
+ * passes. The first is an ext2_walk : host directories are created as the
+ * walk reaches them and every regular file is recorded with the block its
+ * data starts at. The files are then sorted by that block, so their data is
+ * read in the order it lies on the disk instead of in directory order, and
+ * read in large chunks through an ext2_aio context : contiguous blocks of a
+ * chunk go to the disk as one request and several chunks are in flight at
+ * once, spread over the aio helper threads. Completed chunks are written to
+ * the host file at their offset from the calling thread. The aio context
+ * reaps the disk's completion queue, so the caller must not hold another
+ * one on the same disk, and nothing may modify the tree during the export. */
+
+#define EXPORT_CHUNK_BYTES		(1024 * 1024)	/* largest read of one file */
+#define EXPORT_DEPTH			8				/* chunks in flight */
+
+typedef struct export_file {
+	EXT2_NODE	node;
+	UINT32		firstBlock;			/* 0 : no data */
+	UINT32		size;
+	UINT32		mTime;
+	UINT32		mode;
+	char*		path;				/* host path */
+	int			fd;					/* -1 : not open */
+	UINT32		pending;			/* chunks in flight */
+	UINT32		issued;				/* all chunks handed to aio */
+} EXPORT_FILE;
+
+/* files found by one walk worker */
+typedef struct export_list {
+	EXPORT_FILE*	files;
+	UINT32		count;
+	UINT32		size;
+	UINT32		dirs;
+	int			failed;
+} EXPORT_LIST;
+
+typedef struct export_context EXPORT_CONTEXT;
+
+typedef struct export_chunk {
+	EXPORT_CONTEXT*	ctx;
+	EXPORT_FILE*	file;
+	BYTE*		data;				/* EXPORT_CHUNK_BYTES */
+	unsigned long offset;
+	unsigned long length;
+} EXPORT_CHUNK;
+
+struct export_context {
+	const char*	hostPath;
+	EXPORT_LIST	lists[EXT2_WALK_MAX_THREADS];
+	EXPORT_CHUNK	chunks[EXPORT_DEPTH];
+	EXPORT_CHUNK*	idle[EXPORT_DEPTH];
+	UINT32		idleCount;
+	EXT2_EXPORT_REPORT*	report;
+	int			failed;
+};
+
+static char* join_path(const char* base, const char* path)
+{
+	size_t length = strlen(base);
+	char* joined;
+
+	joined = (char *)malloc(length + strlen(path) + 2);
+	if (joined == NULL)
+		return NULL;
+	memcpy(joined, base, length);
+	joined[length] = '/';
+	strcpy(&joined[length + 1], path);
+
+	return joined;
+}
+
+/* ̹ ִ ͸ ״  */
+static int make_host_dir(const char* path)
+{
+	struct stat st;
+
+	if (mkdir(path, 0755) == 0)
+		return EXT2_SUCCESS;
+	if (errno == EEXIST && stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+		return EXT2_SUCCESS;
+
+	LOG_ERROR("error : cannot create directory %s\n", path);
+	return EXT2_ERROR;
+}
+
+static void set_host_time(const char* path, UINT32 mTime)
+{
+	struct timeval times[2];
+
+	times[0].tv_sec = times[1].tv_sec = mTime;
+	times[0].tv_usec = times[1].tv_usec = 0;
+	utimes(path, times);
+}
+
+/******************************************************************************/
+/* walk                                                                       */
+/******************************************************************************/
+
+/* walk worker ڱ Ͽ ߰ϹǷ lock ʿ  */
+static int collect_entry(const EXT2_WALK_ENTRY* entry, void* arg)
+{
+	EXPORT_CONTEXT* ctx = (EXPORT_CONTEXT *)arg;
+	EXPORT_LIST* list = &ctx->lists[entry->worker];
+	EXPORT_FILE* grown;
+	EXPORT_FILE* file;
+	char* path;
+
+	path = join_path(ctx->hostPath, entry->path);
+	if (path == NULL)
+		goto fail;
+
+	if (entry->node.entry.dir2.fileType == EXT2_FT_DIR)
+	{	// walk ͸ 湮 ڿ   Ƿ θ ׻  
+		if (make_host_dir(path) != EXT2_SUCCESS)
+		{
+			free(path);
+			goto fail;
+		}
+		free(path);
+		list->dirs++;
+		return EXT2_SUCCESS;
+	}
+
+	if (list->count == list->size)
+	{
+		grown = (EXPORT_FILE *)realloc(list->files, sizeof(EXPORT_FILE) * (list->size ? list->size * 2 : 256));
+		if (grown == NULL)
+		{
+			free(path);
+			goto fail;
+		}
+		list->files = grown;
+		list->size = list->size ? list->size * 2 : 256;
+	}
+
+	file = &list->files[list->count++];
+	ZeroMemory(file, sizeof(EXPORT_FILE));
+	file->node = entry->node;
+	file->firstBlock = entry->inode.fileSize > 0 ? entry->inode.i_block[0] : 0;
+	file->size = entry->inode.fileSize;
+	file->mTime = entry->inode.mTime;
+	file->mode = entry->inode.fileMode & ACCESSED_BY_ANYONE;
+	file->path = path;
+	file->fd = -1;
+
+	return EXT2_SUCCESS;
+
+fail:
+	list->failed = 1;
+	return EXT2_ERROR;
+}
+
+/* Ͱ ũ  , Ͱ    */
+static int compare_file(const void* a, const void* b)
+{
+	const EXPORT_FILE* fa = (const EXPORT_FILE *)a;
+	const EXPORT_FILE* fb = (const EXPORT_FILE *)b;
+
+	if (fa->firstBlock != fb->firstBlock)
+		return fa->firstBlock < fb->firstBlock ? -1 : 1;
+	if (fa->node.entry.inode != fb->node.entry.inode)
+		return fa->node.entry.inode < fb->node.entry.inode ? -1 : 1;
+
+	return 0;
+}
+
+/******************************************************************************/
+/* copy                                                                       */
+/******************************************************************************/
+
+static int open_host_file(EXPORT_FILE* file)
+{
+	file->fd = open(file->path, O_WRONLY | O_CREAT | O_TRUNC, file->mode ? file->mode : 0644);
+	if (file->fd < 0)
+	{
+		LOG_ERROR("error : cannot create file %s\n", file->path);
+		return EXT2_ERROR;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/*  chunk    */
+static void finish_file(EXPORT_CONTEXT* ctx, EXPORT_FILE* file)
+{
+	if (close(file->fd) != 0)
+	{
+		LOG_ERROR("error : failed to close %s\n", file->path);
+		ctx->failed = 1;
+	}
+	file->fd = -1;
+	set_host_time(file->path, file->mTime);
+	ctx->report->files++;
+}
+
+/* ext2_aio_poll ȣ,  chunk ȣƮ   ġ  */
+static void chunk_done(void* arg, int result)
+{
+	EXPORT_CHUNK* chunk = (EXPORT_CHUNK *)arg;
+	EXPORT_CONTEXT* ctx = chunk->ctx;
+	EXPORT_FILE* file = chunk->file;
+	unsigned long written = 0;
+	ssize_t length;
+
+	if (result != (int)chunk->length)
+	{
+		LOG_ERROR("error : failed to read %s at %lu\n", file->path, chunk->offset);
+		ctx->failed = 1;
+	}
+	while (!ctx->failed && written < chunk->length)
+	{
+		length = pwrite(file->fd, &chunk->data[written], chunk->length - written, chunk->offset + written);
+		if (length <= 0)
+		{
+			LOG_ERROR("error : failed to write %s\n", file->path);
+			ctx->failed = 1;
+			break;
+		}
+		written += length;
+	}
+	ctx->report->bytes += written;
+
+	if (--file->pending == 0 && file->issued)
+		finish_file(ctx, file);
+	ctx->idle[ctx->idleCount++] = chunk;
+}
+
+/* ĵ  chunk EXPORT_DEPTH ÿ  */
+static int copy_files(EXPORT_CONTEXT* ctx, EXT2_AIO* aio, EXPORT_FILE* files, UINT32 count)
+{
+	EXPORT_CHUNK* chunk;
+	EXPORT_FILE* file;
+	unsigned long offset = 0;
+	UINT32 next = 0;
+
+	while (!ctx->failed && next < count)
+	{
+		if (ctx->idleCount == 0)
+		{
+			ext2_aio_poll(aio, 1);
+			continue;
+		}
+
+		file = &files[next];
+		if (file->fd < 0 && open_host_file(file) != EXT2_SUCCESS)
+		{
+			ctx->failed = 1;
+			break;
+		}
+		if (file->size == 0)
+		{
+			file->issued = 1;
+			finish_file(ctx, file);
+			next++;
+			continue;
+		}
+
+		chunk = ctx->idle[--ctx->idleCount];
+		chunk->file = file;
+		chunk->offset = offset;
+		chunk->length = MIN(EXPORT_CHUNK_BYTES, file->size - offset);
+		offset += chunk->length;
+		if (offset == file->size)
+		{
+			file->issued = 1;
+			offset = 0;
+			next++;
+		}
+
+		file->pending++;
+		if (ext2_aio_read(aio, &file->node, chunk->offset, chunk->length, (char *)chunk->data, chunk_done, chunk) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to queue read of %s\n", file->path);
+			file->pending--;
+			file->issued = 0;
+			ctx->idle[ctx->idleCount++] = chunk;
+			ctx->failed = 1;
+			break;
+		}
+		ctx->report->chunks++;
+	}
+
+	while (ext2_aio_poll(aio, 1) > 0) // ص ̹  б  ٸ
+		;
+
+	return ctx->failed ? EXT2_ERROR : EXT2_SUCCESS;
+}
+
+/******************************************************************************/
+/* ext2_export                                                                */
+/******************************************************************************/
+
+/* dir Ʒ ϰ ͸ hostPath Ʒ    */
+/* threadCount walk aio helper  , 0̸  ⺻ */
+int ext2_export(EXT2_NODE* dir, const char* hostPath, UINT32 threadCount, EXT2_EXPORT_REPORT* report)
+{
+	EXPORT_CONTEXT* ctx;
+	EXPORT_FILE* files = NULL;
+	EXT2_AIO* aio = NULL;
+	UINT32 count = 0, total = 0, i, j;
+	int result = EXT2_ERROR;
+
+	ZeroMemory(report, sizeof(EXT2_EXPORT_REPORT));
+
+	ctx = (EXPORT_CONTEXT *)calloc(1, sizeof(EXPORT_CONTEXT));
+	if (ctx == NULL)
+	{
+		LOG_ERROR("error : failed to allocate export context\n");
+		return EXT2_ERROR;
+	}
+	ctx->hostPath = hostPath;
+	ctx->report = report;
+
+	if (make_host_dir(hostPath) != EXT2_SUCCESS)
+		goto out;
+
+	if (ext2_walk(dir, threadCount, collect_entry, ctx) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : failed to walk the tree\n");
+		goto out;
+	}
+
+	for (i = 0; i < EXT2_WALK_MAX_THREADS; i++)
+	{
+		total += ctx->lists[i].count;
+		report->dirs += ctx->lists[i].dirs;
+	}
+	files = (EXPORT_FILE *)malloc(sizeof(EXPORT_FILE) * (total ? total : 1));
+	if (files == NULL)
+	{
+		LOG_ERROR("error : failed to allocate export list\n");
+		goto out;
+	}
+	for (i = 0; i < EXT2_WALK_MAX_THREADS; i++)
+	{
+		for (j = 0; j < ctx->lists[i].count; j++)
+			files[count++] = ctx->lists[i].files[j];
+		ctx->lists[i].count = 0; // path  files 
+	}
+	qsort(files, count, sizeof(EXPORT_FILE), compare_file);
+
+	for (i = 0; i < EXPORT_DEPTH; i++)
+	{
+		ctx->chunks[i].ctx = ctx;
+		ctx->chunks[i].data = (BYTE *)malloc(EXPORT_CHUNK_BYTES);
+		if (ctx->chunks[i].data == NULL)
+		{
+			LOG_ERROR("error : failed to allocate export buffers\n");
+			goto out;
+		}
+		ctx->idle[ctx->idleCount++] = &ctx->chunks[i];
+	}
+
+	aio = ext2_aio_create(dir->fs, threadCount);
+	if (aio == NULL)
+	{
+		LOG_ERROR("error : failed to start aio\n");
+		goto out;
+	}
+	result = copy_files(ctx, aio, files, count);
+	ext2_aio_destroy(aio);
+
+out:
+	for (i = 0; i < count; i++)
+	{
+		if (files[i].fd >= 0)
+			close(files[i].fd);
+		free(files[i].path);
+	}
+	free(files);
+	for (i = 0; i < EXT2_WALK_MAX_THREADS; i++)
+	{
+		for (j = 0; j < ctx->lists[i].count; j++)
+			free(ctx->lists[i].files[j].path);
+		free(ctx->lists[i].files);
+	}
+	for (i = 0; i < EXPORT_DEPTH; i++)
+		free(ctx->chunks[i].data);
+	free(ctx);
+
+	return result;
+}
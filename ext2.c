@@ -9,7 +9,49 @@
 /*                                                                            */
 /******************************************************************************/
 
+#include <ctype.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
 #include "ext2.h"
+#include "journal.h"
+
+static int write_meta_block(EXT2_FILESYSTEM* fs, UINT32 block, const BYTE* buffer);
+static void begin_operation(EXT2_FILESYSTEM* fs, UINT32 credits);
+static int extend_operation(EXT2_FILESYSTEM* fs, UINT32 credits);
+static void end_operation(EXT2_FILESYSTEM* fs);
+static UINT32 release_credits(EXT2_FILESYSTEM* fs, UINT32 inodeNumber);
+static int init_inode_table(EXT2_FILESYSTEM* fs, UINT32 group, UINT32 count);
+static void start_itable_init(EXT2_FILESYSTEM* fs);
+static void stop_itable_init(EXT2_FILESYSTEM* fs);
+static void lock_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, int write);
+static void unlock_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber);
+static UINT32 inode_version(EXT2_FILESYSTEM* fs, UINT32 inodeNumber);
+static int read_disk_super_block(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb);
+static int map_file_block(EXT2_FILE* file, UINT32 logical, UINT32* physical);
+static int mount_fs(EXT2_FILESYSTEM* fs, EXT2_NODE* root);
+static int format_fs(DISK_OPERATIONS* disk, const EXT2_FORMAT_OPTION* option);
+static EXT2_IO_STATS* enter_op(EXT2_FILESYSTEM* fs, int op);
+static void leave_op(EXT2_IO_STATS* outer);
+static void trace_block(EXT2_FILESYSTEM* fs, int opcode, UINT32 block);
+
+/*  尡 Բ ϴ free count,  Ʈ word */
+#define ATOMIC_ADD(var, value)	__atomic_add_fetch(&(var), (value), __ATOMIC_RELAXED)
+#define ATOMIC_LOAD(var)		__atomic_load_n(&(var), __ATOMIC_RELAXED)
+
+/* journal transaction    ϴ  ,   ϳ   ʿ   */
+/* (Ʈ, ׷ ũ, inode,    ܰ log ̹   ) */
+#define EXT2_OP_CREDITS			16
+#define EXT2_BLOCK_CREDITS		7
+
+/*  尡    ٱ ,  I/O ī(NULL :  ̰ų fs )  ð */
+static __thread EXT2_IO_STATS* g_opStats;
+static __thread UINT32 g_opDepth;
+static __thread int g_op;
+static __thread UINT64 g_opStart;
+
+/* LOG_* ũ    ,   ܵ  ÷ µ  */
+int g_logLevel = LOG_LEVEL_INFO;
 
 
 /******************************************************************************/
@@ -46,22 +88,161 @@ static __inline__ int get_set_bit(int nr, volatile void* addr)
 	return oldbit;
 }
 
-// nr Ʈ  ó  zero bit ȣ  
-static int get_next_zero_bit(EXT2_FILESYSTEM* fs, int nr, volatile void* addr)
+// nbits  Ʈ  64Ʈ  (    )
+static __inline__ UINT64 get_bitmap_word(const volatile void* addr, UINT32 word, UINT32 nbits)
+{
+	UINT64 value;
+
+	if ((word << 6) >= nbits)
+		return ~0ULL;
+
+	value = ((const volatile UINT64 *)addr)[word];
+	if (((word + 1) << 6) > nbits)
+		value |= ~0ULL << (nbits & 63);
+
+	return value;
+}
+
+// Ʈ κ  Ʈ 
+static void build_summary(EXT2_BITMAP_SUMMARY* summary, const volatile void* addr, UINT32 nbits)
 {
 	UINT32 i;
-	UINT32 bit;
-	UINT32 blkBits = fs->sb_info.blockSize;
+	UINT32 words = (nbits + 63) >> 6;
+
+	ZeroMemory(summary, sizeof(EXT2_BITMAP_SUMMARY));
+
+	for (i = 0; i < words; i++)
+	{
+		if (~get_bitmap_word(addr, i, nbits))
+			summary->level1[i >> 6] |= 1ULL << (i & 63);
+	}
+
+	for (i = 0; i < EXT2_SUMMARY_WORDS; i++)
+	{
+		if (summary->level1[i])
+			summary->level2 |= 1ULL << i;
+	}
+
+	summary->valid = 1;
+}
+
+//  Ʈʿ word  ó free Ʈ   ȣ,  -1
+static int get_next_free_word(const EXT2_BITMAP_SUMMARY* summary, UINT32 word)
+{
+	UINT32 index = word >> 6;
+	UINT64 bits, upper;
+
+	if (index >= EXT2_SUMMARY_WORDS)
+		return -1;
+
+	bits = summary->level1[index] & (~0ULL << (word & 63));
+	if (bits)
+		return (index << 6) + __builtin_ctzll(bits);
+
+	upper = (index + 1 < 64) ? summary->level2 & (~0ULL << (index + 1)) : 0;
+	if (upper == 0)
+		return -1;
+
+	index = __builtin_ctzll(upper);
+	return (index << 6) + __builtin_ctzll(summary->level1[index]);
+}
+
+// [nr, nbits)  ó  zero bit ȣ,  -1
+static int find_zero_bit_from(const EXT2_BITMAP_SUMMARY* summary, UINT32 nr, const volatile void* addr, UINT32 nbits)
+{
+	UINT32 word = nr >> 6;
+	UINT64 free;
+	int next;
+
+	if (nr >= nbits)
+		return -1;
+
+	free = ~get_bitmap_word(addr, word, nbits) & (~0ULL << (nr & 63));
+	if (free)
+		return (word << 6) + __builtin_ctzll(free);
+
+	for (word++; (word << 6) < nbits; word++)
+	{
+		if (summary != NULL)
+		{
+			if ((next = get_next_free_word(summary, word)) == -1)
+				return -1;
+			word = next;
+		}
+
+		free = ~get_bitmap_word(addr, word, nbits);
+		if (free)
+			return (word << 6) + __builtin_ctzll(free);
+	}
+
+	return -1;
+}
+
+// nr Ʈ  ó  zero bit ȣ  
+static int get_next_zero_bit(const EXT2_BITMAP_SUMMARY* summary, int nr, const volatile void* addr, UINT32 nbits)
+{
+	int bit;
+
+	if (summary != NULL && !summary->valid)
+		summary = NULL;
+
+	if (summary != NULL && summary->level2 == 0)
+		return -1;
+
+	if ((UINT32)nr >= nbits)
+		nr = 0;
+
+	if ((bit = find_zero_bit_from(summary, nr, addr, nbits)) != -1)
+		return bit;
+
+	if (nr == 0)
+		return -1;
+
+	bit = find_zero_bit_from(summary, 0, addr, nbits);
+
+	return (bit < nr) ? bit : -1;
+}
+
+// start ׷ ȯϸ free Ʈ   ִ ù ׷ ȣ,  -1
+static int get_next_free_group(const UINT64* map, UINT32 groupCount, UINT32 start)
+{
+	UINT32 words = (groupCount + 63) >> 6;
+	UINT32 i, word;
+	UINT64 bits;
+
+	if (map == NULL)
+		return start;
 
-	for (i = 0; i < blkBits * 8; i++)
+	for (i = 0; i <= words; i++)
 	{
-		bit = (nr + i) % blkBits;
-		if (get_bit(bit, addr) == 0)
-			return bit;
+		word = ((start >> 6) + i) % words;
+		bits = ATOMIC_LOAD(map[word]);
+		if (i == 0)
+			bits &= ~0ULL << (start & 63);
+		else if (i == words)
+			bits &= ~(~0ULL << (start & 63));
+
+		if (bits)
+			return (word << 6) + __builtin_ctzll(bits);
 	}
+
 	return -1;
 }
 
+// ׷    
+static void update_group_summary(EXT2_BITMAP_SUMMARY* summary, UINT64* map, UINT32 group, const volatile void* addr, UINT32 nbits)
+{
+	if (summary == NULL)
+		return;
+
+	build_summary(&summary[group], addr, nbits);
+
+	if (summary[group].level2) //  word ٸ ׷ 尡 Բ 
+		__atomic_fetch_or(&map[group >> 6], 1ULL << (group & 63), __ATOMIC_RELAXED);
+	else
+		__atomic_fetch_and(&map[group >> 6], ~(1ULL << (group & 63)), __ATOMIC_RELAXED);
+}
+
 
 /******************************************************************************/
 /* read / write		                                                          */
@@ -69,107 +250,260 @@ static int get_next_zero_bit(EXT2_FILESYSTEM* fs, int nr, volatile void* addr)
 
 /*  */
 /* buffer offset lengthŭ file о  */
-int ext2_read(EXT2_NODE* file, unsigned long offset, unsigned long length, char* buffer)
+/* ּ ȯ : mount   shift, mask,  ׷ ̺  б   */
+
+/* inode ȣ  ׷ (inode ȣ < 2^31  Ȯ) */
+static __inline__ UINT32 inode_to_group(const EXT2_SB_INFO* sb_info, UINT32 inode)
 {
+	return (UINT32)(((UINT64)(inode - 1) * sb_info->inodeGroup_magic) >> sb_info->inodeGroup_shift);
 }
 
-/*  */
-/* offset lengthŭ buffer  file  */
-int ext2_write(EXT2_NODE* file, unsigned long offset, unsigned long length, const char* block)
+/* ׷  inode ε */
+static __inline__ UINT32 inode_to_index(const EXT2_SB_INFO* sb_info, UINT32 inode)
+{
+	return (inode - 1) - inode_to_group(sb_info, inode) * sb_info->inodesPerGroup;
+}
+
+/*  ȣ  ׷ */
+static __inline__ UINT32 block_to_group(const EXT2_FILESYSTEM* fs, UINT32 block)
+{
+	return (block - fs->sb.firstDataBlock) >> fs->sb_info.blocksPerGroup_bits;
+}
+
+/* ׷   ε */
+static __inline__ UINT32 block_to_index(const EXT2_FILESYSTEM* fs, UINT32 block)
+{
+	return (block - fs->sb.firstDataBlock) & (fs->sb_info.blocksPerGroup - 1);
+}
+
+/* 2 ŵ ƴϸ ø */
+static UINT32 get_log2(UINT32 number)
+{
+	UINT32 bits = 0;
+
+	while ((1U << bits) < number)
+		bits++;
+
+	return bits;
+}
+
+static int read_file(EXT2_NODE* file, unsigned long offset, unsigned long length, char* buffer)
 {
 	EXT2_SB_INFO* sb_info = &file->fs->sb_info;
-	BYTE buffer[EXT2_BLOCK_SIZE];
+	BYTE block[EXT2_MAX_BLOCK_SIZE];
 	EXT2_INODE inode;
-	UINT32 currentOffset, currentBlock, blockSeq = 0;
+	UINT32 currentOffset, currentBlock;
 	UINT32 readEnd;
-	UINT32 blockSize, blockNumber;
-	UINT32 blockOffset;
+	UINT32 blockOffset, copyLength;
 
-	ZeroMemory(buffer, sizeof(buffer));
-
-	if(get_inode(file->fs, file->entry.inode, &inode) != EXT2_SUCCESS)
+	if (get_inode(file->fs, file->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
 	{
-		printf("error : failed to get_inode() in ext2_write()\n");
+		LOG_ERROR("error : failed to get_inode() in ext2_read()\n");
 		return EXT2_ERROR;
 	}
 
-	readEnd = offset + length;
-	currentBlock = inode.i_block[0];
+	if (offset >= inode.fileSize)
+		return 0;
+
+	readEnd = MIN(offset + length, inode.fileSize);
 	currentOffset = offset;
-	blockSize = EXT2_BLOCK_SIZE;
-	while(offset > blockSize)
+
+	while (currentOffset < readEnd)
 	{
-		if(get_allocated_block(file->fs, blockSeq + 1, &inode, &currentBlock) != EXT2_SUCCESS)
+		blockOffset = currentOffset % sb_info->blockSize;
+		copyLength = MIN(sb_info->blockSize - blockOffset, readEnd - currentOffset);
+
+		if (get_allocated_block(file->fs, currentOffset / sb_info->blockSize, &inode, &currentBlock) != EXT2_SUCCESS)
 		{
-			printf("error : get_allocated_block() in ext2_write()\n");
+			LOG_ERROR("error : failed to get_allocated_block() in ext2_read()\n");
 			return EXT2_ERROR;
 		}
-		blockSize += EXT2_BLOCK_SIZE;
-		blockSeq++;
+
+		if (currentBlock == 0) // Ҵ   0 
+			ZeroMemory(block, sb_info->blockSize);
+		else if (read_block(file->fs, currentBlock, block) != EXT2_SUCCESS)
+			break;
+
+		memcpy(buffer, &block[blockOffset], copyLength);
+
+		buffer += copyLength;
+		currentOffset += copyLength;
+	}
+
+	return currentOffset - offset;
+}
+
+int ext2_read(EXT2_NODE* file, unsigned long offset, unsigned long length, char* buffer)
+{
+	EXT2_IO_STATS* outer = enter_op(file->fs, EXT2_OP_READ);
+	int result;
+
+	lock_inode(file->fs, file->entry.inode, 0);
+	result = read_file(file, offset, length, buffer);
+	unlock_inode(file->fs, file->entry.inode);
+	leave_op(outer);
+
+	return result;
+}
+
+/* offset lengthŭ   ʿ ũ  ȣ blocks ä (Ҵ   0) */
+/* blocks offset length   ŭ ־  */
+/* version   inodeVersion ָ, бⰡ   ext2_map_changed Ȯ */
+/* return :  ũ⿡     ִ Ʈ  */
+int ext2_map_read(EXT2_NODE* file, unsigned long offset, unsigned long length, UINT32* blocks, UINT32* version)
+{
+	EXT2_SB_INFO* sb_info = &file->fs->sb_info;
+	EXT2_INODE inode;
+	UINT32 readEnd, first, last, i;
+	int result = EXT2_SUCCESS;
+
+	lock_inode(file->fs, file->entry.inode, 0);
+	if (get_inode(file->fs, file->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
+	{
+		unlock_inode(file->fs, file->entry.inode);
+		LOG_ERROR("error : failed to get_inode() in ext2_map_read()\n");
+		return EXT2_ERROR;
 	}
+	*version = inode_version(file->fs, file->entry.inode);
 
-	while(currentOffset < readEnd)
+	if (offset >= inode.fileSize || length == 0)
 	{
-		UINT32 copyLength;
+		unlock_inode(file->fs, file->entry.inode);
+		return 0;
+	}
 
-		blockNumber = currentOffset / sb_info->blockSize;
+	readEnd = MIN(offset + length, inode.fileSize);
+	first = offset / sb_info->blockSize;
+	last = (readEnd - 1) / sb_info->blockSize;
 
-		if(currentBlock == 0)
+	for (i = first; i <= last; i++)
+	{
+		if (get_allocated_block(file->fs, i, &inode, &blocks[i - first]) != EXT2_SUCCESS)
 		{
-			if(alloc_block(file->fs, file) != EXT2_SUCCESS)
-			{
-				printf("error : faild to alloc_block() in ext2_write()\n");
-				return EXT2_ERROR;
-			}
-			get_inode(file->fs, file->entry.inode, &inode);
-			currentBlock = inode.i_block[0];
+			LOG_ERROR("error : failed to get_allocated_block() in ext2_map_read()\n");
+			result = EXT2_ERROR;
+			break;
 		}
+	}
+	unlock_inode(file->fs, file->entry.inode);
+
+	return result == EXT2_SUCCESS ? (int)(readEnd - offset) : EXT2_ERROR;
+}
+
+/* ext2_map_read ڿ file inode ٲ Ȯ ( stripe ٸ inode ٲ 1) */
+/* truncate   set_inode inode lock ȿ ϹǷ, бⰡ   lock  Ȯϸ */
+/* д  Ǿ ٸ Ͽ   ־  ݵ 1  */
+int ext2_map_changed(EXT2_NODE* file, UINT32 version)
+{
+	UINT32 current;
+
+	lock_inode(file->fs, file->entry.inode, 0);
+	current = inode_version(file->fs, file->entry.inode);
+	unlock_inode(file->fs, file->entry.inode);
+
+	return current != version;
+}
+
+/*  */
+/* offset lengthŭ buffer  file  */
+/* inode ȣ  о  file inode,     ŵ */
+/* handle  handle   ã, Ʈ ٽ   ( ä   Ʈ ڸ  ʵ) */
+/* journal transaction ڸ   迡 ߰ *restart 1 , ȣ   ٽ  ̾  */
+static int write_file(EXT2_NODE* file, EXT2_INODE* inodePtr, EXT2_FILE* handle, unsigned long offset, unsigned long length, const char* block, int* restart)
+{
+	EXT2_SB_INFO* sb_info = &file->fs->sb_info;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_INODE inode = *inodePtr;
+	UINT32 currentOffset, currentBlock, blockSeq, gapBlock;
+	UINT32 writeEnd;
+	UINT32 blockOffset, copyLength;
+	int allocated, result;
+
+	ZeroMemory(buffer, sizeof(buffer));
+
+	writeEnd = offset + length;
+	currentOffset = offset;
+	*restart = 0;
+
+	while(currentOffset < writeEnd)
+	{
+		blockSeq = currentOffset / sb_info->blockSize;
+		blockOffset = currentOffset % sb_info->blockSize;
+		copyLength = MIN(sb_info->blockSize - blockOffset, writeEnd - currentOffset);
+		allocated = 0;
 
-		//    ʰ   Ѿϴ 
-		if(blockSeq != blockNumber)
+		if(extend_operation(file->fs, EXT2_BLOCK_CREDITS) != EXT2_SUCCESS)
 		{
-			UINT32 nextBlock;
-			int result;
+			*restart = 1;
+			break;
+		}
 
-			// Ҵ      ȣ ޾ƿ
-			blockSeq++;
-			if(get_allocated_block(file->fs, blockSeq, &inode, &nextBlock) != EXT2_SUCCESS)
+		//  ϱ Ҵ    Ҵ 
+		while(inode.blockCount <= blockSeq)
+		{
+			if(allocated && extend_operation(file->fs, EXT2_BLOCK_CREDITS) != EXT2_SUCCESS)
+			{	// Ҵ  inode ϵǾ Ƿ ⼭ 絵 
+				*restart = 1;
+				break;
+			}
+			if(alloc_block(file->fs, file) != EXT2_SUCCESS)
 			{
-				printf("error : faild to get_allocated_block() in ext2_write()\n");
+				LOG_ERROR("error : faild to alloc_block() in ext2_write()\n");
 				return EXT2_ERROR;
-			}			
-
-			//  Ҵ   
-			if(nextBlock == 0)
-			{	//  Ҵ 
-				if(alloc_block(file->fs, file) != EXT2_SUCCESS)
-				{	
-					printf("error : faild to alloc_block() in ext2_write()\n");
-					return EXT2_ERROR;
-				}
-				
-				// Ҵ   
-				if(get_allocated_block(file->fs, blockSeq, &inode, &nextBlock) != EXT2_SUCCESS)
+			}
+			get_inode(file->fs, file->entry.inode, (BYTE *)&inode);
+			allocated = 1;
+
+			//  ġ    Ǿ    Ƿ 0 ä
+			if (inode.blockCount <= blockSeq)
+			{
+				ZeroMemory(buffer, sb_info->blockSize);
+				if (get_allocated_block(file->fs, inode.blockCount - 1, &inode, &gapBlock) != EXT2_SUCCESS ||
+					write_block(file->fs, gapBlock, buffer) != EXT2_SUCCESS)
 				{
-					printf("error : faild to get_allocated_block() in ext2_write()\n");
+					LOG_ERROR("error : failed to clear a block before the write offset in ext2_write()\n");
 					return EXT2_ERROR;
-				}	
+				}
+			}
+		}
+		if (*restart)
+		{
+			if (handle != NULL)
+			{
+				handle->inode = inode;
+				handle->mapCount = 0;
 			}
+			break;
+		}
 
-			//  Ҵ  
-			currentBlock = nextBlock;
+		if (handle != NULL)
+		{
+			if (allocated)
+			{	//   پǷ handle inode  ٽ 
+				handle->inode = inode;
+				handle->mapCount = 0;
+			}
+			result = map_file_block(handle, blockSeq, &currentBlock);
 		}
-		blockOffset = currentOffset % sb_info->blockSize;
+		else
+			result = get_allocated_block(file->fs, blockSeq, &inode, &currentBlock);
 
-		copyLength = MIN(sb_info->blockSize - blockOffset, readEnd - currentOffset);
+		if(result != EXT2_SUCCESS || currentBlock == 0)
+		{
+			LOG_ERROR("error : faild to get_allocated_block() in ext2_write()\n");
+			return EXT2_ERROR;
+		}
 
+		//  Ϻθ     о
 		if(copyLength != sb_info->blockSize)
 		{
-			if(read_block(file->fs, currentBlock, buffer) != EXT2_SUCCESS)
+			if(allocated)
+				ZeroMemory(buffer, sb_info->blockSize);
+			else if(read_block(file->fs, currentBlock, buffer) != EXT2_SUCCESS)
 				break;
 		}
 
-		memcpy(&block[blockOffset], buffer, copyLength);
+		memcpy(&buffer[blockOffset], block, copyLength);
 
 		if(write_block(file->fs, currentBlock, buffer) != EXT2_SUCCESS)
 			break;
@@ -179,30 +513,72 @@ int ext2_write(EXT2_NODE* file, unsigned long offset, unsigned long length, cons
 	}
 
 	inode.fileSize = MAX(currentOffset, inode.fileSize);
-	set_inode(file->fs, file->entry.inode, &inode);
-	set_entry(file->fs, &file->location, &file->entry);
+	set_inode(file->fs, file->entry.inode, (BYTE *)&inode);
+	if (handle == NULL)
+		set_entry(file->fs, &file->location, &file->entry);
+	*inodePtr = inode;
 
 	return currentOffset - offset;
 }
 
+/* journal transaction ϳ  ʴ      */
+int ext2_write(EXT2_NODE* file, unsigned long offset, unsigned long length, const char* block)
+{
+	EXT2_FILESYSTEM* fs = file->fs;
+	EXT2_INODE inode;
+	UINT32 inodeNumber = file->entry.inode;
+	EXT2_IO_STATS* outer = enter_op(fs, EXT2_OP_WRITE);
+	unsigned long written = 0;
+	int result, restart;
+
+	do
+	{
+		begin_operation(fs, EXT2_OP_CREDITS);
+		lock_inode(fs, inodeNumber, 1);
+		if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to get_inode() in ext2_write()\n");
+			result = EXT2_ERROR;
+		}
+		else
+			result = write_file(file, &inode, NULL, offset + written, length - written, block + written, &restart);
+		unlock_inode(fs, inodeNumber);
+		end_operation(fs);
+
+		if (result > 0)
+			written += result;
+	} while (result >= 0 && restart && written < length);
+	leave_op(outer);
+
+	return (result < 0 && written == 0) ? result : (int)written;
+}
+
 /*  */
 /* ϴ ũ б */
 int read_block(EXT2_FILESYSTEM* fs, UINT32 block, BYTE* buffer)
 {
 	if (block <= 0) // 0  Ʈ ڵ 
 	{
-		printf("error : invalid block number\n");
+		LOG_ERROR("error : invalid block number\n");
 		return EXT2_ERROR;
 	}
 
 	UINT32 i;
-	UINT32 sectorNumber = (EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE) + (EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE) * (block - 1);
-	UINT32 sectorCount = EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE;
+	UINT32 sectorCount = fs->sb_info.sectorsPerBlock;
+	UINT32 sectorNumber = block * sectorCount;
+
+	trace_block(fs, DISK_READ, block);
+	if (fs->journal != NULL && journal_read_block(fs->journal, block, buffer)) //  checkpoint  Ÿ
+	{
+		ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 0, 1, 0);
+		return EXT2_SUCCESS;
+	}
 
 	for (i = 0; i < sectorCount; i++)
 	{
 		fs->disk->read_sector(fs->disk, sectorNumber + i, &buffer[i * MAX_SECTOR_SIZE]);
 	}
+	ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 0, 1, sectorCount);
 
 	return EXT2_SUCCESS;
 }
@@ -213,2025 +589,4482 @@ int write_block(EXT2_FILESYSTEM * fs, UINT32 block, const BYTE* buffer)
 {
 	if (block <= 0) // 0  Ʈ ڵ 
 	{
-		printf("error : invalid block number\n");
+		LOG_ERROR("error : invalid block number\n");
 		return EXT2_ERROR;
 	}
 	UINT32 i;
-	UINT32 sectorNumber = (EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE) + (EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE) * (block - 1);
-	UINT32 sectorCount = EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE;
+	UINT32 sectorCount = fs->sb_info.sectorsPerBlock;
+	UINT32 sectorNumber = block * sectorCount;
+	int journaled;
+
+	trace_block(fs, DISK_WRITE, block);
+	if (fs->journal != NULL && (journaled = journal_write_block(fs->journal, block, buffer, 0)) != 0) // log ̹  ִ 
+	{	// journal    ڸ  log  ̹ ߿ 
+		if (journaled < 0)
+			return EXT2_ERROR;
+		ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 1, 1, 0);
+		return EXT2_SUCCESS;
+	}
 
 	for (i = 0; i < sectorCount; i++)
 	{
 		fs->disk->write_sector(fs->disk, sectorNumber + i, &buffer[i * MAX_SECTOR_SIZE]);
 	}
+	ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 1, 1, sectorCount);
 
 	return EXT2_SUCCESS;
 }
 
-
-/******************************************************************************/
-/* control count member 													  */
-/******************************************************************************/
-
-/*  */
-/* dir count  */
-int dec_dir_count(EXT2_FILESYSTEM* fs, UINT32 group)
+/* Ÿ  , journal  running transaction  */
+static int write_meta_block(EXT2_FILESYSTEM* fs, UINT32 block, const BYTE* buffer)
 {
-	EXT2_GROUP_DESC desc;
+	if (fs->journal == NULL)
+		return write_block(fs, block, buffer);
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
+	if (block <= 0)
+	{
+		LOG_ERROR("error : invalid block number\n");
 		return EXT2_ERROR;
+	}
 
-	desc.bg_usedDirCount--;
-
-	if (write_desc(fs, group, &desc) != EXT2_SUCCESS)
+	trace_block(fs, DISK_WRITE, block);
+	if (journal_write_block(fs->journal, block, buffer, 1) != 1)
 		return EXT2_ERROR;
-
-	fs->sb_info.dirCount--;
+	ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 1, 1, 0);
 
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/* dir count  */
-int inc_dir_count(EXT2_FILESYSTEM* fs, UINT32 group)
+/*   ,   transaction  ũų Ǿ commit */
+/* ٸ    ̸ commit    , ׶   ٸ */
+/* credits :    Ÿ    */
+static void begin_operation(EXT2_FILESYSTEM* fs, UINT32 credits)
 {
-	EXT2_GROUP_DESC desc;
+	if (fs->journal != NULL)
+		journal_begin(fs->journal, credits);
+}
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+/*   credits ŭ   ϱ  ȣ */
+/* return : EXT2_ERROR transaction ڸ ,  ϰ   ٽ ؾ  */
+static int extend_operation(EXT2_FILESYSTEM* fs, UINT32 credits)
+{
+	if (fs->journal == NULL)
+		return EXT2_SUCCESS;
 
-	desc.bg_usedDirCount++;
+	return journal_extend(fs->journal, credits);
+}
 
-	if (write_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+/*    Ÿ   , ϴ ׷츶 Ʈʰ ׷ ũ */
+/*   ҴǾ ִٰ  ,  ־ ġ  ڸ  װ͵   */
+static UINT32 release_credits(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
+{
+	EXT2_INODE inode;
 
-	fs->sb_info.dirCount++;
+	if (fs->journal == NULL || get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_OP_CREDITS;
 
-	return EXT2_SUCCESS;
+	return EXT2_OP_CREDITS + 2 * MIN(inode.blockCount / fs->sb.blocksPerGroup + 2, fs->sb_info.groupCount);
 }
 
-/*  */
-/* free block count  */
-int dec_freeb_count(EXT2_FILESYSTEM* fs, UINT32 group)
+/*    */
+static void end_operation(EXT2_FILESYSTEM* fs)
 {
-	EXT2_GROUP_DESC desc;
-
-	fs->sb.freeBlockCount--;
+	if (fs->journal != NULL)
+		journal_end(fs->journal);
+}
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
 
-	desc.bg_freeBlockCount--;
+/******************************************************************************/
+/* I/O 																	  */
+/******************************************************************************/
 
-	if (write_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+static UINT64 now_ns(void)
+{
+	struct timespec ts;
 
-	fs->sb_info.freeBlockCount--;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
 
-	return EXT2_SUCCESS;
+UINT64 ext2_time_ns(void)
+{
+	return now_ns();
 }
 
-/*  */
-/* free block count  */
-int inc_freeb_count(EXT2_FILESYSTEM* fs, UINT32 group)
+/*  尡    ٱ  */
+int ext2_current_op(void)
 {
-	EXT2_GROUP_DESC desc;
+	return g_opDepth != 0 ? g_op : EXT2_OP_OTHER;
+}
 
-	fs->sb.freeBlockCount++;
+/*   I/O trace->hook ˸, trace == NULL̸  */
+/* hook param  ͷ ٲٹǷ ȣ ߿  , trace     hook   ؾ  */
+void ext2_set_trace(EXT2_FILESYSTEM* fs, const EXT2_TRACE* trace)
+{
+	__atomic_store_n(&fs->trace, trace, __ATOMIC_RELEASE);
+}
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+static void trace_block(EXT2_FILESYSTEM* fs, int opcode, UINT32 block)
+{
+	const EXT2_TRACE* trace = __atomic_load_n(&fs->trace, __ATOMIC_ACQUIRE);
+	EXT2_TRACE_EVENT event;
+
+	if (trace == NULL)
+		return;
+
+	event.time = now_ns();
+	event.block = block;
+	event.count = 1;
+	event.opcode = opcode;
+	event.origin = ext2_current_op();
+	trace->hook(trace->param, &event);
+}
 
-	desc.bg_freeBlockCount++;
+/* ֻ  , ʿ θ ext2_* Լ I/O ð ٱ 꿡  */
+static EXT2_IO_STATS* enter_op(EXT2_FILESYSTEM* fs, int op)
+{
+	EXT2_IO_STATS* outer = g_opStats;
 
-	if (write_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+	if (g_opDepth++ == 0)
+	{
+		g_op = op;
+		g_opStart = now_ns();
+		if (fs != NULL)
+		{
+			g_opStats = &fs->ioStats[op];
+			ATOMIC_ADD(g_opStats->calls, 1);
+		}
+	}
 
-	fs->sb_info.freeBlockCount++;
+	return outer;
+}
 
-	return EXT2_SUCCESS;
+static void leave_op(EXT2_IO_STATS* outer)
+{
+	if (--g_opDepth == 0)
+		ext2_latency_record(g_op, now_ns() - g_opStart);
+	g_opStats = outer;
 }
 
-/*  */
-/* free inode count  */
-int dec_freei_count(EXT2_FILESYSTEM* fs, UINT32 group)
+/*  꿡 I/O Ƚ ,  ̸ other (NULL̸  ) */
+void ext2_count_io(EXT2_IO_STATS* other, int write, UINT32 blocks, UINT32 sectors)
 {
-	EXT2_GROUP_DESC desc;
+	EXT2_IO_STATS* stats = g_opStats != NULL ? g_opStats : other;
 
-	fs->sb.freeInodeCount--;
+	if (stats == NULL)
+		return;
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+	if (write)
+	{
+		ATOMIC_ADD(stats->blockWrites, blocks);
+		ATOMIC_ADD(stats->sectorWrites, sectors);
+	}
+	else
+	{
+		ATOMIC_ADD(stats->blockReads, blocks);
+		ATOMIC_ADD(stats->sectorReads, sectors);
+	}
+}
 
-	desc.bg_freeInodeCount--;
+/* 꺰 ī͸ stats[EXT2_OP_COUNT] , reset̸ 0 */
+static UINT64 take_counter(UINT64* counter, int reset)
+{
+	return reset ? __atomic_exchange_n(counter, 0, __ATOMIC_RELAXED) : ATOMIC_LOAD(*counter);
+}
 
-	if (write_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
-
-	fs->sb_info.freeInodeCount--;
+void ext2_io_stats(EXT2_FILESYSTEM* fs, EXT2_IO_STATS* stats, int reset)
+{
+	EXT2_IO_STATS* source;
+	UINT32 op;
 
-	return EXT2_SUCCESS;
+	for (op = 0; op < sizeof(fs->ioStats) / sizeof(fs->ioStats[0]); op++)
+	{
+		source = &fs->ioStats[op];
+		stats[op].calls = take_counter(&source->calls, reset);
+		stats[op].blockReads = take_counter(&source->blockReads, reset);
+		stats[op].blockWrites = take_counter(&source->blockWrites, reset);
+		stats[op].sectorReads = take_counter(&source->sectorReads, reset);
+		stats[op].sectorWrites = take_counter(&source->sectorWrites, reset);
+	}
 }
 
-/*  */
-/* free inode count  */
-int inc_freei_count(EXT2_FILESYSTEM* fs, UINT32 group)
+const char* ext2_op_name(int op)
 {
-	EXT2_GROUP_DESC desc;
+	static const char* names[EXT2_OP_COUNT] = {
+		"other", "mount", "umount", "lookup", "read_dir", "create",
+		"mkdir", "remove", "rmdir", "read", "write", "truncate", "format"
+	};
 
-	fs->sb.freeInodeCount++;
-
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+	return (op >= 0 && op < EXT2_OP_COUNT) ? names[op] : "unknown";
+}
 
-	desc.bg_freeInodeCount++;
 
-	if (write_desc(fs, group, &desc) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+/******************************************************************************/
+/* lock																		  */
+/******************************************************************************/
 
-	fs->sb_info.freeInodeCount++;
+/*  尡  ٸ ׷,  ٸ inode ÿ ۾  ֵ   */
+/* ׷ lock : Ʈʰ  , inode table ʱȭ */
+/*  lock :  ׷/inode/Ʈ     ũ, inode table, ͸  read-modify-write */
+/* inode lock :    , ͸  (б ) */
+/* free count atomic   */
+/* mount (format, dump) fs->locks NULL̸   */
 
-	return EXT2_SUCCESS;
+static void lock_group(EXT2_FILESYSTEM* fs, UINT32 group)
+{
+	if (fs->locks != NULL)
+		pthread_mutex_lock(&fs->locks->group[group]);
 }
 
+static void unlock_group(EXT2_FILESYSTEM* fs, UINT32 group)
+{
+	if (fs->locks != NULL)
+		pthread_mutex_unlock(&fs->locks->group[group]);
+}
 
-/******************************************************************************/
-/* manage block and inode													  */
-/******************************************************************************/
+static void lock_block(EXT2_FILESYSTEM* fs, UINT32 block)
+{
+	if (fs->locks != NULL)
+		pthread_mutex_lock(&fs->locks->block[block & (EXT2_BLOCK_LOCKS - 1)]);
+}
 
-/* ڿ  빮ڷ  */
-void upper_string(char* str, int length)
+static void unlock_block(EXT2_FILESYSTEM* fs, UINT32 block)
 {
-	while (*str && length-- > 0)
-	{
-		*str = toupper(*str);
-		str++;
-	}
+	if (fs->locks != NULL)
+		pthread_mutex_unlock(&fs->locks->block[block & (EXT2_BLOCK_LOCKS - 1)]);
 }
 
-/*  */
-/* inode ȣ ̿ ش  Ƽ  */
-int get_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, BYTE* inode)
+/* ٸ 尡 Ϻθ   Ÿ (ũ, inode table, ͸) б */
+static int read_meta_block(EXT2_FILESYSTEM* fs, UINT32 block, BYTE* buffer)
 {
+	int result;
 
-	UINT32 block, offset;
-	UINT32 sectorNum;
-	BYTE buffer[EXT2_BLOCK_SIZE];
+	lock_block(fs, block);
+	result = read_block(fs, block, buffer);
+	unlock_block(fs, block);
 
-	ZeroMemory(buffer, EXT2_BLOCK_SIZE);
+	return result;
+}
 
-	if (get_block_of_inode(fs, inodeNumber, &block) != EXT2_SUCCESS)
-	{
-		// inode   ȣ
-		printf("error : failed to get_block_of_inode() in get_inode()\n");
-		return EXT2_ERROR;
-	}
+/* ׷ ũͰ ִ  */
+static UINT32 get_desc_block(EXT2_FILESYSTEM* fs, UINT32 group)
+{
+	return fs->sb_info.firstDescBlock + (group >> fs->sb_info.descPerBlock_bits);
+}
 
+/*   inode lock ϳ Ƿ  lock   inode deadlock  */
+static void lock_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, int write)
+{
+	pthread_rwlock_t* lock;
 
-	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
-	{
-		printf("error : failed to read_block() in get_inode()\n");
-		return EXT2_ERROR;
-	}
+	if (fs->locks == NULL)
+		return;
 
-	offset = ((inodeNumber - 1) % fs->sb_info.inodesPerGroup) % fs->sb_info.inodesPerBlock; // block  offset
-	//offset = ((inodeNumber - 1) % fs->sb_info.inodesPerGroup) % fs->sb_info.inodesPerBlock;
-	memcpy(inode, &((EXT2_INODE *)buffer)[offset], sizeof(EXT2_INODE));
+	lock = &fs->locks->inode[inodeNumber & (EXT2_INODE_LOCKS - 1)];
+	if (write)
+		pthread_rwlock_wrlock(lock);
+	else
+		pthread_rwlock_rdlock(lock);
+}
 
-	return EXT2_SUCCESS;
+static void unlock_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
+{
+	if (fs->locks != NULL)
+		pthread_rwlock_unlock(&fs->locks->inode[inodeNumber & (EXT2_INODE_LOCKS - 1)]);
 }
 
-/*  */
-/* inode ȣ ̿ buffer   */
-int set_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, BYTE* inode)
+static UINT32 inode_version(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
-	UINT32 block, offset;
-	BYTE buffer[EXT2_BLOCK_SIZE];
+	if (fs->locks == NULL)
+		return 0;
 
-	ZeroMemory(buffer, EXT2_BLOCK_SIZE);
+	return __atomic_load_n(&fs->locks->inodeVersion[inodeNumber & (EXT2_INODE_LOCKS - 1)], __ATOMIC_ACQUIRE);
+}
 
-	if (get_block_of_inode(fs, inodeNumber, &block) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+/* mount  lock  */
+int init_locks(EXT2_FILESYSTEM* fs)
+{
+	EXT2_LOCKS* locks;
+	UINT32 i;
 
-	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
+	release_locks(fs);
+
+	locks = (EXT2_LOCKS *)calloc(1, sizeof(EXT2_LOCKS));
+	if (locks == NULL || (locks->group = (pthread_mutex_t *)calloc(fs->sb_info.groupCount, sizeof(pthread_mutex_t))) == NULL)
 	{
-		printf("error : failed to read_block in get_inode()\n");
+		LOG_ERROR("error : failed to allocate locks\n");
+		free(locks);
 		return EXT2_ERROR;
 	}
 
-	offset = ((inodeNumber - 1) % fs->sb_info.inodesPerGroup) % fs->sb_info.inodesPerBlock;
-	//offset = ((inodeNumber - 1) % fs->sb_info.inodesPerGroup) % fs->sb_info.inodesPerBlock;
-	memcpy(&((EXT2_INODE *)buffer)[offset], inode, sizeof(EXT2_INODE));
+	for (i = 0; i < fs->sb_info.groupCount; i++)
+		pthread_mutex_init(&locks->group[i], NULL);
+	for (i = 0; i < EXT2_BLOCK_LOCKS; i++)
+		pthread_mutex_init(&locks->block[i], NULL);
+	for (i = 0; i < EXT2_INODE_LOCKS; i++)
+		pthread_rwlock_init(&locks->inode[i], NULL);
+	pthread_mutex_init(&locks->orphan, NULL);
+	pthread_mutex_init(&locks->open, NULL);
 
-	if (write_block(fs, block, buffer) != EXT2_SUCCESS)
-	{
-		printf("error : failed to write_block() in set_inode()\n");
-		return EXT2_ERROR;
-	}
+	fs->locks = locks;
 
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/* ͸ Ҵ ׷ ã ˰ 1 */
-int find_group_dir(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, UINT32* retGroup)
+/* lock , ٸ 尡  ̻ fs    ȣ */
+void release_locks(EXT2_FILESYSTEM* fs)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	EXT2_SB_INFO* sb_info;
-	UINT32 groupCount;
-	EXT2_GROUP_DESC *desc, *bestDesc; //    ׷ ũ
-	INT32 group, bestGroup;
-	UINT32 aveFreeInode;
+	EXT2_LOCKS* locks = fs->locks;
+	UINT32 i;
 
-	sb_info = &fs->sb_info;
-	groupCount = sb_info->groupCount; // ü group 
-	aveFreeInode = sb_info->freeInodeCount / groupCount; // free inode ü ׷  
-	bestGroup = -1; //    ׷ ʱⰪ
-	bestDesc = NULL;
+	if (locks == NULL)
+		return;
+
+	for (i = 0; i < fs->sb_info.groupCount; i++)
+		pthread_mutex_destroy(&locks->group[i]);
+	for (i = 0; i < EXT2_BLOCK_LOCKS; i++)
+		pthread_mutex_destroy(&locks->block[i]);
+	for (i = 0; i < EXT2_INODE_LOCKS; i++)
+		pthread_rwlock_destroy(&locks->inode[i]);
+	pthread_mutex_destroy(&locks->orphan);
+	pthread_mutex_destroy(&locks->open);
+
+	free(locks->group);
+	free(locks);
+	fs->locks = NULL;
+}
 
-	for (group = 0; group < groupCount; group++)
-	{
-		if (read_desc(fs, group, buffer) != EXT2_SUCCESS)
-			return EXT2_ERROR;
-		desc = (EXT2_GROUP_DESC *)buffer;
 
-		if (desc == NULL || desc->bg_freeInodeCount == 0)
-			continue;
-		if (desc->bg_freeInodeCount < aveFreeInode);
-		continue;
-		if (bestDesc == NULL ||
-			(desc->bg_freeBlockCount > bestDesc->bg_freeBlockCount))
-		{
-			bestGroup = group;
-			bestDesc = desc;
-		}
-	}
+/******************************************************************************/
+/* lookup cache																  */
+/******************************************************************************/
 
-	if (bestDesc == NULL)
-		return EXT2_ERROR;
+/* д  lock  slot   sequence ״ Ȯ, ٲ ٽ  */
+static UINT32 read_seq_begin(const UINT32* sequence)
+{
+	UINT32 seq;
 
-	*retGroup = bestGroup;
+	while ((seq = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 1) //  ̸   
+		;
 
-	return EXT2_SUCCESS;
+	return seq;
 }
 
-/*  */
-/* ͸ Ҵ ׷ ã ˰ 2 */
-int find_group_orlov(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, UINT32* retGroup)
+static int read_seq_retry(const UINT32* sequence, UINT32 seq)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	EXT2_SB_INFO* sb_info;
-	EXT2_GROUP_DESC *desc, *bestDesc; //    ׷ ũ
-	UINT32 parentBlock, parentGroup; // θ 丮 ̳尡  ϰ ׷ ȣ
-	UINT32 aveFreeInodes, aveFreeBlocks;
-	UINT32 groupCount;
-	UINT32 inodesPerGroup;
-	UINT32 freeInodes, freeBlocks;
-	UINT32 blocksPerDir;
-	UINT32 dirCount;
-	UINT32 maxDirs, minBlocks, minInodes;
-	INT32 group = -1, i;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(sequence, __ATOMIC_RELAXED) != seq;
+}
 
-	srand((UINT32)time(NULL));
+/* seq  ڷ slot Ⱑ     */
+static int write_seq_try(UINT32* sequence, UINT32 seq)
+{
+	if (!__atomic_compare_exchange_n(sequence, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return 0;
+	__atomic_thread_fence(__ATOMIC_RELEASE); // Ȧ sequence 뺸  ̵
 
-	if (get_block_of_inode(fs, parent->entry.inode, &parentBlock) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+	return 1;
+}
 
-	if (get_group_of_block(fs, parentBlock, &parentGroup) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+/* sequence read_seq_begin atomic loadθ а compare exchange Ȧ  */
+static void write_seq_begin(UINT32* sequence)
+{
+	while (!write_seq_try(sequence, read_seq_begin(sequence)))
+		;
+}
 
-	sb_info = &fs->sb_info;
-	groupCount = sb_info->groupCount;
-	inodesPerGroup = sb_info->inodesPerGroup;
+static void write_seq_end(UINT32* sequence)
+{
+	__atomic_fetch_add(sequence, 1, __ATOMIC_RELEASE);
+}
 
-	freeInodes = sb_info->freeInodeCount;
-	aveFreeInodes = freeInodes / groupCount; // free inode  ü ׷  
-	freeBlocks = sb_info->freeBlockCount;
-	aveFreeBlocks = freeBlocks / groupCount;
-	dirCount = sb_info->dirCount; //  丮 
+static EXT2_DENTRY_BUCKET* get_dentry_bucket(EXT2_FILESYSTEM* fs, const BYTE* name)
+{
+	UINT32 hash = 2166136261u; // FNV-1a
+	UINT32 i;
 
+	for (i = 0; i < MAX_ENTRY_NAME_LENGTH; i++)
+		hash = (hash ^ name[i]) * 16777619u;
 
-								  // θ 丮 Ʈ 丮  
-	if (is_root_dir(parent) == EXT2_SUCCESS)
-	{
-		EXT2_GROUP_DESC* bestDesc = NULL;
-		UINT32 bestDirCount = sb_info->inodesPerGroup;
-		UINT32 bestGroup = -1;
+	return &fs->cache->dentry[hash & (EXT2_DCACHE_BUCKETS - 1)];
+}
 
-		group = rand();
-		parentGroup = (UINT32)group % groupCount;
-		for (i = 0; i < groupCount; i++)
-		{
-			group = (parentGroup + i) % groupCount;
-			ZeroMemory(buffer, sizeof(buffer));
-			read_desc(fs, group, buffer);
-			desc = (EXT2_GROUP_DESC *)buffer;
+/* parent ͸ name Ʈ ĳÿ ã */
+/*  EXT2_ERROR, ũ ã  dcache_fill ѱ sequence seq  */
+static int dcache_lookup(EXT2_FILESYSTEM* fs, UINT32 parent, const BYTE* name, EXT2_NODE* retEntry, UINT32* seq)
+{
+	EXT2_DENTRY_BUCKET* bucket;
+	EXT2_DENTRY_SLOT slot;
+	int i, found;
 
-			if (desc == NULL || desc->bg_freeInodeCount == NULL)
-				continue;
-			if (desc->bg_usedDirCount >= bestDirCount)
-				continue;
-			if (desc->bg_freeInodeCount < aveFreeInodes)
-				continue;
-			if (desc->bg_freeBlockCount < aveFreeBlocks)
-				continue;
+	if (fs->cache == NULL)
+		return EXT2_ERROR;
 
-			bestGroup = group;
-			bestDirCount = desc->bg_usedDirCount;
-			bestDesc = desc;
-		}
-		if (bestGroup >= 0)
+	bucket = get_dentry_bucket(fs, name);
+	do
+	{
+		*seq = read_seq_begin(&bucket->sequence);
+		found = 0;
+		for (i = 0; i < EXT2_DCACHE_WAYS; i++)
 		{
-			desc = bestDesc;
-			group = bestGroup;
-			goto found;
+			if (bucket->way[i].parent == parent && memcmp(bucket->way[i].entry.name, name, MAX_ENTRY_NAME_LENGTH) == 0)
+			{
+				slot = bucket->way[i];
+				found = 1;
+				break;
+			}
 		}
-		goto fallback;
-	}
+	} while (read_seq_retry(&bucket->sequence, *seq));
 
-	// 丮  
-	if (dirCount == 0)
-		dirCount = 1;
+	if (!found)
+		return EXT2_ERROR;
 
-	maxDirs = dirCount / groupCount + inodesPerGroup / 16;
-	minInodes = aveFreeInodes - inodesPerGroup / 4;
-	minBlocks = aveFreeBlocks - sb_info->blocksPerGroup / 4;
+	retEntry->fs = fs;
+	retEntry->entry = slot.entry;
+	retEntry->location = slot.location;
 
-	/* debt ٰ  */
+	return EXT2_SUCCESS;
+}
 
-	for (i = 0; i < groupCount; i++)
-	{
-		group = (parentGroup + i) % groupCount;
-		ZeroMemory(buffer, sizeof(buffer));
-		read_desc(fs, group, buffer);
-		desc = (EXT2_GROUP_DESC *)buffer;
+/* bucket Ʈ ,  Ʈ  way  ư ü */
+static void put_dentry(EXT2_DENTRY_BUCKET* bucket, UINT32 parent, const EXT2_NODE* node)
+{
+	EXT2_DENTRY_SLOT* slot = NULL;
+	int i;
 
-		if (desc == NULL || desc->bg_freeInodeCount == 0)
-			continue;
-		if (desc->bg_usedDirCount >= maxDirs)
-			continue;
-		if (desc->bg_freeInodeCount < minInodes)
-			continue;
-		if (desc->bg_freeBlockCount < minBlocks)
-			continue;
-		goto found;
+	for (i = 0; i < EXT2_DCACHE_WAYS && slot == NULL; i++)
+	{
+		if (bucket->way[i].parent == parent && memcmp(bucket->way[i].entry.name, node->entry.name, MAX_ENTRY_NAME_LENGTH) == 0)
+			slot = &bucket->way[i];
+	}
+	for (i = 0; i < EXT2_DCACHE_WAYS && slot == NULL; i++)
+	{
+		if (bucket->way[i].parent == 0)
+			slot = &bucket->way[i];
+	}
+	if (slot == NULL)
+	{
+		slot = &bucket->way[bucket->next];
+		bucket->next = (bucket->next + 1) & (EXT2_DCACHE_WAYS - 1);
 	}
 
-fallback:
+	slot->parent = parent;
+	slot->entry = node->entry;
+	slot->location = node->location;
+}
 
-	for (i = 0; i < groupCount; i++)
-	{
-		group = (parentGroup + i) % groupCount;
-		ZeroMemory(buffer, sizeof(buffer));
-		read_desc(fs, group, buffer);
-		desc = (EXT2_GROUP_DESC *)buffer;
+/* ũ ã Ʈ ĳÿ  */
+/* seq  bucket ٲ   Ʈ   Ƿ   */
+static void dcache_fill(EXT2_FILESYSTEM* fs, UINT32 parent, const EXT2_NODE* node, UINT32 seq)
+{
+	EXT2_DENTRY_BUCKET* bucket;
 
-		if (desc == NULL || desc->bg_freeInodeCount)
-			continue;
-		if (desc->bg_freeInodeCount >= aveFreeInodes)
-			goto found;
+	if (fs->cache == NULL)
+		return;
 
-		// free inode  հ  ū ׷  
-		if (aveFreeInodes)
-		{
-			aveFreeInodes = 0;
-			goto fallback;
-		}
-	}
-	return EXT2_ERROR;
+	bucket = get_dentry_bucket(fs, node->entry.name);
+	if (!write_seq_try(&bucket->sequence, seq))
+		return;
+	put_dentry(bucket, parent, node);
+	write_seq_end(&bucket->sequence);
+}
 
-found:
+/* ͸   Ʈ ĳÿ  */
+static void dcache_add(EXT2_FILESYSTEM* fs, UINT32 parent, const EXT2_NODE* node)
+{
+	EXT2_DENTRY_BUCKET* bucket;
 
-	*retGroup = group;
+	if (fs->cache == NULL)
+		return;
 
-	return EXT2_SUCCESS;
+	bucket = get_dentry_bucket(fs, node->entry.name);
+	write_seq_begin(&bucket->sequence);
+	put_dentry(bucket, parent, node);
+	write_seq_end(&bucket->sequence);
 }
 
-/*  */
-/*  Ҵ ׷ ã ˰ */
-int find_group_other(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, UINT32* retGroup)
+/* ũ Ʈ ٲ  ȣ, location ִ entry ĳÿ  */
+static void dcache_drop_location(EXT2_FILESYSTEM* fs, const EXT2_DIR_ENTRY* entry, const EXT2_DIR_ENTRY_LOCATION* location)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	UINT32 parentGroup, parentBlock;
-	UINT32 groupCount;
-	EXT2_GROUP_DESC* desc;
-	UINT32 group, i;
+	EXT2_DENTRY_BUCKET* bucket;
+	EXT2_DENTRY_SLOT* slot;
+	int i;
 
-	if (get_block_of_inode(fs, parent->entry.inode, &parentBlock) != EXT2_SUCCESS)
-		return EXT2_ERROR;
+	if (fs->cache == NULL)
+		return;
 
-	if (get_group_of_block(fs, parentBlock, &parentGroup) != EXT2_SUCCESS)
-		return EXT2_ERROR;
-
-	//  1.
-	// θ inode
-	group = parentGroup;
-	ZeroMemory(buffer, sizeof(buffer));
-	read_desc(fs, group, buffer);
-	desc = (EXT2_GROUP_DESC *)buffer;
-	if (desc != NULL && desc->bg_freeInodeCount != NULL &&
-		desc->bg_freeBlockCount != NULL)
-		goto found;
+	bucket = get_dentry_bucket(fs, entry->name);
+	write_seq_begin(&bucket->sequence); // ĳÿ  sequence ÷   dcache_fill 
+	for (i = 0; i < EXT2_DCACHE_WAYS; i++)
+	{
+		slot = &bucket->way[i];
+		if (slot->location.group == location->group && slot->location.block == location->block &&
+			slot->location.offset == location->offset)
+			slot->parent = 0;
+	}
+	write_seq_end(&bucket->sequence);
+}
 
+/* parent ͸ name Ʈ ĳÿ  */
+static void dcache_drop(EXT2_FILESYSTEM* fs, UINT32 parent, const BYTE* name)
+{
+	EXT2_DENTRY_BUCKET* bucket;
+	int i;
 
-	// θ 丮  ׷쿡 ڸ   ؽ ˰
-	// ٸ ׷ inode Ҵ .
-	group = (group + parent->entry.inode) % groupCount;
+	if (fs->cache == NULL)
+		return;
 
-	for (i = 1; i < groupCount; i <<= 1)
+	bucket = get_dentry_bucket(fs, name);
+	write_seq_begin(&bucket->sequence);
+	for (i = 0; i < EXT2_DCACHE_WAYS; i++)
 	{
-		group += i;
-		if (group >= groupCount)
-			group -= groupCount;
-		ZeroMemory(buffer, sizeof(buffer));
-		read_desc(fs, group, buffer);
-		desc = (EXT2_GROUP_DESC *)buffer;
-		if (desc != NULL && desc->bg_freeInodeCount != 0 &&
-			desc->bg_freeBlockCount != 0)
-			goto found;
+		if (bucket->way[i].parent == parent && memcmp(bucket->way[i].entry.name, name, MAX_ENTRY_NAME_LENGTH) == 0)
+			bucket->way[i].parent = 0;
 	}
+	write_seq_end(&bucket->sequence);
+}
 
-	//    н  Ž
-	group = parentGroup;
-	for (i = 0; i < groupCount; i++)
+/* inode ĳÿ ã,  EXT2_ERROR icache_fill ѱ sequence */
+static int icache_lookup(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, BYTE* inode, UINT32* seq)
+{
+	EXT2_INODE_SLOT* slot;
+	int found;
+
+	if (fs->cache == NULL)
+		return EXT2_ERROR;
+
+	slot = &fs->cache->inode[inodeNumber & (EXT2_ICACHE_SLOTS - 1)];
+	do
 	{
-		if (++group >= groupCount)
-			group = 0;
-		ZeroMemory(buffer, sizeof(buffer));
-		read_desc(fs, group, buffer);
-		desc = (EXT2_GROUP_DESC *)buffer;
-		if (desc != NULL && desc->bg_freeInodeCount != 0)
-			goto found;
+		*seq = read_seq_begin(&slot->sequence);
+		found = slot->inodeNumber == inodeNumber;
+		if (found)
+			memcpy(inode, &slot->inode, sizeof(EXT2_INODE));
+	} while (read_seq_retry(&slot->sequence, *seq));
+
+	return found ? EXT2_SUCCESS : EXT2_ERROR;
+}
+
+/* ũ  inode ĳÿ , seq  slot ٲ   */
+static void icache_fill(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, const BYTE* inode, UINT32 seq)
+{
+	EXT2_INODE_SLOT* slot;
+
+	if (fs->cache == NULL)
+		return;
+
+	slot = &fs->cache->inode[inodeNumber & (EXT2_ICACHE_SLOTS - 1)];
+	if (!write_seq_try(&slot->sequence, seq))
+		return;
+	slot->inodeNumber = inodeNumber;
+	memcpy(&slot->inode, inode, sizeof(EXT2_INODE));
+	write_seq_end(&slot->sequence);
+}
+
+/* inode ũ   ĳõ , inode == NULL̸ ĳÿ  */
+static void icache_update(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, const BYTE* inode)
+{
+	EXT2_INODE_SLOT* slot;
+
+	if (fs->cache == NULL)
+		return;
+
+	slot = &fs->cache->inode[inodeNumber & (EXT2_ICACHE_SLOTS - 1)];
+	write_seq_begin(&slot->sequence);
+	if (inode != NULL)
+	{
+		slot->inodeNumber = inodeNumber;
+		memcpy(&slot->inode, inode, sizeof(EXT2_INODE));
 	}
-	return EXT2_ERROR;
+	else if (slot->inodeNumber == inodeNumber)
+		slot->inodeNumber = 0;
+	write_seq_end(&slot->sequence);
+}
 
-found:
+/* mount  lookup ĳ  */
+int init_cache(EXT2_FILESYSTEM* fs)
+{
+	release_cache(fs);
 
-	*retGroup = group;
+	fs->cache = (EXT2_CACHE *)calloc(1, sizeof(EXT2_CACHE));
+	if (fs->cache == NULL)
+	{
+		LOG_ERROR("error : failed to allocate lookup cache\n");
+		return EXT2_ERROR;
+	}
 
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/*    ִ Ȯ */
-int has_free_blocks(EXT2_FILESYSTEM* fs)
+/* ĳ , ٸ 尡  ̻ fs    ȣ */
+void release_cache(EXT2_FILESYSTEM* fs)
 {
-	if (fs->sb_info.freeBlockCount == 0)
-		return EXT2_ERROR;
-	else
-		return EXT2_SUCCESS;
+	free(fs->cache);
+	fs->cache = NULL;
 }
 
-/*  Ʈ ޾ƿ */
-int read_block_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+
+/******************************************************************************/
+/* control count member 													  */
+/******************************************************************************/
+
+/* ׷ ũʹ ׷ lock  ¿ ٲٹǷ ȣϴ ʿ ׷ lock  */
+
+/*  */
+/* dir count  */
+int dec_dir_count(EXT2_FILESYSTEM* fs, UINT32 group)
 {
 	EXT2_GROUP_DESC desc;
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
+	if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
-	if (read_block(fs, desc.bg_blockBitmap, buffer) != EXT2_SUCCESS)
+	desc.bg_usedDirCount--;
+
+	if (write_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
+	ATOMIC_ADD(fs->sb_info.dirCount, -1);
+
 	return EXT2_SUCCESS;
 }
 
-/* block bitmap buffer   */
-int write_block_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+/*  */
+/* dir count  */
+int inc_dir_count(EXT2_FILESYSTEM* fs, UINT32 group)
 {
 	EXT2_GROUP_DESC desc;
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
+	if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
-	if (write_block(fs, desc.bg_blockBitmap, buffer) != EXT2_SUCCESS)
+	desc.bg_usedDirCount++;
+
+	if (write_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
+	ATOMIC_ADD(fs->sb_info.dirCount, 1);
+
 	return EXT2_SUCCESS;
 }
 
-/* inode tabla Ʈ ޾ƿ */
-int read_inode_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+/*  */
+/* free block count  */
+int dec_freeb_count(EXT2_FILESYSTEM* fs, UINT32 group)
 {
 	EXT2_GROUP_DESC desc;
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
+	if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
-	if (read_block(fs, desc.bg_inodeBitmap, buffer) != EXT2_SUCCESS)
+	desc.bg_freeBlockCount--;
+
+	if (write_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
+	ATOMIC_ADD(fs->sb.freeBlockCount, -1);
+	ATOMIC_ADD(fs->sb_info.freeBlockCount, -1);
+
 	return EXT2_SUCCESS;
 }
 
 /*  */
-/* inode bitmap buffer   */
-int write_inode_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+/* free block count  */
+int inc_freeb_count(EXT2_FILESYSTEM* fs, UINT32 group)
 {
 	EXT2_GROUP_DESC desc;
 
-	if (read_desc(fs, group, &desc) != EXT2_SUCCESS)
+	if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
-	if (write_block(fs, desc.bg_inodeBitmap, buffer) != EXT2_SUCCESS)
+	desc.bg_freeBlockCount++;
+
+	if (write_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
+	ATOMIC_ADD(fs->sb.freeBlockCount, 1);
+	ATOMIC_ADD(fs->sb_info.freeBlockCount, 1);
+
 	return EXT2_SUCCESS;
 }
 
-/*
-* 1. ũ Ʈ
-* 2. Ʈ 
-* 3. sb, sb_info freeCount Ʈ
-*/
-
 /*  */
-/* block Ҵ */
-int alloc_block(EXT2_FILESYSTEM* fs, EXT2_NODE* entry)
+/* free inode count  */
+int dec_freei_count(EXT2_FILESYSTEM* fs, UINT32 group)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	EXT2_GROUP_DESC* desc;
-	EXT2_INODE* inode;
-	EXT2_DIR_ENTRY_LOCATION location;
-	UINT32 foundBlk;
-	BYTE bit;
-	UINT32 group, block, offset;
-	UINT32 i;
-	UINT32 currGroup;
-	UINT32 inodeNumber = entry->entry.inode;
-	UINT32 lastBlock = 0;
-	UINT32 ptrsPerBlk = sb_info->blockSize / sizeof(UINT32);
+	EXT2_GROUP_DESC desc;
 
-	if (has_free_blocks(fs) != EXT2_SUCCESS)
+	if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
 		return EXT2_ERROR;
 
-	ZeroMemory(buffer, sizeof(buffer));
+	desc.bg_freeInodeCount--;
 
-	group = inodeNumber - 1 / sb_info->inodesPerGroup; // inode  ׷
-	get_block_of_inode(fs, inodeNumber, &block); // inodeȣ   ȣ ϱ
-	offset = inodeNumber % sb_info->inodesPerBlock; //   inode offset
-	get_inode(fs, inodeNumber, buffer);
-	inode = (EXT2_INODE *)buffer; //  inode*  ĳ
-;
-	UINT32 blkSize = sb_info->blockSize;
-	UINT32 groupCount = sb_info->groupCount;
+	if (write_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
-	if (inode->blockCount != 0)
-	{
-		if (get_allocated_block(fs, inode->blockCount - 1, inode, &lastBlock) != EXT2_SUCCESS)
-		{	//   Ҵ  ȣ 
-			printf("error : get_allocated_block() in alloc_block()\n");
-			goto out;
-		}
-	}
-	else
-	{	//blockCount 0 
-		goto other;
-	}
-	
-	get_location_of_block(fs, lastBlock, &location); // lastBlock  location 
-	currGroup = location.group;
-	read_block_bitmap(fs, currGroup, buffer);	// lastBlock  ׷ Ʈ б
-	if (get_bit(location.block + 1, buffer) == 0)
-	{	//  Ҵ    Ȯ
-		foundBlk = lastBlock + 1; // Ҵ ȵ Ҵ
-		goto allocated;
-	}
-	else
-	{
-		if ((bit = get_next_zero_bit(fs, location.block + 1, buffer)) == -1)
-			;	// ٸ ׷ Ž
-		else
-		{
-			foundBlk = bit;
-			goto allocated;
-		}
-	}
+	ATOMIC_ADD(fs->sb.freeInodeCount, -1);
+	ATOMIC_ADD(fs->sb_info.freeInodeCount, -1);
 
-other:
-	currGroup = group; // inode   ׷
-	for (i = 0; i < groupCount; i++) //  Ž
-	{
-		currGroup = (group + i) % groupCount;
-		ZeroMemory(buffer, sizeof(buffer));
-		read_block_bitmap(fs, currGroup, buffer);
-		if ((bit = get_next_zero_bit(fs, 0, buffer)) == -1)
-			continue;
-		else
-		{
-			foundBlk = (currGroup * sb_info->blocksPerGroup) + bit;
-			goto allocated;
-		}
-	}
+	return EXT2_SUCCESS;
+}
 
-out:
-	return EXT2_ERROR;
+/*  */
+/* free inode count  */
+int inc_freei_count(EXT2_FILESYSTEM* fs, UINT32 group)
+{
+	EXT2_GROUP_DESC desc;
 
-allocated:
+	if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
-	set_bit(bit, buffer); // bitmap Ʈ
-	write_block_bitmap(fs, currGroup, buffer); // 
-	set_allocated_block(fs, inode->blockCount++, inode, foundBlk); // i_block Ҵ 
-	dec_freeb_count(fs, currGroup); // free block count 
-	set_inode(fs, inodeNumber, inode);
+	desc.bg_freeInodeCount++;
+
+	if (write_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	ATOMIC_ADD(fs->sb.freeInodeCount, 1);
+	ATOMIC_ADD(fs->sb_info.freeInodeCount, 1);
 
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/* inode Ҵ */
-int alloc_inode(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, EXT2_NODE* entry)
-{
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	EXT2_INODE* inode;
-	BYTE descBuf[EXT2_BLOCK_SIZE];
-	BYTE inodeBuf[EXT2_BLOCK_SIZE];
-	UINT32 group, i;
-	UINT32 ino;
-	EXT2_GROUP_DESC* desc;
-	UINT32 inodeNumber;
-	UINT32 result;
 
-	ZeroMemory(descBuf, EXT2_BLOCK_SIZE);
-	ZeroMemory(inodeBuf, EXT2_BLOCK_SIZE);
+/******************************************************************************/
+/* manage block and inode													  */
+/******************************************************************************/
 
-	if (is_dir(entry) == EXT2_SUCCESS)
+/* ڿ  빮ڷ  */
+void upper_string(char* str, int length)
+{
+	while (*str && length-- > 0)
 	{
-		if (fs->sb.defaultMountOpt & EXT2_MOUNT_OLDALLOC)
-			result = find_group_dir(fs, parent, &group);
-		else
-			result = find_group_orlov(fs, parent, &group);
+		*str = toupper(*str);
+		str++;
 	}
-	else
-		result = find_group_other(fs, parent, &group);
+}
 
-	if (result == EXT2_ERROR)
-		goto fail;
+/*  */
+/* inode ȣ ̿ ش  Ƽ  */
+int get_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, BYTE* inode)
+{
 
-	for (i = 0; i < sb_info->groupCount; i++)
+	UINT32 block, offset;
+	UINT32 seq = 0;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+
+	if (icache_lookup(fs, inodeNumber, inode, &seq) == EXT2_SUCCESS)
+		return EXT2_SUCCESS;
+
+	ZeroMemory(buffer, sizeof(buffer));
+
+	if (get_block_of_inode(fs, inodeNumber, &block) != EXT2_SUCCESS)
 	{
+		// inode   ȣ
+		LOG_ERROR("error : failed to get_block_of_inode() in get_inode()\n");
+		return EXT2_ERROR;
+	}
 
-		/*
-		//  ׷ȣ  ũ б
-		if (read_desc(fs, group, descBuf) != EXT2_SUCCESS)
-		goto fail;
 
-		desc = (EXT2_GROUP_DESC *)descBuf;
-		if (desc == NULL)
-		{
-		if (++group == sb_info->groupCount)
-		group = 0;
-		continue;
-		}
-		*/
+	if (read_meta_block(fs, block, buffer) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : failed to read_block() in get_inode()\n");
+		return EXT2_ERROR;
+	}
 
-		if (++group == sb_info->groupCount)
-		{
-			group = 0;
-			continue;
-		}
+	offset = inode_to_index(&fs->sb_info, inodeNumber) & (fs->sb_info.inodesPerBlock - 1); // block  offset
+	memcpy(inode, &((EXT2_INODE *)buffer)[offset], sizeof(EXT2_INODE));
+	icache_fill(fs, inodeNumber, inode, seq);
 
-		// inode Ʈ о
-		if (read_inode_bitmap(fs, group, inodeBuf) != EXT2_SUCCESS)
-			goto fail;
-		ino = 0;
+	return EXT2_SUCCESS;
+}
 
-		// ino     Ʈȣ return 
-		ino = get_next_zero_bit(fs, ino, inodeBuf);
-		//ino ȣ ׷ inode  Ѿ  ׷ ˻
-		if (ino >= sb_info->inodesPerGroup || ino == -1)
-		{
-			// ׷ ׷ī͸ ʰϸ ׷ 0
-			if (++group == sb_info->groupCount)
-				group = 0;
-			continue;
-		}
+/*  */
+/* inode ȣ ̿ buffer   */
+int set_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, BYTE* inode)
+{
+	UINT32 block, offset;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
 
-		//Ʈ 
-		set_bit(ino, inodeBuf);
-		write_inode_bitmap(fs, group, inodeBuf);
+	ZeroMemory(buffer, sizeof(buffer));
 
-		goto got;
+	if (get_block_of_inode(fs, inodeNumber, &block) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	lock_block(fs, block); //   ٸ inode ÿ   
+	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
+	{
+		unlock_block(fs, block);
+		LOG_ERROR("error : failed to read_block in get_inode()\n");
+		return EXT2_ERROR;
 	}
 
-got:
-	ino += group * sb_info->inodesPerGroup + 1; // ino Ʈ شϴ inode ȣ
+	offset = inode_to_index(&fs->sb_info, inodeNumber) & (fs->sb_info.inodesPerBlock - 1);
+	memcpy(&((EXT2_INODE *)buffer)[offset], inode, sizeof(EXT2_INODE));
 
-	if (ino < EXT2_BAD_INO || ino > fs->sb.inodeCount)
+	if (write_meta_block(fs, block, buffer) != EXT2_SUCCESS)
 	{
-		goto fail;
+		unlock_block(fs, block);
+		LOG_ERROR("error : failed to write_block() in set_inode()\n");
+		return EXT2_ERROR;
 	}
+	icache_update(fs, inodeNumber, inode); //  lock ȿ ؾ ũ   
+	if (fs->locks != NULL) //  inode  ִ file handle ٽ е 
+		__atomic_add_fetch(&fs->locks->inodeVersion[inodeNumber & (EXT2_INODE_LOCKS - 1)], 1, __ATOMIC_RELEASE);
+	unlock_block(fs, block);
 
-	entry->entry.inode = ino; // ο entry inode ʱȭ
+	return EXT2_SUCCESS;
+}
 
-	if (is_dir(entry) == EXT2_SUCCESS)
-		inc_dir_count(fs, group); // dir  ʵ Ʈ
+/*  */
+/* ͸ Ҵ ׷ ã ˰ 1 */
+int find_group_dir(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, UINT32* retGroup)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_SB_INFO* sb_info;
+	UINT32 groupCount;
+	EXT2_GROUP_DESC *desc, *bestDesc; //    ׷ ũ
+	INT32 group, bestGroup;
+	UINT32 aveFreeInode;
+
+	sb_info = &fs->sb_info;
+	groupCount = sb_info->groupCount; // ü group 
+	aveFreeInode = sb_info->freeInodeCount / groupCount; // free inode ü ׷  
+	bestGroup = -1; //    ׷ ʱⰪ
+	bestDesc = NULL;
+
+	for (group = 0; group < groupCount; group++)
+	{
+		if (read_desc(fs, group, buffer) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+		desc = (EXT2_GROUP_DESC *)buffer;
+
+		if (desc == NULL || desc->bg_freeInodeCount == 0)
+			continue;
+		if (desc->bg_freeInodeCount < aveFreeInode);
+		continue;
+		if (bestDesc == NULL ||
+			(desc->bg_freeBlockCount > bestDesc->bg_freeBlockCount))
+		{
+			bestGroup = group;
+			bestDesc = desc;
+		}
+	}
+
+	if (bestDesc == NULL)
+		return EXT2_ERROR;
+
+	*retGroup = bestGroup;
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* ͸ Ҵ ׷ ã ˰ 2 */
+int find_group_orlov(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, UINT32* retGroup)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_SB_INFO* sb_info;
+	EXT2_GROUP_DESC *desc;
+	UINT32 parentBlock, parentGroup; // θ 丮 ̳尡  ϰ ׷ ȣ
+	UINT32 aveFreeInodes, aveFreeBlocks;
+	UINT32 groupCount;
+	UINT32 inodesPerGroup;
+	UINT32 freeInodes, freeBlocks;
+	UINT32 dirCount;
+	UINT32 maxDirs, minBlocks, minInodes;
+	INT32 group = -1, i;
+
+	srand((UINT32)time(NULL));
+
+	if (get_block_of_inode(fs, parent->entry.inode, &parentBlock) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (get_group_of_block(fs, parentBlock, &parentGroup) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	sb_info = &fs->sb_info;
+	groupCount = sb_info->groupCount;
+	inodesPerGroup = sb_info->inodesPerGroup;
+
+	freeInodes = sb_info->freeInodeCount;
+	aveFreeInodes = freeInodes / groupCount; // free inode  ü ׷  
+	freeBlocks = sb_info->freeBlockCount;
+	aveFreeBlocks = freeBlocks / groupCount;
+	dirCount = sb_info->dirCount; //  丮 
+
+
+								  // θ 丮 Ʈ 丮  
+	if (is_root_dir(parent) == EXT2_SUCCESS)
+	{
+		EXT2_GROUP_DESC* bestDesc = NULL;
+		UINT32 bestDirCount = sb_info->inodesPerGroup;
+		UINT32 bestGroup = -1;
+
+		group = rand();
+		parentGroup = (UINT32)group % groupCount;
+		for (i = 0; i < groupCount; i++)
+		{
+			group = (parentGroup + i) % groupCount;
+			ZeroMemory(buffer, sizeof(buffer));
+			read_desc(fs, group, buffer);
+			desc = (EXT2_GROUP_DESC *)buffer;
+
+			if (desc == NULL || desc->bg_freeInodeCount == 0)
+				continue;
+			if (desc->bg_usedDirCount >= bestDirCount)
+				continue;
+			if (desc->bg_freeInodeCount < aveFreeInodes)
+				continue;
+			if (desc->bg_freeBlockCount < aveFreeBlocks)
+				continue;
+
+			bestGroup = group;
+			bestDirCount = desc->bg_usedDirCount;
+			bestDesc = desc;
+		}
+		if (bestGroup >= 0)
+		{
+			desc = bestDesc;
+			group = bestGroup;
+			goto found;
+		}
+		goto fallback;
+	}
+
+	// 丮  
+	if (dirCount == 0)
+		dirCount = 1;
+
+	maxDirs = dirCount / groupCount + inodesPerGroup / 16;
+	minInodes = aveFreeInodes - inodesPerGroup / 4;
+	minBlocks = aveFreeBlocks - sb_info->blocksPerGroup / 4;
+
+	/* debt ٰ  */
+
+	for (i = 0; i < groupCount; i++)
+	{
+		group = (parentGroup + i) % groupCount;
+		ZeroMemory(buffer, sizeof(buffer));
+		read_desc(fs, group, buffer);
+		desc = (EXT2_GROUP_DESC *)buffer;
+
+		if (desc == NULL || desc->bg_freeInodeCount == 0)
+			continue;
+		if (desc->bg_usedDirCount >= maxDirs)
+			continue;
+		if (desc->bg_freeInodeCount < minInodes)
+			continue;
+		if (desc->bg_freeBlockCount < minBlocks)
+			continue;
+		goto found;
+	}
+
+fallback:
+
+	for (i = 0; i < groupCount; i++)
+	{
+		group = (parentGroup + i) % groupCount;
+		ZeroMemory(buffer, sizeof(buffer));
+		read_desc(fs, group, buffer);
+		desc = (EXT2_GROUP_DESC *)buffer;
+
+		if (desc == NULL || desc->bg_freeInodeCount)
+			continue;
+		if (desc->bg_freeInodeCount >= aveFreeInodes)
+			goto found;
+
+		// free inode  հ  ū ׷  
+		if (aveFreeInodes)
+		{
+			aveFreeInodes = 0;
+			goto fallback;
+		}
+	}
+	return EXT2_ERROR;
+
+found:
+
+	*retGroup = group;
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/*  Ҵ ׷ ã ˰ */
+int find_group_other(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, UINT32* retGroup)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 parentGroup, parentBlock;
+	UINT32 groupCount;
+	EXT2_GROUP_DESC* desc;
+	UINT32 group, i;
+
+	groupCount = fs->sb_info.groupCount;
+	if (get_block_of_inode(fs, parent->entry.inode, &parentBlock) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (get_group_of_block(fs, parentBlock, &parentGroup) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	//  1.
+	// θ inode
+	group = parentGroup;
+	ZeroMemory(buffer, sizeof(buffer));
+	read_desc(fs, group, buffer);
+	desc = (EXT2_GROUP_DESC *)buffer;
+	if (desc != NULL && desc->bg_freeInodeCount != 0 &&
+		desc->bg_freeBlockCount != 0)
+		goto found;
+
+
+	// θ 丮  ׷쿡 ڸ   ؽ ˰
+	// ٸ ׷ inode Ҵ .
+	group = (group + parent->entry.inode) % groupCount;
+
+	for (i = 1; i < groupCount; i <<= 1)
+	{
+		group += i;
+		if (group >= groupCount)
+			group -= groupCount;
+		ZeroMemory(buffer, sizeof(buffer));
+		read_desc(fs, group, buffer);
+		desc = (EXT2_GROUP_DESC *)buffer;
+		if (desc != NULL && desc->bg_freeInodeCount != 0 &&
+			desc->bg_freeBlockCount != 0)
+			goto found;
+	}
+
+	//    н  Ž
+	group = parentGroup;
+	for (i = 0; i < groupCount; i++)
+	{
+		if (++group >= groupCount)
+			group = 0;
+		ZeroMemory(buffer, sizeof(buffer));
+		read_desc(fs, group, buffer);
+		desc = (EXT2_GROUP_DESC *)buffer;
+		if (desc != NULL && desc->bg_freeInodeCount != 0)
+			goto found;
+	}
+	return EXT2_ERROR;
+
+found:
+
+	*retGroup = group;
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/*    ִ Ȯ */
+int has_free_blocks(EXT2_FILESYSTEM* fs)
+{
+	if (ATOMIC_LOAD(fs->sb_info.freeBlockCount) == 0)
+		return EXT2_ERROR;
+	else
+		return EXT2_SUCCESS;
+}
+
+/*  Ʈ ޾ƿ */
+int read_block_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+{
+	if (read_block(fs, fs->groupBase[group].blockBitmap, buffer) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (fs->blockSummary != NULL && !fs->blockSummary[group].valid)
+		update_group_summary(fs->blockSummary, fs->blockGroupMap, group, buffer, fs->sb_info.blocksPerGroup);
+
+	return EXT2_SUCCESS;
+}
+
+/* block bitmap buffer   */
+int write_block_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+{
+	if (write_meta_block(fs, fs->groupBase[group].blockBitmap, buffer) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	update_group_summary(fs->blockSummary, fs->blockGroupMap, group, buffer, fs->sb_info.blocksPerGroup);
+
+	return EXT2_SUCCESS;
+}
+
+/* inode tabla Ʈ ޾ƿ */
+int read_inode_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+{
+	if (read_block(fs, fs->groupBase[group].inodeBitmap, buffer) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (fs->inodeSummary != NULL && !fs->inodeSummary[group].valid)
+		update_group_summary(fs->inodeSummary, fs->inodeGroupMap, group, buffer, fs->sb_info.inodesPerGroup);
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* inode bitmap buffer   */
+int write_inode_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer)
+{
+	if (write_meta_block(fs, fs->groupBase[group].inodeBitmap, buffer) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	update_group_summary(fs->inodeSummary, fs->inodeGroupMap, group, buffer, fs->sb_info.inodesPerGroup);
+
+	return EXT2_SUCCESS;
+}
+
+/*
+* 1. ũ Ʈ
+* 2. Ʈ 
+* 3. sb, sb_info freeCount Ʈ
+*/
+
+/*  */
+/* goalGroup goalBit free  ã Ʈʰ free count ݿ */
+static int take_free_block(EXT2_FILESYSTEM* fs, UINT32 goalGroup, UINT32 goalBit, UINT32* retBlk)
+{
+	BYTE bitmap[EXT2_MAX_BLOCK_SIZE];
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	UINT32 groupCount = sb_info->groupCount;
+	UINT32 currGroup, i;
+	INT32 bit, next;
+
+	if (has_free_blocks(fs) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	currGroup = goalGroup;
+	if (goalBit != 0)
+	{	//  Ҵ   Ϻ Ȯ
+		lock_group(fs, currGroup);
+		read_block_bitmap(fs, currGroup, bitmap);
+		if ((bit = get_next_zero_bit(fs->blockSummary ? &fs->blockSummary[currGroup] : NULL,
+			goalBit, bitmap, sb_info->blocksPerGroup)) != -1)
+			goto found;
+		unlock_group(fs, currGroup);
+	}
+
+	// ٸ ׷ Ž
+	for (i = 0; i < groupCount; i++) //  Ʈ free  ִ ׷츸 Ž
+	{
+		if ((next = get_next_free_group(fs->blockGroupMap, groupCount, currGroup)) == -1)
+			break;
+		currGroup = next;
+
+		ZeroMemory(bitmap, sizeof(bitmap));
+		lock_group(fs, currGroup);
+		read_block_bitmap(fs, currGroup, bitmap);
+		if ((bit = get_next_zero_bit(fs->blockSummary ? &fs->blockSummary[currGroup] : NULL,
+			0, bitmap, sb_info->blocksPerGroup)) != -1)
+			goto found;
+
+		if (fs->blockGroupMap != NULL)
+			__atomic_fetch_and(&fs->blockGroupMap[currGroup >> 6], ~(1ULL << (currGroup & 63)), __ATOMIC_RELAXED);
+		unlock_group(fs, currGroup);
+		currGroup = (currGroup + 1) % groupCount;
+	}
+
+	return EXT2_ERROR;
+
+found:
+	set_bit(bit, bitmap); // bitmap Ʈ
+	write_block_bitmap(fs, currGroup, bitmap); //  Ʈʵ Բ 
+	dec_freeb_count(fs, currGroup); // free block count 
+	unlock_group(fs, currGroup);
+	*retBlk = fs->groupBase[currGroup].firstBlock + bit;
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/*  ῡ   Ҵ, 0 ʱȭ */
+/* nearBlk ̿ ã, blockCount Ե  */
+static int alloc_index_block(EXT2_FILESYSTEM* fs, UINT32 nearBlk, UINT32* retBlk)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_DIR_ENTRY_LOCATION location;
+
+	get_location_of_block(fs, nearBlk, &location);
+	if (take_free_block(fs, location.group, location.block + 1, retBlk) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : no free block for indirect block\n");
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(buffer, sizeof(buffer));
+	return write_meta_block(fs, *retBlk, buffer);
+}
+
+/*  */
+/* block Ҵ */
+int alloc_block(EXT2_FILESYSTEM* fs, EXT2_NODE* entry)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	EXT2_INODE* inode;
+	EXT2_DIR_ENTRY_LOCATION location;
+	UINT32 foundBlk;
+	UINT32 goalGroup, goalBit = 0;
+	UINT32 inodeNumber = entry->entry.inode;
+	UINT32 lastBlock = 0;
+
+	ZeroMemory(buffer, sizeof(buffer));
+
+	get_inode(fs, inodeNumber, buffer);
+	inode = (EXT2_INODE *)buffer; //  inode*  ĳ
+	goalGroup = inode_to_group(sb_info, inodeNumber); // inode  ׷
+
+	if (inode->blockCount != 0)
+	{
+		if (get_allocated_block(fs, inode->blockCount - 1, inode, &lastBlock) != EXT2_SUCCESS)
+		{	//   Ҵ  ȣ 
+			LOG_ERROR("error : get_allocated_block() in alloc_block()\n");
+			return EXT2_ERROR;
+		}
+		get_location_of_block(fs, lastBlock, &location); // lastBlock  location 
+		goalGroup = location.group;
+		goalBit = location.block + 1;
+	}
+
+	if (take_free_block(fs, goalGroup, goalBit, &foundBlk) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (set_allocated_block(fs, inode->blockCount, inode, foundBlk) != EXT2_SUCCESS) // i_block Ҵ
+		return EXT2_ERROR;
+	inode->blockCount++;
+	set_inode(fs, inodeNumber, (BYTE *)inode);
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* inode Ҵ */
+int alloc_inode(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, EXT2_NODE* entry)
+{
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	EXT2_INODE* inode;
+	BYTE descBuf[EXT2_MAX_BLOCK_SIZE];
+	BYTE inodeBuf[EXT2_MAX_BLOCK_SIZE];
+	UINT32 group, i;
+	UINT32 ino;
+	UINT32 result;
+
+	ZeroMemory(descBuf, sizeof(descBuf));
+	ZeroMemory(inodeBuf, sizeof(inodeBuf));
+
+	if (is_dir(entry) == EXT2_SUCCESS)
+	{
+		if (fs->sb.defaultMountOpt & EXT2_MOUNT_OLDALLOC)
+			result = find_group_dir(fs, parent, &group);
+		else
+			result = find_group_orlov(fs, parent, &group);
+	}
+	else
+		result = find_group_other(fs, parent, &group);
+
+	if (result == EXT2_ERROR)
+		goto fail;
+
+	for (i = 0; i < sb_info->groupCount; i++)
+	{
+		INT32 next, bit;
+
+		//  Ʈ free inode ִ ׷ ٷ ̵
+		if ((next = get_next_free_group(fs->inodeGroupMap, sb_info->groupCount, group)) == -1)
+			break;
+		group = next;
+
+		// inode Ʈ о
+		lock_group(fs, group);
+		if (read_inode_bitmap(fs, group, inodeBuf) != EXT2_SUCCESS)
+		{
+			unlock_group(fs, group);
+			goto fail;
+		}
+
+		//    zero Ʈȣ return  (׷ inode  ̳)
+		bit = get_next_zero_bit(fs->inodeSummary ? &fs->inodeSummary[group] : NULL,
+			0, inodeBuf, sb_info->inodesPerGroup);
+		if (bit == -1)
+		{
+			if (fs->inodeGroupMap != NULL)
+				__atomic_fetch_and(&fs->inodeGroupMap[group >> 6], ~(1ULL << (group & 63)), __ATOMIC_RELAXED);
+			unlock_group(fs, group);
+			// ׷ ׷ī͸ ʰϸ ׷ 0
+			if (++group == sb_info->groupCount)
+				group = 0;
+			continue;
+		}
+		ino = bit;
+
+		// ʱȭ  inode table ̸ Ʈ   0 ä (ص    inode )
+		//  ׷쿡  Ҵ inode ʱȭ    ʵ ׷ lock  ä ó
+		if (init_inode_table(fs, group, ino + 1) != EXT2_SUCCESS)
+		{
+			unlock_group(fs, group);
+			goto fail;
+		}
+
+		//Ʈ 
+		set_bit(ino, inodeBuf);
+		if (write_inode_bitmap(fs, group, inodeBuf) != EXT2_SUCCESS)
+		{
+			unlock_group(fs, group);
+			goto fail;
+		}
+
+		goto got;
+	}
+	goto fail;
+
+got:
+	if (is_dir(entry) == EXT2_SUCCESS)
+		inc_dir_count(fs, group); // dir  ʵ Ʈ
+
+	dec_freei_count(fs, group); // free inode  ʵ Ʈ
+	unlock_group(fs, group);
+
+	ino += group * sb_info->inodesPerGroup + 1; // ino Ʈ شϴ inode ȣ
+
+	if (ino < EXT2_BAD_INO || ino > fs->sb.inodeCount)
+	{
+		goto fail;
+	}
+
+	entry->entry.inode = ino; // ο entry inode ʱȭ
+
+	ZeroMemory(inodeBuf, sizeof(inodeBuf)); //  inode   Ƿ   
+
+	inode = (EXT2_INODE *)inodeBuf;
+	inode->blockCount = 0;
+	if (is_dir(entry) == EXT2_SUCCESS)
+	{
+		inode->fileMode |= FILE_TYPE_DIR;
+		inode->linkCount = 2; // θ Ʈ "."
+	}
+	else
+	{
+		inode->fileMode |= FILE_TYPE_FILE;
+		inode->linkCount = 1;
+	}
+	inode->fileSize = 0;
+
+	set_inode(fs, ino, (BYTE *)inode);
+
+	return EXT2_SUCCESS;
+
+fail:
+	return EXT2_ERROR;
+}
+
+/* group inode table   count inode ִ ϱ 0 ʱȭ */
+/* ʱȭ  ũ bg_itableUnused  */
+static int init_inode_table(EXT2_FILESYSTEM* fs, UINT32 group, UINT32 count)
+{
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	EXT2_GROUP_DESC desc;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 inodesPerBlock = sb_info->inodesPerBlock;
+	UINT32 initialized, block, lastBlock, i;
+
+	if (!(fs->sb.featureROCompat & EXT2_FEATURE_RO_COMPAT_UNINIT_BG))
+		return EXT2_SUCCESS;
+
+	if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (!(desc.bg_flags & EXT2_BG_INODE_UNINIT))
+		return EXT2_SUCCESS;
+
+	initialized = sb_info->inodesPerGroup - desc.bg_itableUnused; // ʱȭ inode  (high-water mark)
+	if (count > sb_info->inodesPerGroup)
+		count = sb_info->inodesPerGroup;
+	if (count <= initialized)
+		return EXT2_SUCCESS;
+
+	ZeroMemory(buffer, sizeof(buffer));
+	lastBlock = (count + inodesPerBlock - 1) / inodesPerBlock;
+	for (block = initialized / inodesPerBlock; block < lastBlock; block++)
+	{
+		if (write_block(fs, desc.bg_inodeTable + block, buffer) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+	}
+	for (i = initialized; i < lastBlock * inodesPerBlock && i < sb_info->inodesPerGroup; i++)
+		icache_update(fs, group * sb_info->inodesPerGroup + i + 1, NULL); // 0 ä inode ĳÿ 
+
+	initialized = MIN(lastBlock * inodesPerBlock, sb_info->inodesPerGroup);
+	desc.bg_itableUnused = sb_info->inodesPerGroup - initialized;
+	if (desc.bg_itableUnused == 0)
+	{
+		desc.bg_flags &= ~EXT2_BG_INODE_UNINIT;
+		desc.bg_flags |= EXT2_BG_INODE_ZEROED;
+	}
+
+	return write_desc(fs, group, (BYTE *)&desc);
+}
+
+/* ʱȭ  inode table ִ maxGroups ׷츸ŭ ʱȭ (0̸ ü) */
+/* mount ߿ ׶ 尡  ׷쾿 ȣ,  ׷  0  */
+/* fs->itableNext  ׷ ʱȭ Ƿ ٽ  , ׶  Բ ȣص  */
+int ext2_init_inode_tables(EXT2_FILESYSTEM* fs, UINT32 maxGroups)
+{
+	EXT2_GROUP_DESC desc;
+	UINT32 group, done = 0;
+	int result;
+
+	if (!(fs->sb.featureROCompat & EXT2_FEATURE_RO_COMPAT_UNINIT_BG))
+		return 0;
+
+	for (group = ATOMIC_LOAD(fs->itableNext); group < fs->sb_info.groupCount; group++)
+	{
+		__atomic_store_n(&fs->itableNext, group, __ATOMIC_RELAXED);
+		if (read_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+
+		if (!(desc.bg_flags & EXT2_BG_INODE_UNINIT))
+			continue;
+
+		if (maxGroups != 0 && done == maxGroups)
+			return 1;
+
+		lock_group(fs, group);
+		result = init_inode_table(fs, group, fs->sb_info.inodesPerGroup);
+		unlock_group(fs, group);
+		if (result != EXT2_SUCCESS)
+			return EXT2_ERROR;
+		done++;
+	}
+	__atomic_store_n(&fs->itableNext, group, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+/* mount   inode table  ׷쾿 ʱȭϴ ׶  */
+#define EXT2_ITABLE_INIT_DELAY	1	/* ms, ׷ ̿ ٸ 꿡 ũ 纸ϴ ð */
+
+typedef struct ext2_itable_init {
+	pthread_t		thread;
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;			/* umount ٸ 带  */
+	UINT32			stop;
+} EXT2_ITABLE_INIT;
+
+static void* itable_init_thread(void* arg)
+{
+	EXT2_FILESYSTEM* fs = (EXT2_FILESYSTEM *)arg;
+	EXT2_ITABLE_INIT* init = fs->itableInit;
+	struct timespec until;
+	int result = 1;
+
+	pthread_mutex_lock(&init->lock);
+	while (!init->stop && result == 1)
+	{
+		pthread_mutex_unlock(&init->lock);
+		begin_operation(fs, EXT2_OP_CREDITS);
+		result = ext2_init_inode_tables(fs, 1);
+		end_operation(fs);
+
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_nsec += EXT2_ITABLE_INIT_DELAY * 1000000;
+		if (until.tv_nsec >= 1000000000)
+		{
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000;
+		}
+		pthread_mutex_lock(&init->lock);
+		if (!init->stop && result == 1)
+			pthread_cond_timedwait(&init->wake, &init->lock, &until);
+	}
+	pthread_mutex_unlock(&init->lock);
+
+	if (result == EXT2_ERROR)
+		LOG_WARN("warning : background inode table initialization stopped at group %u\n", ATOMIC_LOAD(fs->itableNext));
+
+	return NULL;
+}
+
+/* ʱȭ  inode table   ִ file system̸ ׶ ʱȭ  */
+/*  ص alloc_inode Ҵ  ʱȭϹǷ mount   */
+static void start_itable_init(EXT2_FILESYSTEM* fs)
+{
+	EXT2_ITABLE_INIT* init;
+
+	fs->itableInit = NULL;
+	if (!(fs->sb.featureROCompat & EXT2_FEATURE_RO_COMPAT_UNINIT_BG))
+		return;
+
+	if ((init = (EXT2_ITABLE_INIT *)calloc(1, sizeof(EXT2_ITABLE_INIT))) == NULL)
+		return;
+	pthread_mutex_init(&init->lock, NULL);
+	pthread_cond_init(&init->wake, NULL);
+	fs->itableInit = init;
+
+	if (pthread_create(&init->thread, NULL, itable_init_thread, fs) != 0)
+	{
+		fs->itableInit = NULL;
+		pthread_mutex_destroy(&init->lock);
+		pthread_cond_destroy(&init->wake);
+		free(init);
+	}
+}
+
+static void stop_itable_init(EXT2_FILESYSTEM* fs)
+{
+	EXT2_ITABLE_INIT* init = fs->itableInit;
+
+	if (init == NULL)
+		return;
+
+	pthread_mutex_lock(&init->lock);
+	init->stop = 1;
+	pthread_cond_signal(&init->wake);
+	pthread_mutex_unlock(&init->lock);
+	pthread_join(init->thread, NULL);
+
+	pthread_mutex_destroy(&init->lock);
+	pthread_cond_destroy(&init->wake);
+	free(init);
+	fs->itableInit = NULL;
+}
+
+/*   ׷   Ʈʰ free count    */
+/* Ʈ   flush   ׷ lock   */
+typedef struct {
+	UINT32		group;
+	UINT32		count;				/*  ׷쿡    */
+	UINT32		locked;				/* group lock  bitmap о  */
+	BYTE		bitmap[EXT2_MAX_BLOCK_SIZE];
+} BLOCK_RELEASE;
+
+static int flush_release(EXT2_FILESYSTEM* fs, BLOCK_RELEASE* release)
+{
+	EXT2_GROUP_DESC desc;
+	int result = EXT2_SUCCESS;
+
+	if (!release->locked)
+		return EXT2_SUCCESS;
+
+	if (release->count != 0)
+	{
+		if (write_block_bitmap(fs, release->group, release->bitmap) != EXT2_SUCCESS ||
+			read_desc(fs, release->group, (BYTE *)&desc) != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+		else
+		{
+			desc.bg_freeBlockCount += release->count;
+			result = write_desc(fs, release->group, (BYTE *)&desc);
+		}
+
+		if (result == EXT2_SUCCESS)
+		{
+			ATOMIC_ADD(fs->sb.freeBlockCount, release->count);
+			ATOMIC_ADD(fs->sb_info.freeBlockCount, release->count);
+		}
+	}
+
+	unlock_group(fs, release->group);
+	release->count = 0;
+	release->locked = 0;
+
+	return result;
+}
+
+/*  ϳ free ǥ, ̹ free   (orphan ó ߰  ٽ   ) */
+static int release_block(EXT2_FILESYSTEM* fs, BLOCK_RELEASE* release, UINT32 block)
+{
+	UINT32 group, bit;
+
+	if (block < fs->sb.firstDataBlock || block >= fs->sb.blockCount)
+	{
+		LOG_ERROR("error : invalid block number %u to release\n", block);
+		return EXT2_ERROR;
+	}
+
+	group = block_to_group(fs, block);
+	bit = block_to_index(fs, block);
+
+	if (release->locked && release->group != group && flush_release(fs, release) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (!release->locked)
+	{
+		lock_group(fs, group);
+		release->group = group;
+		release->locked = 1;
+		if (read_block_bitmap(fs, group, release->bitmap) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+	}
+
+	if (get_bit(bit, release->bitmap))
+	{
+		set_bit(bit, release->bitmap);
+		release->count++;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/*   Ʈ   from    */
+/* level ܰ   block base ϴ   Ŵ */
+/* return : 1(block  ), 0(  ) */
+static int release_tree(EXT2_FILESYSTEM* fs, BLOCK_RELEASE* release, UINT32 block, UINT32 level, UINT64 base, UINT64 from)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32* ptr = (UINT32 *)buffer;
+	UINT32 ptrBits = fs->sb_info.blockSize_bits + 8;
+	UINT64 span = 1ULL << (ptrBits * (level - 1)); //  ϳ Ű   
+	UINT32 i, remain = 0, changed = 0;
+
+	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
+		return 0;
+
+	for (i = 0; i < (1U << ptrBits); i++)
+	{
+		if (ptr[i] == 0)
+			continue;
+
+		if (base + (i + 1) * span <= from) // ܵ 
+			remain = 1;
+		else if (level == 1 ? (release_block(fs, release, ptr[i]) == EXT2_SUCCESS) :
+			release_tree(fs, release, ptr[i], level - 1, base + i * span, from))
+		{
+			ptr[i] = 0;
+			changed = 1;
+		}
+		else
+			remain = 1;
+	}
+
+	if (!remain)
+		return release_block(fs, release, block) == EXT2_SUCCESS;
+
+	if (changed)
+		write_meta_block(fs, block, buffer);
+
+	return 0;
+}
+
+/* inode   from ĸ  ϰ i_block, blockCount  */
+/* inode ȣ ʿ set_inode  */
+static int truncate_blocks(EXT2_FILESYSTEM* fs, EXT2_INODE* inode, UINT32 from)
+{
+	BLOCK_RELEASE release;
+	UINT32 ptrBits = fs->sb_info.blockSize_bits + 8;
+	UINT64 base = EXT2_NDIR_BLOCKS;
+	UINT32 i;
+
+	release.group = 0;
+	release.count = 0;
+	release.locked = 0;
+
+	for (i = from; i < EXT2_NDIR_BLOCKS; i++)
+	{
+		if (inode->i_block[i] != 0 && release_block(fs, &release, inode->i_block[i]) == EXT2_SUCCESS)
+			inode->i_block[i] = 0;
+	}
+
+	for (i = 1; i <= 3; i++) // , ,   
+	{
+		UINT32 index = EXT2_IND_BLOCK + i - 1;
+		UINT64 span = 1ULL << (ptrBits * i);
+
+		if (inode->i_block[index] != 0 && base + span > from &&
+			release_tree(fs, &release, inode->i_block[index], i, base, from))
+			inode->i_block[index] = 0;
+		base += span;
+	}
+
+	if (inode->blockCount > from)
+		inode->blockCount = from;
+
+	return flush_release(fs, &release);
+}
+
+/* inode ϳ free ǥ, ̹ free inode  */
+static int release_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, UINT32 isDir)
+{
+	BYTE bitmap[EXT2_MAX_BLOCK_SIZE];
+	UINT32 group = inode_to_group(&fs->sb_info, inodeNumber);
+	UINT32 bit = inode_to_index(&fs->sb_info, inodeNumber);
+	int result = EXT2_SUCCESS;
+
+	lock_group(fs, group);
+	if (read_inode_bitmap(fs, group, bitmap) != EXT2_SUCCESS)
+		result = EXT2_ERROR;
+	else if (get_bit(bit, bitmap))
+	{
+		set_bit(bit, bitmap);
+		if ((result = write_inode_bitmap(fs, group, bitmap)) == EXT2_SUCCESS)
+		{
+			if (isDir)
+				dec_dir_count(fs, group);
+			result = inc_freei_count(fs, group);
+		}
+	}
+	unlock_group(fs, group);
+
+	return result;
+}
+
+/* Ͽ Ҵ ϵ ٽ free · ȯ */
+int free_block(EXT2_NODE* retEntry)
+{
+	EXT2_INODE inode;
+
+	if (get_inode(retEntry->fs, retEntry->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (truncate_blocks(retEntry->fs, &inode, 0) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+	inode.fileSize = 0;
+
+	return set_inode(retEntry->fs, retEntry->entry.inode, (BYTE *)&inode);
+}
+
+/* Ͽ Ҵ inode ٽ free · ȯ */
+int free_inode(EXT2_NODE* retEntry)
+{
+	EXT2_INODE inode;
+
+	if (get_inode(retEntry->fs, retEntry->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	inode.linkCount = 0;
+	inode.dTime = time(NULL);
+	if (set_inode(retEntry->fs, retEntry->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	return release_inode(retEntry->fs, retEntry->entry.inode, (inode.fileMode & 0xF000) == FILE_TYPE_DIR);
+}
+
+
+/******************************************************************************/
+/* format																	  */
+/******************************************************************************/
+
+/*  ߿ fs Ƿ disk  ũ    */
+static int format_read_block(DISK_OPERATIONS* disk, UINT32 blkSize, UINT32 block, BYTE* buffer)
+{
+	UINT32 sectorsPerBlock = blkSize / MAX_SECTOR_SIZE;
+	SECTOR sectorNumber = (SECTOR)block * sectorsPerBlock;
+	UINT32 i;
+
+	for (i = 0; i < sectorsPerBlock; i++)
+	{
+		if (disk->read_sector(disk, sectorNumber + i, &buffer[i * MAX_SECTOR_SIZE]) != 0)
+			return EXT2_ERROR;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+static int format_write_block(DISK_OPERATIONS* disk, UINT32 blkSize, UINT32 block, const BYTE* buffer)
+{
+	UINT32 sectorsPerBlock = blkSize / MAX_SECTOR_SIZE;
+	SECTOR sectorNumber = (SECTOR)block * sectorsPerBlock;
+	UINT32 i;
+
+	for (i = 0; i < sectorsPerBlock; i++)
+	{
+		if (disk->write_sector(disk, sectorNumber + i, &buffer[i * MAX_SECTOR_SIZE]) != 0)
+			return EXT2_ERROR;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/* number base ŵ (1 ) */
+static int is_power_of(UINT32 number, UINT32 base)
+{
+	while (number > 1 && number % base == 0)
+		number /= base;
+
+	return number == 1;
+}
+
+/*  ׷쿡 ۺϰ ׷ ũ ̺  ִ */
+/* sparse super 忡 0, 1 3, 5, 7 ŵ ° ׷쿡  */
+int ext2_group_has_super(const EXT2_SUPER_BLOCK* sb, UINT32 group)
+{
+	if (!(sb->featureROCompat & EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER) || group <= 1)
+		return 1;
+
+	return is_power_of(group, 3) || is_power_of(group, 5) || is_power_of(group, 7);
+}
+
+/*  ׷ block bitmap  ȣ ( ڷ inode bitmap, inode table ̾) */
+static UINT32 get_group_bitmap_block(const EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+{
+	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
+	UINT32 groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1;
+	UINT32 descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize;
+	UINT32 block = sb->firstDataBlock + blkGroupNumber * sb->blocksPerGroup;
+
+	if (ext2_group_has_super(sb, blkGroupNumber))
+		block += 1 + descTableBlks; // ۺ, ׷ ũ ̺
+
+	return block;
+}
+
+/*  ׷ ü   ׷ պκ Ÿ   */
+/* Ÿ : ۺ, ׷ ũ ̺ ( ִ ׷츸), block bitmap, inode bitmap, inode table */
+static void get_group_layout(const EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber, UINT32* groupBlocks, UINT32* metaBlocks)
+{
+	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
+	UINT32 inoBlksPerGroup = ((sb->inodesPerGroup * sb->inodeSize) + (blkSize - 1)) / blkSize;
+	UINT32 groupStart = sb->firstDataBlock + blkGroupNumber * sb->blocksPerGroup;
+
+	*metaBlocks = get_group_bitmap_block(sb, blkGroupNumber) - groupStart + 2 + inoBlksPerGroup;
+	*groupBlocks = MIN(sb->blockCount - groupStart, sb->blocksPerGroup); //  ׷ ª  
+}
+
+/*  */
+/* ۺ ü    */
+int fill_super_block(EXT2_SUPER_BLOCK* sb, UINT32 numberOfSectors, UINT32 bytesPerSector, UINT32 logBlockSize, UINT32 sparseSuper)
+{
+	UINT32 groupCount;
+	UINT32 descTableBlks;
+
+	QWORD totalSize;
+	UINT32 blkSize;
+	UINT32 totalBlkCnt;
+	UINT32 blkPerGroup;
+	UINT32 inoBlksPerGroup, inodesPerGroup;
+	UINT32 firstDataBlock;
+	UINT32 groupBlocks, metaBlocks;
+	UINT32 i;
+
+	ZeroMemory(sb, sizeof(*sb));
+
+	if (logBlockSize > 2)
+	{
+		LOG_ERROR("error : invalid block size\n");
+		return EXT2_ERROR;
+	}
+
+	blkSize = EXT2_MIN_BLOCK_SIZE << logBlockSize; // ϳ   
+	totalSize = (QWORD)numberOfSectors * bytesPerSector; // ũ ü ũ 
+	totalBlkCnt = (UINT32)(totalSize / blkSize); // ü   (  ʹ  )
+	firstDataBlock = (blkSize == EXT2_MIN_BLOCK_SIZE) ? 1 : 0; // 1KB ̸ 0  Ʈ 
+
+	blkPerGroup = blkSize << 3; // Ʈ   Ʈ  
+	groupCount = ((totalBlkCnt - firstDataBlock - 1) / blkPerGroup) + 1;
+
+	inodesPerGroup = MIN((totalBlkCnt / 2) / groupCount, blkSize << 3); // inode bitmap  
+	inoBlksPerGroup = ((EXT2_INODE_SIZE * inodesPerGroup) + (blkSize - 1)) / blkSize; // ׷ inode table  
+	descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize; // ׷ ũͰ ϴ   
+
+	//  ׷ ŸͿ   ϳ  ϸ 
+	if (groupCount > 1 &&
+		totalBlkCnt - (firstDataBlock + (groupCount - 1) * blkPerGroup) < 3 + descTableBlks + inoBlksPerGroup + 1)
+	{
+		groupCount--;
+		totalBlkCnt = firstDataBlock + groupCount * blkPerGroup;
+	}
+
+	if (totalBlkCnt <= firstDataBlock + 3 + descTableBlks + inoBlksPerGroup + 1)
+	{
+		LOG_ERROR("error : disk is too small\n");
+		return EXT2_ERROR;
+	}
+
+	sb->inodeCount = inodesPerGroup * groupCount;
+	sb->blockCount = totalBlkCnt;
+
+	sb->magicSignature = 0xEF53;
+
+	sb->reservedBlockCount = totalBlkCnt / 20;
+	sb->freeInodeCount = sb->inodeCount;
+	sb->firstDataBlock = firstDataBlock;
+	sb->logBlockSize = logBlockSize;
+	sb->logFragSize = logBlockSize;
+	sb->inodesPerGroup = inodesPerGroup;
+
+	sb->firstInode = EXT2_GOOD_OLD_FIRST_INO;
+	sb->inodeSize = EXT2_INODE_SIZE;
+	sb->blocksPerGroup = blkPerGroup;
+	if (sparseSuper)
+		sb->featureROCompat |= EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER;
+
+	sb->freeBlockCount = 0;
+	for (i = 0; i < groupCount; i++)
+	{
+		get_group_layout(sb, i, &groupBlocks, &metaBlocks);
+		sb->freeBlockCount += groupBlocks - metaBlocks;
+	}
+
+	memcpy(sb->fsID, "EXT2", 4);
+	memcpy(sb->volumeName, VOLUME_LABEL, VOLUME_LABEL_LENGTH);
+
+	//  ڵ
+	sb->firstMetaBlockGroup = 99;
+	sb->reserved[189] = 98;
+	/*
+	printf("\ninodeCount		%#08x\t%X\n", &sb->inodeCount, sb->inodeCount);
+	printf("blockCount		%#08x\t%X\n", &sb->blockCount, sb->blockCount);
+	printf("reservedBlockCount	%#08x\t%X\n", &sb->reservedBlockCount, sb->reservedBlockCount);
+	printf("freeBlockCount		%#08x\t%X\n", &sb->freeBlockCount, sb->freeBlockCount);
+	printf("freeInodeCount		%#08x\t%X\n", &sb->freeInodeCount, sb->freeInodeCount);
+	printf("firstDataBlock		%#08x\t%X\n", &sb->firstDataBlock, sb->firstDataBlock);
+	printf("logBlockSize		%#08x\t%X\n", &sb->logBlockSize, sb->logBlockSize);
+	printf("logFragSize		%#08x\t%X\n", &sb->logFragSize, sb->logFragSize);
+	printf("blocksPerGroup		%#08x\t%X\n", &sb->blocksPerGroup, sb->blocksPerGroup);
+	printf("inodesPerGroup		%#08x\t%X\n", &sb->inodesPerGroup, sb->inodesPerGroup);
+	printf("magicSignature		%#08x\t%X\n", &sb->magicSignature, sb->magicSignature);
+	printf("firstInode		%#08x\t%X\n", &sb->firstInode, sb->firstInode);
+	printf("inodeSize		%#08x\t%X\n", &sb->inodeSize, sb->inodeSize);
+	printf("fsID(EXT2)		%#08x\t%X %X %X %X\n", &sb->fsID, 'E', 'X', 'T', '2');
+	printf("volumeName(EXT2 BY YJM)	%#08x\t%X %X %X %X %X %X %X %X %X %X %X\n", &sb->volumeName, 'E', 'X', 'T', '2', ' ', 'B', 'Y', ' ', 'Y', 'J', 'M');
+	printf("firstMetaBlkGroup	%#08x\t%X\n", &sb->firstMetaBlockGroup, sb->firstMetaBlockGroup);
+	printf("reserved[189]		%#08x\t%X\n\n", &sb->reserved[189], sb->reserved[189]);
+	*/
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* ۺ ϳ ϱ׷쿡  */
+int write_super_block(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+{
+	BYTE buffer[MAX_SECTOR_SIZE];
+	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
+	QWORD byteOffset = (QWORD)(sb->firstDataBlock + blkGroupNumber * sb->blocksPerGroup) * blkSize;
+
+	SECTOR sectorNumber;
+	UINT32 offset = 0;
+	UINT32 sbSize = sizeof(EXT2_SUPER_BLOCK);
+
+	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
+	{
+		LOG_ERROR("error : wrong argument\n");
+		return EXT2_ERROR;
+	}
+
+	// 0 ׷ ۺ  ũ  1024 Ʈ ġ
+	if (blkGroupNumber == 0)
+		byteOffset = EXT2_MIN_BLOCK_SIZE;
+	sectorNumber = (SECTOR)(byteOffset / MAX_SECTOR_SIZE);
+
+	while (offset < sbSize)
+	{
+		ZeroMemory(buffer, sizeof(buffer));
+		memcpy(buffer, &((BYTE *)sb)[offset], sizeof(buffer));
+		disk->write_sector(disk, sectorNumber, buffer);
+		offset += MAX_SECTOR_SIZE;
+		sectorNumber++;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* ϳ ϱ׷쿡  ׷ ũ    */
+int fill_desc(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, EXT2_GROUP_DESC* desc, UINT32 blkGroupNumber)
+{
+	UINT32 groupBlocks, metaBlocks;
+
+	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
+	{
+		LOG_ERROR("error : wrong argument\n");
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(desc, sizeof(EXT2_GROUP_DESC));
+	get_group_layout(sb, blkGroupNumber, &groupBlocks, &metaBlocks);
+
+	desc->bg_blockBitmap = get_group_bitmap_block(sb, blkGroupNumber); // block bitmap  ȣ 
+	desc->bg_inodeBitmap = desc->bg_blockBitmap + 1;
+	desc->bg_inodeTable = desc->bg_inodeBitmap + 1;
+
+	// ʱ free    
+	// ׷ ϼ - Ÿ ϼ (ۺ, ũ ̺ , bitmap, inode table) 
+	desc->bg_freeBlockCount = groupBlocks - metaBlocks;
+	desc->bg_freeInodeCount = sb->inodesPerGroup;
+	desc->bg_usedDirCount = 0;
+
+	// lazy ʱȭ 忡 0 ׷  inode table ʱȭ 
+	if ((sb->featureROCompat & EXT2_FEATURE_RO_COMPAT_UNINIT_BG) && blkGroupNumber != 0)
+	{
+		desc->bg_flags = EXT2_BG_INODE_UNINIT;
+		desc->bg_itableUnused = sb->inodesPerGroup;
+	}
+	else
+		desc->bg_flags = EXT2_BG_INODE_ZEROED;
+	/*
+	printf("\nbg_blockBitmap		%#08x\t%X\n", &desc->bg_blockBitmap, desc->bg_blockBitmap);
+	printf("bg_inodeBitmap		%#08x\t%X\n", &desc->bg_inodeBitmap, desc->bg_inodeBitmap);
+	printf("bg_inodeTable		%#08x\t%X\n", &desc->bg_inodeTable, desc->bg_inodeTable);
+	printf("bg_freeBlockCount	%#08x\t%X\n", &desc->bg_freeBlockCount, desc->bg_freeBlockCount);
+	printf("bg_freeInodeCount	%#08x\t%X\n", &desc->bg_freeInodeCount, desc->bg_freeInodeCount);
+	printf("bg_usedDirCount		%#08x\t%X\n\n", &desc->bg_usedDirCount, desc->bg_usedDirCount);
+	*/
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* ϳ ϱ׷쿡  ׷ ũ ̺ ʱȭ */
+int init_desc(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_GROUP_DESC desc;	// ׷ ũ 
+	EXT2_GROUP_DESC* pdesc = &desc;	// ׷ ũ  
+	UINT32 groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1; // ü ׷  
+	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize; //  ϳ ũ 
+	UINT32 descPerBlock = blkSize / sizeof(EXT2_GROUP_DESC); //   ũ 
+	UINT32 block = sb->firstDataBlock + blkGroupNumber * sb->blocksPerGroup + 1; // ũ ̺   
+	UINT32 offset = 0;
+	UINT32 i;
+
+	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
+	{
+		LOG_ERROR("error : wrong argument\n");
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(buffer, sizeof(buffer));
+	for (i = 0; i < groupCount; i++)
+	{
+		ZeroMemory(pdesc, sizeof(EXT2_GROUP_DESC));
+		if (fill_desc(disk, sb, pdesc, i) != EXT2_SUCCESS) // i ׷ ũ ʱȭ
+		{
+			LOG_ERROR("error : faid to fill group descriptor of group %d\n", i);
+			return EXT2_ERROR;
+		}
+
+		memcpy(&((EXT2_GROUP_DESC *)buffer)[offset++], pdesc, sizeof(desc)); // ۿ ũ  
+
+		if (offset >= descPerBlock) //    ũ  
+		{
+			if (format_write_block(disk, blkSize, block++, buffer) != EXT2_SUCCESS)
+				return EXT2_ERROR;
+			offset = 0;
+			ZeroMemory(buffer, sizeof(buffer)); //  Ŭ 
+		}
+	}
+
+	if (offset > 0) //    ũ 
+		return format_write_block(disk, blkSize, block, buffer);
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* block bitmap inode bitmap ʱȭ */
+/* ׷ Ÿ ϰ ũ  Ѵ    ǥ */
+int clear_bitmap(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
+	UINT32 block = get_group_bitmap_block(sb, blkGroupNumber); // block bitmap  
+	UINT32 groupBlocks, metaBlocks;
+	UINT32 i;
+
+	get_group_layout(sb, blkGroupNumber, &groupBlocks, &metaBlocks);
+
+	ZeroMemory(buffer, sizeof(buffer));
+	for (i = 0; i < metaBlocks; i++)
+		set_bit(i, buffer);
+	for (i = groupBlocks; i < sb->blocksPerGroup; i++)
+		set_bit(i, buffer);
+
+	if (format_write_block(disk, blkSize, block, buffer) != EXT2_SUCCESS) // block bitmap
+		return EXT2_ERROR;
+
+	ZeroMemory(buffer, sizeof(buffer));
+	return format_write_block(disk, blkSize, block + 1, buffer); // inode bitmap
+}
+
+/*  */
+/* inode table ʱȭ */
+int clear_inode_table(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize; //  ũ 
+	UINT32 inoBlksPerGroup = ((sb->inodesPerGroup * sb->inodeSize) + (blkSize - 1)) / blkSize; // ׷  inode table   
+	UINT32 block = get_group_bitmap_block(sb, blkGroupNumber) + 2; // inode table   
+
+	UINT32 i;
+
+	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
+	{
+		LOG_ERROR("error : wrong argument\n");
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(buffer, sizeof(buffer));
+	for (i = 0; i < inoBlksPerGroup; i++)
+	{
+		if (format_write_block(disk, blkSize, block + i, buffer) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* Ʈ ͸  */
+int create_root(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_INODE* inode;
+	EXT2_GROUP_DESC* desc;
+	EXT2_DIR_ENTRY* entry;
+	UINT32 firstDataBlk, inoBlksPerGroup;
+	UINT32 blkSize;
+	UINT32 descBlock, bitmapBlock, itableBlock;
+
+	blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize; // ϳ  ũ 
+	inoBlksPerGroup = ((sb->inodeSize * sb->inodesPerGroup) + (blkSize - 1)) / blkSize; // ׷ inode table   
+
+	descBlock = sb->firstDataBlock + 1;
+	bitmapBlock = get_group_bitmap_block(sb, 0); // 0 ׷ ׻ ۺϰ ũ ̺ 
+	itableBlock = bitmapBlock + 2;
+	firstDataBlk = itableBlock + inoBlksPerGroup; // 0  ׷     
+
+	// INODE
+	ZeroMemory(buffer, sizeof(buffer));
+	format_read_block(disk, blkSize, itableBlock, buffer);
+	inode = (EXT2_INODE *)buffer;
+	inode[EXT2_ROOT_INO - 1].fileSize = 0;
+	inode[EXT2_ROOT_INO - 1].fileMode = ACCESSED_BY_ANYONE | FILE_TYPE_DIR;
+	inode[EXT2_ROOT_INO - 1].linkCount = 2; // dot, dotdot 
+	inode[EXT2_ROOT_INO - 1].blockCount = 1;
+	inode[EXT2_ROOT_INO - 1].i_block[0] = firstDataBlk; // 0  ׷    պκ Ʈ 丮 Ʈ 
+	format_write_block(disk, blkSize, itableBlock, buffer); // inode table 2(Ʈ 丮)  
+
+	// EXT2_DIR_ENTRY
+	ZeroMemory(buffer, sizeof(buffer));
+	entry = (EXT2_DIR_ENTRY *)buffer;
+
+	// dot entry 
+	entry->inode = EXT2_ROOT_INO;
+	entry->dir2.nameLength = 1;
+	memcpy(entry->name, ".", 1);
+	entry->dir2.fileType = EXT2_FT_DIR;
+	entry++;
+
+	// dotdot entry 
+	entry->inode = EXT2_ROOT_INO;
+	entry->dir2.nameLength = 2;
+	memcpy(entry->name, "..", 2);
+	entry->dir2.fileType = EXT2_FT_DIR;
+	entry++;
+
+	// no more entry
+	entry->dir2.fileType = EXT2_FT_NO_MORE;
+
+	// 0  ׷    պκп Ƽ 丮 Ʈ  
+	format_write_block(disk, blkSize, firstDataBlk, buffer);
+
+	// ׷ ũ Ʈ 
+	ZeroMemory(buffer, sizeof(buffer));
+	format_read_block(disk, blkSize, descBlock, buffer);
+	desc = (EXT2_GROUP_DESC *)buffer;
+	desc->bg_freeBlockCount--;
+	desc->bg_freeInodeCount--;
+	desc->bg_usedDirCount++;
+	format_write_block(disk, blkSize, descBlock, buffer);
+
+	//  Ʈ Ʈ (Ÿ  clear_bitmap ǥõ)
+	ZeroMemory(buffer, sizeof(buffer));
+	format_read_block(disk, blkSize, bitmapBlock, buffer);
+	set_bit(firstDataBlk - sb->firstDataBlock, buffer);
+	format_write_block(disk, blkSize, bitmapBlock, buffer);
+
+	// inode Ʈ Ʈ
+	ZeroMemory(buffer, sizeof(buffer));
+	format_read_block(disk, blkSize, bitmapBlock + 1, buffer);
+	set_bit(1, buffer);
+	format_write_block(disk, blkSize, bitmapBlock + 1, buffer);
+
+	//   Ʈ 
+	sb->freeBlockCount--;
+	sb->freeInodeCount--;
+
+	return EXT2_SUCCESS;
+}
+
+/* ϳ  ׷  ʱȭ (ۺ, ũ ̺, Ʈ, inode table) */
+/* ׷츶  Ͱ ġ Ƿ  忡 ÿ ȣ  */
+int format_group(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+{
+	if (ext2_group_has_super(sb, blkGroupNumber)) // sparse super 忡 Ϻ ׷츸  
+	{
+		if (write_super_block(disk, sb, blkGroupNumber) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+		if (init_desc(disk, sb, blkGroupNumber) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+	}
+	if (clear_bitmap(disk, sb, blkGroupNumber) != EXT2_SUCCESS) // block bitmap, inode bitmap ʱȭ 
+		return EXT2_ERROR;
+	if (!(sb->featureROCompat & EXT2_FEATURE_RO_COMPAT_UNINIT_BG) || blkGroupNumber == 0)
+		return clear_inode_table(disk, sb, blkGroupNumber); // lazy 忡 ù inode Ҵ  ʱȭ
+
+	return EXT2_SUCCESS;
+}
+
+typedef struct ext2_format_work {
+	DISK_OPERATIONS*	disk;
+	EXT2_SUPER_BLOCK*	sb;
+	UINT32				firstGroup;		/* ϴ ù ׷ */
+	UINT32				lastGroup;		/*    ( ) */
+	int					result;
+} EXT2_FORMAT_WORK;
+
+/* ۾  : Ҵ ׷  ʷ ʱȭ */
+static void* format_worker(void* arg)
+{
+	EXT2_FORMAT_WORK* work = (EXT2_FORMAT_WORK *)arg;
+	UINT32 group;
+
+	work->result = EXT2_SUCCESS;
+	for (group = work->firstGroup; group < work->lastGroup; group++)
+	{
+		if (format_group(work->disk, work->sb, group) != EXT2_SUCCESS)
+		{
+			work->result = EXT2_ERROR;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/*  ׷ threadCount 忡  ķ ʱȭ */
+/* disk  ٸ Ϳ   read/write ؾ  */
+int format_groups_parallel(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 groupCount, UINT32 threadCount)
+{
+	pthread_t* threads;
+	EXT2_FORMAT_WORK* works;
+	UINT32 i, started;
+	int result = EXT2_SUCCESS;
+
+	if (threadCount > groupCount)
+		threadCount = groupCount;
+
+	threads = (pthread_t *)malloc(sizeof(pthread_t) * threadCount);
+	works = (EXT2_FORMAT_WORK *)malloc(sizeof(EXT2_FORMAT_WORK) * threadCount);
+	if (threads == NULL || works == NULL)
+	{
+		free(threads);
+		free(works);
+		return EXT2_ERROR;
+	}
+
+	for (started = 0; started < threadCount; started++)
+	{
+		works[started].disk = disk;
+		works[started].sb = sb;
+		works[started].firstGroup = (UINT32)((QWORD)groupCount * started / threadCount);
+		works[started].lastGroup = (UINT32)((QWORD)groupCount * (started + 1) / threadCount);
+		works[started].result = EXT2_ERROR;
+
+		if (pthread_create(&threads[started], NULL, format_worker, &works[started]) != 0)
+		{
+			result = EXT2_ERROR;
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++)
+	{
+		pthread_join(threads[i], NULL);
+		if (works[i].result != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+	}
+
+	free(threads);
+	free(works);
+
+	return result;
+}
+
+/*  */
+/* journal (EXT2_JOURNAL_INO) , log   Ҵ */
+static int create_journal(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 journalBlocks)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	EXT2_INODE inode;
+	EXT2_DIR_ENTRY_LOCATION location;
+	UINT32 i, block, firstBlock = 0;
+	UINT32 groupCount;
+
+	ZeroMemory(&fs, sizeof(fs));
+	fs.disk = disk;
+	if (ext2_read_superblock(&fs, &root) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	//   log ̿  ʵ    Ҵ
+	for (i = 0; i < journalBlocks; i++)
+	{
+		if (i == 0)
+			location.group = location.block = 0;
+		else
+			get_location_of_block(&fs, block, &location);
+
+		if (take_free_block(&fs, location.group, i == 0 ? 0 : location.block + 1, &block) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : no free block for journal\n");
+			goto fail;
+		}
+
+		if (i == 0)
+			firstBlock = block;
+		else if (block != firstBlock + i)
+		{
+			LOG_ERROR("error : no contiguous %u blocks for journal\n", journalBlocks);
+			goto fail;
+		}
+	}
+
+	ZeroMemory(&inode, sizeof(inode));
+	for (i = 0; i < journalBlocks; i++)
+	{
+		if (set_allocated_block(&fs, i, &inode, firstBlock + i) != EXT2_SUCCESS)
+			goto fail;
+	}
+	inode.fileMode = FILE_TYPE_FILE | USER_READ | USER_WRITE;
+	inode.fileSize = journalBlocks * fs.sb_info.blockSize;
+	inode.linkCount = 1;
+	inode.blockCount = journalBlocks;
+	if (set_inode(&fs, EXT2_JOURNAL_INO, (BYTE *)&inode) != EXT2_SUCCESS)
+		goto fail;
+
+	//  inode Ʈʿ ǥõǾ  Ƿ ⼭   ǥ
+	ZeroMemory(buffer, sizeof(buffer));
+	read_inode_bitmap(&fs, 0, buffer);
+	if (!get_bit(EXT2_JOURNAL_INO - 1, buffer))
+	{
+		set_bit(EXT2_JOURNAL_INO - 1, buffer);
+		write_inode_bitmap(&fs, 0, buffer);
+		dec_freei_count(&fs, 0);
+	}
+
+	if (journal_format(disk, fs.sb_info.blockSize, firstBlock, journalBlocks) != EXT2_SUCCESS)
+		goto fail;
+
+	fs.sb.journalInode = EXT2_JOURNAL_INO;
+	fs.sb.featureCompat |= EXT3_FEATURE_COMPAT_HAS_JOURNAL;
+	*sb = fs.sb;
+	groupCount = fs.sb_info.groupCount;
+	ext2_umount(&fs);
+
+	for (i = 0; i < groupCount; i++)
+	{
+		if (ext2_group_has_super(sb, i))
+			write_super_block(disk, sb, i);
+	}
+
+	LOG_INFO("journal blocks			: %u (block %u)\n", journalBlocks, firstBlock);
+
+	return EXT2_SUCCESS;
+
+fail:
+	ext2_umount(&fs);
+	return EXT2_ERROR;
+}
+
+/*  */
+/*   ׷  ʱȭ  Ʈ ͸  */
+int ext2_format(DISK_OPERATIONS* disk, const EXT2_FORMAT_OPTION* option)
+{
+	EXT2_IO_STATS* outer = enter_op(NULL, EXT2_OP_FORMAT);
+	int result;
+
+	result = format_fs(disk, option);
+	leave_op(outer);
+
+	return result;
+}
+
+static int format_fs(DISK_OPERATIONS* disk, const EXT2_FORMAT_OPTION* option)
+{
+	EXT2_SUPER_BLOCK sb;
+	UINT32 groupCount;
+	UINT32 blkGroupNumber = 0;
+	UINT32 backupGroups, blkSize, descTableBlks;
+	EXT2_SUPER_BLOCK * p_sb = &sb;
+
+	if (fill_super_block(p_sb, disk->numberOfSectors, disk->bytesPerSector,
+		option != NULL ? option->logBlockSize : EXT2_BLOCK_SIZE_BIT,
+		option != NULL ? option->sparseSuper : 0) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : failed to fill super block\n");
+		return EXT2_ERROR;
+	}
+
+	if (option != NULL && option->lazyItableInit)
+		p_sb->featureROCompat |= EXT2_FEATURE_RO_COMPAT_UNINIT_BG;
+
+	groupCount = ((p_sb->blockCount - p_sb->firstDataBlock - 1) / p_sb->blocksPerGroup) + 1; //  ׷  
+
+	if (option != NULL && option->threadCount > 1)
+	{
+		if (format_groups_parallel(disk, p_sb, groupCount, option->threadCount) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to format block groups\n");
+			return EXT2_ERROR;
+		}
+	}
+	else
+	{
+		while (blkGroupNumber < groupCount)
+		{
+			if (format_group(disk, p_sb, blkGroupNumber) != EXT2_SUCCESS)
+				return EXT2_ERROR;
+
+			blkGroupNumber++;
+		}
+	}
+
+	LOG_INFO("total sector count		: %u\n", disk->numberOfSectors);
+	LOG_INFO("total block count		: %u\n", sb.blockCount);
+	LOG_INFO("total inode count		: %u\n", sb.inodeCount);
+	LOG_INFO("sector byte size		: %u\n", MAX_SECTOR_SIZE);
+	LOG_INFO("block byte size			: %u\n", EXT2_MIN_BLOCK_SIZE << sb.logBlockSize);
+	LOG_INFO("inode byte size			: %u\n", sb.inodeSize);
+	if (sb.featureROCompat & EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER)
+	{
+		for (blkGroupNumber = 0, backupGroups = 0; blkGroupNumber < groupCount; blkGroupNumber++)
+			backupGroups += ext2_group_has_super(p_sb, blkGroupNumber);
+
+		//    ׷츶 ۺ 1 ϰ ũ ̺ ϸŭ   þ
+		blkSize = EXT2_MIN_BLOCK_SIZE << sb.logBlockSize;
+		descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize;
+		LOG_INFO("superblock backups		: %u / %u groups\n", backupGroups, groupCount);
+		LOG_INFO("reclaimed blocks		: %u\n", (groupCount - backupGroups) * (1 + descTableBlks));
+	}
+	LOG_INFO("\n");
+
+	create_root(disk, p_sb);
+	write_super_block(disk, p_sb, 0); // Ʈ 丮  , inode ݿ
+
+	if (option != NULL && option->journalBlocks != 0)
+		return create_journal(disk, p_sb, option->journalBlocks);
+
+	return EXT2_SUCCESS;
+}
+
+
+/******************************************************************************/
+/* mount / umount	                                                          */
+/******************************************************************************/
+
+/*  */
+/* ۺ ȿ ˻ */
+int validate_superblock(EXT2_FILESYSTEM* fs)
+{
+	UINT32 blockSize;
+	EXT2_SUPER_BLOCK* sb = &fs->sb;
+
+	if (sb->logBlockSize < 0 || sb->logBlockSize > 2) //  ũ ˻ 
+	{
+		LOG_ERROR("error : invalid block size\n");
+		return EXT2_ERROR;
+	}
+
+	if (sb->magicSignature != 0xEF53) // ñ״ó ˻ 
+	{
+		LOG_ERROR("error : invalid signature\n");
+		return EXT2_ERROR;
+	}
+
+	// mount  ̸ ϴ ּ ȯ  ϴ ˻
+	// (׷   2 ŵ, inode ȣ 2^31 ̸)
+	blockSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
+	if (sb->blocksPerGroup == 0 || sb->blocksPerGroup > blockSize * 8 ||
+		(sb->blocksPerGroup & (sb->blocksPerGroup - 1)) != 0 ||
+		sb->inodesPerGroup == 0 || sb->inodesPerGroup > blockSize * 8 ||
+		sb->inodeCount >= 0x80000000 || sb->firstDataBlock >= sb->blockCount)
+	{
+		LOG_ERROR("error : invalid geometry\n");
+		return EXT2_ERROR;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* location entry   */
+int set_entry(EXT2_FILESYSTEM* fs, EXT2_DIR_ENTRY_LOCATION* location, EXT2_DIR_ENTRY* newEntry)
+{
+	UINT32 block;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_DIR_ENTRY oldEntry;
+
+	block = fs->groupBase[location->group].firstBlock + location->block;
+	ZeroMemory(buffer, sizeof(buffer));
+
+	lock_block(fs, block); //   ũ  θ ͸ lock  Ʈ 
+	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
+	{
+		unlock_block(fs, block);
+		LOG_ERROR("error : failed to read_block() in get_entry()\n");
+		return EXT2_ERROR;
+	}
+	oldEntry = ((EXT2_DIR_ENTRY *)buffer)[location->offset];
+	memcpy(&((EXT2_DIR_ENTRY *)buffer)[location->offset], newEntry, sizeof(EXT2_DIR_ENTRY));
+
+	if (write_meta_block(fs, block, buffer) != EXT2_SUCCESS)
+	{
+		unlock_block(fs, block);
+		LOG_ERROR("error : failed to write_block() in get_entry()\n");
+		return EXT2_ERROR;
+	}
+	//  Ʈ ٲ ĳÿ 
+	if (oldEntry.dir2.fileType != EXT2_FT_FREE && oldEntry.dir2.fileType != EXT2_FT_NO_MORE &&
+		memcmp(&oldEntry, newEntry, sizeof(EXT2_DIR_ENTRY)) != 0)
+		dcache_drop_location(fs, &oldEntry, location);
+	unlock_block(fs, block);
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* location entry   */
+int get_entry(EXT2_FILESYSTEM* fs, EXT2_DIR_ENTRY_LOCATION* location, EXT2_DIR_ENTRY* retEntry)
+{
+	UINT32 block;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+
+	block = fs->groupBase[location->group].firstBlock + location->block;
+	ZeroMemory(buffer, sizeof(buffer));
+
+	if (read_meta_block(fs, block, buffer) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : failed to read_block() in get_entry()\n");
+		return EXT2_ERROR;
+	}
+	memcpy(retEntry, &((EXT2_DIR_ENTRY *)buffer)[location->offset], sizeof(EXT2_DIR_ENTRY));
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* ũ ۺ  о */
+int ext2_read_superblock(EXT2_FILESYSTEM* fs, EXT2_NODE* root)
+{
+	EXT2_IO_STATS* outer;
+	int result;
+
+	if (fs == NULL)
+		return mount_fs(fs, root);
+
+	ZeroMemory(fs->ioStats, sizeof(fs->ioStats));
+	outer = enter_op(fs, EXT2_OP_MOUNT);
+	result = mount_fs(fs, root);
+	leave_op(outer);
+
+	return result;
+}
+
+static int mount_fs(EXT2_FILESYSTEM* fs, EXT2_NODE* root)
+{
+	int result;
+	if (fs == NULL || fs->disk == NULL)
+	{
+		LOG_ERROR("error : wrong argumenet\n");
+			return EXT2_ERROR;
+	}
+	fs->itableInit = NULL;
+	fs->itableNext = 0;
+
+	int readNum = sizeof(fs->sb);
+	UINT32 sectorNumber = EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE;
+	int i = 0;
+	int offset = 0;
+
+	while (offset < readNum)
+	{
+		result = fs->disk->read_sector(fs->disk, sectorNumber + i, &((BYTE *)&fs->sb)[offset]); // ۺ ٷ о 
+		if (result)
+		{
+			LOG_ERROR("error : failed to read sector %d\n", sectorNumber + i);
+			return EXT2_ERROR;
+		}
+		offset += MAX_SECTOR_SIZE;
+		i++;
+	}
+	ext2_count_io(NULL, 0, 1, i);
+
+	result = validate_superblock(fs);
+
+	if (result) //    ȿ 
+	{
+		LOG_ERROR("error : invalid super block\n");
+		return EXT2_ERROR;
+	}
+
+
+	if (fill_sb_info(fs) != EXT2_SUCCESS) //   б   ũ  ׷ ̺ 
+		return EXT2_ERROR;
+
+	if (load_journal(fs) != EXT2_SUCCESS) // Ÿ͸ б   transaction replay
+	{
+		release_locks(fs);
+		release_bitmap_summary(fs);
+		release_group_base(fs);
+		return EXT2_ERROR;
+	}
+
+	// replay  ڿ ĳø  replay   ĳÿ  
+	if (init_cache(fs) != EXT2_SUCCESS)
+	{
+		ext2_umount(fs);
+		return EXT2_ERROR;
+	}
+
+	//     orphan ϸ , ü Ʈ̳ inode table ˻ 
+	if (fs->sb.orphanList != 0 && process_orphans(fs) != EXT2_SUCCESS)
+	{
+		ext2_umount(fs);
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(root, sizeof(EXT2_NODE));
+
+	root->fs = fs;
+	root->location.group = 0;
+	root->location.block = fs->groupBase[0].inodeTable + fs->sb_info.itbPerGroup - fs->groupBase[0].firstBlock; // 0 ׷   ù 
+	root->location.offset = 0;
+
+	get_entry(fs, &root->location, &root->entry);
+	LOG_DEBUG("root->entry.inode : %u\n", root->entry.inode);
+
+	start_itable_init(fs);
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* SB_INFO ü    */
+int fill_sb_info(EXT2_FILESYSTEM* fs)
+{
+	EXT2_SUPER_BLOCK* sb = &fs->sb;
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+
+	ZeroMemory(sb_info, sizeof(EXT2_SB_INFO));
+
+	sb_info->blockSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
+	sb_info->groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1;
+	sb_info->inodesPerBlock = sb_info->blockSize / EXT2_INODE_SIZE;
+	sb_info->blocksPerGroup = sb->blocksPerGroup;
+	sb_info->inodesPerGroup = sb->inodesPerGroup;
+	sb_info->itbPerGroup = (sb->inodesPerGroup * EXT2_INODE_SIZE + (sb_info->blockSize - 1)) / sb_info->blockSize;
+	sb_info->blocksPerDesc = (sizeof(EXT2_GROUP_DESC) * sb_info->groupCount + (sb_info->blockSize - 1)) / sb_info->blockSize;
+	sb_info->sectorsPerBlock = sb_info->blockSize / MAX_SECTOR_SIZE;
+	sb_info->sectorsPerGroup = sb_info->blocksPerGroup * sb_info->sectorsPerBlock;
+	sb_info->descPerBlock = sb_info->blockSize / EXT2_DESC_SIZE;
+	sb_info->firstDescBlock = sb->firstDataBlock + 1;
+	sb_info->descPerBlock_bits = sb->logBlockSize + 5;
+	sb_info->blockSize_bits = sb->logBlockSize;
+	sb_info->blocksPerGroup_bits = get_log2(sb_info->blocksPerGroup);
+	sb_info->inodesPerBlock_bits = get_log2(sb_info->inodesPerBlock);
+	// inodesPerGroup 2 ŵ ƴ  Ƿ ø  ϰ shift ؼ 
+	sb_info->inodeGroup_shift = 31 + get_log2(sb_info->inodesPerGroup);
+	sb_info->inodeGroup_magic = ((1ULL << sb_info->inodeGroup_shift) + sb_info->inodesPerGroup - 1) / sb_info->inodesPerGroup;
+	sb_info->inodeSize = EXT2_INODE_SIZE;
+	sb_info->firstInode = sb->firstInode;
+	sb_info->dirCount = 1;
+	sb_info->freeBlockCount = sb->freeBlockCount;
+	sb_info->freeInodeCount = sb->freeInodeCount;
+
+	if (init_group_base(fs) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (init_bitmap_summary(fs) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	return init_locks(fs);
+}
+
+/* ׷캰 Ÿ  ȣ ̺  */
+/* format  ġ Ģ ϹǷ mount  ũ ̺   */
+/*  ũͿ 񱳴 read_desc ũ͸   ϰ, ٸ ջ   */
+int init_group_base(EXT2_FILESYSTEM* fs)
+{
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	EXT2_GROUP_BASE* base;
+	UINT32 group;
+
+	release_group_base(fs);
+
+	fs->groupBase = (EXT2_GROUP_BASE *)calloc(sb_info->groupCount, sizeof(EXT2_GROUP_BASE));
+	if (fs->groupBase == NULL)
+	{
+		LOG_ERROR("error : failed to allocate group table\n");
+		return EXT2_ERROR;
+	}
+
+	for (group = 0; group < sb_info->groupCount; group++)
+	{
+		base = &fs->groupBase[group];
+
+		base->firstBlock = fs->sb.firstDataBlock + (group << sb_info->blocksPerGroup_bits);
+		base->blockBitmap = base->firstBlock;
+		if (ext2_group_has_super(&fs->sb, group)) // ۺ, ũ ̺ 
+			base->blockBitmap += 1 + sb_info->blocksPerDesc;
+		base->inodeBitmap = base->blockBitmap + 1;
+		base->inodeTable = base->inodeBitmap + 1;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/* ׷캰 Ÿ  ȣ ̺  */
+void release_group_base(EXT2_FILESYSTEM* fs)
+{
+	free(fs->groupBase);
+	fs->groupBase = NULL;
+}
+
+/* /inode Ʈ   Ҵ */
+/* ׷  ó Ʈ   ,    ׷ free   */
+int init_bitmap_summary(EXT2_FILESYSTEM* fs)
+{
+	UINT32 groupCount = fs->sb_info.groupCount;
+	UINT32 mapWords = (groupCount + 63) >> 6;
+	UINT32 i;
+
+	release_bitmap_summary(fs);
+
+	fs->blockSummary = (EXT2_BITMAP_SUMMARY *)calloc(groupCount, sizeof(EXT2_BITMAP_SUMMARY));
+	fs->inodeSummary = (EXT2_BITMAP_SUMMARY *)calloc(groupCount, sizeof(EXT2_BITMAP_SUMMARY));
+	fs->blockGroupMap = (UINT64 *)calloc(mapWords, sizeof(UINT64));
+	fs->inodeGroupMap = (UINT64 *)calloc(mapWords, sizeof(UINT64));
+
+	if (fs->blockSummary == NULL || fs->inodeSummary == NULL ||
+		fs->blockGroupMap == NULL || fs->inodeGroupMap == NULL)
+	{
+		LOG_ERROR("error : failed to allocate bitmap summary\n");
+		release_bitmap_summary(fs);
+		return EXT2_ERROR;
+	}
+
+	for (i = 0; i < groupCount; i++)
+	{
+		fs->blockGroupMap[i >> 6] |= 1ULL << (i & 63);
+		fs->inodeGroupMap[i >> 6] |= 1ULL << (i & 63);
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/* /inode Ʈ    */
+void release_bitmap_summary(EXT2_FILESYSTEM* fs)
+{
+	free(fs->blockSummary);
+	free(fs->inodeSummary);
+	free(fs->blockGroupMap);
+	free(fs->inodeGroupMap);
+
+	fs->blockSummary = NULL;
+	fs->inodeSummary = NULL;
+	fs->blockGroupMap = NULL;
+	fs->inodeGroupMap = NULL;
+}
+
+/*  */
+/* journal  ҷ checkpoint   */
+int load_journal(EXT2_FILESYSTEM* fs)
+{
+	EXT2_INODE inode;
+
+	if (!(fs->sb.featureCompat & EXT3_FEATURE_COMPAT_HAS_JOURNAL))
+		return EXT2_SUCCESS;
+
+	if (fs->sb.journalInode == 0 || get_inode(fs, fs->sb.journalInode, (BYTE *)&inode) != EXT2_SUCCESS ||
+		inode.blockCount == 0)
+	{
+		LOG_ERROR("error : invalid journal inode\n");
+		return EXT2_ERROR;
+	}
+
+	// journal  format   Ҵ
+	if (journal_load(fs->disk, fs->sb_info.blockSize, inode.i_block[0], inode.blockCount, &fs->journal) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+	fs->journal->ioStats = &fs->ioStats[EXT2_OP_OTHER]; // checkpoint  I/O
+
+	if (fs->journal->replayed != 0) // replay ۺ(orphan , free count) ٽ 
+	{
+		if (read_disk_super_block(fs->disk, &fs->sb) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+		fs->sb_info.freeBlockCount = fs->sb.freeBlockCount;
+		fs->sb_info.freeInodeCount = fs->sb.freeInodeCount;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/* 0 ׷ ۺ ũ , journal  Ÿͷ transaction  */
+int sync_super_block(EXT2_FILESYSTEM* fs)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 block = fs->sb.firstDataBlock; // 1KB ̸ 1 ,  ܿ 0  1024 Ʈ ġ
+	UINT32 offset = (block == 0) ? EXT2_MIN_BLOCK_SIZE : 0;
+
+	fs->sb.wTime = time(NULL);
+
+	if (fs->journal == NULL)
+	{
+		ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 1, 1, sizeof(EXT2_SUPER_BLOCK) / MAX_SECTOR_SIZE);
+		return write_super_block(fs->disk, &fs->sb, 0);
+	}
+
+	// 0  read_block   Ƿ  
+	if (journal_read_block(fs->journal, block, buffer))
+		ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 0, 1, 0);
+	else if (format_read_block(fs->disk, fs->sb_info.blockSize, block, buffer) == EXT2_SUCCESS)
+		ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 0, 1, fs->sb_info.sectorsPerBlock);
+	else
+		return EXT2_ERROR;
+
+	memcpy(&buffer[offset], &fs->sb, sizeof(EXT2_SUPER_BLOCK));
+	ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 1, 1, 0);
+
+	return journal_write_block(fs->journal, block, buffer, 1) == 1 ? EXT2_SUCCESS : EXT2_ERROR;
+}
+
+/*  */
+/* mount  */
+void ext2_umount(EXT2_FILESYSTEM* fs)
+{
+	EXT2_IO_STATS* outer = enter_op(fs, EXT2_OP_UMOUNT);
+	UINT32 i;
+
+	stop_itable_init(fs);
+	sync_super_block(fs); //   ٲ free count 
+
+	if (fs->journal != NULL)
+	{	//  Ÿ͸  ڸ 
+		journal_release(fs->journal);
+		fs->journal = NULL;
+	}
+	leave_op(outer);
+	free(fs->openInodes);
+	fs->openInodes = NULL;
+	fs->openCount = fs->openSize = 0;
+	for (i = 0; i < fs->fileSlots; i++)
+	{	//   handle ,  ̸  mount orphan ó 
+		if (fs->files[i] != NULL)
+		{
+			pthread_mutex_destroy(&fs->files[i]->lock);
+			free(fs->files[i]->raBuffer);
+			free(fs->files[i]);
+		}
+	}
+	free(fs->files);
+	fs->files = NULL;
+	fs->fileSlots = 0;
+	release_cache(fs);
+	release_locks(fs);
+	release_bitmap_summary(fs);
+	release_group_base(fs);
+}
+
+
+/******************************************************************************/
+/* ls								                                          */
+/******************************************************************************/
+
+/*  */
+/*   ͸ Ʈ list ߰ */
+int read_dir_from_block(EXT2_FILESYSTEM* fs, BYTE* buffer, EXT2_NODE_ADD adder, void* list)
+{
+	EXT2_DIR_ENTRY* entry;
+	EXT2_NODE node;
+	UINT32 maxEntry = fs->sb_info.blockSize / sizeof(EXT2_DIR_ENTRY);
+	int i;
+
+	ZeroMemory(&entry, sizeof(entry));
+	entry = (EXT2_DIR_ENTRY*)buffer;
+	for (i = 0; i < maxEntry; i++)
+	{
+		if (entry->dir2.fileType == EXT2_FT_FREE)
+			;
+		else if (entry->dir2.fileType == EXT2_FT_NO_MORE) //  Ʈ 
+			return 1;
+		else
+		{
+			node.fs = fs;
+			node.entry = *entry;
+			adder(fs, list, &node);
+		}
+		entry++;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* ͸ Ʈ   */
+static int read_dir_blocks(EXT2_NODE* dir, EXT2_NODE_ADD adder, void* list)
+{
+	EXT2_INODE inode;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 block;
+	int i, result;
+
+	ZeroMemory(&inode, sizeof(EXT2_INODE));
+	ZeroMemory(buffer, sizeof(buffer));
+
+	if (get_inode(dir->fs, dir->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : failed to get inode\n");
+		return EXT2_ERROR;
+	}
+
+	LOG_DEBUG("read_dir : inode %u, mode %#X, links %u, blocks %u\n",
+		dir->entry.inode, inode.fileMode, inode.linkCount, inode.blockCount);
+
+	for (i = 0; i < inode.blockCount; i++)
+	{
+		if(get_allocated_block(dir->fs, i, &inode, &block) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to get_allocated_block in ext2_read_dir\n");
+			return EXT2_ERROR;
+		}
+
+		if (read_meta_block(dir->fs, block, buffer)) // ϴ ũ о
+		{
+			LOG_ERROR("error : failed read block\n");
+			return EXT2_ERROR;
+		}
+
+		result = read_dir_from_block(dir->fs, buffer, adder, list); //  Ʈ list ߰
+		if (result == EXT2_ERROR)
+		{
+			LOG_ERROR("error : failed read dir from block\n");
+			return EXT2_ERROR;
+		}
+		if (result == 1) // no more Ʈ Ĵ  
+			break;
+	} 
+
+	return EXT2_SUCCESS;
+}
+
+int ext2_read_dir(EXT2_NODE* dir, EXT2_NODE_ADD adder, void* list) // ͸ Ʈ о list ߰ 
+{
+	EXT2_IO_STATS* outer = enter_op(dir->fs, EXT2_OP_READ_DIR);
+	int result;
+
+	lock_inode(dir->fs, dir->entry.inode, 0);
+	result = read_dir_blocks(dir, adder, list);
+	unlock_inode(dir->fs, dir->entry.inode);
+	leave_op(outer);
+
+	return result;
+}
+
+
+/******************************************************************************/
+/* cd									                                      */
+/******************************************************************************/
 
-	dec_freei_count(fs, group); // free inode  ʵ Ʈ
+/*  */
+/* ̸ Ͻý Ŀ °  */ /*  ؾ */
+int format_name(EXT2_FILESYSTEM* fs, char* name)
+{
+	UINT32	i, length;
+	UINT32	extender = 0, nameLength = 0;
+	UINT32	extenderCurrent = 21;
+	BYTE	regularName[MAX_ENTRY_NAME_LENGTH];
+	BYTE	nameBuf[MAX_NAME_LENGTH];
 
-	ZeroMemory(inodeBuf, sizeof(inodeBuf));
-	if (get_inode(fs, ino, inodeBuf) != EXT2_SUCCESS)
-		goto fail;
+	memset(regularName, 0x20, sizeof(regularName));
+	memset(nameBuf, 0x20, sizeof(nameBuf));
+	length = strlen(name);
 
-	inode = (EXT2_INODE *)inodeBuf;
-	inode->blockCount = 0;
-	if (is_dir(entry) == EXT2_SUCCESS)
-		inode->fileMode |= FILE_TYPE_DIR;
+	if (strncmp(name, "..", 2) == 0)
+	{
+		memcpy(nameBuf, "..", 2);
+		memcpy(name, nameBuf, MAX_ENTRY_NAME_LENGTH);
+		return EXT2_SUCCESS;
+	}
+	else if (strncmp(name, ".", 1) == 0)
+	{
+		memcpy(nameBuf, ".", 1);
+		memcpy(name, nameBuf, MAX_ENTRY_NAME_LENGTH);
+		return EXT2_SUCCESS;
+	}
 	else
-		inode->fileMode |= FILE_TYPE_FILE;
-	inode->fileSize = 0;
+	{
+		upper_string(name, MAX_NAME_LENGTH);
+
+		for (i = 0; i < length; i++)
+		{
+			if (name[i] != '.' && !isdigit(name[i]) && !isalpha(name[i]))
+				return EXT2_ERROR;
+
+			if (name[i] == '.')
+			{
+				if (extender)
+					return EXT2_ERROR;
+				extender = 1;
+			}
+			else if (isdigit(name[i]) || isalpha(name[i]))
+			{
+				if (extender)
+					regularName[extenderCurrent++] = name[i];
+				else
+					regularName[nameLength++] = name[i];
+			}
+			else
+				return EXT2_ERROR;
+		}
+
+		if (nameLength > MAX_ENTRY_NAME_LENGTH - 3 || nameLength == 0 || extenderCurrent > MAX_ENTRY_NAME_LENGTH)
+			return EXT2_ERROR;
+	}
 
-	set_inode(fs, ino, inode);
+	memcpy(name, regularName, sizeof(regularName));
 
 	return EXT2_SUCCESS;
+}
+
+/*  */
+/*   number° Ʈ ã */
+/* return : EXT2_SUCCESS( ̸ ã)
+* 			EXT2_ERROR(ƹ͵ ã)
+* 			1 (free)
+* 			2 (no more)
+*/
+int find_entry_at_block(EXT2_FILESYSTEM* fs, const BYTE* block, const char* entryName, UINT32* offset)
+{
+	UINT32 i;
+	const EXT2_DIR_ENTRY* entry = (EXT2_DIR_ENTRY *)block;
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	UINT32 last = sb_info->blockSize / sizeof(EXT2_DIR_ENTRY) - 1;
+
+	for (i = 0; i <= last; i++)
+	{
+		if (entryName == NULL)
+		{
+			if (entry[i].dir2.fileType == EXT2_FT_FREE)
+			{
+				*offset = i;
+				return 1;
+			}
+		}
+		else
+		{
+			if (memcmp(entry[i].name, entryName, MAX_ENTRY_NAME_LENGTH) == 0)
+			{
+				*offset = i;
+				return EXT2_SUCCESS;
+			}
+		}
+
+		if( entry[i].dir2.fileType == EXT2_FT_NO_MORE )
+		{
+			*offset = i;
+			return 2;
+		}
+	}
+
+	*offset = i;
 
-fail:
 	return EXT2_ERROR;
 }
 
-/* Ͽ Ҵ ϵ ٽ free · ȯ */
-int free_block(EXT2_NODE* retEntry)
+/*  */
+/*       */
+/* return :  i_block ε, offsets ܰ躰 ε, depth ܰ  */
+static int get_indirect_path(EXT2_FILESYSTEM* fs, UINT32 block, UINT32* offsets, UINT32* depth)
 {
+	UINT32 ptrBits = fs->sb_info.blockSize_bits + 8; //      (1KB : 2 8)
+	UINT32 ptrMask = (1 << ptrBits) - 1;
+
+	block -= EXT2_NDIR_BLOCKS;
+	if (block <= ptrMask)
+	{	//    
+		*depth = 1;
+		offsets[0] = block;
+		return EXT2_IND_BLOCK;
+	}
+
+	block -= ptrMask + 1;
+	if (block < (1U << (ptrBits * 2)))
+	{	//    
+		*depth = 2;
+		offsets[0] = block >> ptrBits;
+		offsets[1] = block & ptrMask;
+		return EXT2_DIND_BLOCK;
+	}
 
+	//    
+	block -= 1U << (ptrBits * 2);
+	*depth = 3;
+	offsets[0] = block >> (ptrBits * 2);
+	offsets[1] = (block >> ptrBits) & ptrMask;
+	offsets[2] = block & ptrMask;
+	return EXT2_TIND_BLOCK;
 }
 
-/* Ͽ Ҵ inode ٽ free · ȯ */
-int free_inode(EXT2_NODE* retEntry)
+/*  */
+/*     */
+int get_indirect_block(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32* retBlk)
 {
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 offsets[3], depth, i;
+	UINT32 current;
+
+	current = inode->i_block[get_indirect_path(fs, block, offsets, &depth)];
+
+	for (i = 0; i < depth && current != 0; i++)
+	{
+		if (read_block(fs, current, buffer) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+		current = ((UINT32 *)buffer)[offsets[i]];
+	}
 
+	*retBlk = current;
+
+	return EXT2_SUCCESS;
 }
 
+/* logical°  ũ  ȣ, ű⼭ ũ ̾   */
+/*    ܰ ϳ Ƿ count   ȿ , Ҵ   physical 0, count 1 */
+static int get_block_run(EXT2_FILESYSTEM* fs, const EXT2_INODE* inode, UINT32 logical, UINT32* physical, UINT32* count)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	const UINT32* pointers;
+	UINT32 offsets[3], depth, i;
+	UINT32 current, limit;
+
+	*physical = 0;
+	*count = 1;
+	if (inode->blockCount == 0 || logical >= inode->blockCount)
+		return EXT2_SUCCESS;
 
-/******************************************************************************/
-/* format																	  */
-/******************************************************************************/
+	if (logical < EXT2_NDIR_BLOCKS)
+	{
+		pointers = &inode->i_block[logical];
+		limit = EXT2_NDIR_BLOCKS - logical;
+	}
+	else
+	{
+		current = inode->i_block[get_indirect_path(fs, logical, offsets, &depth)];
+		for (i = 0; i < depth; i++)
+		{
+			if (current == 0)
+				return EXT2_SUCCESS;
+			if (read_block(fs, current, buffer) != EXT2_SUCCESS)
+				return EXT2_ERROR;
+			if (i < depth - 1)
+				current = ((UINT32 *)buffer)[offsets[i]];
+		}
+		pointers = &((UINT32 *)buffer)[offsets[depth - 1]];
+		limit = (fs->sb_info.blockSize >> 2) - offsets[depth - 1];
+	}
+
+	limit = MIN(limit, inode->blockCount - logical);
+	*physical = pointers[0];
+	if (*physical == 0)
+		return EXT2_SUCCESS;
+
+	for (i = 1; i < limit && pointers[i] == *physical + i; i++)
+		;
+	*count = i;
+
+	return EXT2_SUCCESS;
+}
 
 /*  */
-/* ۺ ü    */
-int fill_super_block(EXT2_SUPER_BLOCK* sb, UINT32 numberOfSectors, UINT32 bytesPerSector)
+/*   Ͽ newBlk , ִ    Ҵ */
+int set_indirect_block(EXT2_FILESYSTEM* fs, UINT32 block, EXT2_INODE* inode, UINT32 newBlk)
 {
-	UINT32 groupCount;
-	UINT32 descTableBlks;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 offsets[3], depth, i;
+	UINT32 index, current, next;
 
-	UINT32 totalSize, blkSize;
-	UINT32 totalBlkCnt;
-	UINT32 blkPerGroup;
-	UINT32 inoBlksPerGroup, inodesPerGroup;
-	UINT32 inodeCount;
+	index = get_indirect_path(fs, block, offsets, &depth);
 
-	ZeroMemory(sb, sizeof(*sb));
+	if (inode->i_block[index] == 0)
+	{
+		if (alloc_index_block(fs, newBlk, &inode->i_block[index]) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+	}
+	current = inode->i_block[index];
 
-	blkSize = EXT2_MIN_BLOCK_SIZE << EXT2_BLOCK_SIZE_BIT; // ϳ   
-	totalSize = numberOfSectors * bytesPerSector; // ũ ü ũ 
-	totalBlkCnt = (totalSize + (blkSize - 1)) / blkSize; // ü   
+	for (i = 0; i < depth; i++)
+	{
+		if (read_block(fs, current, buffer) != EXT2_SUCCESS)
+			return EXT2_ERROR;
 
-	sb->inodeCount = totalBlkCnt / 2;
-	sb->blockCount = totalBlkCnt;
+		if (i == depth - 1)
+		{
+			((UINT32 *)buffer)[offsets[i]] = newBlk;
+			return write_meta_block(fs, current, buffer);
+		}
 
-	blkPerGroup = blkSize << 3; // Ʈ   Ʈ  
-	groupCount = ((totalBlkCnt - 1) / blkPerGroup) + 1;
+		next = ((UINT32 *)buffer)[offsets[i]];
+		if (next == 0)
+		{
+			if (alloc_index_block(fs, newBlk, &next) != EXT2_SUCCESS)
+				return EXT2_ERROR;
+			((UINT32 *)buffer)[offsets[i]] = next;
+			if (write_meta_block(fs, current, buffer) != EXT2_SUCCESS)
+				return EXT2_ERROR;
+		}
+		current = next;
+	}
 
+	return EXT2_SUCCESS;
+}
 
-	descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize; // ׷ ũ ̺ ϴ  
-	inodesPerGroup = sb->inodeCount / groupCount;
-	inoBlksPerGroup = ((sb->inodeSize * inodesPerGroup) + (blkSize - 1)) / blkSize; // ׷ inode table  
-	descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize; // ׷ ũͰ ϴ   
+/*  */
+/*  ȣ  ׷ ȣ */
+int get_group_of_block(EXT2_FILESYSTEM* fs, UINT32 block, UINT32* retGroup)
+{
+	*retGroup = block_to_group(fs, block);
 
-	sb->magicSignature = 0xEF53;
+	return EXT2_SUCCESS;
+}
 
-	sb->reservedBlockCount = totalBlkCnt / 20;
-	sb->freeBlockCount = (blkPerGroup - 1 - descTableBlks - 2 - inoBlksPerGroup) * groupCount;
-	sb->freeInodeCount = sb->inodeCount;
-	sb->firstDataBlock = 1;
-	sb->logBlockSize = EXT2_BLOCK_SIZE_BIT;
-	sb->logFragSize = EXT2_BLOCK_SIZE_BIT;
-	sb->inodesPerGroup = inodesPerGroup;
+/*  */
+/* inode ȣ   ȣ */
+int get_block_of_inode(EXT2_FILESYSTEM* fs, UINT32 inode, UINT32* retBlk)
+{
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	UINT32 group;
+	UINT32 block;
 
-	sb->firstInode = EXT2_GOOD_OLD_FIRST_INO;
-	sb->inodeSize = EXT2_INODE_SIZE;
-	sb->blocksPerGroup = blkPerGroup;
+	group = inode_to_group(sb_info, inode); // inode ִ ׷
+	block = fs->groupBase[group].inodeTable; // inode table   (mount  format ġ Ģ )
 
-	memcpy(sb->fsID, "EXT2", 4);
-	memcpy(sb->volumeName, VOLUME_LABEL, VOLUME_LABEL_LENGTH);
+	*retBlk = block + (inode_to_index(sb_info, inode) >> sb_info->inodesPerBlock_bits);
 
-	//  ڵ
-	sb->firstMetaBlockGroup = 99;
-	sb->reserved[189] = 98;
-	/*
-	printf("\ninodeCount		%#08x\t%X\n", &sb->inodeCount, sb->inodeCount);
-	printf("blockCount		%#08x\t%X\n", &sb->blockCount, sb->blockCount);
-	printf("reservedBlockCount	%#08x\t%X\n", &sb->reservedBlockCount, sb->reservedBlockCount);
-	printf("freeBlockCount		%#08x\t%X\n", &sb->freeBlockCount, sb->freeBlockCount);
-	printf("freeInodeCount		%#08x\t%X\n", &sb->freeInodeCount, sb->freeInodeCount);
-	printf("firstDataBlock		%#08x\t%X\n", &sb->firstDataBlock, sb->firstDataBlock);
-	printf("logBlockSize		%#08x\t%X\n", &sb->logBlockSize, sb->logBlockSize);
-	printf("logFragSize		%#08x\t%X\n", &sb->logFragSize, sb->logFragSize);
-	printf("blocksPerGroup		%#08x\t%X\n", &sb->blocksPerGroup, sb->blocksPerGroup);
-	printf("inodesPerGroup		%#08x\t%X\n", &sb->inodesPerGroup, sb->inodesPerGroup);
-	printf("magicSignature		%#08x\t%X\n", &sb->magicSignature, sb->magicSignature);
-	printf("firstInode		%#08x\t%X\n", &sb->firstInode, sb->firstInode);
-	printf("inodeSize		%#08x\t%X\n", &sb->inodeSize, sb->inodeSize);
-	printf("fsID(EXT2)		%#08x\t%X %X %X %X\n", &sb->fsID, 'E', 'X', 'T', '2');
-	printf("volumeName(EXT2 BY YJM)	%#08x\t%X %X %X %X %X %X %X %X %X %X %X\n", &sb->volumeName, 'E', 'X', 'T', '2', ' ', 'B', 'Y', ' ', 'Y', 'J', 'M');
-	printf("firstMetaBlkGroup	%#08x\t%X\n", &sb->firstMetaBlockGroup, sb->firstMetaBlockGroup);
-	printf("reserved[189]		%#08x\t%X\n\n", &sb->reserved[189], sb->reserved[189]);
-	*/
 	return EXT2_SUCCESS;
 }
 
 /*  */
-/* ۺ ϳ ϱ׷쿡  */
-int write_super_block(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+/* inode block ° Ҵ  ȣ  */
+int get_allocated_block(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32* retBlk)
 {
-	BYTE buffer[MAX_SECTOR_SIZE];
-	UINT32 blkSize = EXT2_BLOCK_SIZE;
-	UINT32 sectorsPerBlock = blkSize / MAX_SECTOR_SIZE;
-	UINT32 sectorsPerGroup = sectorsPerBlock * sb->blocksPerGroup;
-
-	UINT32 sectorNumber = EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE + blkGroupNumber * sectorsPerGroup;
-	UINT32 offset = 0;
-	UINT32 sbSize = sizeof(EXT2_SUPER_BLOCK);
-
-	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
+	if(inode->blockCount == 0 || (inode->blockCount - 1) < block) // inode  Ҵ    -1 
 	{
-		printf("error : wrong argument\n");
-		return EXT2_ERROR;
+		*retBlk = 0;
+		return EXT2_SUCCESS;
 	}
 
-	while (offset < sbSize)
+	if (block < 0)
+		return EXT2_ERROR;
+	else if (block < EXT2_NDIR_BLOCKS)
+		*retBlk = inode->i_block[block];
+	else
 	{
-		ZeroMemory(buffer, sizeof(buffer));
-		memcpy(buffer, &((BYTE *)sb)[offset], sizeof(buffer));
-		disk->write_sector(disk, sectorNumber, buffer);
-		offset += MAX_SECTOR_SIZE;
-		sectorNumber++;
+		if (get_indirect_block(fs, block, inode, retBlk) != EXT2_SUCCESS) // i   ȣ 
+		{
+			LOG_ERROR("error : failed to get indirect block\n");
+			return EXT2_ERROR;
+		}
 	}
 
 	return EXT2_SUCCESS;
 }
 
 /*  */
-/* ϳ ϱ׷쿡  ׷ ũ    */
-int fill_desc(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, EXT2_GROUP_DESC* desc, UINT32 blkGroupNumber)
+/* block ° i_block  ġ newBlk  */
+int set_allocated_block(EXT2_FILESYSTEM* fs, UINT32 block, EXT2_INODE* inode, UINT32 newBlk)
 {
-	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize; //  ũ 
-	UINT32 groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1; //  ׷  
-	UINT32 descTableBlks = ((sizeof(EXT2_GROUP_DESC) * groupCount) + (blkSize - 1)) / blkSize; // ׷ ũ ̺   																				  
-	UINT32 inoBlksPerGroup = ((sb->inodesPerGroup * sb->inodeSize) + (blkSize - 1)) / blkSize; // ׷ inode table   
-
-	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
-	{
-		printf("error : wrong argument\n");
+	if (block < 0)
 		return EXT2_ERROR;
+	else if (block < EXT2_NDIR_BLOCKS)
+		inode->i_block[block] = newBlk;
+	else
+	{
+		if (set_indirect_block(fs, block, inode, newBlk) != EXT2_SUCCESS) // i   ȣ 
+		{
+			LOG_ERROR("error : failed to get indirect block\n");
+			return EXT2_ERROR;
+		}
 	}
 
-	ZeroMemory(desc, sizeof(EXT2_GROUP_DESC));
-
-	desc->bg_blockBitmap = sb->firstDataBlock + descTableBlks + 1 + blkGroupNumber * sb->blocksPerGroup; // block bitmap  ȣ 
-	desc->bg_inodeBitmap = desc->bg_blockBitmap + 1;
-	desc->bg_inodeTable = desc->bg_inodeBitmap + 1;
-
-	// ʱ free    
-	// ׷ ϼ - inode table ϼ -  ũ ̺ ϼ - 3(ۺ, bitmap) 
-	desc->bg_freeBlockCount = sb->blocksPerGroup - inoBlksPerGroup - descTableBlks - 3;
-	desc->bg_freeInodeCount = sb->inodeCount / groupCount;
-	desc->bg_usedDirCount = 0;
-	/*
-	printf("\nbg_blockBitmap		%#08x\t%X\n", &desc->bg_blockBitmap, desc->bg_blockBitmap);
-	printf("bg_inodeBitmap		%#08x\t%X\n", &desc->bg_inodeBitmap, desc->bg_inodeBitmap);
-	printf("bg_inodeTable		%#08x\t%X\n", &desc->bg_inodeTable, desc->bg_inodeTable);
-	printf("bg_freeBlockCount	%#08x\t%X\n", &desc->bg_freeBlockCount, desc->bg_freeBlockCount);
-	printf("bg_freeInodeCount	%#08x\t%X\n", &desc->bg_freeInodeCount, desc->bg_freeInodeCount);
-	printf("bg_usedDirCount		%#08x\t%X\n\n", &desc->bg_usedDirCount, desc->bg_usedDirCount);
-	*/
 	return EXT2_SUCCESS;
 }
 
 /*  */
-/* ϳ ϱ׷쿡  ׷ ũ ̺ ʱȭ */
-int init_desc(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+/* inode   ȸϸ entryName Ž */
+/* */
+int lookup_entry(EXT2_FILESYSTEM* fs, const EXT2_INODE* inode, const char* entryName, EXT2_NODE* ret)
 {
-	BYTE buffer[MAX_SECTOR_SIZE];
-	EXT2_GROUP_DESC desc;	// ׷ ũ 
-	EXT2_GROUP_DESC* pdesc = &desc;	// ׷ ũ  
-	UINT32 groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1; // ü ׷  
-	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize; //  ϳ ũ 
-	UINT32 sectorsPerBlock = blkSize / MAX_SECTOR_SIZE; //    
-	UINT32 sectorsPerGroup = sectorsPerBlock * sb->blocksPerGroup; // ϱ׷   
-	UINT32 sectorNumber = (EXT2_MIN_BLOCK_SIZE + blkSize) / MAX_SECTOR_SIZE + sectorsPerGroup * blkGroupNumber; // write   ȣ 
-	UINT32 offset = 0;
-	UINT32 i;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 retBlk, offset;
+	UINT32 usedBlk;
+	UINT32 i, result;
+	EXT2_DIR_ENTRY_LOCATION location;
 
-	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
-	{
-		printf("error : wrong argument\n");
-		return EXT2_ERROR;
-	}
+	ZeroMemory(buffer, sizeof(buffer));
 
-	for (i = 0; i < groupCount; i++)
+	usedBlk = inode->blockCount;
+
+	for (i = 0; i < usedBlk; i++)
 	{
-		ZeroMemory(pdesc, sizeof(EXT2_GROUP_DESC));
-		if (fill_desc(disk, sb, pdesc, i) != EXT2_SUCCESS) // i ׷ ũ ʱȭ
+
+		if (get_allocated_block(fs, i, inode, &retBlk) != EXT2_SUCCESS) // inode ü i_block[i]  ȣ 
 		{
-			printf("error : faid to fill group descriptor of group %d\n", i);
+			LOG_ERROR("error : failed to get allocated block number\n");
 			return EXT2_ERROR;
 		}
 
-		memcpy(&((EXT2_GROUP_DESC *)buffer)[offset++], pdesc, sizeof(desc)); // ۿ ũ  
+		if (read_meta_block(fs, retBlk, buffer) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to read block in lookup_entry()\n");
+			return EXT2_ERROR;
+		}
+
+//  number° Ʈ ã */
+//return : EXT2_SUCCESS( ̸ ã)
+//			EXT2_ERROR(ƹ͵ ã)
+//			1 (free)
+//			2 (no more)
+		result = find_entry_at_block(fs, buffer, entryName, &offset);
+
+
+		get_location_of_block(fs, retBlk, &location);
+		location.offset = offset;
+
+		ret->location = location;
 
-		if (offset >= (MAX_SECTOR_SIZE / sizeof(desc))) //    ũ  
+		if (result == EXT2_SUCCESS) // ã Ʈ 뵵 Բ 
 		{
-			disk->write_sector(disk, sectorNumber++, buffer);
-			offset = 0;
-			ZeroMemory(buffer, sizeof(buffer)); //  Ŭ 
+			ret->fs = fs;
+			memcpy(&ret->entry, &((EXT2_DIR_ENTRY *)buffer)[offset], sizeof(EXT2_DIR_ENTRY));
 		}
+
+		if (result != EXT2_ERROR) // ãҰų free, no more Ʈ     
+			break;
 	}
 
-	return EXT2_SUCCESS;
+	return result;
 }
 
-/*  */
-/* block bitmap inode bitmap ʱȭ */
-int clear_bitmap(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+/*  */
+/*  ͸ entryName Ʈ ִ ˻ */
+/* ĳÿ ִ 쿡 ã, ũ   */
+int ext2_lookup_cached(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
 {
-	BYTE buffer[MAX_SECTOR_SIZE];
-	UINT32 offset = 0;
-	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
-	UINT32 groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1; //  ׷ 
-	UINT32 descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize; // ׷ ũͰ ϴ  
-	UINT32 sectorsPerBlock = blkSize / MAX_SECTOR_SIZE; //    
-	UINT32 sectorsPerGroup = sectorsPerBlock * sb->blocksPerGroup; // ϱ׷   
-	UINT32 sectorNumber = (EXT2_MIN_BLOCK_SIZE + blkSize + descTableBlks * blkSize) / MAX_SECTOR_SIZE + blkGroupNumber * sectorsPerGroup; // write   ȣ 
+	BYTE name[MAX_NAME_LENGTH] = { 0, };
+	UINT32 seq;
 
-	while (offset < blkSize * 2) // block bitmap, inode bitmap clear 
-	{
-		ZeroMemory(buffer, sizeof(buffer));
-		disk->write_sector(disk, sectorNumber, buffer);
-		offset += MAX_SECTOR_SIZE;
-		sectorNumber++;
-	}
+	strncpy((char *)name, entryName, MAX_ENTRY_NAME_LENGTH);
 
-	return EXT2_SUCCESS;
+	if (format_name(parent->fs, (char *)name) == EXT2_ERROR)
+		return EXT2_ERROR;
+
+	return dcache_lookup(parent->fs, parent->entry.inode, name, retEntry, &seq);
 }
 
-/*  */
-/* inode table ʱȭ */
-int clear_inode_table(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb, UINT32 blkGroupNumber)
+int ext2_lookup(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
 {
-	BYTE buffer[MAX_SECTOR_SIZE];
-	UINT32 blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize; //  ũ 
-	UINT32 groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1; //  ׷  
-	UINT32 descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize; // ׷ ũͰ ϴ   
+	BYTE name[MAX_NAME_LENGTH] = { 0, };
+	EXT2_INODE inode;
+	EXT2_IO_STATS* outer;
+	UINT32 seq = 1;
+	int result;
 
-	UINT32 inoBlksPerGroup = ((sb->inodesPerGroup * sb->inodeSize) + (blkSize - 1)) / blkSize; // ׷  inode table   
-	UINT32 inoSecPerGroup = inoBlksPerGroup * EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE; // ׷  inode table  
+	strncpy((char *)name, entryName, MAX_ENTRY_NAME_LENGTH);
 
-	UINT32 sectorsPerBlock = blkSize / MAX_SECTOR_SIZE; //    
-	UINT32 sectorsPerGroup = sectorsPerBlock * sb->blocksPerGroup; // ϱ׷   
-	UINT32 sectorNumber = (EXT2_MIN_BLOCK_SIZE + blkSize + descTableBlks + 2 * blkSize) / MAX_SECTOR_SIZE + blkGroupNumber * sectorsPerGroup; // write   ȣ 
+	if (format_name(parent->fs, (char *)name) == EXT2_ERROR)
+		return EXT2_ERROR;
 
-	UINT32 i;
+	outer = enter_op(parent->fs, EXT2_OP_LOOKUP);
 
-	if (disk == NULL || sb == NULL || blkGroupNumber < 0)
+	// ĳÿ  lock  
+	if (dcache_lookup(parent->fs, parent->entry.inode, name, retEntry, &seq) == EXT2_SUCCESS)
 	{
-		printf("error : wrong argument\n");
-		return EXT2_ERROR;
+		leave_op(outer);
+		return EXT2_SUCCESS;
 	}
 
-	for (i = 0; i < inoSecPerGroup; i++)
+	lock_inode(parent->fs, parent->entry.inode, 0);
+	if (get_inode(parent->fs, parent->entry.inode, (BYTE *)&inode))
 	{
-		ZeroMemory(buffer, sizeof(buffer));
-		disk->write_sector(disk, sectorNumber + i, buffer);
+		unlock_inode(parent->fs, parent->entry.inode);
+		leave_op(outer);
+		LOG_ERROR("error : failed to get inode\n");
+		return EXT2_ERROR;
 	}
 
-	return EXT2_SUCCESS;
-}
+	result = lookup_entry(parent->fs, &inode, (char *)name, retEntry);
+	unlock_inode(parent->fs, parent->entry.inode);
 
-/*  */
-/* Ʈ ͸  */
-int create_root(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb)
-{
-	BYTE buffer[MAX_SECTOR_SIZE];
-	EXT2_INODE* inode;
-	EXT2_GROUP_DESC* desc;
-	EXT2_DIR_ENTRY* entry;
-	UINT32 firstDataBlk, inoBlksPerGroup, descTableBlks;
-	UINT32 blkSize, groupCount;
-	UINT32 sectorNumber;
-	UINT32 i;
-	UINT32 metaBlocks;
+	if (result == EXT2_SUCCESS)
+		dcache_fill(parent->fs, parent->entry.inode, retEntry, seq);
+	leave_op(outer);
 
-	groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1; //  ׷  
-	blkSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize; // ϳ  ũ 
-	descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (blkSize - 1)) / blkSize; // ׷ ũͰ ϴ   
-	inoBlksPerGroup = ((sb->inodeSize * sb->inodesPerGroup) + (blkSize - 1)) / blkSize; // ׷ inode table   
+	return result;
+}
 
-																						// 0  ׷     
-	firstDataBlk = (EXT2_MIN_BLOCK_SIZE + (3 + descTableBlks + inoBlksPerGroup) * EXT2_BLOCK_SIZE) / EXT2_BLOCK_SIZE;
-	metaBlocks = 4 + descTableBlks + inoBlksPerGroup;
 
-	// INODE
-	ZeroMemory(buffer, sizeof(buffer));
-	inode = (EXT2_INODE *)buffer;
-	inode[EXT2_ROOT_INO - 1].fileSize = 0;
-	inode[EXT2_ROOT_INO - 1].fileMode = ACCESSED_BY_ANYONE | FILE_TYPE_DIR;
-	inode[EXT2_ROOT_INO - 1].linkCount = 2; // dot, dotdot 
-	inode[EXT2_ROOT_INO - 1].blockCount = 1;
-	inode[EXT2_ROOT_INO - 1].i_block[0] = firstDataBlk; // 0  ׷    պκ Ʈ 丮 Ʈ 
+/******************************************************************************/
+/* touch, fill							                                      */
+/******************************************************************************/
 
-	sectorNumber = (EXT2_MIN_BLOCK_SIZE + blkSize * (3 + descTableBlks)) / MAX_SECTOR_SIZE;
-	disk->write_sector(disk, sectorNumber, inode); // inode table 2(Ʈ 丮)  
+/* ش  ׷ ũ ü ġ ˻  о (fsck) */
+int load_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	UINT32 block;
+	UINT32 offset;
 
-												   // EXT2_DIR_ENTRY
 	ZeroMemory(buffer, sizeof(buffer));
-	entry = (EXT2_DIR_ENTRY *)buffer;
 
-	// dot entry 
-	entry->inode = EXT2_ROOT_INO;
-	entry->dir2.nameLength = 1;
-	memcpy(entry->name, ".", 1);
-	entry->dir2.fileType = EXT2_FT_DIR;
-	entry++;
-
-	// dotdot entry 
-	entry->inode = EXT2_ROOT_INO;
-	entry->dir2.nameLength = 2;
-	memcpy(entry->name, "..", 2);
-	entry->dir2.fileType = EXT2_FT_DIR;
-	entry++;
+	offset = blkGroupNumber & (sb_info->descPerBlock - 1);
+	block = get_desc_block(fs, blkGroupNumber);
+	if (read_meta_block(fs, block, buffer) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : failed to read_block() in load_desc()\n");
+		return EXT2_ERROR;
+	}
+	memcpy(retDesc, &((EXT2_GROUP_DESC *)buffer)[offset], sizeof(EXT2_GROUP_DESC));
 
-	// no more entry
-	entry->dir2.fileType = EXT2_FT_NO_MORE;
+	return EXT2_SUCCESS;
+}
 
-	// 0  ׷    պκп Ƽ 丮 Ʈ  
-	sectorNumber = (EXT2_MIN_BLOCK_SIZE + blkSize * (3 + descTableBlks + inoBlksPerGroup)) / MAX_SECTOR_SIZE;
-	disk->write_sector(disk, sectorNumber, buffer);
+/*  */
+/* ش  ׷ ũ ü о */
+/* Ÿ  ȣ mount   ׷ ̺ ٸ ջ  , ġ  fsck ñ */
+/* ׷ ̺  尡 lock  Ƿ  ߿ ٲ  */
+int read_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc)
+{
+	EXT2_GROUP_DESC* desc = (EXT2_GROUP_DESC *)retDesc;
+	EXT2_GROUP_BASE* base = &fs->groupBase[blkGroupNumber];
 
-	// ׷ ũ Ʈ 
-	ZeroMemory(buffer, sizeof(buffer));
-	sectorNumber = (EXT2_MIN_BLOCK_SIZE + blkSize) / MAX_SECTOR_SIZE;
-	disk->read_sector(disk, sectorNumber, buffer);
-	desc = (EXT2_GROUP_DESC *)buffer;
-	desc->bg_freeBlockCount -= 4;
-	desc->bg_freeInodeCount--;
-	desc->bg_usedDirCount++;
-	disk->write_sector(disk, sectorNumber, buffer);
+	if (load_desc(fs, blkGroupNumber, retDesc) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
-	//  Ʈ Ʈ
-	ZeroMemory(buffer, sizeof(buffer));
-	sectorNumber = (EXT2_MIN_BLOCK_SIZE + blkSize * (1 + descTableBlks)) / MAX_SECTOR_SIZE;
-	disk->read_sector(disk, sectorNumber, buffer);
-	for (i = 0; i < 4 + descTableBlks + inoBlksPerGroup + 1; i++)
+	if (desc->bg_blockBitmap != base->blockBitmap || desc->bg_inodeBitmap != base->inodeBitmap ||
+		desc->bg_inodeTable != base->inodeTable)
 	{
-		set_bit(i, buffer);
+		LOG_ERROR("error : group %u descriptor does not match the file system layout, run fsck\n", blkGroupNumber);
+		return EXT2_ERROR;
 	}
-	disk->write_sector(disk, sectorNumber, buffer);
 
-	// inode Ʈ Ʈ
+	return EXT2_SUCCESS;
+}
+
+/*  */
+/* ش  ׷ ũ ü  */
+int write_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	UINT32 block;
+	UINT32 offset;
+
 	ZeroMemory(buffer, sizeof(buffer));
-	sectorNumber += (EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE);
-	disk->read_sector(disk, sectorNumber, buffer);
-	set_bit(1, buffer);
-	disk->write_sector(disk, sectorNumber, buffer);
 
-	//   Ʈ 
-	sb->freeBlockCount--;
-	sb->freeInodeCount--;
+	offset = blkGroupNumber & (sb_info->descPerBlock - 1);
+	block = get_desc_block(fs, blkGroupNumber);
+	lock_block(fs, block); //  Ͽ ִ ٸ ׷ ũͰ ÿ   
+	read_block(fs, block, buffer);
+	memcpy(&((EXT2_GROUP_DESC *)buffer)[offset], retDesc, sizeof(EXT2_GROUP_DESC));
+
+	write_meta_block(fs, block, buffer);
+	unlock_block(fs, block);
 
 	return EXT2_SUCCESS;
 }
 
 /*  */
-/*   ׷  ʱȭ  Ʈ ͸  */
-int ext2_format(DISK_OPERATIONS* disk)
+/* 丮  Ȯ */
+int is_dir(EXT2_NODE* entry)
 {
-	EXT2_SUPER_BLOCK sb;
-	UINT32 groupCount;
-	UINT32 blkGroupNumber = 0;
-	BYTE buffer[MAX_SECTOR_SIZE];
-	EXT2_SUPER_BLOCK * p_sb = &sb;
+	if (entry->entry.dir2.fileType == EXT2_FT_DIR)
+		return EXT2_SUCCESS;
+	else
+		return EXT2_ERROR;
+}
 
-	if (fill_super_block(p_sb, disk->numberOfSectors, disk->bytesPerSector) != EXT2_SUCCESS)
-	{
-		printf("error : failed to fill super block\n");
+/*  */
+/* Ʈ ͸ Ȯ */
+int is_root_dir(EXT2_NODE* entry)
+{
+	if (entry->entry.inode == EXT2_ROOT_INO && entry->entry.dir2.fileType == EXT2_FT_DIR)
+		return EXT2_SUCCESS;
+	else
 		return EXT2_ERROR;
-	}
+}
+/*  */
+/* entry  inode Ҵְ, entry  ʱȭ */
+int make_entry(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, const char* name, UINT32 fileType, EXT2_NODE* newEntry)
+{
 
-	groupCount = ((p_sb->blockCount - p_sb->firstDataBlock - 1) / p_sb->blocksPerGroup) + 1; //  ׷  
+	newEntry->entry.recordLength = sizeof(EXT2_DIR_ENTRY);
+	newEntry->entry.dir2.nameLength = MAX_ENTRY_NAME_LENGTH;
+	newEntry->entry.dir2.fileType = fileType;
+	memcpy(newEntry->entry.name, name, MAX_ENTRY_NAME_LENGTH);
 
-	while (blkGroupNumber < groupCount)
+	if (alloc_inode(fs, parent, newEntry) != EXT2_SUCCESS)
 	{
-		write_super_block(disk, p_sb, blkGroupNumber);
-		init_desc(disk, p_sb, blkGroupNumber);
-		clear_bitmap(disk, p_sb, blkGroupNumber); // block bitmap, inode bitmap ʱȭ 
-		clear_inode_table(disk, p_sb, blkGroupNumber);
-
-		blkGroupNumber++;
+		LOG_ERROR("error : failed to alloc_inode() in make_entry\n");
+		return EXT2_ERROR;
 	}
 
-	printf("total sector count		: %u\n", disk->numberOfSectors);
-	printf("total block count		: %u\n", sb.blockCount);
-	printf("total inode count		: %u\n", sb.inodeCount);
-	printf("sector byte size		: %u\n", MAX_SECTOR_SIZE);
-	printf("block byte size			: %u\n", EXT2_BLOCK_SIZE);
-	printf("inode byte size			: %u\n", sb.inodeSize);
-	printf("\n");
-
-	create_root(disk, p_sb);
-
 	return EXT2_SUCCESS;
 }
 
 
-/******************************************************************************/
-/* mount / umount	                                                          */
-/******************************************************************************/
+int get_location_of_block(EXT2_FILESYSTEM* fs, UINT32 block, EXT2_DIR_ENTRY_LOCATION* location)
+{
+	location->group = block_to_group(fs, block); //  ׷ ȣ
+	location->block = block_to_index(fs, block);
+	location->offset = 0;
+	return EXT2_SUCCESS;
+}
 
-/*  */
-/* ۺ ȿ ˻ */
-int validate_superblock(EXT2_FILESYSTEM* fs)
+/*  */
+/* Ʈ  */
+int insert_entry(EXT2_NODE* parent, EXT2_NODE* newEntry, UINT32 overwrite)
 {
-	UINT32 blockSize;
-	EXT2_SUPER_BLOCK* sb = &fs->sb;
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	BYTE newBlock[EXT2_MAX_BLOCK_SIZE];
+	EXT2_INODE* inode;
+	EXT2_DIR_ENTRY_LOCATION location;
+	int result;
+	EXT2_SB_INFO* sb_info = &parent->fs->sb_info;
+	inode = (EXT2_INODE *)buffer;
+	UINT32 blockNumber;
 
-	if (sb->logBlockSize < 0 || sb->logBlockSize > 2) //  ũ ˻ 
+	EXT2_NODE entryNoMore;
+
+	// θ 丮 inode о
+	ZeroMemory(buffer, sizeof(buffer));
+	inode = (EXT2_INODE *)buffer;
+	if (get_inode(parent->fs, parent->entry.inode, (BYTE *)inode) != EXT2_SUCCESS)
 	{
-		printf("error : invalid block size\n");
+		LOG_ERROR("error : failed to get inode\n");
 		return EXT2_ERROR;
 	}
 
-	if (sb->magicSignature != 0xEF53) // ñ״ó ˻ 
+	if (get_allocated_block(parent->fs, 0, inode, &blockNumber) != EXT2_SUCCESS)
 	{
-		printf("error : invalid signature\n");
+		LOG_ERROR("error : failed to get_allocated_block() in insert_entry()\n");
 		return EXT2_ERROR;
 	}
 
-	return EXT2_SUCCESS;
-}
+	get_location_of_block(parent->fs, blockNumber, &location);
 
-/*  */
-/* location entry   */
-int set_entry(EXT2_FILESYSTEM* fs, EXT2_DIR_ENTRY_LOCATION* location, EXT2_DIR_ENTRY* newEntry)
-{
-	EXT2_SUPER_BLOCK* sb = &fs->sb;
-	UINT32 block;
-	BYTE buffer[EXT2_BLOCK_SIZE];
+	// Ʈ 丮 ƴϰ overwrite set̸
+	if (is_root_dir(parent) != EXT2_SUCCESS && overwrite == 1)
+	{
+		if (set_entry(parent->fs, &location, &newEntry->entry) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to set_entry() in insert_entry()\n");
+			return EXT2_ERROR;
+		}
+		newEntry->location = location;
+		dcache_add(parent->fs, parent->entry.inode, newEntry);
+		// ϴ 
+		location.offset = 1;
+		ZeroMemory(&entryNoMore, sizeof(entryNoMore));
+		entryNoMore.entry.dir2.fileType = EXT2_FT_NO_MORE;
+		entryNoMore.entry.recordLength = sb_info->blockSize - sizeof(EXT2_DIR_ENTRY);
+		if (set_entry(parent->fs, &location, &entryNoMore.entry) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to set_entry() in insert_entry()\n");
+			return EXT2_ERROR;
+		}
 
-	block = sb->firstDataBlock + location->group * sb->blocksPerGroup + location->block;
-	ZeroMemory(buffer, sizeof(buffer));
+		return EXT2_SUCCESS;
+	}
 
-	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
-	{
-		printf("error : failed to read_block() in get_entry()\n");
-		return EXT2_ERROR;
+	// find free entry
+	ZeroMemory(&entryNoMore, sizeof(entryNoMore));
+	result = lookup_entry(parent->fs, inode, NULL, &entryNoMore);
+	if (result != 1 && result != 2)
+	{	//  ͸      Ҵ
+		if (alloc_block(parent->fs, parent) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to alloc_block() in insert_entry()\n");
+			return EXT2_ERROR;
+		}
+		// alloc_block  inode ٽ о   
+		if (get_inode(parent->fs, parent->entry.inode, (BYTE *)inode) != EXT2_SUCCESS ||
+			get_allocated_block(parent->fs, inode->blockCount - 1, inode, &blockNumber) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : get_allocated_block() in insert_entry()\n");
+			return EXT2_ERROR;
+		}
+		ZeroMemory(newBlock, sizeof(newBlock)); //  ͸   Ʈ ʱȭ
+		write_meta_block(parent->fs, blockNumber, newBlock);
+		get_location_of_block(parent->fs, blockNumber, &entryNoMore.location);
 	}
-	memcpy(&((EXT2_DIR_ENTRY *)buffer)[location->offset], newEntry, sizeof(EXT2_DIR_ENTRY));
 
-	if (write_block(fs, block, buffer) != EXT2_SUCCESS)
-	{
-		printf("error : failed to write_block() in get_entry()\n");
-		return EXT2_ERROR;
+	set_entry(parent->fs, &entryNoMore.location, &newEntry->entry);
+	newEntry->location = entryNoMore.location;
+	dcache_add(parent->fs, parent->entry.inode, newEntry);
+
+	if (result == 2)
+	{	// no more Ʈ  ĭ ڷ,  ̸      Ҵ
+		entryNoMore.location.offset++;
+		if (entryNoMore.location.offset < (sb_info->blockSize / sizeof(EXT2_DIR_ENTRY)))
+		{
+			entryNoMore.entry.dir2.fileType = EXT2_FT_NO_MORE;
+			set_entry(parent->fs, &entryNoMore.location, &entryNoMore.entry);
+		}
 	}
 
 	return EXT2_SUCCESS;
 }
 
 /*  */
-/* location entry   */
-int get_entry(EXT2_FILESYSTEM* fs, EXT2_DIR_ENTRY_LOCATION* location, EXT2_DIR_ENTRY* retEntry)
+/*   */
+static int create_file(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
 {
-	EXT2_SUPER_BLOCK* sb = &fs->sb;
-	UINT32 block;
-	BYTE buffer[EXT2_BLOCK_SIZE];
+	/*
+	format_name() // ̸   *
+	lookup_entry() // ̸ Ʈ   ˻*
+	insert_entry() //  ͸ Ʈ Ʈ ο Ʈ ߰*
+	alloc_inode() //  inode Ҵ
+	EXT2_DIR_ENTRY ʱȭ
+	adjust_free_count() // ɼǿ  freeCount  (COUNT_UP / COUNT_DOWN)
+	set_bitmap() // bitmap 
+	*/
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_INODE* inode;
+	BYTE name[MAX_NAME_LENGTH] = { 0, };
 
-	block = sb->firstDataBlock + location->group * sb->blocksPerGroup + location->block;
-	ZeroMemory(buffer, sizeof(buffer));
+	strncpy((char *)name, entryName, MAX_ENTRY_NAME_LENGTH);
+	if (format_name(parent->fs, (char *)name))
+		return EXT2_ERROR;
 
-	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
+	ZeroMemory(retEntry, sizeof(EXT2_NODE));
+
+	// ۿ inode ü о
+	if (get_inode(parent->fs, parent->entry.inode, buffer) != EXT2_SUCCESS)
 	{
-		printf("error : failed to read_block() in get_entry()\n");
+		LOG_ERROR("error : failed to get inode\n");
 		return EXT2_ERROR;
 	}
-	memcpy(retEntry, &((EXT2_DIR_ENTRY *)buffer)[location->offset], sizeof(EXT2_DIR_ENTRY));
 
-	return EXT2_SUCCESS;
-}
+	inode = (EXT2_INODE *)buffer;
 
-/*  */
-/* ũ ۺ  о */
-int ext2_read_superblock(EXT2_FILESYSTEM* fs, EXT2_NODE* root)
-{
-	BYTE buffer[EXT2_MIN_BLOCK_SIZE];
-	int result;
-	int nameLength;
-	UINT32 descTableBlks, inoBlksPerGroup;
-	UINT32 groupCount, inodesPerGroup;
-	if (fs == NULL || fs->disk == NULL)
+	// inode  ̸ Ʈ ã
+	if (lookup_entry(parent->fs, inode, (char *)name, retEntry) == EXT2_SUCCESS)
 	{
-		printf("error : wrong argumenet\n");
-		printf("DISK OPERATIONS : %p \nFAT_FILESYSTEM : %p \n", fs, fs->disk);
+		LOG_ERROR("error : no entry named %s\n", name);
 		return EXT2_ERROR;
 	}
 
-	int readNum = sizeof(fs->sb);
-	UINT32 sectorNumber = EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE;
-	int i = 0;
-	int offset = 0;
-
-	while (offset < readNum)
+	if (make_entry(parent->fs, parent, (char *)name, EXT2_FT_REG_FILE, retEntry) != EXT2_SUCCESS)
 	{
-		result = fs->disk->read_sector(fs->disk, sectorNumber + i, &buffer[offset]); // ۿ ۺ  о 
-		if (result)
-		{
-			printf("error : failed to read sector %d\n", sectorNumber + i);
-			return EXT2_ERROR;
-		}
-		offset += MAX_SECTOR_SIZE;
-		i++;
+		LOG_ERROR("error : failed to make_entry() in ext2_create()\n");
+		return EXT2_ERROR;
 	}
 
-	memcpy(&fs->sb, buffer, EXT2_MIN_BLOCK_SIZE);
-
-	result = validate_superblock(fs);
+	retEntry->fs = parent->fs;
 
-	if (result) //    ȿ 
+	if (insert_entry(parent, retEntry, 0) != EXT2_SUCCESS)
 	{
-		printf("error : invalid super block\n");
+		LOG_ERROR("error : failed to insert entry\n");
 		return EXT2_ERROR;
 	}
 
-
-	groupCount = ((fs->sb.blockCount - fs->sb.firstDataBlock - 1) / fs->sb.blocksPerGroup) + 1;
-	descTableBlks = ((EXT2_DESC_SIZE * groupCount) + (EXT2_BLOCK_SIZE - 1)) / EXT2_BLOCK_SIZE;
-	inoBlksPerGroup = ((fs->sb.inodeSize * fs->sb.inodesPerGroup) + (EXT2_BLOCK_SIZE - 1)) / EXT2_BLOCK_SIZE;
-
-	ZeroMemory(root, sizeof(EXT2_NODE));
-
-	root->fs = fs;
-	root->location.group = 0;
-	root->location.block = (3 + descTableBlks + inoBlksPerGroup) * EXT2_BLOCK_SIZE / EXT2_BLOCK_SIZE;
-	root->location.offset = 0;
-
-	get_entry(fs, &root->location, &root->entry);
-	printf("root->entry.inode : %d\n", root->entry.inode);
-
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/* SB_INFO ü    */
-int fill_sb_info(EXT2_FILESYSTEM* fs)
+/* θ ͸ lock  ,  inode Ʈ ֱ  ٸ 忡   */
+int ext2_create(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
 {
-	EXT2_SUPER_BLOCK* sb = &fs->sb;
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 sectorPerBlock;
-	int i = 0;
-
-	ZeroMemory(sb_info, sizeof(EXT2_SB_INFO));
-
-	sb_info->blockSize = EXT2_MIN_BLOCK_SIZE << sb->logBlockSize;
-	sb_info->groupCount = ((sb->blockCount - sb->firstDataBlock - 1) / sb->blocksPerGroup) + 1;
-	sb_info->inodesPerBlock = sb_info->blockSize / EXT2_INODE_SIZE;
-	sb_info->blocksPerGroup = sb_info->blockSize * 8;
-	sb_info->inodesPerGroup = sb->inodesPerGroup;
-	sb_info->itbPerGroup = (sb->inodesPerGroup * EXT2_INODE_SIZE + (sb_info->blockSize - 1)) / sb_info->blockSize;
-	sb_info->blocksPerDesc = (sizeof(EXT2_GROUP_DESC) * sb_info->groupCount + (sb_info->blockSize - 1)) / sb_info->blockSize;
-	sb_info->sectorsPerBlock = sb_info->blockSize / MAX_SECTOR_SIZE;
-	sb_info->sectorsPerGroup = sb_info->blocksPerGroup * sectorPerBlock;
-	sb_info->descPerBlock = sb_info->blockSize / EXT2_DESC_SIZE;
-	sb_info->firstDescBlock = sb->firstDataBlock + 1;
-	sb_info->descPerBlock_bits = sb->logBlockSize + 5;
-	sb_info->blockSize_bits = sb->logBlockSize;
-	sb_info->inodeSize = EXT2_INODE_SIZE;
-	sb_info->firstInode = sb->firstInode;
-	sb_info->dirCount = 1;
-	sb_info->freeBlockCount = sb->freeBlockCount;
-	sb_info->freeInodeCount = sb->freeInodeCount;
+	EXT2_FILESYSTEM* fs = parent->fs;
+	EXT2_IO_STATS* outer = enter_op(fs, EXT2_OP_CREATE);
+	int result;
 
-	return EXT2_SUCCESS;
-}
+	begin_operation(fs, EXT2_OP_CREDITS);
+	lock_inode(fs, parent->entry.inode, 1);
+	result = create_file(parent, entryName, retEntry);
+	unlock_inode(fs, parent->entry.inode);
+	end_operation(fs);
+	leave_op(outer);
 
-/*  */
-/* mount  */
-void ext2_umount(EXT2_SB_INFO* sb_info)
-{
-	return; // do nothing
+	return result;
 }
 
 
 /******************************************************************************/
-/* ls								                                          */
+/* remove							                                          */
 /******************************************************************************/
 
-/*  */
-/*   ͸ Ʈ list ߰ */
-int read_dir_from_block(EXT2_FILESYSTEM* fs, BYTE* buffer, EXT2_NODE_ADD adder, void* list)
-{
-	EXT2_DIR_ENTRY* entry;
-	EXT2_NODE node;
-	UINT32 offset = 0;
-	UINT32 maxEntry = EXT2_BLOCK_SIZE / sizeof(EXT2_DIR_ENTRY);
-	int i;
-
-	ZeroMemory(&entry, sizeof(entry));
-	entry = (EXT2_DIR_ENTRY*)buffer;
-	printf("max entry : %d\n", sizeof(EXT2_DIR_ENTRY));
-	for (i = 0; i < maxEntry; i++)
-	{
-		if (entry->dir2.fileType == EXT2_FT_FREE)
-			;
-		else if (entry->dir2.fileType == EXT2_FT_NO_MORE) //  Ʈ 
-			return -1;
-		else
-		{
-			node.fs = fs;
-			node.entry = *entry;
-			adder(fs, list, &node);
-		}
-		entry++;
-	}
-
-	return EXT2_SUCCESS;
-}
+/* orphan  : Ǿ   ְų ߶󳻴  inode  Ʈ */
+/* Ӹ ۺ orphanList,  inode ȣ  inode dTime  (ext3  ) */
+/*    mount   ϸ 󰡸  ϰ inode  */
 
-/*  */
-/* ͸ Ʈ   */
-int ext2_read_dir(EXT2_NODE* dir, EXT2_NODE_ADD adder, void* list) // ͸ Ʈ о list ߰ 
+/* inode orphan   տ  */
+static int link_orphan(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
 	EXT2_INODE inode;
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	UINT32 block;
-	UINT32 offset = 0;
-	int i;
-
-	ZeroMemory(&inode, sizeof(EXT2_INODE));
-	ZeroMemory(buffer, sizeof(buffer));
 
-	if (get_inode(dir->fs, dir->entry.inode, &inode) != EXT2_SUCCESS)
-	{
-		printf("error : failed to get inode\n");
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
 		return EXT2_ERROR;
-	}
-
-	printf("fileMode	: %#X\n", inode.fileMode);
-	printf("linkCount	: %u\n", inode.linkCount);
-	printf("blockCount	: %u\n", inode.blockCount);
-	printf("i.block[0]	: %u\n", inode.i_block[0]);
 
-	for (i = 0; i < inode.blockCount; i++)
-	{
-		if(get_allocated_block(dir->fs, i, &inode, &block) != EXT2_SUCCESS)
-		{
-			printf("error : failed to get_allocated_block in ext2_read_dir\n");
-			return EXT2_ERROR;
-		}
-
-		if (read_block(dir->fs, block, buffer)) // ϴ ũ о
-		{
-			printf("error : failed read block\n");
-			return EXT2_ERROR;
-		}
+	inode.dTime = fs->sb.orphanList;
+	if (set_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
-		if (read_dir_from_block(dir->fs, buffer, adder, list) == EXT2_ERROR) //  Ʈ list ߰
-		{
-			printf("error : failed read dir from block\n");
-			return EXT2_ERROR;
-		}
-	} 
+	fs->sb.orphanList = inodeNumber;
 
-	return EXT2_SUCCESS;
+	return sync_super_block(fs);
 }
 
+#define ORPHAN_BUSY		1	/*  inode ٸ 尡 װ , orphan lock  ٽ õ */
 
-/******************************************************************************/
-/* cd									                                      */
-/******************************************************************************/
-
-/*  */
-/* ̸ Ͻý Ŀ °  */ /*  ؾ */
-int format_name(EXT2_FILESYSTEM* fs, char* name)
+/* orphan Ͽ inode  */
+/*  inode dTime ġ  inode lock ʿ ( 尡 inode ü а--Ƿ) */
+/* lock  inode -> orphan̹Ƿ ٸ ʰ try  */
+static int unlink_orphan(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
-	UINT32	i, length;
-	UINT32	extender = 0, nameLength = 0;
-	UINT32	extenderCurrent = 21;
-	BYTE	regularName[MAX_ENTRY_NAME_LENGTH];
-	BYTE	nameBuf[MAX_NAME_LENGTH];
-
-	memset(regularName, 0x20, sizeof(regularName));
-	memset(nameBuf, 0x20, sizeof(nameBuf));
-	length = strlen(name);
+	EXT2_INODE inode;
+	UINT32 prev = 0, current = fs->sb.orphanList;
+	UINT32 count = 0;
+	pthread_rwlock_t* prevLock = NULL;
+	int result;
 
-	if (strncmp(name, "..", 2) == 0)
-	{
-		memcpy(nameBuf, "..", 2);
-		memcpy(name, nameBuf, MAX_ENTRY_NAME_LENGTH);
-		return EXT2_SUCCESS;
-	}
-	else if (strncmp(name, ".", 1) == 0)
-	{
-		memcpy(nameBuf, ".", 1);
-		memcpy(name, nameBuf, MAX_ENTRY_NAME_LENGTH);
-		return EXT2_SUCCESS;
-	}
-	else
+	while (current != 0 && current != inodeNumber)
 	{
-		upper_string(name, MAX_NAME_LENGTH);
-
-		for (i = 0; i < length; i++)
+		if (++count > fs->sb.inodeCount || get_inode(fs, current, (BYTE *)&inode) != EXT2_SUCCESS)
 		{
-			if (name[i] != '.' && !isdigit(name[i]) && !isalpha(name[i]))
-				return EXT2_ERROR;
-
-			if (name[i] == '.')
-			{
-				if (extender)
-					return EXT2_ERROR;
-				extender = 1;
-			}
-			else if (isdigit(name[i]) || isalpha(name[i]))
-			{
-				if (extender)
-					regularName[extenderCurrent++] = name[i];
-				else
-					regularName[nameLength++] = name[i];
-			}
-			else
-				return EXT2_ERROR;
-		}
-
-		if (nameLength > MAX_ENTRY_NAME_LENGTH - 3 || nameLength == 0 || extenderCurrent > MAX_ENTRY_NAME_LENGTH)
+			LOG_ERROR("error : broken orphan list\n");
 			return EXT2_ERROR;
+		}
+		prev = current;
+		current = inode.dTime;
 	}
 
-	memcpy(name, regularName, sizeof(regularName));
+	if (current == 0) // Ͽ 
+		return EXT2_SUCCESS;
 
-	return EXT2_SUCCESS;
-}
+	//  stripe ȣ 尡 ̹ װ 
+	if (prev != 0 && fs->locks != NULL &&
+		(prev & (EXT2_INODE_LOCKS - 1)) != (inodeNumber & (EXT2_INODE_LOCKS - 1)))
+	{
+		prevLock = &fs->locks->inode[prev & (EXT2_INODE_LOCKS - 1)];
+		if (pthread_rwlock_trywrlock(prevLock) != 0)
+			return ORPHAN_BUSY;
+	}
 
-/*  */
-/*   number° Ʈ ã */
-/* return : EXT2_SUCCESS( ̸ ã)
-* 			EXT2_ERROR(ƹ͵ ã)
-* 			1 (free)
-* 			2 (no more)
-*/
-int find_entry_at_block(EXT2_FILESYSTEM* fs, const BYTE* block, const char* entryName, UINT32* offset)
-{
-	UINT32 i;
-	const EXT2_DIR_ENTRY* entry = (EXT2_DIR_ENTRY *)block;
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 last = EXT2_BLOCK_SIZE / sizeof(EXT2_DIR_ENTRY) - 1;
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		result = EXT2_ERROR;
+	else
+	{
+		current = inode.dTime; //  orphan
+		inode.dTime = 0;
+		result = set_inode(fs, inodeNumber, (BYTE *)&inode);
+	}
 
-	for (i = 0; i <= last; i++)
+	if (result == EXT2_SUCCESS && prev == 0)
 	{
-		if (entryName == NULL)
-		{
-			if (entry[i].dir2.fileType == EXT2_FT_FREE)
-			{
-				*offset = i;
-				return 1;
-			}
-		}
+		fs->sb.orphanList = current;
+		result = sync_super_block(fs);
+	}
+	else if (result == EXT2_SUCCESS)
+	{
+		if (get_inode(fs, prev, (BYTE *)&inode) != EXT2_SUCCESS)
+			result = EXT2_ERROR;
 		else
 		{
-			if (memcmp(entry[i].name, entryName, MAX_ENTRY_NAME_LENGTH) == 0)
-			{
-				*offset = i;
-				return EXT2_SUCCESS;
-			}
-		}
-
-		if( entry[i].dir2.fileType == EXT2_FT_NO_MORE )
-		{
-			*offset = i;
-			return 2;
+			inode.dTime = current;
+			result = set_inode(fs, prev, (BYTE *)&inode);
 		}
 	}
 
-	*offset = i;
+	if (prevLock != NULL)
+		pthread_rwlock_unlock(prevLock);
 
-	return EXT2_ERROR;
+	return result;
 }
 
-/*  */
-/*     ˻ */
-int get_indirect_traversal(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32 *probe, BYTE* prevBuf, UINT32* retBlk)
+/*   inode ȣ(dTime) Ӹ orphan lock ȣ */
+static int orphan_add(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 ptrsPerBlk = sb_info->blockSize / sizeof(UINT32);
-	BYTE nextBuf[EXT2_BLOCK_SIZE];
-	UINT32 offset;
-
-	(*probe)--;
+	int result;
 
-	if (*probe == 0)
-	{
-		//   Ͽ ε ϱ
-		offset = (block - EXT2_NDIR_BLOCKS) % ptrsPerBlk;
-		*retBlk = ((UINT32 *)prevBuf)[offset];
-		return EXT2_SUCCESS;
-	}
-	else
-	{
-		//   ε ϱ, 8 2 8(256) ǹ
-		ZeroMemory(nextBuf, sizeof(nextBuf));
-		//offset = (block - EXT2_NDIR_BLOCKS - (1 << (*probe * 8) - 1)) / (1 << (*probe * 8));
-		offset = (block - EXT2_NDIR_BLOCKS) / (1 << (*probe * 8));
-		read_block(fs, ((UINT32 *)prevBuf)[offset], nextBuf);
-	}
+	if (fs->locks != NULL)
+		pthread_mutex_lock(&fs->locks->orphan);
+	result = link_orphan(fs, inodeNumber);
+	if (fs->locks != NULL)
+		pthread_mutex_unlock(&fs->locks->orphan);
 
-	return get_indirect_traversal(fs, block, inode, probe, nextBuf, retBlk);
+	return result;
 }
 
-int set_indirect_traversal(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32 *probe, BYTE* prevBuf, UINT32 newBlk)
+static int orphan_del(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 ptrsPerBlk = sb_info->blockSize / sizeof(UINT32);
-	BYTE nextBuf[EXT2_BLOCK_SIZE];
-	UINT32 offset;
+	int result;
 
-	(*probe)--;
+	if (fs->locks == NULL)
+		return unlink_orphan(fs, inodeNumber);
 
-	if (*probe == 0)
-	{
-		//   Ͽ ε ϱ
-		offset = (block - EXT2_NDIR_BLOCKS) % ptrsPerBlk;
-		((UINT32 *)prevBuf)[offset] = newBlk;
-			return EXT2_SUCCESS;
-	}
-	else
+	for (;;)
 	{
-		//   ε ϱ, 8 2 8(256) ǹ
-		ZeroMemory(nextBuf, sizeof(nextBuf));
-		offset = (block - EXT2_NDIR_BLOCKS) / (1 << (*probe * 8));
-		read_block(fs, ((UINT32 *)prevBuf)[offset], newBlk);
+		pthread_mutex_lock(&fs->locks->orphan);
+		result = unlink_orphan(fs, inodeNumber);
+		pthread_mutex_unlock(&fs->locks->orphan);
+		if (result != ORPHAN_BUSY)
+			return result;
+		sched_yield(); //  inode  尡 orphan lock ٸ   
 	}
+}
 
-	return set_indirect_traversal(fs, block, inode, probe, nextBuf, newBlk);
+/*    lock */
+static void lock_open_table(EXT2_FILESYSTEM* fs)
+{
+	if (fs->locks != NULL)
+		pthread_mutex_lock(&fs->locks->open);
 }
 
-/*  */
-/*     */
-int get_indirect_block(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32* retBlk)
+static void unlock_open_table(EXT2_FILESYSTEM* fs)
 {
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 ptrsPerBlk = sb_info->blockSize / sizeof(UINT32);
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	UINT32 probe = -1;
-printf("11\n");
-	if (probe == -1)
-	{
-		if (block >= EXT2_IND_BLOCK &&
-			block < EXT2_IND_BLOCK + ptrsPerBlk)
-			probe = 1; //    
-		else if (block < EXT2_IND_BLOCK + ptrsPerBlk)
-			probe = 2; //    
-		else
-			probe = 3; //    
-	}
-printf("12\n");
-	// ù   о 
-	ZeroMemory(buffer, sizeof(buffer));
-	read_block(fs, inode->i_block[EXT2_IND_BLOCK], buffer);
-printf("13\n");
-	get_indirect_traversal(fs, block, inode, &probe, buffer, retBlk);
-printf("14\n");
-	return EXT2_SUCCESS;
+	if (fs->locks != NULL)
+		pthread_mutex_unlock(&fs->locks->open);
 }
 
-int set_indirect_block(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32 newBlk)
+/*   Ͽ inode ִ ˻,  lock  · ȣ */
+static int is_open(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 ptrsPerBlk = sb_info->blockSize / sizeof(UINT32);
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	UINT32 probe = -1;
+	UINT32 i;
 
-	if (probe == -1)
+	for (i = 0; i < fs->openCount; i++)
 	{
-		if (block >= EXT2_IND_BLOCK &&
-			block < EXT2_IND_BLOCK + ptrsPerBlk)
-			probe = 1; //    
-		else if (block < EXT2_IND_BLOCK + ptrsPerBlk * ptrsPerBlk)
-			probe = 2; //    
-		else
-			probe = 3; //    
+		if (fs->openInodes[i] == inodeNumber)
+			return 1;
 	}
 
-	// ù   о 
-	ZeroMemory(buffer, sizeof(buffer));
-	read_block(fs, inode->i_block[EXT2_IND_BLOCK], buffer);
-	set_indirect_traversal(fs, block, inode, &probe, buffer, newBlk);
-
-	return EXT2_SUCCESS;
+	return 0;
 }
 
-/*  */
-/*  ȣ  ׷ ȣ */
-int get_group_of_block(EXT2_FILESYSTEM* fs, UINT32 block, UINT32* retGroup)
+/* ũ   orphan inode ϰ inode ϰ Ͽ  */
+static int delete_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
-	*retGroup = (block - fs->sb.firstDataBlock) / fs->sb_info.blocksPerGroup;
+	EXT2_INODE inode;
 
-	return EXT2_SUCCESS;
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	//    ڿ Ͽ  ߰ 絵 mount  ٽ ó
+	if (truncate_blocks(fs, &inode, 0) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+	inode.fileSize = 0;
+	if (set_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	// ȣ ϸ ٸ 尡 ٷ ٽ Ҵ dTime( ũ)   Ƿ Ͽ  
+	//  ̿ ߸ inode ϳ  fsck ãƳ
+	if (orphan_del(fs, inodeNumber) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+	inode.dTime = time(NULL);
+	if (set_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	return release_inode(fs, inodeNumber, (inode.fileMode & 0xF000) == FILE_TYPE_DIR);
 }
 
 /*  */
-/* inode ȣ   ȣ */
-int get_block_of_inode(EXT2_FILESYSTEM* fs, UINT32 inode, UINT32* retBlk)
+/*   */
+/*  ִ  Ʈ  orphan Ͽ ܵξٰ  close  */
+static int remove_file(EXT2_NODE* file)
 {
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 group;
-	UINT32 block;
+	EXT2_FILESYSTEM* fs = file->fs;
+	EXT2_INODE inode;
+	UINT32 inodeNumber = file->entry.inode;
+	int open;
 
-	group = (inode - 1) / sb_info->inodesPerGroup; // inode ִ ׷
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+	inode.linkCount = 0;
+	if (set_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
-												   // inode table  
-	block = group * sb_info->blocksPerGroup + 1 + sb_info->blocksPerDesc + 1 + 1;
-	*retBlk = 1 + block + ((inode - 1) % sb_info->inodesPerGroup) / sb_info->inodesPerBlock;
+	if (orphan_add(fs, inodeNumber) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
-	if (*retBlk < 0)
-	{
-		printf("error : invalid block number in get_block_of_inode()\n");
+	ZeroMemory(&file->entry, sizeof(EXT2_DIR_ENTRY)); //  Ʈ 
+	file->entry.dir2.fileType = EXT2_FT_FREE;
+	if (set_entry(fs, &file->location, &file->entry) != EXT2_SUCCESS)
 		return EXT2_ERROR;
-	}
 
-	return EXT2_SUCCESS;
+	lock_open_table(fs);
+	open = is_open(fs, inodeNumber);
+	unlock_open_table(fs);
+	if (open)
+		return EXT2_SUCCESS;
+
+	return delete_inode(fs, inodeNumber);
 }
 
-/*  */
-/* inode block ° Ҵ  ȣ  */
-int get_allocated_block(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32* retBlk)
+/*  inode lock , Ʈ  lock θ ͸ ٸ  Բ ϰ  */
+int ext2_remove(EXT2_NODE* file)
 {
-	if(inode->blockCount == 0 || (inode->blockCount - 1) < block) // inode  Ҵ    -1 
-	{
-		*retBlk = 0;
-		return EXT2_SUCCESS;
-	}
+	EXT2_FILESYSTEM* fs = file->fs;
+	UINT32 inodeNumber = file->entry.inode;
+	EXT2_IO_STATS* outer;
+	int result;
 
-	if (block < 0)
-		return EXT2_ERROR;
-	else if (block < EXT2_NDIR_BLOCKS)
-		*retBlk = inode->i_block[block];
-	else
+	if (file->entry.dir2.fileType == EXT2_FT_DIR)
 	{
-		printf("10\n");
-		if (get_indirect_block(fs, block, inode, retBlk) != EXT2_SUCCESS) // i   ȣ 
-		{
-			printf("error : failed to get indirect block\n");
-			return EXT2_ERROR;
-		}
+		LOG_ERROR("error : %s is a directory\n", file->entry.name);
+		return EXT2_ERROR;
 	}
 
-	return EXT2_SUCCESS;
+	outer = enter_op(fs, EXT2_OP_REMOVE);
+	begin_operation(fs, release_credits(fs, inodeNumber));
+	lock_inode(fs, inodeNumber, 1);
+	result = remove_file(file);
+	unlock_inode(fs, inodeNumber);
+	end_operation(fs);
+	leave_op(outer);
+
+	return result;
 }
 
-/*  */
-/* block ° i_block  ġ newBlk  */
-int set_allocated_block(EXT2_FILESYSTEM* fs, UINT32 block, EXT2_INODE* inode, UINT32 newBlk)
+/*  ũ⸦ size , پ κ   */
+/* ϴ  orphan Ͽ  ξ ߰ ߸ mount   ߶ */
+static int truncate_file(EXT2_NODE* file, unsigned long size)
 {
-	if (block < 0)
+	EXT2_FILESYSTEM* fs = file->fs;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_INODE inode;
+	UINT32 inodeNumber = file->entry.inode;
+	UINT32 blockSize = fs->sb_info.blockSize;
+	UINT32 from, block;
+	int orphan;
+
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
 		return EXT2_ERROR;
-	else if (block < EXT2_NDIR_BLOCKS)
-		inode->i_block[block] = newBlk;
-	else
+
+	if ((inode.fileMode & 0xF000) == FILE_TYPE_DIR)
 	{
-		if (set_indirect_block(fs, block, inode, newBlk) != EXT2_SUCCESS) // i   ȣ 
-		{
-			printf("error : failed to get indirect block\n");
+		LOG_ERROR("error : %s is a directory\n", file->entry.name);
+		return EXT2_ERROR;
+	}
+
+	from = (size + blockSize - 1) / blockSize;
+	if (size < inode.fileSize && size % blockSize != 0)
+	{	//  Ͽ size Ĵ 0 ä (ٽ ÷     ʵ)
+		if (get_allocated_block(fs, from - 1, &inode, &block) != EXT2_SUCCESS)
 			return EXT2_ERROR;
+		if (block != 0 && read_block(fs, block, buffer) == EXT2_SUCCESS)
+		{
+			ZeroMemory(&buffer[size % blockSize], blockSize - size % blockSize);
+			write_block(fs, block, buffer);
 		}
 	}
 
+	inode.fileSize = size;
+	if (set_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (inode.blockCount <= from)
+		return EXT2_SUCCESS;
+
+	orphan = inode.linkCount != 0; //   ̹ orphan Ͽ 
+	if (orphan && orphan_add(fs, inodeNumber) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS ||
+		truncate_blocks(fs, &inode, from) != EXT2_SUCCESS ||
+		set_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	if (orphan)
+		return orphan_del(fs, inodeNumber);
+
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/* inode   ȸϸ entryName Ž */
-/* */
-int lookup_entry(EXT2_FILESYSTEM* fs, const EXT2_INODE* inode, const char* entryName, EXT2_NODE* ret)
+int ext2_truncate(EXT2_NODE* file, unsigned long size)
 {
-	BYTE* buffer[EXT2_BLOCK_SIZE];
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 block, retBlk, offset;
-	UINT32 usedBlk;
-	UINT32 i, result;
-	EXT2_DIR_ENTRY_LOCATION location;
+	EXT2_FILESYSTEM* fs = file->fs;
+	UINT32 inodeNumber = file->entry.inode;
+	EXT2_IO_STATS* outer = enter_op(fs, EXT2_OP_TRUNCATE);
+	int result;
 
-	ZeroMemory(buffer, sizeof(buffer));
+	begin_operation(fs, release_credits(fs, inodeNumber));
+	lock_inode(fs, inodeNumber, 1);
+	result = truncate_file(file, size);
+	unlock_inode(fs, inodeNumber);
+	end_operation(fs);
+	leave_op(outer);
 
-	usedBlk = inode->blockCount;
+	return result;
+}
 
-	for (i = 0; i < usedBlk; i++)
-	{
+/*  ,   Ǿ inode   */
+int ext2_open(EXT2_NODE* file)
+{
+	EXT2_FILESYSTEM* fs = file->fs;
+	UINT32* openInodes;
+	int result = EXT2_SUCCESS;
 
-		if (get_allocated_block(fs, i, inode, &retBlk) != EXT2_SUCCESS) // inode ü i_block[i]  ȣ 
+	lock_inode(fs, file->entry.inode, 0); //     
+	lock_open_table(fs);
+	if (fs->openCount == fs->openSize)
+	{
+		openInodes = (UINT32 *)realloc(fs->openInodes, sizeof(UINT32) * (fs->openSize ? fs->openSize * 2 : 16));
+		if (openInodes == NULL)
 		{
-			printf("error : failed to get allocated block number\n");
-			return EXT2_ERROR;
+			LOG_ERROR("error : failed to allocate open file table\n");
+			result = EXT2_ERROR;
 		}
-
-		if (read_block(fs, retBlk, buffer) != EXT2_SUCCESS)
+		else
 		{
-			printf("error : failed to read block in lookup_entry()\n");
-			return EXT2_ERROR;
+			fs->openInodes = openInodes;
+			fs->openSize = fs->openSize ? fs->openSize * 2 : 16;
 		}
-
-//  number° Ʈ ã */
-//return : EXT2_SUCCESS( ̸ ã)
-//			EXT2_ERROR(ƹ͵ ã)
-//			1 (free)
-//			2 (no more)
-		result = find_entry_at_block(fs, buffer, entryName, &offset);
-
-
-		get_location_of_block(fs, retBlk, &location);
-		location.offset = offset;
-
-		ret->location = location;
 	}
 
+	if (result == EXT2_SUCCESS)
+		fs->openInodes[fs->openCount++] = file->entry.inode;
+	unlock_open_table(fs);
+	unlock_inode(fs, file->entry.inode);
+
 	return result;
 }
 
-/*  */
-/*  ͸ entryName Ʈ ִ ˻ */
-int ext2_lookup(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
+/*  ݱ,    close inode   */
+static int close_file(EXT2_FILESYSTEM* fs, UINT32 inodeNumber)
 {
-	unsigned char* name;
 	EXT2_INODE inode;
+	UINT32 i;
+	int open;
 
-	my_strncpy(name, entryName, MAX_ENTRY_NAME_LENGTH);
-
-	if (format_name(parent->fs, name) == EXT2_ERROR)
-		return EXT2_ERROR;
+	lock_open_table(fs);
+	for (i = 0; i < fs->openCount; i++)
+	{
+		if (fs->openInodes[i] == inodeNumber)
+			break;
+	}
 
-	if (get_inode(parent->fs, parent->entry.inode, &inode))
+	if (i == fs->openCount)
 	{
-		printf("error : failed to get inode\n");
+		unlock_open_table(fs);
+		LOG_ERROR("error : inode %u is not open\n", inodeNumber);
 		return EXT2_ERROR;
 	}
+	fs->openInodes[i] = fs->openInodes[--fs->openCount];
+	open = is_open(fs, inodeNumber);
+	unlock_open_table(fs);
+
+	if (open)
+		return EXT2_SUCCESS;
+
+	if (get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
-	return lookup_entry(parent->fs, &inode, name, retEntry);
+	if (inode.linkCount != 0)
+		return EXT2_SUCCESS;
+
+	return delete_inode(fs, inodeNumber);
 }
 
+/* inode lock  ä Ͽ Ƿ     close ġų     */
+int ext2_close(EXT2_NODE* file)
+{
+	EXT2_FILESYSTEM* fs = file->fs;
+	UINT32 inodeNumber = file->entry.inode;
+	int result;
 
-/******************************************************************************/
-/* touch, fill							                                      */
-/******************************************************************************/
+	begin_operation(fs, release_credits(fs, inodeNumber));
+	lock_inode(fs, inodeNumber, 1);
+	result = close_file(fs, inodeNumber);
+	unlock_inode(fs, inodeNumber);
+	end_operation(fs);
 
-/*  */
-/* ش  ׷ ũ ü о */
-int read_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc)
+	return result;
+}
+
+/* file handle */
+/* handle open  inode 纻, ġ,  ã   , readahead ۸   */
+/* ٸ ο set_inode Ҹ stripe inodeVersion ٲǷ  ȣ⿡ ٽ  */
+
+/* inode lock  · ȣ */
+static int refresh_file(EXT2_FILE* file)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 block;
-	UINT32 offset;
+	EXT2_FILESYSTEM* fs = file->node.fs;
+	UINT32 version = 0;
 
-	ZeroMemory(buffer, sizeof(buffer));
+	if (fs->locks != NULL)
+	{
+		version = __atomic_load_n(&fs->locks->inodeVersion[file->node.entry.inode & (EXT2_INODE_LOCKS - 1)], __ATOMIC_ACQUIRE);
+		if (version == file->version)
+			return EXT2_SUCCESS;
+	}
 
-	offset = blkGroupNumber % sb_info->descPerBlock;
-	block = sb_info->firstDescBlock + blkGroupNumber / sb_info->descPerBlock;
-	read_block(fs, block, buffer);
-	memcpy(retDesc, &((EXT2_GROUP_DESC *)buffer)[offset], sizeof(EXT2_GROUP_DESC));
+	if (get_inode(fs, file->node.entry.inode, (BYTE *)&file->inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	file->version = version;
+	file->mapCount = 0;
+	file->raCount = 0;
 
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/* ش  ׷ ũ ü  */
-int write_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc)
+/*  ã  ̸     */
+static int map_file_block(EXT2_FILE* file, UINT32 logical, UINT32* physical)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
-	UINT32 block;
-	UINT32 offset;
+	if (file->mapCount == 0 || logical < file->mapLogical || logical - file->mapLogical >= file->mapCount)
+	{
+		if (get_block_run(file->node.fs, &file->inode, logical, &file->mapPhysical, &file->mapCount) != EXT2_SUCCESS)
+		{
+			file->mapCount = 0;
+			return EXT2_ERROR;
+		}
+		file->mapLogical = logical;
+	}
 
-	ZeroMemory(buffer, sizeof(buffer));
+	*physical = file->mapPhysical ? file->mapPhysical + (logical - file->mapLogical) : 0;
+
+	return EXT2_SUCCESS;
+}
+
+/* logical readahead  ä, ̾ д ̸ â   ø */
+static int fill_readahead(EXT2_FILE* file, UINT32 logical)
+{
+	EXT2_FILESYSTEM* fs = file->node.fs;
+	UINT32 blockSize = fs->sb_info.blockSize;
+	UINT32 lastBlock, count, i, physical;
+
+	if (logical == file->raNext && file->raWindow != 0)
+		file->raWindow = MIN(file->raWindow * 2, EXT2_FILE_RA_BLOCKS);
+	else
+		file->raWindow = 1;
+
+	lastBlock = (file->inode.fileSize - 1) / blockSize;
+	count = MIN(file->raWindow, lastBlock - logical + 1);
+
+	file->raCount = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (map_file_block(file, logical + i, &physical) != EXT2_SUCCESS)
+			return EXT2_ERROR;
 
-	offset = blkGroupNumber % sb_info->descPerBlock;
-	block = sb_info->firstDescBlock + blkGroupNumber / sb_info->descPerBlock;
-	read_block(fs, block, buffer);
-	memcpy(&((EXT2_GROUP_DESC *)buffer)[offset], retDesc, sizeof(EXT2_GROUP_DESC));
+		if (physical == 0)
+			ZeroMemory(&file->raBuffer[i * blockSize], blockSize);
+		else if (read_block(fs, physical, &file->raBuffer[i * blockSize]) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+	}
 
-	write_block(fs, block, buffer);
+	file->raLogical = logical;
+	file->raCount = count;
+	file->raNext = logical + count;
 
 	return EXT2_SUCCESS;
 }
 
-/*  */
-/* 丮  Ȯ */
-int is_dir(EXT2_NODE* entry)
+static int read_handle(EXT2_FILE* file, unsigned long length, char* buffer)
 {
-	if (entry->entry.dir2.fileType == EXT2_FT_DIR)
-		return EXT2_SUCCESS;
-	else
-		return EXT2_ERROR;
-}
+	EXT2_FILESYSTEM* fs = file->node.fs;
+	UINT32 blockSize = fs->sb_info.blockSize;
+	UINT32 currentOffset, readEnd, logical, physical;
+	UINT32 blockOffset, copyLength;
+	unsigned long offset = file->position;
 
-/*  */
-/* Ʈ ͸ Ȯ */
-int is_root_dir(EXT2_NODE* entry)
-{
-	if (entry->entry.inode == EXT2_ROOT_INO && entry->entry.dir2.fileType == EXT2_FT_DIR)
-		return EXT2_SUCCESS;
-	else
-		return EXT2_ERROR;
-}
-/*  */
-/* entry  inode Ҵְ, entry  ʱȭ */
-int make_entry(EXT2_FILESYSTEM* fs, EXT2_NODE* parent, const char* name, UINT32 fileType, EXT2_NODE* newEntry)
-{
-	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	if (offset >= file->inode.fileSize)
+		return 0;
 
-	newEntry->entry.recordLength = sizeof(EXT2_DIR_ENTRY);
-	newEntry->entry.dir2.nameLength = MAX_ENTRY_NAME_LENGTH;
-	newEntry->entry.dir2.fileType = fileType;
-	memcpy(newEntry->entry.name, name, MAX_ENTRY_NAME_LENGTH);
+	readEnd = MIN(offset + length, file->inode.fileSize);
+	currentOffset = offset;
 
-	if (alloc_inode(fs, parent, newEntry) != EXT2_SUCCESS)
+	while (currentOffset < readEnd)
 	{
-		printf("error : failed to alloc_inode() in make_entry\n");
-		return EXT2_ERROR;
+		logical = currentOffset / blockSize;
+		blockOffset = currentOffset % blockSize;
+		copyLength = MIN(blockSize - blockOffset, readEnd - currentOffset);
+
+		if (file->raCount != 0 && logical >= file->raLogical && logical - file->raLogical < file->raCount)
+			memcpy(buffer, &file->raBuffer[(logical - file->raLogical) * blockSize + blockOffset], copyLength);
+		else if (copyLength == blockSize)
+		{	//  ü д  ۸ ġ 
+			if (map_file_block(file, logical, &physical) != EXT2_SUCCESS)
+				break;
+			if (physical == 0)
+				ZeroMemory(buffer, blockSize);
+			else if (read_block(fs, physical, (BYTE *)buffer) != EXT2_SUCCESS)
+				break;
+			file->raNext = logical + 1;
+		}
+		else
+		{
+			if (fill_readahead(file, logical) != EXT2_SUCCESS)
+				break;
+			memcpy(buffer, &file->raBuffer[blockOffset], copyLength);
+		}
+
+		buffer += copyLength;
+		currentOffset += copyLength;
 	}
 
-	return EXT2_SUCCESS;
-}
+	file->position = currentOffset;
 
+	return currentOffset - offset;
+}
 
-int get_location_of_block(EXT2_FILESYSTEM* fs, UINT32 block, EXT2_DIR_ENTRY_LOCATION* location)
+/* fd handle   ,   put_file  */
+/*   ٸ thread ext2_file_closeص handle   */
+static EXT2_FILE* get_file(EXT2_FILESYSTEM* fs, int fd)
 {
-	location->group = (block - fs->sb.firstDataBlock) / fs->sb_info.blocksPerGroup; //  ׷ ȣ
-	location->block = (block - fs->sb.firstDataBlock) % fs->sb_info.blocksPerGroup;
-	location->offset = 0;
-	return EXT2_SUCCESS;
+	EXT2_FILE* file = NULL;
+
+	lock_open_table(fs);
+	if (fd >= 0 && (UINT32)fd < fs->fileSlots)
+		file = fs->files[fd];
+	if (file != NULL)
+		file->refCount++;
+	unlock_open_table(fs);
+
+	if (file == NULL)
+		LOG_ERROR("error : bad file handle %d\n", fd);
+
+	return file;
 }
 
-/*  */
-/* Ʈ  */
-int insert_entry(EXT2_NODE* parent, EXT2_NODE* newEntry, UINT32 overwrite)
+/*  ϳ ,    ݰ handle  */
+static int put_file(EXT2_FILESYSTEM* fs, EXT2_FILE* file)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	EXT2_INODE* inode;
-	EXT2_DIR_ENTRY_LOCATION location;
-	EXT2_SUPER_BLOCK* sb = &parent->fs->sb;
-	EXT2_SB_INFO* sb_info = &parent->fs->sb_info;
-	inode = (EXT2_INODE *)buffer;
-	UINT32 blockNumber;
+	UINT32 refCount;
+	int result;
 
-	EXT2_NODE entryNoMore;
+	lock_open_table(fs);
+	refCount = --file->refCount;
+	unlock_open_table(fs);
 
-	// θ 丮 inode о
-	ZeroMemory(buffer, sizeof(buffer));
-	inode = (EXT2_INODE *)buffer;
-	if (get_inode(parent->fs, parent->entry.inode, inode) != EXT2_SUCCESS)
+	if (refCount != 0)
+		return EXT2_SUCCESS;
+
+	result = ext2_close(&file->node);
+	pthread_mutex_destroy(&file->lock);
+	free(file->raBuffer);
+	free(file);
+
+	return result;
+}
+
+/*   handle ȣ , ext2_open    Ǿ   */
+int ext2_file_open(EXT2_NODE* node)
+{
+	EXT2_FILESYSTEM* fs = node->fs;
+	EXT2_FILE* file;
+	EXT2_FILE** files;
+	UINT32 i, slots;
+	int result;
+
+	file = (EXT2_FILE *)calloc(1, sizeof(EXT2_FILE));
+	if (file == NULL || (file->raBuffer = (BYTE *)malloc(EXT2_FILE_RA_BLOCKS * fs->sb_info.blockSize)) == NULL)
 	{
-		printf("error : failed to get inode\n");
+		LOG_ERROR("error : failed to allocate file handle\n");
+		free(file);
 		return EXT2_ERROR;
 	}
+	file->node = *node;
+	file->refCount = 1;
 
-	if (get_allocated_block(parent->fs, 0, inode, &blockNumber) != EXT2_SUCCESS)
+	if (ext2_open(node) != EXT2_SUCCESS)
 	{
-		printf("error : failed to get_allocated_block() in insert_entry()\n");
+		free(file->raBuffer);
+		free(file);
 		return EXT2_ERROR;
 	}
+	pthread_mutex_init(&file->lock, NULL);
 
-	get_location_of_block(parent->fs, blockNumber, &location);
+	lock_inode(fs, node->entry.inode, 0);
+	if (fs->locks != NULL)
+		file->version = __atomic_load_n(&fs->locks->inodeVersion[node->entry.inode & (EXT2_INODE_LOCKS - 1)], __ATOMIC_ACQUIRE);
+	result = get_inode(fs, node->entry.inode, (BYTE *)&file->inode);
+	unlock_inode(fs, node->entry.inode);
 
-	// Ʈ 丮 ƴϰ overwrite set̸
-	if (!is_root_dir(&parent->entry) && overwrite == 1)
+	if (result == EXT2_SUCCESS)
 	{
-		if (set_entry(parent->fs, &location, &newEntry->entry) != EXT2_SUCCESS)
-		{
-			printf("error : failed to set_entry() in insert_entry()\n");
-			return EXT2_ERROR;
-		}
-		newEntry->location = location;
-		// ϴ 
-		location.offset = 1;
-		ZeroMemory(&entryNoMore, sizeof(entryNoMore));
-		entryNoMore.entry.dir2.fileType = EXT2_FT_NO_MORE;
-		entryNoMore.entry.recordLength = EXT2_BLOCK_SIZE - sizeof(EXT2_DIR_ENTRY);
-		if (set_entry(parent->fs, &location, &entryNoMore.entry) != EXT2_SUCCESS)
+		lock_open_table(fs);
+		for (i = 0; i < fs->fileSlots && fs->files[i] != NULL; i++)
+			;
+		if (i == fs->fileSlots)
 		{
-			printf("error : failed to set_entry() in insert_entry()\n");
-			return EXT2_ERROR;
+			slots = fs->fileSlots ? fs->fileSlots * 2 : 16;
+			files = (EXT2_FILE **)realloc(fs->files, sizeof(EXT2_FILE *) * slots);
+			if (files == NULL)
+				result = EXT2_ERROR;
+			else
+			{
+				ZeroMemory(&files[fs->fileSlots], sizeof(EXT2_FILE *) * (slots - fs->fileSlots));
+				fs->files = files;
+				fs->fileSlots = slots;
+			}
 		}
-
-		return EXT2_SUCCESS;
+		if (result == EXT2_SUCCESS)
+			fs->files[i] = file;
+		unlock_open_table(fs);
 	}
 
-	// find free entry
-	UINT32 block;
-	ZeroMemory(&entryNoMore, sizeof(entryNoMore));
-	if (lookup_entry(parent->fs, inode, NULL, &entryNoMore) == 1)
+	if (result != EXT2_SUCCESS)
 	{
-		set_entry(parent->fs, &entryNoMore.location, &newEntry->entry);
-		newEntry->location = entryNoMore.location;
+		LOG_ERROR("error : failed to open file handle\n");
+		ext2_close(node);
+		pthread_mutex_destroy(&file->lock);
+		free(file->raBuffer);
+		free(file);
+		return EXT2_ERROR;
 	}
-	else
-	{
 
-		// find no more entry
-		ZeroMemory(&entryNoMore, sizeof(entryNoMore));
-		if (lookup_entry(parent->fs, inode, NULL, &entryNoMore) != 2)
-			return EXT2_ERROR;
+	return (int)i;
+}
 
-		set_entry(parent->fs, &entryNoMore.location, &newEntry->entry);
-		newEntry->location = entryNoMore.location;
-		entryNoMore.location.offset++;
+/* handle ȣ ٷ , ٸ thread  ̸  ȣ    */
+int ext2_file_close(EXT2_FILESYSTEM* fs, int fd)
+{
+	EXT2_FILE* file = NULL;
 
-		if (entryNoMore.location.offset == (EXT2_BLOCK_SIZE / sizeof(EXT2_DIR_ENTRY)))
-		{
-			if (alloc_block(parent->fs, parent) != EXT2_SUCCESS)
-			{
-				printf("error : failed to alloc_block() in insert_entry()\n");
-				return EXT2_ERROR;
-			}
-			if (get_allocated_block(parent->fs, inode->blockCount - 1, inode, &blockNumber) != EXT2_SUCCESS)
-			{
-				printf("error : get_allocated_block() in insert_entry()\n");
-				return EXT2_ERROR;
-			}
-			get_location_of_block(parent->fs, blockNumber, &entryNoMore.location);
+	lock_open_table(fs);
+	if (fd >= 0 && (UINT32)fd < fs->fileSlots)
+	{
+		file = fs->files[fd];
+		fs->files[fd] = NULL;
+	}
+	unlock_open_table(fs);
 
-		}
-		set_entry(parent->fs, &entryNoMore.location, &entryNoMore.entry);
+	if (file == NULL)
+	{
+		LOG_ERROR("error : bad file handle %d\n", fd);
+		return EXT2_ERROR;
 	}
 
-	return EXT2_SUCCESS;
+	return put_file(fs, file); // open table  ִ 
 }
 
-/*  */
-/*   */
-int ext2_create(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
+/*  ġ а ġ ű, inode   ٲ ʾ handle   */
+int ext2_file_read(EXT2_FILESYSTEM* fs, int fd, unsigned long length, char* buffer)
 {
-	/*
-	format_name() // ̸   *
-	lookup_entry() // ̸ Ʈ   ˻*
-	insert_entry() //  ͸ Ʈ Ʈ ο Ʈ ߰*
-	alloc_inode() //  inode Ҵ
-	EXT2_DIR_ENTRY ʱȭ
-	adjust_free_count() // ɼǿ  freeCount  (COUNT_UP / COUNT_DOWN)
-	set_bitmap() // bitmap 
-	*/
-	BYTE buffer[EXT2_BLOCK_SIZE];
-	EXT2_DIR_ENTRY_LOCATION first;
-	EXT2_INODE* inode;
-	EXT2_FILESYSTEM* fs = &parent->fs;
-	BYTE name[MAX_NAME_LENGTH] = { 0, };
-	int result;
+	EXT2_FILE* file = get_file(fs, fd);
+	EXT2_IO_STATS* outer;
+	UINT32 inodeNumber;
+	int result = EXT2_ERROR;
 
-	strncpy(name, entryName, MAX_ENTRY_NAME_LENGTH);
-	if (format_name(parent->fs, name))
+	if (file == NULL)
 		return EXT2_ERROR;
 
-	ZeroMemory(retEntry, sizeof(EXT2_NODE));
+	inodeNumber = file->node.entry.inode;
+	outer = enter_op(fs, EXT2_OP_READ);
+	pthread_mutex_lock(&file->lock);
+	lock_inode(fs, inodeNumber, 0);
+	if (refresh_file(file) == EXT2_SUCCESS)
+		result = read_handle(file, length, buffer);
+	unlock_inode(fs, inodeNumber);
+	pthread_mutex_unlock(&file->lock);
+	leave_op(outer);
+	put_file(fs, file);
 
-	// ۿ inode ü о
-	if (get_inode(parent->fs, parent->entry.inode, buffer) != EXT2_SUCCESS)
-	{
-		printf("error : failed to get inode\n");
-		return EXT2_ERROR;
-	}
+	return result;
+}
 
-	inode = (EXT2_INODE *)buffer;
+int ext2_file_write(EXT2_FILESYSTEM* fs, int fd, unsigned long length, const char* buffer)
+{
+	EXT2_FILE* file = get_file(fs, fd);
+	EXT2_IO_STATS* outer;
+	UINT32 inodeNumber;
+	unsigned long written = 0;
+	int result, restart;
 
-	// inode  ̸ Ʈ ã
-	if (lookup_entry(parent->fs, inode, name, retEntry) == EXT2_SUCCESS)
-	{
-		printf("error : no entry named %s\n", name);
+	if (file == NULL)
 		return EXT2_ERROR;
-	}
 
-	if (make_entry(parent->fs, parent, name, EXT2_FT_REG_FILE, retEntry) != EXT2_SUCCESS)
-	{
-		printf("error : failed to make_entry() in ext2_create()\n");
+	inodeNumber = file->node.entry.inode;
+	outer = enter_op(fs, EXT2_OP_WRITE);
+	pthread_mutex_lock(&file->lock);
+	do
+	{	// journal transaction ϳ      
+		begin_operation(fs, EXT2_OP_CREDITS);
+		lock_inode(fs, inodeNumber, 1);
+		result = EXT2_ERROR;
+		restart = 0;
+		if (refresh_file(file) == EXT2_SUCCESS)
+		{
+			result = write_file(&file->node, &file->inode, file, file->position, length - written, buffer + written, &restart);
+			if (result > 0)
+			{
+				file->position += result;
+				written += result;
+			}
+			file->raCount = 0;
+			//   inode handle Ƿ ڱ set_inode ٲ version ޾Ƶ (stripe write lock  )
+			if (fs->locks != NULL)
+				file->version = __atomic_load_n(&fs->locks->inodeVersion[inodeNumber & (EXT2_INODE_LOCKS - 1)], __ATOMIC_ACQUIRE);
+		}
+		unlock_inode(fs, inodeNumber);
+		end_operation(fs);
+	} while (result >= 0 && restart && written < length);
+	pthread_mutex_unlock(&file->lock);
+	leave_op(outer);
+	put_file(fs, file);
+
+	return (result < 0 && written == 0) ? result : (int)written;
+}
+
+/* ġ ̵,  ũ⸦ Ѿ  (  ̴ Ҵ) */
+int ext2_file_seek(EXT2_FILESYSTEM* fs, int fd, unsigned long offset)
+{
+	EXT2_FILE* file = get_file(fs, fd);
+
+	if (file == NULL)
 		return EXT2_ERROR;
-	}
 
-	retEntry->fs = parent->fs;
+	pthread_mutex_lock(&file->lock);
+	file->position = offset;
+	pthread_mutex_unlock(&file->lock);
 
-	if (insert_entry(parent, retEntry, 0) != EXT2_SUCCESS)
+	return put_file(fs, file);
+}
+
+/* mount  orphan  inode  */
+/* ũ  ,  ߶󳻴 ̹Ƿ fileSize ߶ */
+/* inode ϳ  ϳ ó   transaction ϳ    */
+static int clean_orphans(EXT2_FILESYSTEM* fs)
+{
+	EXT2_INODE inode;
+	UINT32 inodeNumber, count = 0;
+	UINT32 blockSize = fs->sb_info.blockSize;
+	int result;
+
+	while ((inodeNumber = fs->sb.orphanList) != 0)
 	{
-		printf("error : failed to insert entry\n");
-		return EXT2_ERROR;
+		if (inodeNumber > fs->sb.inodeCount || ++count > fs->sb.inodeCount ||
+			get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : broken orphan list\n");
+			fs->sb.orphanList = 0;
+			sync_super_block(fs);
+			return EXT2_ERROR;
+		}
+
+		begin_operation(fs, release_credits(fs, inodeNumber));
+		if (inode.linkCount == 0)
+			result = delete_inode(fs, inodeNumber);
+		else if (truncate_blocks(fs, &inode, (inode.fileSize + blockSize - 1) / blockSize) != EXT2_SUCCESS ||
+			set_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS ||
+			orphan_del(fs, inodeNumber) != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+		else
+			result = EXT2_SUCCESS;
+		end_operation(fs);
+
+		if (result != EXT2_SUCCESS)
+			return EXT2_ERROR;
 	}
 
+	LOG_INFO("orphan inodes cleaned up	: %u\n", count);
+
 	return EXT2_SUCCESS;
 }
 
-
-/******************************************************************************/
-/* remove							                                          */
-/******************************************************************************/
-
-/*   */
-int ext2_remove(EXT2_NODE* file)
+/* mount ߿ ȣǹǷ inode lock   */
+int process_orphans(EXT2_FILESYSTEM* fs)
 {
-
+	return clean_orphans(fs);
 }
 
 
@@ -2241,61 +5074,88 @@ int ext2_remove(EXT2_NODE* file)
 
 /*  */
 /* ͸  */
-int ext2_mkdir(const EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
+static int make_dir(const EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
 {
-	EXT2_NODE dotNode, dotdotNode;
+	EXT2_DIR_ENTRY* dotEntry;
 	EXT2_INODE inode;
-	BYTE name[MAX_ENTRY_NAME_LENGTH];
+	BYTE name[MAX_NAME_LENGTH] = { 0, };
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32 blockNumber;
 
-	my_strncpy((char*)name, entryName);
+	strncpy((char *)name, entryName, MAX_ENTRY_NAME_LENGTH);
 
 	if (format_name(parent->fs, (char*)name) == EXT2_ERROR)
 		return EXT2_ERROR;
 
 	ZeroMemory(retEntry, sizeof(EXT2_NODE));
 	memcpy(retEntry->entry.name, name, MAX_ENTRY_NAME_LENGTH);
-	retEntry->entry.dir2.nameLength = strlen((char*)retEntry->entry.name);
+	retEntry->entry.recordLength = sizeof(EXT2_DIR_ENTRY);
+	retEntry->entry.dir2.nameLength = MAX_ENTRY_NAME_LENGTH;
 	retEntry->fs = parent->fs;
 	retEntry->entry.dir2.fileType = EXT2_FT_DIR;
 
-	if (alloc_inode(parent->fs, parent, retEntry) == EXT2_ERROR)
+	if (alloc_inode(parent->fs, (EXT2_NODE *)parent, retEntry) == EXT2_ERROR)
 	{
-		printf("error : failed to alloc inode\n");
+		LOG_ERROR("error : failed to alloc inode\n");
 		return EXT2_ERROR;
 	}
 
-	if (insert_entry(parent, retEntry, 0) == EXT2_ERROR)
+	// ".", ".."  ڿ θ ؾ ٸ 尡   ͸  
+	if (alloc_block(parent->fs, retEntry))
 	{
-		printf("error : failed to insert entry\n");
+		LOG_ERROR("error : failed to alloc block\n");
 		return EXT2_ERROR;
 	}
 
-	if (alloc_block(parent->fs, retEntry))
+	//  Ͽ    Ƿ ".", ".." ִ  ° 
+	if (get_inode(parent->fs, retEntry->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS ||
+		get_allocated_block(parent->fs, 0, &inode, &blockNumber) != EXT2_SUCCESS)
 	{
-		printf("error : failed to alloc block\n");
+		LOG_ERROR("error : failed to get_allocated_block() in make_dir()\n");
+		return EXT2_ERROR;
+	}
+	ZeroMemory(buffer, sizeof(buffer));
+	dotEntry = (EXT2_DIR_ENTRY *)buffer;
+	memset(dotEntry[0].name, 0x20, 24);
+	dotEntry[0].name[0] = '.';
+	dotEntry[0].inode = retEntry->entry.inode;
+	dotEntry[0].dir2.fileType = EXT2_FT_DIR;
+	memset(dotEntry[1].name, 0x20, 24);
+	dotEntry[1].name[0] = '.';
+	dotEntry[1].name[1] = '.';
+	dotEntry[1].inode = retEntry->entry.inode;
+	dotEntry[1].dir2.fileType = EXT2_FT_DIR;
+	if (write_meta_block(parent->fs, blockNumber, buffer) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : failed to write directory block in make_dir()\n");
 		return EXT2_ERROR;
 	}
 
-	ZeroMemory(&dotNode, sizeof(EXT2_NODE));
-	memset(dotNode.entry.name, 0x20, 24);
-	dotNode.entry.name[0] = '.';
-	dotNode.fs = retEntry->fs;
-	dotNode.entry.inode = retEntry->entry.inode;
-	dotNode.entry.dir2.fileType = EXT2_FT_DIR;
-	insert_entry(retEntry, &dotNode, 0);
-
-	ZeroMemory(&dotNode, sizeof(EXT2_NODE));
-	memset(dotNode.entry.name, 0x20, 24);
-	dotNode.entry.name[0] = '.';
-	dotNode.entry.name[1] = '.';
-	dotNode.fs = retEntry->fs;
-	dotNode.entry.inode = retEntry->entry.inode;
-	dotNode.entry.dir2.fileType = EXT2_FT_DIR;
-	insert_entry(retEntry, &dotNode, 0);
+	if (insert_entry((EXT2_NODE *)parent, retEntry, 0) == EXT2_ERROR)
+	{
+		LOG_ERROR("error : failed to insert entry\n");
+		return EXT2_ERROR;
+	}
 
 	return EXT2_SUCCESS;
 }
 
+int ext2_mkdir(const EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry)
+{
+	EXT2_FILESYSTEM* fs = parent->fs;
+	EXT2_IO_STATS* outer = enter_op(fs, EXT2_OP_MKDIR);
+	int result;
+
+	begin_operation(fs, EXT2_OP_CREDITS);
+	lock_inode(fs, parent->entry.inode, 1);
+	result = make_dir(parent, entryName, retEntry);
+	unlock_inode(fs, parent->entry.inode);
+	end_operation(fs);
+	leave_op(outer);
+
+	return result;
+}
+
 
 /******************************************************************************/
 /* rmdir							                                          */
@@ -2305,44 +5165,88 @@ int ext2_mkdir(const EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEnt
 /* ͸  Ʈ  ִ ˻ */
 int has_sub_entry(EXT2_FILESYSTEM* fs, EXT2_NODE* node)
 {
-	EXT2_DIR_ENTRY_LOCATION location = node->location;
-	EXT2_NODE entry;
-	UINT32 inode = node->entry.inode;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_DIR_ENTRY* entry = (EXT2_DIR_ENTRY *)buffer;
+	EXT2_INODE inode;
+	UINT32 maxEntry = fs->sb_info.blockSize / sizeof(EXT2_DIR_ENTRY);
+	UINT32 i, j, block;
 
-	location.offset += 2;
+	if (get_inode(fs, node->entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_SUCCESS;
+
+	for (i = 0; i < inode.blockCount; i++)
+	{
+		if (get_allocated_block(fs, i, &inode, &block) != EXT2_SUCCESS || block == 0 ||
+			read_meta_block(fs, block, buffer) != EXT2_SUCCESS)
+			return EXT2_SUCCESS;
+
+		for (j = 0; j < maxEntry; j++)
+		{
+			if (entry[j].dir2.fileType == EXT2_FT_NO_MORE)
+				return EXT2_ERROR;
+			if (entry[j].dir2.fileType != EXT2_FT_FREE && entry[j].name[0] != '.') // ".", ".." 
+				return EXT2_SUCCESS;
+		}
+	}
 
-	if (lookup_entry(fs, inode, NULL, &entry) == EXT2_SUCCESS)
-		return EXT2_ERROR;
 	return EXT2_ERROR;
 }
 
 /*  */
 /* ͸  */
-int ext2_rmdir(EXT2_NODE* node)
+static int remove_dir(EXT2_NODE* node)
 {
-	BYTE buffer[EXT2_BLOCK_SIZE];
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	BYTE name[MAX_ENTRY_NAME_LENGTH];
+	UINT32 inodeNumber = node->entry.inode;
 
-	if (has_sub_entry(node->fs, &node->entry) == EXT2_SUCCESS) //  Ʈ   
+	if (has_sub_entry(node->fs, node) == EXT2_SUCCESS) //  Ʈ   
 	{
-		printf("error : this directory has entry yet\n");
+		LOG_ERROR("error : this directory has entry yet\n");
 		return EXT2_ERROR;
 	}
 
 	if (node->entry.dir2.fileType != EXT2_FT_DIR) // ͸ ƴϸ 
 	{
-		printf("error : no directory\n");
+		LOG_ERROR("error : no directory\n");
 		return EXT2_ERROR;
 	}
 
 	ZeroMemory(buffer, sizeof(buffer));
-	node->entry.dir2.fileType = EXT2_FT_FREE; //  Ʈ 
 	free_block(node);
 	free_inode(node);
+	ZeroMemory(&node->entry, sizeof(EXT2_DIR_ENTRY)); //  Ʈ 
+	node->entry.dir2.fileType = EXT2_FT_FREE;
 	set_entry(node->fs, &node->location, &node->entry); //   
 
+	//  Ͽ ִ ".", ".." Ʈ ĳÿ 
+	memset(name, 0x20, sizeof(name));
+	name[0] = '.';
+	dcache_drop(node->fs, inodeNumber, name);
+	name[1] = '.';
+	dcache_drop(node->fs, inodeNumber, name);
+
 	return EXT2_SUCCESS;
 }
 
+/* ͸ ڽ lock  ˻ϴ   ȿ Ʈ  ʵ  */
+int ext2_rmdir(EXT2_NODE* node)
+{
+	EXT2_FILESYSTEM* fs = node->fs;
+	UINT32 inodeNumber = node->entry.inode;
+	EXT2_IO_STATS* outer = enter_op(fs, EXT2_OP_RMDIR);
+	int result;
+
+	begin_operation(fs, EXT2_OP_CREDITS);
+	lock_inode(fs, inodeNumber, 1);
+	result = remove_dir(node);
+	unlock_inode(fs, inodeNumber);
+	end_operation(fs);
+	leave_op(outer);
+
+	return result;
+}
+
 
 /******************************************************************************/
 /* df								                                          */
@@ -2350,7 +5254,12 @@ int ext2_rmdir(EXT2_NODE* node)
 
 int ext2_df(EXT2_FILESYSTEM* fs, UINT32* totalSectors, UINT32* usedSectors)
 {
+	UINT32 sectorsPerBlock = fs->sb_info.sectorsPerBlock;
+
+	*totalSectors = fs->sb.blockCount * sectorsPerBlock;
+	*usedSectors = (fs->sb.blockCount - ATOMIC_LOAD(fs->sb.freeBlockCount)) * sectorsPerBlock;
 
+	return EXT2_SUCCESS;
 }
 
 
@@ -2358,20 +5267,53 @@ int ext2_df(EXT2_FILESYSTEM* fs, UINT32* totalSectors, UINT32* usedSectors)
 /* dump								                                          */
 /******************************************************************************/
 
+/* dump  mount ̵ ̹Ƿ ũ  ۺ о  ũ⸦  */
+static int read_disk_super_block(DISK_OPERATIONS* disk, EXT2_SUPER_BLOCK* sb)
+{
+	UINT32 sectorNumber = EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE;
+	UINT32 offset;
+
+	for (offset = 0; offset < sizeof(EXT2_SUPER_BLOCK); offset += MAX_SECTOR_SIZE)
+		disk->read_sector(disk, sectorNumber++, &((BYTE *)sb)[offset]);
+
+	if (sb->magicSignature != 0xEF53 || sb->logBlockSize > 2 || sb->blocksPerGroup == 0)
+	{
+		LOG_ERROR("error : invalid super block\n");
+		return EXT2_ERROR;
+	}
+
+	return EXT2_SUCCESS;
+}
+
 /*  */
 /*  ޸𸮿    */
 int ext2_dump(DISK_OPERATIONS* disk, int blockGroupNum, int type, int target)
 {
 	BYTE sector[MAX_SECTOR_SIZE];
-	UINT32 totalBlock = (disk->bytesPerSector*disk->numberOfSectors + (EXT2_BLOCK_SIZE - 1)) / EXT2_BLOCK_SIZE;
-	UINT32 groupCount = ((disk->numberOfSectors * disk->bytesPerSector + (EXT2_BLOCK_SIZE - 1)) / EXT2_BLOCK_SIZE - 1) / (EXT2_BLOCK_SIZE * 8) + 1; // ϱ׷
-	UINT32 blocksPerDesc = (sizeof(EXT2_GROUP_DESC) * groupCount + (EXT2_BLOCK_SIZE - 1)) / EXT2_BLOCK_SIZE; // ũ  
-	UINT32 itbPerGroup = (((totalBlock / 2) / groupCount) * EXT2_INODE_SIZE + (EXT2_BLOCK_SIZE - 1)) / EXT2_BLOCK_SIZE;// inode table  
-	UINT32 blockNum = 1 + blockGroupNum * EXT2_BLOCK_SIZE * 8; //  ׷   ȣ
-	UINT32 sectorNum = 2 * blockNum; //   ȣ
+	EXT2_SUPER_BLOCK sb;
+	UINT32 blkSize, sectorsPerBlock, groupCount, blocksPerDesc, itbPerGroup, metaBlocks;
+	UINT32 blockNum; //  ׷   ȣ
+	UINT32 sectorNum; //   ȣ
 	UINT32 sectorCount; //   
 	UINT32 i, j;
 
+	if (read_disk_super_block(disk, &sb) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	blkSize = EXT2_MIN_BLOCK_SIZE << sb.logBlockSize;
+	sectorsPerBlock = blkSize / MAX_SECTOR_SIZE;
+	groupCount = ((sb.blockCount - sb.firstDataBlock - 1) / sb.blocksPerGroup) + 1; // ϱ׷
+	blocksPerDesc = (sizeof(EXT2_GROUP_DESC) * groupCount + (blkSize - 1)) / blkSize; // ũ  
+	itbPerGroup = (sb.inodesPerGroup * sb.inodeSize + (blkSize - 1)) / blkSize; // inode table  
+	blockNum = sb.firstDataBlock + blockGroupNum * sb.blocksPerGroup;
+	metaBlocks = ext2_group_has_super(&sb, blockGroupNum) ? 1 + blocksPerDesc : 0; // ۺ, ũ ̺ 
+
+	if (type <= 2 && metaBlocks == 0)
+	{
+		LOG_ERROR("error : group %d has no superblock backup\n", blockGroupNum);
+		return EXT2_ERROR;
+	}
+
 	switch (type)
 	{
 	case 1: // super block
@@ -2379,29 +5321,33 @@ int ext2_dump(DISK_OPERATIONS* disk, int blockGroupNum, int type, int target)
 		break;
 	case 2: // group descriptor table
 		blockNum += 1;
-		sectorCount = blocksPerDesc * (EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE);
+		sectorCount = blocksPerDesc * sectorsPerBlock;
 		printf("blocksPerDesc : %u\n", blocksPerDesc);
 		break;
 	case 3: // inode bitmap
-		blockNum += 1 + blocksPerDesc;
-		sectorCount = EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE;
+		blockNum += metaBlocks;
+		sectorCount = sectorsPerBlock;
 		break;
 	case 4: // block bitmap
-		blockNum += 2 + blocksPerDesc;
-		sectorCount = EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE;
+		blockNum += metaBlocks + 1;
+		sectorCount = sectorsPerBlock;
 		break;
 	case 5: // inode table
-		blockNum += 3 + blocksPerDesc;
+		blockNum += metaBlocks + 2;
 		printf("itbPerGroup : %u\n", itbPerGroup);
-		sectorCount = itbPerGroup * (EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE);
+		sectorCount = itbPerGroup * sectorsPerBlock;
 		break;
 	case 6: // data by block number
-		blockNum += 3 + blocksPerDesc + itbPerGroup;
-		sectorCount = EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE;
+		blockNum += metaBlocks + 2 + itbPerGroup;
+		sectorCount = sectorsPerBlock;
 		break;
+	default:
+		return EXT2_ERROR;
 	}
 
-	sectorNum += (blockNum - 1) * (EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE);
+	sectorNum = blockNum * sectorsPerBlock;
+	if (type == 1 && blockGroupNum == 0) // 0 ׷ ۺ 1024 Ʈ ġ
+		sectorNum = EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE;
 	printf("block number : %u\tstart sector : %u\tsector count : %u\n", blockNum, sectorNum, sectorCount);
 	printf("start adress : %p , end address : %p\n", sector, sector + MAX_SECTOR_SIZE * sectorCount - 1);
 
@@ -2428,14 +5374,14 @@ int ext2_dump(DISK_OPERATIONS* disk, int blockGroupNum, int type, int target)
 void hexDump(DISK_OPERATIONS* disk, BYTE *addr, UINT32 len)
 {
 	BYTE* s = addr;
-	BYTE* endPtr = (BYTE *)((UINT32)addr + len);
+	BYTE* endPtr = addr + len;
 	UINT32 i;
 	UINT32 remainder = len % 16;
 
 	printf("\n Offset		Hex Value 		Ascii value\n");
 
 	//print out 16byte blocks
-	while ((UINT32)(s + 16) <= (UINT32)endPtr)
+	while (s + 16 <= endPtr)
 	{
 		//offset 
 		printf("0x%08lx  ", (long)(s - addr));
@@ -2494,13 +5440,19 @@ void hexDump(DISK_OPERATIONS* disk, BYTE *addr, UINT32 len)
 
 void print_hexDump(DISK_OPERATIONS* disk, UINT32 block)
 {
+	EXT2_SUPER_BLOCK sb;
 	UINT32 offset = 0;
-	UINT32 sectorNumber = (EXT2_MIN_BLOCK_SIZE / MAX_SECTOR_SIZE) + (EXT2_BLOCK_SIZE / MAX_SECTOR_SIZE) * (block - 1);
-	BYTE addr[EXT2_BLOCK_SIZE];
+	UINT32 blkSize, sectorNumber;
+	BYTE addr[EXT2_MAX_BLOCK_SIZE];
+
+	if (read_disk_super_block(disk, &sb) != EXT2_SUCCESS)
+		return;
 
-	ZeroMemory(addr, EXT2_BLOCK_SIZE);
+	blkSize = EXT2_MIN_BLOCK_SIZE << sb.logBlockSize;
+	sectorNumber = block * (blkSize / MAX_SECTOR_SIZE);
+	ZeroMemory(addr, sizeof(addr));
 
-	while (offset < EXT2_BLOCK_SIZE)
+	while (offset < blkSize)
 	{
 		disk->read_sector(disk, sectorNumber, &addr[offset]);
 		offset += MAX_SECTOR_SIZE;
@@ -2510,7 +5462,7 @@ void print_hexDump(DISK_OPERATIONS* disk, UINT32 block)
 	printf("sectorNumber : %d\n", sectorNumber);
 	printf("addr[1023] : %d\n", ((UINT32 *)addr)[255]);
 
-	hexDump(disk, addr, EXT2_BLOCK_SIZE);
+	hexDump(disk, addr, blkSize);
 
-	return EXT2_SUCCESS;
+	return;
 }
\ No newline at end of file
@@ -12,6 +12,7 @@
 #ifndef _EXT2_H_
 #define _EXT2_H_
 
+#include <pthread.h>
 #include "common.h"
 #include "disk.h"
 
@@ -85,6 +86,7 @@
 #define EXT2_FEATURE_RO_COMPAT_SPARSE_SUPER 0x0001
 #define EXT2_FEATURE_RO_COMPAT_LARGE_FILE	0x0002
 #define EXT2_FEATURE_RO_COMPT_BTREE_DIR		0x0004
+#define EXT2_FEATURE_RO_COMPAT_UNINIT_BG	0x0010 /* lazy inode table initialization */
 #define EXT2_FEATURE_RO_COMPAT_ANY			0xFFFFFFFF
 
 /* permition mask */
@@ -164,10 +166,17 @@ typedef struct ext2_group_desc{
 	UINT16		bg_freeBlockCount;	/* Free blocks count */
 	UINT16		bg_freeInodeCount;	/* Free inodes count */
 	UINT16		bg_usedDirCount;	/* Directories count */
-	UINT16		bg_padding;
-	UINT32		bg_reserved[3];
+	UINT16		bg_flags;			/* EXT2_BG_* flags */
+	UINT32		bg_reserved[2];
+	UINT16		bg_itableUnused;	/* number of uninitialized inodes at the end of inode table */
+	UINT16		bg_checksum;
 } EXT2_GROUP_DESC;
 
+/* block group flags */
+#define EXT2_BG_INODE_UNINIT	0x0001 /* inode table is not initialized */
+#define EXT2_BG_BLOCK_UNINIT	0x0002 /* block bitmap is not initialized */
+#define EXT2_BG_INODE_ZEROED	0x0004 /* inode table is zeroed */
+
 typedef struct ext2_sb_info {
 	UINT32 		inodesPerBlock;		/* number of inodes per block*/
 	UINT32		sectorsPerGroup;	/* number of sectors per block group */
@@ -182,6 +191,10 @@ typedef struct ext2_sb_info {
 	UINT32 		firstDescBlock;		/* start block of group descriptor table */
 	UINT32 		descPerBlock_bits;	/* power of 2 (5, 6, 7) */
 	UINT32 		blockSize_bits;		/* power of 2 (0, 1, 2) */
+	UINT32 		blocksPerGroup_bits;	/* power of 2 (13, 14, 15) */
+	UINT32 		inodesPerBlock_bits;	/* power of 2 (3, 4, 5) */
+	UINT32 		inodeGroup_shift;	/* (inode - 1) / inodesPerGroup == ((inode - 1) * inodeGroup_magic) >> inodeGroup_shift */
+	UINT64 		inodeGroup_magic;	/* rounded-up reciprocal of inodesPerGroup */
 	UINT32 		inodeSize;			/* bytes of inode struct */
 	UINT32 		firstInode;			/* first useable inode number*/
 	UINT32 		blockSize;			/* block size */
@@ -284,17 +297,151 @@ typedef struct ext2_dir_entry {
 	BYTE name[24];
 } EXT2_DIR_ENTRY;
 
+/* only the on-disk structures above are packed, in-core structures shared with shell.h keep their natural layout */
+#ifdef _WIN32
+#pragma pack(pop,fatstructures)
+#else
+#pragma pack()
+#endif
+
 typedef struct ext2_dir_entry_location {
 	UINT32 group;
 	UINT32 block;
 	UINT32 offset;
 } EXT2_DIR_ENTRY_LOCATION;
 
+/* in-core summary of one bitmap block */
+#define EXT2_BITMAP_WORDS		(EXT2_MAX_BLOCK_SIZE * 8 / 64)	/* 64bit words of a bitmap block */
+#define EXT2_SUMMARY_WORDS		(EXT2_BITMAP_WORDS / 64)		/* 64bit words of level1 summary */
+
+typedef struct ext2_bitmap_summary {
+	UINT64		level1[EXT2_SUMMARY_WORDS];	/* bit set : bitmap word has a free bit */
+	UINT64		level2;						/* bit set : level1 word has a set bit */
+	UINT32		valid;						/* built from on-disk bitmap */
+} EXT2_BITMAP_SUMMARY;
+
+/* metadata block numbers of one block group, computed at mount */
+typedef struct ext2_group_base {
+	UINT32		firstBlock;			/* first block of the group */
+	UINT32		blockBitmap;
+	UINT32		inodeBitmap;
+	UINT32		inodeTable;
+} EXT2_GROUP_BASE;
+
+/* locks of a mounted file system
+ * order : inode -> group -> orphan -> block, a block lock is never held while taking another */
+#define EXT2_BLOCK_LOCKS		64		/* striped, power of 2 */
+#define EXT2_INODE_LOCKS		256		/* striped, power of 2 */
+
+typedef struct ext2_locks {
+	pthread_mutex_t*	group;						/* per group : bitmaps, summary, inode table init */
+	pthread_mutex_t		block[EXT2_BLOCK_LOCKS];	/* read-modify-write of descriptor, inode table and directory blocks */
+	pthread_rwlock_t	inode[EXT2_INODE_LOCKS];	/* file data, block map and directory contents */
+	pthread_mutex_t		orphan;						/* orphan list */
+	pthread_mutex_t		open;						/* open file table and file handles */
+	UINT32				inodeVersion[EXT2_INODE_LOCKS];	/* bumped by every set_inode of an inode of the stripe */
+} EXT2_LOCKS;
+
+/* lookup caches of a mounted file system
+ * readers copy a slot without locks and retry if its sequence changed meanwhile (seqlock).
+ * slots are fixed and never freed while mounted, so readers need no reclamation */
+#define EXT2_DCACHE_BUCKETS		1024	/* power of 2 */
+#define EXT2_DCACHE_WAYS		4		/* power of 2 */
+#define EXT2_ICACHE_SLOTS		4096	/* power of 2 */
+
+typedef struct ext2_dentry_slot {
+	UINT32		parent;				/* inode number of the directory, 0 : empty */
+	EXT2_DIR_ENTRY entry;
+	EXT2_DIR_ENTRY_LOCATION location;
+} EXT2_DENTRY_SLOT;
+
+/* bucket is chosen by name only, removing an entry does not know its directory */
+typedef struct ext2_dentry_bucket {
+	UINT32		sequence;			/* odd : being written */
+	UINT32		next;				/* way replaced next */
+	EXT2_DENTRY_SLOT way[EXT2_DCACHE_WAYS];
+} EXT2_DENTRY_BUCKET;
+
+typedef struct ext2_inode_slot {
+	UINT32		sequence;			/* odd : being written */
+	UINT32		inodeNumber;		/* 0 : empty */
+	EXT2_INODE	inode;
+} EXT2_INODE_SLOT;
+
+typedef struct ext2_cache {
+	EXT2_DENTRY_BUCKET	dentry[EXT2_DCACHE_BUCKETS];
+	EXT2_INODE_SLOT		inode[EXT2_ICACHE_SLOTS];
+} EXT2_CACHE;
+
+/* I/O counters per kind of top-level operation
+ * I/O is attributed to the outermost ext2_* call of the calling thread, I/O done
+ * outside of a call (journal checkpoint thread, aio helper threads) goes to EXT2_OP_OTHER */
+enum {
+	EXT2_OP_OTHER		= 0,
+	EXT2_OP_MOUNT		= 1,
+	EXT2_OP_UMOUNT		= 2,
+	EXT2_OP_LOOKUP		= 3,
+	EXT2_OP_READ_DIR	= 4,
+	EXT2_OP_CREATE		= 5,
+	EXT2_OP_MKDIR		= 6,
+	EXT2_OP_REMOVE		= 7,
+	EXT2_OP_RMDIR		= 8,
+	EXT2_OP_READ		= 9,
+	EXT2_OP_WRITE		= 10,
+	EXT2_OP_TRUNCATE	= 11,
+	EXT2_OP_FORMAT		= 12,	/* latency only, there is no file system to count on */
+	EXT2_OP_COUNT
+};
+
+typedef struct ext2_io_stats {
+	UINT64		calls;
+	UINT64		blockReads;			/* block reads, including those served from the journal */
+	UINT64		blockWrites;		/* block writes, including those only logged to the journal */
+	UINT64		sectorReads;		/* sectors read from the disk */
+	UINT64		sectorWrites;		/* sectors written to the disk, journal log and checkpoint included */
+} EXT2_IO_STATS;
+
+/* block layer trace event, see ext2_set_trace and trace.c */
+typedef struct ext2_trace_event {
+	UINT64		time;				/* CLOCK_MONOTONIC ns */
+	UINT32		block;
+	UINT32		count;				/* blocks */
+	int			opcode;				/* DISK_READ, DISK_WRITE */
+	int			origin;				/* EXT2_OP_* of the calling thread */
+} EXT2_TRACE_EVENT;
+
+typedef void(*EXT2_TRACE_HOOK)(void* param, const EXT2_TRACE_EVENT* event);
+
+/* hook and its param, published together by ext2_set_trace */
+typedef struct ext2_trace {
+	EXT2_TRACE_HOOK hook;
+	void*		param;
+} EXT2_TRACE;
+
 typedef struct ext2_filesystem {
 	EXT2_SUPER_BLOCK sb;
 	EXT2_SB_INFO sb_info;
 	DISK_OPERATIONS* disk;
 	EXT2_DIR_ENTRY_LOCATION location;
+
+	EXT2_BITMAP_SUMMARY* blockSummary;	/* per group summary of block bitmap */
+	EXT2_BITMAP_SUMMARY* inodeSummary;	/* per group summary of inode bitmap */
+	UINT64*		blockGroupMap;			/* bit set : group may have a free block */
+	UINT64*		inodeGroupMap;			/* bit set : group may have a free inode */
+	EXT2_GROUP_BASE* groupBase;			/* per group metadata block numbers */
+	struct ext2_journal* journal;		/* metadata journal, NULL without EXT3_FEATURE_COMPAT_HAS_JOURNAL */
+	struct ext2_itable_init* itableInit;	/* background inode table initializer, NULL : not running */
+	UINT32		itableNext;				/* groups before it have initialized inode tables */
+
+	UINT32*		openInodes;				/* inode numbers of open files, one element per open */
+	UINT32		openCount;
+	UINT32		openSize;
+	struct ext2_file** files;			/* file handles indexed by fd, NULL : free */
+	UINT32		fileSlots;
+	EXT2_LOCKS*	locks;
+	EXT2_CACHE*	cache;					/* lookup caches, NULL : always read from disk */
+	EXT2_IO_STATS ioStats[EXT2_OP_COUNT];	/* reset by mount */
+	const EXT2_TRACE* trace;			/* called for every block read and write, NULL : not traced */
 } EXT2_FILESYSTEM;
 
 typedef struct ext2_node {
@@ -305,12 +452,120 @@ typedef struct ext2_node {
 
 typedef int(*EXT2_NODE_ADD)(EXT2_FILESYSTEM*, void*, EXT2_NODE*);
 
+/* open file handle, see ext2_file_open. threads sharing a handle are serialized by its lock */
+#define EXT2_FILE_RA_BLOCKS		16		/* largest readahead window */
+
+typedef struct ext2_file {
+	EXT2_NODE	node;
+	UINT32		refCount;			/* the open table and calls in progress, under the open table lock */
+	pthread_mutex_t lock;			/* position, block map and readahead */
+	EXT2_INODE	inode;				/* in-core copy, reloaded when the stripe version moves */
+	UINT32		version;			/* inodeVersion of the stripe when inode was loaded */
+	unsigned long position;
+	UINT32		mapLogical;			/* last resolved run : mapCount blocks from mapLogical */
+	UINT32		mapPhysical;		/* are mapPhysical.. on disk, 0 : hole */
+	UINT32		mapCount;			/* 0 : nothing resolved */
+	UINT32		raLogical;			/* raBuffer holds raCount blocks from raLogical */
+	UINT32		raCount;
+	UINT32		raWindow;			/* blocks the next sequential miss reads */
+	UINT32		raNext;				/* block a sequential read continues at */
+	BYTE*		raBuffer;			/* EXT2_FILE_RA_BLOCKS blocks */
+} EXT2_FILE;
+
+/* format option */
+typedef struct ext2_format_option {
+	UINT32		lazyItableInit;		/* leave inode tables of group 1.. uninitialized */
+	UINT32		threadCount;		/* number of worker threads formatting block groups */
+	UINT32		logBlockSize;		/* block size = EXT2_MIN_BLOCK_SIZE << logBlockSize (0, 1, 2) */
+	UINT32		sparseSuper;		/* keep superblock/descriptor backups only in groups 0, 1, 3^n, 5^n, 7^n */
+	UINT32		journalBlocks;		/* size of the metadata journal, 0 : no journal */
+} EXT2_FORMAT_OPTION;
+
+/* result of ext2_check */
+typedef struct ext2_check_report {
+	UINT32		usedInodes;
+	UINT32		dirs;
+	UINT32		freeBlocks;			/* rebuilt free counts */
+	UINT32		freeInodes;
+
+	UINT32		badBlocks;			/* block numbers out of range */
+	UINT32		duplicateBlocks;	/* blocks referenced more than once */
+	UINT32		blockCountErrors;	/* blockCount differs from the mapped data blocks */
+	UINT32		missingBlocks;		/* used blocks marked free in the bitmap */
+	UINT32		leakedBlocks;		/* free blocks marked used in the bitmap */
+	UINT32		missingInodes;
+	UINT32		leakedInodes;
+	UINT32		danglingEntries;	/* directory entries pointing to unused inodes */
+	UINT32		unreferencedInodes;	/* used inodes no directory entry points to */
+	UINT32		linkCountErrors;
+	UINT32		descErrors;			/* group descriptors whose counts or layout differ */
+	UINT32		superErrors;		/* superblock free counts that differ */
+	UINT32		errors;				/* sum of the error counts above */
+} EXT2_CHECK_REPORT;
+
+/* result of ext2_import, see import.c */
+typedef struct ext2_import_report {
+	UINT32		files;
+	UINT32		dirs;				/* root not counted */
+	UINT32		skipped;			/* host entries left out : other types, names that do not fit, too large */
+	UINT64		bytes;				/* file data copied */
+	UINT32		dataBlocks;			/* file and directory blocks */
+	UINT32		indexBlocks;
+	UINT32		metaBlocks;			/* bitmaps, inode tables and descriptors */
+	UINT32		requests;			/* disk writes the data, directory and metadata blocks went out in */
+} EXT2_IMPORT_REPORT;
+
+/* result of ext2_export, see export.c */
+typedef struct ext2_export_report {
+	UINT32		files;
+	UINT32		dirs;				/* start directory not counted */
+	UINT64		bytes;				/* file data copied */
+	UINT32		chunks;				/* reads the file data was split into */
+} EXT2_EXPORT_REPORT;
+
+/* entry passed to the visitor of ext2_walk */
+#define EXT2_WALK_MAX_THREADS	64
+
+typedef struct ext2_walk_entry {
+	EXT2_NODE	node;				/* location is not filled */
+	EXT2_INODE	inode;
+	const char*	name;				/* "NAME.EXT" */
+	const char*	path;				/* "/" separated path below the start directory */
+	UINT32		depth;				/* 1 : entry of the start directory */
+	UINT32		worker;				/* index of the calling worker, < EXT2_WALK_MAX_THREADS */
+} EXT2_WALK_ENTRY;
+
+/* called from all walker threads at once, return EXT2_ERROR to stop the walk */
+typedef int(*EXT2_WALK_VISIT)(const EXT2_WALK_ENTRY* entry, void* arg);
+
+/* streaming fill through a file handle, see fill.c. the generator fills
+ * buffer with the length bytes that go at offset from the start of the fill */
+#define EXT2_FILL_CHUNK			(1024 * 1024)
+#define EXT2_FILL_MAX_CHUNK		(64 * 1024 * 1024)
+
+typedef void(*EXT2_FILL_GENERATE)(void* arg, UINT64 offset, char* buffer, UINT32 length);
+
+typedef struct ext2_fill_report {
+	UINT64		bytes;				/* written */
+	UINT32		chunks;
+	UINT64		nanoseconds;
+	UINT64		waitNanoseconds;	/* writer waiting for the generator */
+} EXT2_FILL_REPORT;
+
+/* asynchronous file operations, see aio.c. the callback gets the result the
+ * blocking call would have returned and runs from ext2_aio_poll */
+#define EXT2_AIO_THREADS		4
+#define EXT2_AIO_MAX_THREADS	64
+
+typedef struct ext2_aio EXT2_AIO;
+typedef void(*EXT2_AIO_DONE)(void* arg, int result);
+
 int ext2_read(EXT2_NODE* file, unsigned long offset, unsigned long length, char* buffer);
 int ext2_write(EXT2_NODE* file, unsigned long offset, unsigned long length, const char* buffer);
 
-int ext2_format(DISK_OPERATIONS* disk); 
+int ext2_format(DISK_OPERATIONS* disk, const EXT2_FORMAT_OPTION* option); 
 int ext2_read_superblock(EXT2_FILESYSTEM* fs, EXT2_NODE* root); 
-void ext2_umount(EXT2_SB_INFO* sb_info); 
+void ext2_umount(EXT2_FILESYSTEM* fs); 
 
 int ext2_lookup(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry);
 int ext2_read_dir(EXT2_NODE* dir, EXT2_NODE_ADD adder, void* list); 
@@ -319,8 +574,99 @@ int ext2_rmdir(EXT2_NODE* node);
 
 int ext2_create(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry);
 int ext2_remove(EXT2_NODE* file); 
+int ext2_truncate(EXT2_NODE* file, unsigned long size);
+
+int ext2_open(EXT2_NODE* file);
+int ext2_close(EXT2_NODE* file);
+
+int ext2_file_open(EXT2_NODE* file);
+int ext2_file_close(EXT2_FILESYSTEM* fs, int fd);
+int ext2_file_read(EXT2_FILESYSTEM* fs, int fd, unsigned long length, char* buffer);
+int ext2_file_write(EXT2_FILESYSTEM* fs, int fd, unsigned long length, const char* buffer);
+int ext2_file_seek(EXT2_FILESYSTEM* fs, int fd, unsigned long offset);
+int ext2_file_fill(EXT2_FILESYSTEM* fs, int fd, UINT64 length, UINT32 chunkSize, EXT2_FILL_GENERATE generate, void* arg, EXT2_FILL_REPORT* report);
 
 int ext2_df(EXT2_FILESYSTEM* fs, UINT32* totalSectors, UINT32* usedSectors);
+int ext2_check(EXT2_FILESYSTEM* fs, UINT32 threadCount, EXT2_CHECK_REPORT* report);
+int ext2_walk(EXT2_NODE* dir, UINT32 threadCount, EXT2_WALK_VISIT visit, void* arg);
+int ext2_import(EXT2_NODE* root, const char* hostPath, EXT2_IMPORT_REPORT* report);
+int ext2_export(EXT2_NODE* dir, const char* hostPath, UINT32 threadCount, EXT2_EXPORT_REPORT* report);
+
+EXT2_AIO* ext2_aio_create(EXT2_FILESYSTEM* fs, UINT32 threadCount);
+void ext2_aio_destroy(EXT2_AIO* aio);
+int ext2_aio_read(EXT2_AIO* aio, EXT2_NODE* file, unsigned long offset, unsigned long length, char* buffer, EXT2_AIO_DONE done, void* arg);
+int ext2_aio_write(EXT2_AIO* aio, EXT2_NODE* file, unsigned long offset, unsigned long length, const char* buffer, EXT2_AIO_DONE done, void* arg);
+int ext2_aio_lookup(EXT2_AIO* aio, EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry, EXT2_AIO_DONE done, void* arg);
+int ext2_aio_poll(EXT2_AIO* aio, int wait);
+int ext2_lookup_cached(EXT2_NODE* parent, const char* entryName, EXT2_NODE* retEntry);
+int ext2_map_read(EXT2_NODE* file, unsigned long offset, unsigned long length, UINT32* blocks, UINT32* version);
+int ext2_map_changed(EXT2_NODE* file, UINT32 version);
+
+void ext2_io_stats(EXT2_FILESYSTEM* fs, EXT2_IO_STATS* stats, int reset);
+const char* ext2_op_name(int op);
+void ext2_count_io(EXT2_IO_STATS* other, int write, UINT32 blocks, UINT32 sectors);
+
+/* latency of the top-level operations of all threads, see latency.c, values in ns */
+typedef struct ext2_latency_stats {
+	UINT64		count;
+	UINT64		mean;
+	UINT64		p50;
+	UINT64		p90;
+	UINT64		p99;
+	UINT64		p999;
+	UINT64		max;
+} EXT2_LATENCY_STATS;
+
+void ext2_latency_record(int op, UINT64 nanoseconds);
+void ext2_latency_stats(int op, EXT2_LATENCY_STATS* stats);
+void ext2_latency_reset(void);
+
+int ext2_current_op(void);
+UINT64 ext2_time_ns(void);
+void ext2_set_trace(EXT2_FILESYSTEM* fs, const EXT2_TRACE* trace);
+
+/* binary trace of the disk and block layers into a file, one trace at a time, see trace.c */
+#define EXT2_TRACE_RING_SIZE	65536	/* records per thread buffer, power of 2 */
+#define EXT2_TRACE_MAX_THREADS	256
+
+int ext2_trace_start(const char* path, DISK_OPERATIONS* disk, EXT2_FILESYSTEM* fs);
+int ext2_trace_stop(UINT64* records, UINT64* dropped);
+
+int read_block(EXT2_FILESYSTEM* fs, UINT32 block, BYTE* buffer);
+int write_block(EXT2_FILESYSTEM* fs, UINT32 block, const BYTE* buffer);
+int read_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc);
+int load_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc);
+int read_block_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer);
+int read_inode_bitmap(EXT2_FILESYSTEM* fs, UINT32 group, BYTE* buffer);
+int get_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, BYTE* inode);
+int set_inode(EXT2_FILESYSTEM* fs, UINT32 inodeNumber, BYTE* inode);
+int get_allocated_block(EXT2_FILESYSTEM* fs, UINT32 block, const EXT2_INODE* inode, UINT32* retBlk);
+int set_allocated_block(EXT2_FILESYSTEM* fs, UINT32 block, EXT2_INODE* inode, UINT32 newBlk);
+int set_entry(EXT2_FILESYSTEM* fs, EXT2_DIR_ENTRY_LOCATION* location, EXT2_DIR_ENTRY* newEntry);
+int is_dir(EXT2_NODE* entry);
+int is_root_dir(EXT2_NODE* entry);
+int fill_sb_info(EXT2_FILESYSTEM* fs);
+int alloc_block(EXT2_FILESYSTEM* fs, EXT2_NODE* entry);
+int write_desc(EXT2_FILESYSTEM* fs, UINT32 blkGroupNumber, BYTE* retDesc);
+
+int init_bitmap_summary(EXT2_FILESYSTEM* fs);
+void release_bitmap_summary(EXT2_FILESYSTEM* fs);
+int init_group_base(EXT2_FILESYSTEM* fs);
+int init_locks(EXT2_FILESYSTEM* fs);
+void release_locks(EXT2_FILESYSTEM* fs);
+int init_cache(EXT2_FILESYSTEM* fs);
+void release_cache(EXT2_FILESYSTEM* fs);
+int load_journal(EXT2_FILESYSTEM* fs);
+int process_orphans(EXT2_FILESYSTEM* fs);
+int sync_super_block(EXT2_FILESYSTEM* fs);
+void release_group_base(EXT2_FILESYSTEM* fs);
+int ext2_init_inode_tables(EXT2_FILESYSTEM* fs, UINT32 maxGroups);
+int ext2_group_has_super(const EXT2_SUPER_BLOCK* sb, UINT32 group);
+
+int get_block_of_inode(EXT2_FILESYSTEM* fs, UINT32 inode, UINT32* retBlk);
+int get_group_of_block(EXT2_FILESYSTEM* fs, UINT32 block, UINT32* retGroup);
+int get_location_of_block(EXT2_FILESYSTEM* fs, UINT32 block, EXT2_DIR_ENTRY_LOCATION* location);
+int format_name(EXT2_FILESYSTEM* fs, char* name);
 int ext2_dump(DISK_OPERATIONS* disk, int blockGroupNum, int type, int target);
 
 #endif
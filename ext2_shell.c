@@ -12,25 +12,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <ctype.h>
+#include <fnmatch.h>
 #include "ext2_shell.h"
 
 #define FSOPRS_TO_EXT2FS( a )      ( EXT2_FILESYSTEM* )a->pdata
 
-int fs_read(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry, unsigned long offset, unsigned long length, const char* buffer); 
+int fs_read(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry, unsigned long offset, unsigned long length, char* buffer); 
 int fs_write(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry, unsigned long offset, unsigned long length, const char* buffer); 
+int fs_open(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry);
+int fs_close(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd);
+int fs_read_fd(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long length, char* buffer);
+int fs_write_fd(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long length, const char* buffer);
+int fs_seek(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long offset);
+int fs_fill_fd(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long long length, unsigned int chunkSize, SHELL_FILL_GENERATE generate, void* arg, unsigned long long* written);
 int	fs_create(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name, SHELL_ENTRY* retEntry);
 int fs_remove(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name); 
 int fs_lookup(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry, const char* name); 
 int fs_read_dir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY_LIST* list); 
 int is_exist(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name); 
 int fs_mkdir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name, SHELL_ENTRY* retEntry); 
-int fs_rmdir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name, SHELL_ENTRY* retEntry);
+int fs_rmdir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name);
 int fs_format(DISK_OPERATIONS* disk, void* param); 
 int fs_mount(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, SHELL_ENTRY* root); 
 void fs_umount(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs); 
 int fs_stat(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, unsigned int* totalSectors, unsigned int* usedSectors); 
 int fs_dump(DISK_OPERATIONS*, int, int, int);
 int fs_dumpdata(DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, const char*);
+int fs_check(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, unsigned int threadCount);
+int fs_du(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* dir, const char* path, unsigned int threadCount);
+int fs_find(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* dir, const char* path, const char* pattern, unsigned int threadCount);
+int fs_stats(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int reset);
+int fs_trace(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const char* path);
 
 char* my_strncpy(char* dest, const char* src, int length)
 {
@@ -79,9 +92,9 @@ int ext2_entry_to_shell_entry(EXT2_FILESYSTEM* fs, const EXT2_NODE* ext2_entry,
 
 	int inode = ext2_entry->entry.inode;
 
-	if (get_inode(fs, inode, &inodeBuffer)) 
+	if (get_inode(fs, inode, (BYTE *)&inodeBuffer)) 
 	{
-		printf("error : failed to get inode\n");
+		LOG_ERROR("error : failed to get inode\n");
 		return EXT2_ERROR;
 	}
 
@@ -107,7 +120,13 @@ static SHELL_FILE_OPERATIONS g_file =
 	fs_create,
 	fs_remove,
 	fs_read,
-	fs_write
+	fs_write,
+	fs_open,
+	fs_close,
+	fs_read_fd,
+	fs_write_fd,
+	fs_seek,
+	fs_fill_fd
 };
 
 static SHELL_FS_OPERATIONS   g_fsOprs =
@@ -119,6 +138,11 @@ static SHELL_FS_OPERATIONS   g_fsOprs =
 	fs_lookup,
 	fs_dump,
 	fs_dumpdata,
+	fs_check,
+	fs_du,
+	fs_find,
+	fs_stats,
+	fs_trace,
 	&g_file,
 	NULL
 };
@@ -139,16 +163,25 @@ void shell_register_filesystem(SHELL_FILESYSTEM* fs)
 int adder(EXT2_FILESYSTEM* fs, void* list, EXT2_NODE* entry) /* entry lsit ߰ */
 {
 	SHELL_ENTRY_LIST*   entryList = (SHELL_ENTRY_LIST*)list;
-	SHELL_ENTRY         newEntry;
+	EXT2_INODE          inode;
 
-	ext2_entry_to_shell_entry(fs, entry, &newEntry); /* SHELL_ENTRY ȯ  */
-printf("newEntry.size : %d\n", newEntry.size);	
-	add_entry_list(entryList, &newEntry); /* ENTRY_LIST ߰ */
+	if (get_inode(fs, entry->entry.inode, (BYTE *)&inode)) /* ũ⸸ inode а SHELL_ENTRY   */
+	{
+		LOG_ERROR("error : failed to get inode\n");
+		return EXT2_ERROR;
+	}
+
+	if (add_entry_list(entryList, (const char*)entry->entry.name, entry->entry.dir2.nameLength, entry->entry.inode,
+		inode.fileSize, entry->entry.dir2.fileType == EXT2_FT_DIR)) /* ENTRY_LIST ߰ */
+	{
+		LOG_ERROR("error : no memory for entry list\n");
+		return EXT2_ERROR;
+	}
 
 	return EXT2_SUCCESS;
 }
 
-int fs_read(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry, unsigned long offset, unsigned long length, const char* buffer) /*  б */
+int fs_read(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry, unsigned long offset, unsigned long length, char* buffer) /*  б */
 {
 	EXT2_NODE EXT2Entry;
 
@@ -166,6 +199,46 @@ int fs_write(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENT
 	return ext2_write(&EXT2Entry, offset, length, buffer); /* offset ġ lengthŭ buffer о */
 }
 
+int fs_open(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, SHELL_ENTRY* entry) /*  , handle ȣ  */
+{
+	EXT2_NODE EXT2Entry;
+
+	shell_entry_to_ext2_entry(entry, &EXT2Entry); /*     ȯ */
+
+	return ext2_file_open(&EXT2Entry);
+}
+
+int fs_close(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd) /*  ݱ */
+{
+	return ext2_file_close(FSOPRS_TO_EXT2FS(fsOprs), fd);
+}
+
+int fs_read_fd(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long length, char* buffer) /*  ġ б */
+{
+	return ext2_file_read(FSOPRS_TO_EXT2FS(fsOprs), fd, length, buffer);
+}
+
+int fs_write_fd(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long length, const char* buffer) /*  ġ  */
+{
+	return ext2_file_write(FSOPRS_TO_EXT2FS(fsOprs), fd, length, buffer);
+}
+
+int fs_seek(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long offset) /* ġ ̵ */
+{
+	return ext2_file_seek(FSOPRS_TO_EXT2FS(fsOprs), fd, offset);
+}
+
+int fs_fill_fd(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int fd, unsigned long long length, unsigned int chunkSize, SHELL_FILL_GENERATE generate, void* arg, unsigned long long* written) /*  ġ chunk    */
+{
+	EXT2_FILL_REPORT report;
+	int result;
+
+	result = ext2_file_fill(FSOPRS_TO_EXT2FS(fsOprs), fd, length, chunkSize, generate, arg, &report);
+	*written = report.bytes;
+
+	return result;
+}
+
 int	fs_create(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name, SHELL_ENTRY* retEntry) /*   */
 {
 	EXT2_NODE	EXT2Parent;
@@ -174,7 +247,8 @@ int	fs_create(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_EN
 
 	shell_entry_to_ext2_entry(parent, &EXT2Parent); /* EXT2_ENTRY ȯ  */
 	result = ext2_create(&EXT2Parent, name, &EXT2Entry); /* ϸ FAT_ENTRY Ŀ °   ش ̸  Ʈ   θ ͸ ߰ */
-	ext2_entry_to_shell_entry(EXT2Parent.fs, &EXT2Entry, retEntry); /* SHELL_ENTRY ȯ */
+	if (result == EXT2_SUCCESS) /* ϸ EXT2Entry ä  */
+		ext2_entry_to_shell_entry(EXT2Parent.fs, &EXT2Entry, retEntry); /* SHELL_ENTRY ȯ */
 
 	return result;
 }
@@ -185,7 +259,8 @@ int fs_remove(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_EN
 	EXT2_NODE	EXT2Entry;
 
 	shell_entry_to_ext2_entry(parent, &EXT2Parent); /* EXT2_ENTRY ȯ  */
-	ext2_lookup(&EXT2Parent, name, &EXT2Entry); /*  ͸ ش  ã */
+	if (ext2_lookup(&EXT2Parent, name, &EXT2Entry) != EXT2_SUCCESS) /*  ͸ ش  ã */
+		return EXT2_ERROR;
 
 	return ext2_remove(&EXT2Entry); /* ã   */
 }
@@ -198,7 +273,7 @@ int fs_lookup(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_EN
 
 	shell_entry_to_ext2_entry(parent, &EXT2Parent); /* EXT2_ENTRY ȯ  */
 
-	if (result = ext2_lookup(&EXT2Parent, name, &EXT2Entry)) /*  ͸ ش  ã */
+	if ((result = ext2_lookup(&EXT2Parent, name, &EXT2Entry)) != EXT2_SUCCESS) /*  ͸ ش  ã */
 		return result;
 
 	ext2_entry_to_shell_entry(EXT2Parent.fs, &EXT2Entry, entry); /* SHELL_ENTRY ȯ */
@@ -210,8 +285,7 @@ int fs_read_dir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_
 {
 	EXT2_NODE   entry;
 
-	if (list->count) /* list  */
-		release_entry_list(list);
+	release_entry_list(list); /* list  */
 
 	shell_entry_to_ext2_entry(parent, &entry); /* EXT2_ENTRY ȯ */
 	ext2_read_dir(&entry, adder, list); /* ͸ Ʈ list  */
@@ -222,21 +296,18 @@ int fs_read_dir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_
 int is_exist(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name) /*  ͸ ش ̸ Ʈ ϴ ˻ */
 {
 	SHELL_ENTRY_LIST		list;
-	SHELL_ENTRY_LIST_ITEM*  current;
+	unsigned int			i;
 
 	init_entry_list(&list); /* ENTRY_LIST ʱȭ */
 	fs_read_dir(disk, fsOprs, parent, &list); /* ͸ Ʈ list  */
-	current = list.first; /* list ù Ʈ */
 
-	while (current) /*  Ʈ name Ʈ ִ ˻*/
+	for (i = 0; i < list.count; i++) /*  Ʈ name Ʈ ִ ˻*/
 	{
-		if (my_strnicmp((char*)current->entry.name, name, 12) == 0) /*  */
+		if (my_strnicmp(entry_list_name(&list, &list.items[i]), name, 12) == 0) /*  */
 		{
 			release_entry_list(&list); /* ENTRY_LIST     */
 			return EXT2_ERROR;
 		}
-
-		current = current->next; 
 	}
 	release_entry_list(&list); /* ENTRY_LIST     */
 
@@ -257,26 +328,71 @@ int fs_mkdir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENT
 
 	shell_entry_to_ext2_entry(parent, &EXT2_Parent); /* EXT2_ENTRT ȯ */
 	result = ext2_mkdir(&EXT2_Parent, name, &EXT2_Entry); /* name  Ʈ  */
-	ext2_entry_to_shell_entry(ext2, &EXT2_Entry, retEntry); /* SHELL_ENTRY ȯ */
+	if (result == EXT2_SUCCESS)
+		ext2_entry_to_shell_entry(ext2, &EXT2_Entry, retEntry); /* SHELL_ENTRY ȯ */
 
 	return result;
 }
 
-int fs_rmdir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name, SHELL_ENTRY* retEntry)
+int fs_rmdir(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* parent, const char* name)
 {
 	EXT2_NODE EXT2_Parent;
 	EXT2_NODE EXT2_Entry;
 
 	shell_entry_to_ext2_entry(parent, &EXT2_Parent); /* EXT2_ENTRT ȯ */
-	ext2_lookup(&EXT2_Parent, name, &EXT2_Entry); /* ش ̸  Ʈ ġ ã */
+	if (ext2_lookup(&EXT2_Parent, name, &EXT2_Entry) != EXT2_SUCCESS) /* ش ̸  Ʈ ġ ã */
+		return EXT2_ERROR;
 
 	return ext2_rmdir(&EXT2_Entry); 
 }
 
 int fs_format(DISK_OPERATIONS* disk, void* param) /*   ,  ׷  Ҵ, Ʈ ͸  */
 {
-	printf("formatting as a %s\n\n", (char *)param);
-	ext2_format(disk);
+	EXT2_FORMAT_OPTION option;
+	char options[256];
+	char* opt;
+
+	ZeroMemory(&option, sizeof(option));
+
+	if (param != NULL)
+	{
+		strncpy(options, (const char *)param, sizeof(options) - 1);
+		options[sizeof(options) - 1] = 0;
+
+		for (opt = strtok(options, " "); opt != NULL; opt = strtok(NULL, " "))
+		{
+			if (strcmp(opt, "-l") == 0) // lazy inode table ʱȭ
+				option.lazyItableInit = 1;
+			else if (strcmp(opt, "-s") == 0) // sparse superblock 
+				option.sparseSuper = 1;
+			else if (strcmp(opt, "-t") == 0 && (opt = strtok(NULL, " ")) != NULL) //  
+				option.threadCount = atoi(opt);
+			else if (strcmp(opt, "-j") == 0 && (opt = strtok(NULL, " ")) != NULL) // journal  
+				option.journalBlocks = atoi(opt);
+			else if (strcmp(opt, "-b") == 0 && (opt = strtok(NULL, " ")) != NULL) //  ũ (1024, 2048, 4096)
+			{
+				for (option.logBlockSize = 0; option.logBlockSize <= 2; option.logBlockSize++)
+				{
+					if ((EXT2_MIN_BLOCK_SIZE << option.logBlockSize) == atoi(opt))
+						break;
+				}
+				if (option.logBlockSize > 2)
+				{
+					LOG_ERROR("error : invalid block size %s\n", opt);
+					return EXT2_ERROR;
+				}
+			}
+			else
+			{
+				LOG_ERROR("error : unknown format option %s\n", opt ? opt : "");
+				return EXT2_ERROR;
+			}
+		}
+	}
+
+	printf("formatting as a %s\n\n", g_ext2.name);
+	if (ext2_format(disk, &option) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
 	return  1;
 }
@@ -298,13 +414,10 @@ int fs_mount(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, SHELL_ENTRY* ro
 	
 	sb = &fs->sb;
 
-	if (ext2_read_superblock(fs, &ext2_entry)) /* superblock fs оͼ ȿ ˻  */
+	if (ext2_read_superblock(fs, &ext2_entry)) /* superblock fs оͼ ȿ ˻  sb_info    */
 		return EXT2_ERROR; 
 
 	sb_info = &fs->sb_info;
-
-	if (fill_sb_info(fs)) /* sb_info    */
-		return EXT2_ERROR;
 	
 	printf("\nnumber of groups         	: %u\n", sb_info->groupCount);
 	printf("blocks per group         	: %u\n", sb_info->blocksPerGroup);
@@ -325,16 +438,165 @@ void fs_umount(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs) /* mount 
 	if (fsOprs && fsOprs->pdata)
 	{
 		ext2_umount(FSOPRS_TO_EXT2FS(fsOprs));
+		if (((EXT2_FILESYSTEM *)fsOprs->pdata)->trace != NULL) // umount I/O ϰ 
+			fs_trace(disk, fsOprs, NULL);
 		free(fsOprs->pdata);
 		fsOprs->pdata = 0; 
 	}
 	return;
 }
 
-int fs_stat(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, unsigned int* totalSectors, unsigned int* usedSectors)
+int fs_check(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, unsigned int threadCount) /* Ʈʰ free count ٽ   */
+{
+	EXT2_CHECK_REPORT report;
+
+	if (ext2_check(FSOPRS_TO_EXT2FS(fsOprs), threadCount, &report) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	printf("used inodes			: %u (%u directories)\n", report.usedInodes, report.dirs);
+	printf("free blocks / inodes		: %u / %u\n", report.freeBlocks, report.freeInodes);
+	printf("bad / duplicate blocks		: %u / %u\n", report.badBlocks, report.duplicateBlocks);
+	printf("wrong inode block counts	: %u\n", report.blockCountErrors);
+	printf("block bitmap missing / leaked	: %u / %u\n", report.missingBlocks, report.leakedBlocks);
+	printf("inode bitmap missing / leaked	: %u / %u\n", report.missingInodes, report.leakedInodes);
+	printf("dangling entries		: %u\n", report.danglingEntries);
+	printf("unreferenced inodes		: %u\n", report.unreferencedInodes);
+	printf("wrong link counts		: %u\n", report.linkCountErrors);
+	printf("wrong group descriptors		: %u\n", report.descErrors);
+	printf("wrong superblock counts		: %u\n", report.superErrors);
+
+	return report.errors == 0 ? EXT2_SUCCESS : EXT2_ERROR;
+}
+
+/* du worker    ħ */
+typedef struct
 {
+	unsigned long	files;
+	unsigned long	dirs;
+	unsigned long long	bytes;
+	unsigned long long	blocks;
+	char			pad[32];	/* worker  cache line  ʵ */
+} DU_COUNT;
+
+static int du_visit(const EXT2_WALK_ENTRY* entry, void* arg)
+{
+	DU_COUNT* count = &((DU_COUNT*)arg)[entry->worker];
+
+	if (entry->node.entry.dir2.fileType == EXT2_FT_DIR)
+		count->dirs++;
+	else
+		count->files++;
+	count->bytes += entry->inode.fileSize;
+	count->blocks += entry->inode.blockCount;
+
+	return EXT2_SUCCESS;
+}
+
+int fs_du(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* dir, const char* path, unsigned int threadCount) /* ͸ Ʒ ü 뷮 */
+{
+	EXT2_FILESYSTEM* fs = FSOPRS_TO_EXT2FS(fsOprs);
+	DU_COUNT count[EXT2_WALK_MAX_THREADS];
 	EXT2_NODE entry;
+	EXT2_INODE inode;
+	int i;
+
+	ZeroMemory(count, sizeof(count));
+	shell_entry_to_ext2_entry(dir, &entry);
+	if (get_inode(fs, entry.entry.inode, (BYTE *)&inode) != EXT2_SUCCESS) /*  ͸ ڽ  */
+		return EXT2_ERROR;
+	count[0].blocks = inode.blockCount;
+
+	if (ext2_walk(&entry, threadCount, du_visit, count) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	for (i = 1; i < EXT2_WALK_MAX_THREADS; i++)
+	{
+		count[0].files += count[i].files;
+		count[0].dirs += count[i].dirs;
+		count[0].bytes += count[i].bytes;
+		count[0].blocks += count[i].blocks;
+	}
+
+	printf("%lluK\t%s\n", count[0].blocks * fs->sb_info.blockSize / 1024, path);
+	printf("files : %lu, directories : %lu, bytes : %llu\n", count[0].files, count[0].dirs, count[0].bytes);
 
+	return EXT2_SUCCESS;
+}
+
+typedef struct
+{
+	const char*	path;
+	const char*	pattern;
+} FIND_ARG;
+
+static int find_visit(const EXT2_WALK_ENTRY* entry, void* arg)
+{
+	FIND_ARG* find = (FIND_ARG*)arg;
+
+	if (fnmatch(find->pattern, entry->name, 0) == 0)
+		printf("%s/%s\n", find->path, entry->path);
+
+	return EXT2_SUCCESS;
+}
+
+int fs_find(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const SHELL_ENTRY* dir, const char* path, const char* pattern, unsigned int threadCount) /* ͸ Ʒ ̸ pattern ´ Ʈ  */
+{
+	EXT2_NODE entry;
+	FIND_ARG find;
+	char upper[MAX_NAME_LENGTH] = { 0, };
+	int i;
+
+	for (i = 0; pattern[i] && i < MAX_NAME_LENGTH - 1; i++) /* ̸ 빮ڷ ǹǷ pattern 빮ڷ */
+		upper[i] = toupper(pattern[i]);
+
+	find.path = path;
+	find.pattern = upper;
+	shell_entry_to_ext2_entry(dir, &entry);
+
+	return ext2_walk(&entry, threadCount, find_visit, &find);
+}
+
+int fs_stats(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, int reset) /* 꺰  ð   I/O */
+{
+	EXT2_IO_STATS io[EXT2_OP_COUNT];
+	EXT2_LATENCY_STATS latency;
+	int op;
+
+	ext2_io_stats(FSOPRS_TO_EXT2FS(fsOprs), io, reset);
+
+	printf("%-10s %10s %10s %10s %10s %10s %12s %12s\n", "operation", "count", "p50(us)", "p99(us)", "p999(us)", "max(us)", "blk reads", "blk writes");
+	for (op = 0; op < EXT2_OP_COUNT; op++)
+	{
+		ext2_latency_stats(op, &latency);
+		if (latency.count == 0 && io[op].blockReads == 0 && io[op].blockWrites == 0)
+			continue;
+
+		printf("%-10s %10llu %10.1f %10.1f %10.1f %10.1f %12llu %12llu\n", ext2_op_name(op), latency.count,
+			latency.p50 / 1e3, latency.p99 / 1e3, latency.p999 / 1e3, latency.max / 1e3, io[op].blockReads, io[op].blockWrites);
+	}
+
+	if (reset)
+		ext2_latency_reset();
+
+	return EXT2_SUCCESS;
+}
+
+int fs_trace(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, const char* path) /* path NULL̸   trace  */
+{
+	UINT64 records, dropped;
+
+	if (path != NULL)
+		return ext2_trace_start(path, disk, FSOPRS_TO_EXT2FS(fsOprs));
+
+	if (ext2_trace_stop(&records, &dropped))
+		return EXT2_ERROR;
+	printf("trace : %llu records, %llu dropped\n", records, dropped);
+
+	return EXT2_SUCCESS;
+}
+
+int fs_stat(DISK_OPERATIONS* disk, SHELL_FS_OPERATIONS* fsOprs, unsigned int* totalSectors, unsigned int* usedSectors)
+{
 	return ext2_df(FSOPRS_TO_EXT2FS(fsOprs), totalSectors, usedSectors);
 }
 
@@ -359,12 +621,13 @@ int fs_dumpdata(DISK_OPERATIONS* disk, struct SHELL_FS_OPERATIONS* fsOprs, const
 		return EXT2_ERROR;
 
 	shell_entry_to_ext2_entry(parent, &ext2_parent);
-	ext2_lookup(&ext2_parent, name, &ext2_entry);
-	//get_inode(&inode, ext2_entry.entry.inode);
+	if (ext2_lookup(&ext2_parent, name, &ext2_entry) != EXT2_SUCCESS ||
+		get_inode(ext2_parent.fs, ext2_entry.entry.inode, (BYTE *)&inode) != EXT2_SUCCESS)
+		return EXT2_ERROR;
 
 	printf("inode number\t: %u\n", ext2_entry.entry.inode);
-	for (i = 0; i < inode.blockCount; i++)
-		printf("i_block[i]\t: %u\n", inode.i_block[i]);
+	for (i = 0; i < EXT2_N_BLOCKS && i < inode.blockCount; i++)
+		printf("i_block[%d]\t: %u\n", i, inode.i_block[i]);
 
 	return EXT2_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ext2.h"
+#include "disk.h"
+#include "diskfile.h"
+
+/* image extractor : mounts a disk image file and copies its tree, or the
+ * tree below -p, to a host directory with ext2_export, then prints one
+ * "key=value" line. The image keeps its size; it is opened read/write only
+ * because mounting replays the journal and the orphan list. */
+
+#define EXTRACT_SECTOR_SIZE		512
+#define EXTRACT_MAX_PATH		256
+
+typedef struct
+{
+	UINT32		threadCount;
+	const char*	sourcePath;
+	const char*	imagePath;
+	const char*	hostPath;
+} EXTRACT_OPTIONS;
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( double )ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage( void )
+{
+	printf( "usage : extract [-t threads] [-p path] image directory\n"
+		"  -t threads  walk and read threads, default : walk on every cpu, %d readers\n"
+		"  -p path     directory of the image to extract, default : /\n", EXT2_AIO_THREADS );
+}
+
+static int parse_options( int argc, char* argv[], EXTRACT_OPTIONS* options )
+{
+	int opt;
+
+	memset( options, 0, sizeof( EXTRACT_OPTIONS ) );
+	options->sourcePath = "/";
+
+	while( ( opt = getopt( argc, argv, "t:p:" ) ) != -1 )
+	{
+		switch( opt )
+		{
+		case 't':
+			options->threadCount = ( UINT32 )atoi( optarg );
+			break;
+		case 'p':
+			options->sourcePath = optarg;
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	if( argc - optind != 2 )
+		return -1;
+	options->imagePath = argv[optind];
+	options->hostPath = argv[optind + 1];
+
+	return 0;
+}
+
+/* resolves a "/" separated path one component at a time from root */
+static int lookup_path( EXT2_NODE* root, const char* path, EXT2_NODE* retEntry )
+{
+	char buffer[EXTRACT_MAX_PATH];
+	char* name;
+	EXT2_NODE parent;
+
+	if( strlen( path ) >= sizeof( buffer ) )
+		return EXT2_ERROR;
+	strcpy( buffer, path );
+
+	*retEntry = *root;
+	for( name = strtok( buffer, "/" ); name != NULL; name = strtok( NULL, "/" ) )
+	{
+		parent = *retEntry;
+		if( ext2_lookup( &parent, name, retEntry ) != EXT2_SUCCESS )
+			return EXT2_ERROR;
+		if( retEntry->entry.dir2.fileType != EXT2_FT_DIR )
+			return EXT2_ERROR;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+int main( int argc, char* argv[] )
+{
+	EXTRACT_OPTIONS options;
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root, dir;
+	EXT2_EXPORT_REPORT report;
+	struct stat st;
+	double start, seconds;
+	int result;
+
+	if( parse_options( argc, argv, &options ) < 0 )
+	{
+		usage( );
+		return 1;
+	}
+	g_logLevel = LOG_LEVEL_WARN;
+
+	if( stat( options.imagePath, &st ) < 0 || st.st_size < EXTRACT_SECTOR_SIZE )
+	{
+		printf( "error : cannot open %s\n", options.imagePath );
+		return 1;
+	}
+	if( diskfile_init( options.imagePath, ( SECTOR )( st.st_size / EXTRACT_SECTOR_SIZE ), EXTRACT_SECTOR_SIZE, &disk ) < 0 )
+	{
+		printf( "error : cannot open %s\n", options.imagePath );
+		return 1;
+	}
+
+	memset( &fs, 0, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+	{
+		printf( "error : cannot mount %s\n", options.imagePath );
+		diskfile_uninit( &disk );
+		return 1;
+	}
+
+	if( lookup_path( &root, options.sourcePath, &dir ) != EXT2_SUCCESS )
+	{
+		printf( "error : no directory %s in %s\n", options.sourcePath, options.imagePath );
+		ext2_umount( &fs );
+		diskfile_uninit( &disk );
+		return 1;
+	}
+
+	start = now_ns( );
+	result = ext2_export( &dir, options.hostPath, options.threadCount, &report );
+	seconds = ( now_ns( ) - start ) / 1e9;
+
+	if( result == EXT2_SUCCESS )
+		printf( "extract=%s path=%s dir=%s files=%u dirs=%u mb=%.1f chunks=%u seconds=%.3f mb_per_s=%.1f\n",
+			options.imagePath, options.sourcePath, options.hostPath, report.files, report.dirs,
+			( double )report.bytes / ( 1024 * 1024 ), report.chunks, seconds,
+			seconds > 0 ? ( double )report.bytes / ( 1024 * 1024 ) / seconds : 0 );
+	else
+		printf( "error : export failed\n" );
+
+	ext2_umount( &fs );
+	diskfile_uninit( &disk );
+
+	return result == EXT2_SUCCESS ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "ext2.h"
+
+/* streaming fill
+ *
+ * ext2_file_fill writes a long stretch of generated data through an open
+ * handle without holding it in memory. The data is produced in chunks by
+ * the caller's generator and each chunk goes to ext2_file_write as one call,
+ * so memory stays at two chunk buffers whatever the length. A helper thread
+ * runs the generator one chunk ahead of the writer : while chunk n is being
+ * written, chunk n + 1 is being generated into the other buffer. If the
+ * helper cannot be started the writer generates each chunk itself. */
+
+#define FILL_BUFFERS			2
+
+typedef struct fill_context {
+	EXT2_FILL_GENERATE	generate;
+	void*		arg;
+	BYTE*		buffers[FILL_BUFFERS];
+	UINT64		length;
+	UINT32		chunkSize;
+	UINT32		chunkCount;
+	UINT32		produced;			/* chunks generated */
+	UINT32		consumed;			/* chunks written, their buffers are free again */
+	int			stop;				/* writer failed */
+	pthread_mutex_t lock;
+	pthread_cond_t	cond;
+} FILL_CONTEXT;
+
+static UINT64 fill_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static UINT32 get_chunk_length(const FILL_CONTEXT* ctx, UINT32 chunk)
+{
+	UINT64 offset = (UINT64)chunk * ctx->chunkSize;
+
+	return (UINT32)MIN((UINT64)ctx->chunkSize, ctx->length - offset);
+}
+
+static void generate_chunk(FILL_CONTEXT* ctx, UINT32 chunk)
+{
+	ctx->generate(ctx->arg, (UINT64)chunk * ctx->chunkSize, (char *)ctx->buffers[chunk % FILL_BUFFERS], get_chunk_length(ctx, chunk));
+}
+
+/*   ۸    chunk   */
+static void* fill_generator(void* arg)
+{
+	FILL_CONTEXT* ctx = (FILL_CONTEXT *)arg;
+	UINT32 chunk;
+	int stop;
+
+	for (chunk = 0; chunk < ctx->chunkCount; chunk++)
+	{
+		pthread_mutex_lock(&ctx->lock);
+		while (chunk - ctx->consumed >= FILL_BUFFERS && !ctx->stop)
+			pthread_cond_wait(&ctx->cond, &ctx->lock);
+		stop = ctx->stop;
+		pthread_mutex_unlock(&ctx->lock);
+		if (stop)
+			break;
+
+		generate_chunk(ctx, chunk);
+
+		pthread_mutex_lock(&ctx->lock);
+		ctx->produced = chunk + 1;
+		pthread_cond_broadcast(&ctx->cond);
+		pthread_mutex_unlock(&ctx->lock);
+	}
+
+	return NULL;
+}
+
+/*  ġ length Ʈ chunkSize    ġ ű, chunkSize 0̸ EXT2_FILL_CHUNK */
+/* generate fill ۺ offset ̸ ޾ buffer ä */
+/* return : EXT2_SUCCESS  , EXT2_ERROR   (report->bytes  ) */
+int ext2_file_fill(EXT2_FILESYSTEM* fs, int fd, UINT64 length, UINT32 chunkSize, EXT2_FILL_GENERATE generate, void* arg, EXT2_FILL_REPORT* report)
+{
+	FILL_CONTEXT ctx;
+	pthread_t thread;
+	UINT64 start, waitStart;
+	UINT32 chunk, chunkLength, i;
+	int threaded, written, result = EXT2_SUCCESS;
+
+	ZeroMemory(report, sizeof(EXT2_FILL_REPORT));
+	if (chunkSize == 0)
+		chunkSize = EXT2_FILL_CHUNK;
+	if (chunkSize > EXT2_FILL_MAX_CHUNK)
+		chunkSize = EXT2_FILL_MAX_CHUNK;
+	if (length == 0)
+		return EXT2_SUCCESS;
+	if (length > 0xFFFFFFFFULL) // fileSize 32Ʈ
+	{
+		LOG_ERROR("error : fill of %llu bytes is larger than a file can be\n", length);
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(&ctx, sizeof(ctx));
+	ctx.generate = generate;
+	ctx.arg = arg;
+	ctx.length = length;
+	ctx.chunkSize = (UINT32)MIN((UINT64)chunkSize, length);
+	ctx.chunkCount = (UINT32)((length + ctx.chunkSize - 1) / ctx.chunkSize);
+	for (i = 0; i < FILL_BUFFERS; i++)
+	{
+		ctx.buffers[i] = (BYTE *)malloc(ctx.chunkSize);
+		if (ctx.buffers[i] == NULL)
+		{
+			LOG_ERROR("error : failed to allocate fill buffers\n");
+			for (; i > 0; i--)
+				free(ctx.buffers[i - 1]);
+			return EXT2_ERROR;
+		}
+	}
+	pthread_mutex_init(&ctx.lock, NULL);
+	pthread_cond_init(&ctx.cond, NULL);
+
+	start = fill_now_ns();
+	threaded = ctx.chunkCount > 1 && pthread_create(&thread, NULL, fill_generator, &ctx) == 0;
+
+	for (chunk = 0; chunk < ctx.chunkCount; chunk++)
+	{
+		if (threaded)
+		{
+			waitStart = fill_now_ns();
+			pthread_mutex_lock(&ctx.lock);
+			while (ctx.produced <= chunk)
+				pthread_cond_wait(&ctx.cond, &ctx.lock);
+			pthread_mutex_unlock(&ctx.lock);
+			report->waitNanoseconds += fill_now_ns() - waitStart;
+		}
+		else
+			generate_chunk(&ctx, chunk);
+
+		chunkLength = get_chunk_length(&ctx, chunk);
+		written = ext2_file_write(fs, fd, chunkLength, (const char *)ctx.buffers[chunk % FILL_BUFFERS]);
+		if (written > 0)
+			report->bytes += written;
+		if (written != (int)chunkLength)
+		{
+			LOG_ERROR("error : fill stopped after %llu bytes\n", report->bytes);
+			result = EXT2_ERROR;
+			break;
+		}
+		report->chunks++;
+
+		pthread_mutex_lock(&ctx.lock);
+		ctx.consumed = chunk + 1;
+		pthread_cond_broadcast(&ctx.cond);
+		pthread_mutex_unlock(&ctx.lock);
+	}
+
+	if (threaded)
+	{
+		pthread_mutex_lock(&ctx.lock);
+		ctx.stop = 1;
+		pthread_cond_broadcast(&ctx.cond);
+		pthread_mutex_unlock(&ctx.lock);
+		pthread_join(thread, NULL);
+	}
+	report->nanoseconds = fill_now_ns() - start;
+
+	pthread_cond_destroy(&ctx.cond);
+	pthread_mutex_destroy(&ctx.lock);
+	for (i = 0; i < FILL_BUFFERS; i++)
+		free(ctx.buffers[i]);
+
+	return result;
+}
@@ -0,0 +1,581 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <memory.h>
+#include <pthread.h>
+#include "ext2.h"
+
+/* consistency checker
+ *
+ * Rebuilds the block and inode bitmaps and the free counts from the inode
+ * tables and directory blocks, then compares them with the bitmaps,
+ * group descriptors and superblock. Block groups are handed out to a
+ * pool of workers. A worker records references that fall into its own
+ * group directly and queues the others; the queues are merged after all
+ * groups are scanned, then the workers verify the groups again in
+ * parallel. The file system must not be modified while it runs. */
+
+#define CHECK_INODE_FREE		0
+#define CHECK_INODE_FILE		1
+#define CHECK_INODE_DIR			2
+#define CHECK_INODE_ORPHAN		0x80	/* on the orphan list, set before the scan */
+
+typedef struct check_context {
+	EXT2_FILESYSTEM*	fs;
+	UINT32		bitmapBytes;		/* bytes of one group's block bitmap */
+	UINT32		inodeBitmapBytes;
+	BYTE*		blockMap;			/* rebuilt block bitmaps of all groups */
+	BYTE*		inodeMap;			/* rebuilt inode bitmaps of all groups */
+	BYTE*		inodeState;			/* CHECK_INODE_* per inode number */
+	UINT16*		links;				/* linkCount per inode number */
+	UINT16*		refs;				/* directory entries per inode number */
+	UINT32*		dirs;				/* directories per group */
+
+	UINT32		nextGroup;			/* next group to hand out */
+	pthread_mutex_t lock;
+} CHECK_CONTEXT;
+
+typedef struct check_worker {
+	CHECK_CONTEXT*	ctx;
+	UINT32		group;				/* group being scanned */
+	UINT32*		crossBlocks;		/* referenced blocks of other groups */
+	UINT32		crossBlockCount;
+	UINT32		crossBlockSize;
+	UINT32*		crossInodes;		/* referenced inodes of other groups */
+	UINT32		crossInodeCount;
+	UINT32		crossInodeSize;
+	int			result;
+	EXT2_CHECK_REPORT report;		/* counts of this worker, summed at the end */
+} CHECK_WORKER;
+
+static __inline__ int test_and_set(BYTE* map, UINT32 bit)
+{
+	int old = (map[bit >> 3] >> (bit & 7)) & 1;
+
+	map[bit >> 3] |= 1 << (bit & 7);
+	return old;
+}
+
+static __inline__ int test_bit(const BYTE* map, UINT32 bit)
+{
+	return (map[bit >> 3] >> (bit & 7)) & 1;
+}
+
+static int push_number(UINT32** array, UINT32* count, UINT32* size, UINT32 number)
+{
+	UINT32* grown;
+
+	if (*count == *size)
+	{
+		grown = (UINT32 *)realloc(*array, sizeof(UINT32) * (*size ? *size * 2 : 256));
+		if (grown == NULL)
+			return EXT2_ERROR;
+		*array = grown;
+		*size = *size ? *size * 2 : 256;
+	}
+	(*array)[(*count)++] = number;
+
+	return EXT2_SUCCESS;
+}
+
+/*  ˻ ׷,  ׷  groupCount */
+static UINT32 next_group(CHECK_CONTEXT* ctx)
+{
+	UINT32 group;
+
+	pthread_mutex_lock(&ctx->lock);
+	group = ctx->nextGroup;
+	if (group < ctx->fs->sb_info.groupCount)
+		ctx->nextGroup++;
+	pthread_mutex_unlock(&ctx->lock);
+
+	return group;
+}
+
+/*   ǥ,   0  */
+static int mark_block(CHECK_WORKER* worker, UINT32 block)
+{
+	CHECK_CONTEXT* ctx = worker->ctx;
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	UINT32 group, bit;
+
+	if (block < fs->sb.firstDataBlock || block >= fs->sb.blockCount)
+	{
+		worker->report.badBlocks++;
+		return 0;
+	}
+
+	group = (block - fs->sb.firstDataBlock) >> fs->sb_info.blocksPerGroup_bits;
+	bit = (block - fs->sb.firstDataBlock) & (fs->sb_info.blocksPerGroup - 1);
+
+	if (group != worker->group) // ٸ ׷ Ʈ merge ܰ迡 ǥ
+	{
+		if (push_number(&worker->crossBlocks, &worker->crossBlockCount, &worker->crossBlockSize, block) != EXT2_SUCCESS)
+			worker->result = EXT2_ERROR;
+		return 1;
+	}
+
+	if (test_and_set(&ctx->blockMap[(size_t)group * ctx->bitmapBytes], bit))
+		worker->report.duplicateBlocks++;
+
+	return 1;
+}
+
+/* ͸ Ʈ Ű inode    */
+static void mark_reference(CHECK_WORKER* worker, UINT32 inodeNumber)
+{
+	CHECK_CONTEXT* ctx = worker->ctx;
+	EXT2_FILESYSTEM* fs = ctx->fs;
+
+	if (inodeNumber == 0 || inodeNumber > fs->sb.inodeCount)
+	{
+		worker->report.danglingEntries++;
+		return;
+	}
+
+	if ((inodeNumber - 1) / fs->sb_info.inodesPerGroup != worker->group)
+	{
+		if (push_number(&worker->crossInodes, &worker->crossInodeCount, &worker->crossInodeSize, inodeNumber) != EXT2_SUCCESS)
+			worker->result = EXT2_ERROR;
+		return;
+	}
+
+	if (ctx->refs[inodeNumber] != 0xFFFF)
+		ctx->refs[inodeNumber]++;
+}
+
+static void scan_dir_block(CHECK_WORKER* worker, UINT32 block)
+{
+	EXT2_FILESYSTEM* fs = worker->ctx->fs;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_DIR_ENTRY* entry = (EXT2_DIR_ENTRY *)buffer;
+	UINT32 i, maxEntry = fs->sb_info.blockSize / sizeof(EXT2_DIR_ENTRY);
+
+	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
+		return;
+
+	for (i = 0; i < maxEntry; i++)
+	{
+		if (entry[i].dir2.fileType == EXT2_FT_NO_MORE)
+			break;
+		if (entry[i].dir2.fileType != EXT2_FT_FREE)
+			mark_reference(worker, entry[i].inode);
+	}
+}
+
+/* level ܰ  Ϻ 󰡸  ǥ,    dataBlocks  */
+static void walk_blocks(CHECK_WORKER* worker, UINT32 block, UINT32 level, int isDir, UINT32* dataBlocks)
+{
+	EXT2_FILESYSTEM* fs = worker->ctx->fs;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	UINT32* ptr = (UINT32 *)buffer;
+	UINT32 i, ptrCount = fs->sb_info.blockSize / sizeof(UINT32);
+
+	if (!mark_block(worker, block))
+		return;
+
+	if (level == 0)
+	{
+		(*dataBlocks)++;
+		if (isDir)
+			scan_dir_block(worker, block);
+		return;
+	}
+
+	if (read_block(fs, block, buffer) != EXT2_SUCCESS)
+		return;
+
+	for (i = 0; i < ptrCount; i++)
+	{
+		if (ptr[i] != 0)
+			walk_blocks(worker, ptr[i], level - 1, isDir, dataBlocks);
+	}
+}
+
+/* ׷ Ÿ ϰ ׷   Ʈ ǥ (format clear_bitmap  Ģ) */
+static void mark_group_metadata(CHECK_WORKER* worker, UINT32 group)
+{
+	CHECK_CONTEXT* ctx = worker->ctx;
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	EXT2_GROUP_BASE* base = &fs->groupBase[group];
+	BYTE* map = &ctx->blockMap[(size_t)group * ctx->bitmapBytes];
+	UINT32 metaBlocks = base->inodeTable + fs->sb_info.itbPerGroup - base->firstBlock;
+	UINT32 groupBlocks = MIN(fs->sb_info.blocksPerGroup, fs->sb.blockCount - base->firstBlock);
+	UINT32 i;
+
+	for (i = 0; i < metaBlocks; i++)
+		test_and_set(map, i);
+	for (i = groupBlocks; i < fs->sb_info.blocksPerGroup; i++)
+		test_and_set(map, i);
+}
+
+/* 1ܰ : ׷ inode table о   inode , ͸ Ʈ   */
+static int scan_group(CHECK_WORKER* worker, UINT32 group)
+{
+	CHECK_CONTEXT* ctx = worker->ctx;
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	EXT2_INODE* inode = (EXT2_INODE *)buffer;
+	EXT2_GROUP_DESC desc;
+	UINT32 validInodes, block, i, j, dataBlocks;
+	UINT32 inodeNumber;
+	BYTE* state;
+
+	worker->group = group;
+	mark_group_metadata(worker, group);
+
+	if (load_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	validInodes = sb_info->inodesPerGroup;
+	if (desc.bg_flags & EXT2_BG_INODE_UNINIT) // ʱȭ  inode table   
+		validInodes -= desc.bg_itableUnused;
+
+	for (block = 0; block * sb_info->inodesPerBlock < validInodes; block++)
+	{
+		if (read_block(fs, fs->groupBase[group].inodeTable + block, buffer) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+
+		for (i = 0; i < sb_info->inodesPerBlock && block * sb_info->inodesPerBlock + i < validInodes; i++)
+		{
+			inodeNumber = group * sb_info->inodesPerGroup + block * sb_info->inodesPerBlock + i + 1;
+			state = &ctx->inodeState[inodeNumber];
+
+			if (inode[i].fileMode == 0 || (inode[i].linkCount == 0 && !(*state & CHECK_INODE_ORPHAN)))
+				continue;
+
+			*state |= ((inode[i].fileMode & 0xF000) == FILE_TYPE_DIR) ? CHECK_INODE_DIR : CHECK_INODE_FILE;
+			ctx->links[inodeNumber] = inode[i].linkCount;
+			test_and_set(&ctx->inodeMap[(size_t)group * ctx->inodeBitmapBytes], inodeNumber - 1 - group * sb_info->inodesPerGroup);
+			worker->report.usedInodes++;
+			if (*state & CHECK_INODE_DIR)
+				ctx->dirs[group]++;
+
+			dataBlocks = 0;
+			for (j = 0; j < EXT2_N_BLOCKS; j++)
+			{
+				if (inode[i].i_block[j] != 0)
+					walk_blocks(worker, inode[i].i_block[j], j < EXT2_NDIR_BLOCKS ? 0 : j - EXT2_NDIR_BLOCKS + 1,
+						*state & CHECK_INODE_DIR, &dataBlocks);
+			}
+
+			if (dataBlocks != inode[i].blockCount)
+				worker->report.blockCountErrors++;
+		}
+	}
+
+	return worker->result;
+}
+
+/* Ʈ  nbits Ʈ ,  ε free ǥõ Ʈ  ݴ   */
+static UINT32 compare_bitmap(const BYTE* rebuilt, const BYTE* disk, UINT32 nbits, UINT32* missing, UINT32* leaked)
+{
+	UINT32 bit, freeCount = 0;
+
+	for (bit = 0; bit < nbits; bit++)
+	{
+		int used = test_bit(rebuilt, bit);
+		int marked = test_bit(disk, bit);
+
+		if (used && !marked)
+			(*missing)++;
+		else if (!used && marked)
+			(*leaked)++;
+
+		if (!used)
+			freeCount++;
+	}
+
+	return freeCount;
+}
+
+/* 2ܰ : ٽ  Ʈʰ free count ũ   */
+static int verify_group(CHECK_WORKER* worker, UINT32 group)
+{
+	CHECK_CONTEXT* ctx = worker->ctx;
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	EXT2_CHECK_REPORT* report = &worker->report;
+	BYTE bitmap[EXT2_MAX_BLOCK_SIZE];
+	EXT2_GROUP_DESC desc;
+	UINT32 freeBlocks, freeInodes, i, inodeNumber;
+	UINT32 groupBlocks = MIN(sb_info->blocksPerGroup, fs->sb.blockCount - fs->groupBase[group].firstBlock);
+
+	// read_block_bitmap ϴ ׷   ϹǷ Ʈ   
+	if (load_desc(fs, group, (BYTE *)&desc) != EXT2_SUCCESS ||
+		read_block(fs, fs->groupBase[group].blockBitmap, bitmap) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	// Ÿ ġ format ġ Ģ  ׷ ̺  ˻
+	if (desc.bg_blockBitmap != fs->groupBase[group].blockBitmap || desc.bg_inodeBitmap != fs->groupBase[group].inodeBitmap ||
+		desc.bg_inodeTable != fs->groupBase[group].inodeTable)
+		report->descErrors++;
+
+	freeBlocks = compare_bitmap(&ctx->blockMap[(size_t)group * ctx->bitmapBytes], bitmap, groupBlocks,
+		&report->missingBlocks, &report->leakedBlocks);
+
+	if (read_block(fs, fs->groupBase[group].inodeBitmap, bitmap) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	freeInodes = compare_bitmap(&ctx->inodeMap[(size_t)group * ctx->inodeBitmapBytes], bitmap, sb_info->inodesPerGroup,
+		&report->missingInodes, &report->leakedInodes);
+
+	if (desc.bg_freeBlockCount != freeBlocks || desc.bg_freeInodeCount != freeInodes ||
+		desc.bg_usedDirCount != ctx->dirs[group])
+		report->descErrors++;
+
+	report->freeBlocks += freeBlocks;
+	report->freeInodes += freeInodes;
+	report->dirs += ctx->dirs[group];
+
+	for (i = 0; i < sb_info->inodesPerGroup; i++)
+	{
+		BYTE state;
+
+		inodeNumber = group * sb_info->inodesPerGroup + i + 1;
+		state = ctx->inodeState[inodeNumber];
+
+		if ((state & ~CHECK_INODE_ORPHAN) == CHECK_INODE_FREE)
+		{
+			if (ctx->refs[inodeNumber] != 0) //  inode Ű Ʈ
+				report->danglingEntries += ctx->refs[inodeNumber];
+			continue;
+		}
+
+		//  inode(Ʈ, journal ) orphan Ʈ ̵    
+		if (ctx->refs[inodeNumber] == 0 && !(state & CHECK_INODE_ORPHAN) && inodeNumber >= fs->sb.firstInode)
+			report->unreferencedInodes++;
+		else if ((state & CHECK_INODE_FILE) && ctx->refs[inodeNumber] != 0 && ctx->refs[inodeNumber] != ctx->links[inodeNumber])
+			report->linkCountErrors++;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+static void* scan_worker(void* arg)
+{
+	CHECK_WORKER* worker = (CHECK_WORKER *)arg;
+	UINT32 group;
+
+	while ((group = next_group(worker->ctx)) < worker->ctx->fs->sb_info.groupCount)
+	{
+		if (scan_group(worker, group) != EXT2_SUCCESS)
+		{
+			worker->result = EXT2_ERROR;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void* verify_worker(void* arg)
+{
+	CHECK_WORKER* worker = (CHECK_WORKER *)arg;
+	UINT32 group;
+
+	while ((group = next_group(worker->ctx)) < worker->ctx->fs->sb_info.groupCount)
+	{
+		if (verify_group(worker, group) != EXT2_SUCCESS)
+		{
+			worker->result = EXT2_ERROR;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* threadCount  routine , 尡 ϳ ȣ 忡  */
+static int run_workers(CHECK_CONTEXT* ctx, CHECK_WORKER* workers, UINT32 threadCount, void* (*routine)(void*))
+{
+	pthread_t* threads;
+	UINT32 i, started;
+	int result = EXT2_SUCCESS;
+
+	ctx->nextGroup = 0;
+
+	if (threadCount == 1)
+	{
+		routine(&workers[0]);
+		return workers[0].result;
+	}
+
+	threads = (pthread_t *)malloc(sizeof(pthread_t) * threadCount);
+	if (threads == NULL)
+		return EXT2_ERROR;
+
+	for (started = 0; started < threadCount; started++)
+	{
+		if (pthread_create(&threads[started], NULL, routine, &workers[started]) != 0)
+			break;
+	}
+	if (started == 0)
+		result = EXT2_ERROR;
+
+	for (i = 0; i < started; i++)
+	{
+		pthread_join(threads[i], NULL);
+		if (workers[i].result != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+	}
+
+	free(threads);
+
+	return result;
+}
+
+/* ٸ ׷쿡   Ƽ ݿ */
+static void merge_references(CHECK_CONTEXT* ctx, CHECK_WORKER* workers, UINT32 threadCount, EXT2_CHECK_REPORT* report)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	UINT32 i, j, block, inodeNumber;
+
+	for (i = 0; i < threadCount; i++)
+	{
+		for (j = 0; j < workers[i].crossBlockCount; j++)
+		{
+			block = workers[i].crossBlocks[j] - fs->sb.firstDataBlock;
+			if (test_and_set(&ctx->blockMap[(size_t)(block >> fs->sb_info.blocksPerGroup_bits) * ctx->bitmapBytes],
+				block & (fs->sb_info.blocksPerGroup - 1)))
+				report->duplicateBlocks++;
+		}
+
+		for (j = 0; j < workers[i].crossInodeCount; j++)
+		{
+			inodeNumber = workers[i].crossInodes[j];
+			if (ctx->refs[inodeNumber] != 0xFFFF)
+				ctx->refs[inodeNumber]++;
+		}
+	}
+}
+
+static void add_report(EXT2_CHECK_REPORT* sum, const EXT2_CHECK_REPORT* report)
+{
+	sum->usedInodes += report->usedInodes;
+	sum->dirs += report->dirs;
+	sum->freeBlocks += report->freeBlocks;
+	sum->freeInodes += report->freeInodes;
+	sum->badBlocks += report->badBlocks;
+	sum->duplicateBlocks += report->duplicateBlocks;
+	sum->blockCountErrors += report->blockCountErrors;
+	sum->missingBlocks += report->missingBlocks;
+	sum->leakedBlocks += report->leakedBlocks;
+	sum->missingInodes += report->missingInodes;
+	sum->leakedInodes += report->leakedInodes;
+	sum->danglingEntries += report->danglingEntries;
+	sum->unreferencedInodes += report->unreferencedInodes;
+	sum->linkCountErrors += report->linkCountErrors;
+	sum->descErrors += report->descErrors;
+}
+
+/* orphan  inode ũ    */
+static int mark_orphans(CHECK_CONTEXT* ctx)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	EXT2_INODE inode;
+	UINT32 inodeNumber = fs->sb.orphanList;
+	UINT32 count = 0;
+
+	while (inodeNumber != 0)
+	{
+		if (inodeNumber > fs->sb.inodeCount || ++count > fs->sb.inodeCount ||
+			get_inode(fs, inodeNumber, (BYTE *)&inode) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+
+		ctx->inodeState[inodeNumber] |= CHECK_INODE_ORPHAN;
+		inodeNumber = inode.dTime;
+	}
+
+	return EXT2_SUCCESS;
+}
+
+/*  ý ü ˻,  report  */
+/* return : EXT2_SUCCESS ˻ Ϸ (ġ report->errors), EXT2_ERROR ˻  */
+int ext2_check(EXT2_FILESYSTEM* fs, UINT32 threadCount, EXT2_CHECK_REPORT* report)
+{
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	CHECK_CONTEXT ctx;
+	CHECK_WORKER* workers;
+	UINT32 groupCount = sb_info->groupCount;
+	UINT32 i;
+	int result = EXT2_ERROR;
+
+	ZeroMemory(report, sizeof(EXT2_CHECK_REPORT));
+	ZeroMemory(&ctx, sizeof(ctx));
+
+	if (threadCount == 0)
+		threadCount = 1;
+	if (threadCount > groupCount)
+		threadCount = groupCount;
+
+	ctx.fs = fs;
+	ctx.bitmapBytes = sb_info->blocksPerGroup / 8;
+	ctx.inodeBitmapBytes = (sb_info->inodesPerGroup + 7) / 8;
+	ctx.blockMap = (BYTE *)calloc(groupCount, ctx.bitmapBytes);
+	ctx.inodeMap = (BYTE *)calloc(groupCount, ctx.inodeBitmapBytes);
+	ctx.inodeState = (BYTE *)calloc(fs->sb.inodeCount + 1, sizeof(BYTE));
+	ctx.links = (UINT16 *)calloc(fs->sb.inodeCount + 1, sizeof(UINT16));
+	ctx.refs = (UINT16 *)calloc(fs->sb.inodeCount + 1, sizeof(UINT16));
+	ctx.dirs = (UINT32 *)calloc(groupCount, sizeof(UINT32));
+	workers = (CHECK_WORKER *)calloc(threadCount, sizeof(CHECK_WORKER));
+	pthread_mutex_init(&ctx.lock, NULL);
+
+	if (ctx.blockMap == NULL || ctx.inodeMap == NULL || ctx.inodeState == NULL ||
+		ctx.links == NULL || ctx.refs == NULL || ctx.dirs == NULL || workers == NULL)
+	{
+		LOG_ERROR("error : failed to allocate check tables\n");
+		goto out;
+	}
+
+	if (mark_orphans(&ctx) != EXT2_SUCCESS)
+	{
+		LOG_ERROR("error : broken orphan list\n");
+		goto out;
+	}
+
+	for (i = 0; i < threadCount; i++)
+		workers[i].ctx = &ctx;
+
+	if (run_workers(&ctx, workers, threadCount, scan_worker) != EXT2_SUCCESS)
+		goto out;
+
+	merge_references(&ctx, workers, threadCount, report);
+
+	if (run_workers(&ctx, workers, threadCount, verify_worker) != EXT2_SUCCESS)
+		goto out;
+
+	for (i = 0; i < threadCount; i++)
+		add_report(report, &workers[i].report);
+
+	if (fs->sb.freeBlockCount != report->freeBlocks)
+		report->superErrors++;
+	if (fs->sb.freeInodeCount != report->freeInodes)
+		report->superErrors++;
+
+	report->errors = report->badBlocks + report->duplicateBlocks + report->blockCountErrors +
+		report->missingBlocks + report->leakedBlocks + report->missingInodes + report->leakedInodes +
+		report->danglingEntries + report->unreferencedInodes + report->linkCountErrors +
+		report->descErrors + report->superErrors;
+	result = EXT2_SUCCESS;
+
+out:
+	if (workers != NULL)
+	{
+		for (i = 0; i < threadCount; i++)
+		{
+			free(workers[i].crossBlocks);
+			free(workers[i].crossInodes);
+		}
+	}
+	free(workers);
+	free(ctx.blockMap);
+	free(ctx.inodeMap);
+	free(ctx.inodeState);
+	free(ctx.links);
+	free(ctx.refs);
+	free(ctx.dirs);
+	pthread_mutex_destroy(&ctx.lock);
+
+	return result;
+}
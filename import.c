@@ -0,0 +1,907 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "ext2.h"
+
+/* bulk import
+ *
+ * ext2_import copies a host directory tree into an empty file system in a
+ * single depth first pass. Inodes are handed out in order and blocks come
+ * from one cursor that only moves forward, so the blocks of a directory are
+ * followed by the data of its files, and the indirect blocks of a file sit
+ * in front of the data they map as they do for files written by ext2_write.
+ * Every block is written once : file and directory blocks are staged in
+ * large buffers that go to the disk as one request per contiguous run,
+ * several runs in flight when the disk has submit/complete. The bitmaps,
+ * inode tables, group descriptors and free counts are kept in memory and
+ * written in one batch at the end, so an import that fails before that
+ * leaves the file system empty. The journal and the lookup caches are
+ * bypassed, nothing else may use the file system while the import runs. */
+
+#define IMPORT_RUN_BYTES		(1024 * 1024)	/* largest write request */
+#define IMPORT_RUN_DEPTH		4				/* run buffers, in flight at once with submit */
+
+typedef struct import_run {
+	DISK_REQUEST	request;
+	BYTE*		data;				/* IMPORT_RUN_BYTES */
+	UINT32		block;				/* first block of the run */
+	UINT32		count;				/* blocks staged */
+} IMPORT_RUN;
+
+typedef struct import_group {
+	BYTE*		blockBitmap;		/* NULL : not loaded yet */
+	BYTE*		inodeBitmap;
+	BYTE*		inodeTable;			/* whole table, NULL : no inode taken */
+	UINT32		takenBlocks;
+	UINT32		takenInodes;
+	UINT32		usedInodes;			/* high-water mark of the table, in inodes */
+} IMPORT_GROUP;
+
+/* host entry of the directory being imported */
+typedef struct import_entry {
+	BYTE		name[MAX_ENTRY_NAME_LENGTH];	/* format_name form */
+	char*		path;
+	UINT32		inode;
+	int			isDir;
+	struct stat	st;
+} IMPORT_ENTRY;
+
+/* open chain of index blocks below i_block[top] of the inode being mapped */
+typedef struct import_map {
+	EXT2_INODE*	inode;
+	UINT32		top;				/* 0 : no chain open */
+	UINT32		depth;
+	UINT32		offsets[3];
+	UINT32		blocks[3];
+} IMPORT_MAP;
+
+typedef struct import_context {
+	EXT2_FILESYSTEM*	fs;
+	EXT2_IMPORT_REPORT*	report;
+	IMPORT_GROUP*	groups;
+	BYTE*		descs;				/* group descriptor table */
+	BYTE*		index[3];			/* index blocks of the open chain */
+	UINT32		nextBlock;			/* allocation cursors */
+	UINT32		nextInode;
+	IMPORT_RUN	runs[IMPORT_RUN_DEPTH];
+	IMPORT_RUN*	idle[IMPORT_RUN_DEPTH];
+	UINT32		idleCount;
+	UINT32		inflight;
+	IMPORT_RUN*	current;			/* run being staged, NULL : none */
+	UINT32		runBlocks;			/* blocks per run buffer */
+} IMPORT_CONTEXT;
+
+static __inline__ int test_and_set(BYTE* map, UINT32 bit)
+{
+	int old = (map[bit >> 3] >> (bit & 7)) & 1;
+
+	map[bit >> 3] |= 1 << (bit & 7);
+	return old;
+}
+
+static __inline__ EXT2_GROUP_DESC* get_desc(IMPORT_CONTEXT* ctx, UINT32 group)
+{
+	return &((EXT2_GROUP_DESC *)ctx->descs)[group];
+}
+
+/******************************************************************************/
+/* run writer                                                                 */
+/******************************************************************************/
+
+/*  û ŵ idle , wait̸ ϳ ̻   ٸ */
+static int reap_runs(IMPORT_CONTEXT* ctx, int wait)
+{
+	DISK_OPERATIONS* disk = ctx->fs->disk;
+	DISK_REQUEST* done[IMPORT_RUN_DEPTH];
+	int finished, i, result = EXT2_SUCCESS;
+
+	finished = disk->complete(disk, done, IMPORT_RUN_DEPTH, wait);
+	if (finished < 0)
+		return EXT2_ERROR;
+
+	for (i = 0; i < finished; i++)
+	{
+		if (done[i]->result < 0)
+		{
+			LOG_ERROR("error : failed to write %u sectors at sector %u\n", done[i]->count, done[i]->sector);
+			result = EXT2_ERROR;
+		}
+		ctx->idle[ctx->idleCount++] = (IMPORT_RUN *)done[i]->param;
+		ctx->inflight--;
+	}
+
+	return result;
+}
+
+/*   run   û , submit  ũ   ٷ  */
+static int flush_run(IMPORT_CONTEXT* ctx)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	DISK_OPERATIONS* disk = fs->disk;
+	IMPORT_RUN* run = ctx->current;
+	DISK_REQUEST* request;
+	UINT32 sectorsPerBlock = fs->sb_info.sectorsPerBlock;
+	UINT32 i;
+
+	ctx->current = NULL;
+	if (run == NULL)
+		return EXT2_SUCCESS;
+
+	ext2_count_io(&fs->ioStats[EXT2_OP_OTHER], 1, run->count, run->count * sectorsPerBlock);
+	ctx->report->requests++;
+
+	if (disk->submit == NULL)
+	{
+		ctx->idle[ctx->idleCount++] = run;
+		for (i = 0; i < run->count * sectorsPerBlock; i++)
+		{
+			if (disk->write_sector(disk, run->block * sectorsPerBlock + i, &run->data[i * MAX_SECTOR_SIZE]) < 0)
+			{
+				LOG_ERROR("error : failed to write block %u\n", run->block + i / sectorsPerBlock);
+				return EXT2_ERROR;
+			}
+		}
+		return EXT2_SUCCESS;
+	}
+
+	request = &run->request;
+	request->opcode = DISK_WRITE;
+	request->sector = run->block * sectorsPerBlock;
+	request->count = run->count * sectorsPerBlock;
+	request->data = run->data;
+	request->result = 0;
+	request->param = run;
+	if (disk->submit(disk, &request, 1) != 1)
+	{
+		LOG_ERROR("error : failed to submit block %u\n", run->block);
+		ctx->idle[ctx->idleCount++] = run;
+		return EXT2_ERROR;
+	}
+	ctx->inflight++;
+
+	return EXT2_SUCCESS;
+}
+
+/* block   ġ,  ϰ ̾ ʰų ۰   run  */
+static BYTE* stage_block(IMPORT_CONTEXT* ctx, UINT32 block)
+{
+	IMPORT_RUN* run = ctx->current;
+	UINT32 blockSize = ctx->fs->sb_info.blockSize;
+
+	if (run != NULL && block == run->block + run->count && run->count < ctx->runBlocks)
+		return &run->data[(size_t)run->count++ * blockSize];
+
+	if (flush_run(ctx) != EXT2_SUCCESS)
+		return NULL;
+
+	while (ctx->idleCount == 0)
+	{
+		if (reap_runs(ctx, 1) != EXT2_SUCCESS)
+			return NULL;
+	}
+
+	run = ctx->idle[--ctx->idleCount];
+	run->block = block;
+	run->count = 1;
+	ctx->current = run;
+
+	return run->data;
+}
+
+/*  run   û   ٸ */
+static int drain_runs(IMPORT_CONTEXT* ctx)
+{
+	int result = flush_run(ctx);
+
+	while (ctx->inflight > 0)
+	{
+		if (reap_runs(ctx, 1) != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+	}
+
+	return result;
+}
+
+/******************************************************************************/
+/* allocation                                                                 */
+/******************************************************************************/
+
+static int load_bitmap(IMPORT_CONTEXT* ctx, BYTE** bitmap, UINT32 block)
+{
+	if (*bitmap != NULL)
+		return EXT2_SUCCESS;
+
+	*bitmap = (BYTE *)malloc(ctx->fs->sb_info.blockSize);
+	if (*bitmap == NULL)
+	{
+		LOG_ERROR("error : failed to allocate bitmap\n");
+		return EXT2_ERROR;
+	}
+
+	return read_block(ctx->fs, block, *bitmap);
+}
+
+/* ׷ inode table ü ޸𸮿 , 0 ׷  inode ִ  о  */
+static int load_inode_table(IMPORT_CONTEXT* ctx, UINT32 group)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	IMPORT_GROUP* g = &ctx->groups[group];
+	UINT32 block, reservedBlocks;
+
+	if (g->inodeTable != NULL)
+		return EXT2_SUCCESS;
+
+	g->inodeTable = (BYTE *)calloc(sb_info->itbPerGroup, sb_info->blockSize);
+	if (g->inodeTable == NULL)
+	{
+		LOG_ERROR("error : failed to allocate inode table of group %u\n", group);
+		return EXT2_ERROR;
+	}
+
+	if (group != 0)
+		return EXT2_SUCCESS;
+
+	reservedBlocks = (sb_info->firstInode - 1 + sb_info->inodesPerBlock - 1) / sb_info->inodesPerBlock;
+	for (block = 0; block < reservedBlocks; block++)
+	{
+		if (read_block(fs, fs->groupBase[0].inodeTable + block, &g->inodeTable[(size_t)block * sb_info->blockSize]) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+	}
+	g->usedInodes = reservedBlocks * sb_info->inodesPerBlock;
+
+	return EXT2_SUCCESS;
+}
+
+static EXT2_INODE* get_table_inode(IMPORT_CONTEXT* ctx, UINT32 inodeNumber)
+{
+	UINT32 inodesPerGroup = ctx->fs->sb_info.inodesPerGroup;
+
+	return &((EXT2_INODE *)ctx->groups[(inodeNumber - 1) / inodesPerGroup].inodeTable)[(inodeNumber - 1) % inodesPerGroup];
+}
+
+/* cursor ó  free , cursor ǵư  */
+static int take_block(IMPORT_CONTEXT* ctx, UINT32* retBlk)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	UINT32 relative, group, bit;
+	IMPORT_GROUP* g;
+
+	for (; ctx->nextBlock < fs->sb.blockCount; ctx->nextBlock++)
+	{
+		relative = ctx->nextBlock - fs->sb.firstDataBlock;
+		group = relative >> fs->sb_info.blocksPerGroup_bits;
+		bit = relative & (fs->sb_info.blocksPerGroup - 1);
+		g = &ctx->groups[group];
+
+		if (load_bitmap(ctx, &g->blockBitmap, fs->groupBase[group].blockBitmap) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+
+		if ((bit & 7) == 0 && g->blockBitmap[bit >> 3] == 0xFF)
+		{	//   byte   ǳʶ
+			ctx->nextBlock += 7;
+			continue;
+		}
+
+		if (test_and_set(g->blockBitmap, bit))
+			continue;
+
+		g->takenBlocks++;
+		get_desc(ctx, group)->bg_freeBlockCount--;
+		fs->sb.freeBlockCount--;
+		fs->sb_info.freeBlockCount--;
+		*retBlk = ctx->nextBlock++;
+		return EXT2_SUCCESS;
+	}
+
+	LOG_ERROR("error : no free block left for import\n");
+	return EXT2_ERROR;
+}
+
+static int take_inode(IMPORT_CONTEXT* ctx, int isDir, UINT32* retIno)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	UINT32 group, index;
+	IMPORT_GROUP* g;
+
+	for (; ctx->nextInode <= fs->sb.inodeCount; ctx->nextInode++)
+	{
+		group = (ctx->nextInode - 1) / fs->sb_info.inodesPerGroup;
+		index = (ctx->nextInode - 1) % fs->sb_info.inodesPerGroup;
+		g = &ctx->groups[group];
+
+		if (load_bitmap(ctx, &g->inodeBitmap, fs->groupBase[group].inodeBitmap) != EXT2_SUCCESS ||
+			load_inode_table(ctx, group) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+
+		if (test_and_set(g->inodeBitmap, index))
+			continue;
+
+		g->takenInodes++;
+		g->usedInodes = MAX(g->usedInodes, index + 1);
+		get_desc(ctx, group)->bg_freeInodeCount--;
+		if (isDir)
+		{
+			get_desc(ctx, group)->bg_usedDirCount++;
+			fs->sb_info.dirCount++;
+		}
+		fs->sb.freeInodeCount--;
+		fs->sb_info.freeInodeCount--;
+		*retIno = ctx->nextInode++;
+		return EXT2_SUCCESS;
+	}
+
+	LOG_ERROR("error : no free inode left for import\n");
+	return EXT2_ERROR;
+}
+
+/******************************************************************************/
+/* block map                                                                  */
+/******************************************************************************/
+
+/*  ִ index   level ܰ Ʒ  */
+static int close_chain(IMPORT_CONTEXT* ctx, IMPORT_MAP* map, UINT32 level)
+{
+	UINT32 i;
+
+	if (map->top == 0)
+		return EXT2_SUCCESS;
+
+	for (i = level; i < map->depth; i++)
+	{
+		if (write_block(ctx->fs, map->blocks[i], ctx->index[i]) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+		ctx->report->indexBlocks++;
+	}
+	if (level == 0)
+		map->top = 0;
+
+	return EXT2_SUCCESS;
+}
+
+/* logical°  block , block 0̸ cursor Ҵ */
+/*  index    ų  ٷ տ Ҵ */
+static int map_block(IMPORT_CONTEXT* ctx, IMPORT_MAP* map, UINT32 logical, UINT32* block)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	UINT32 ptrBits = fs->sb_info.blockSize_bits + 8; //      (1KB : 2 8)
+	UINT32 ptrMask = (1 << ptrBits) - 1;
+	UINT32 offsets[3], top, depth, level, i;
+	UINT32 rest = logical - EXT2_NDIR_BLOCKS;
+
+	if (logical < EXT2_NDIR_BLOCKS)
+	{
+		if (*block == 0 && take_block(ctx, block) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+		map->inode->i_block[logical] = *block;
+		return EXT2_SUCCESS;
+	}
+
+	// get_indirect_path   
+	if (rest <= ptrMask)
+	{
+		top = EXT2_IND_BLOCK;
+		depth = 1;
+		offsets[0] = rest;
+	}
+	else if ((rest -= ptrMask + 1) < (1U << (ptrBits * 2)))
+	{
+		top = EXT2_DIND_BLOCK;
+		depth = 2;
+		offsets[0] = rest >> ptrBits;
+		offsets[1] = rest & ptrMask;
+	}
+	else
+	{
+		rest -= 1U << (ptrBits * 2);
+		top = EXT2_TIND_BLOCK;
+		depth = 3;
+		offsets[0] = rest >> (ptrBits * 2);
+		offsets[1] = (rest >> ptrBits) & ptrMask;
+		offsets[2] = rest & ptrMask;
+	}
+
+	// ΰ ó ޶ ܰ index  ٲ
+	level = 0;
+	if (top == map->top)
+	{
+		for (level = 1; level < depth && offsets[level - 1] == map->offsets[level - 1]; level++)
+			;
+	}
+
+	if (level < depth)
+	{
+		if (close_chain(ctx, map, level) != EXT2_SUCCESS)
+			return EXT2_ERROR;
+
+		for (i = level; i < depth; i++)
+		{
+			if (take_block(ctx, &map->blocks[i]) != EXT2_SUCCESS)
+				return EXT2_ERROR;
+			ZeroMemory(ctx->index[i], fs->sb_info.blockSize);
+			if (i == 0)
+				map->inode->i_block[top] = map->blocks[0];
+			else
+				((UINT32 *)ctx->index[i - 1])[offsets[i - 1]] = map->blocks[i];
+		}
+	}
+
+	if (*block == 0 && take_block(ctx, block) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+	((UINT32 *)ctx->index[depth - 1])[offsets[depth - 1]] = *block;
+
+	map->top = top;
+	map->depth = depth;
+	memcpy(map->offsets, offsets, sizeof(offsets));
+
+	return EXT2_SUCCESS;
+}
+
+/******************************************************************************/
+/* tree                                                                       */
+/******************************************************************************/
+
+static int compare_entry(const void* a, const void* b)
+{
+	return memcmp(((const IMPORT_ENTRY *)a)->name, ((const IMPORT_ENTRY *)b)->name, MAX_ENTRY_NAME_LENGTH);
+}
+
+static void set_host_inode(EXT2_INODE* inode, const struct stat* st, int isDir)
+{
+	inode->fileMode = (isDir ? FILE_TYPE_DIR : FILE_TYPE_FILE) | (st->st_mode & ACCESSED_BY_ANYONE);
+	inode->linkCount = isDir ? 2 : 1; // θ Ʈ "."
+	inode->aTime = inode->cTime = inode->mTime = (UINT32)st->st_mtime;
+}
+
+/*   ִ Ʈ ̸ , ̸ ġ   ǳʶ */
+static int read_host_dir(IMPORT_CONTEXT* ctx, const char* path, IMPORT_ENTRY** retEntries, UINT32* retCount)
+{
+	IMPORT_ENTRY* entries = NULL;
+	IMPORT_ENTRY* entry;
+	UINT32 count = 0, size = 0, i, kept;
+	char name[MAX_NAME_LENGTH];
+	size_t length;
+	struct dirent* dirent;
+	DIR* dir;
+
+	dir = opendir(path);
+	if (dir == NULL)
+	{
+		LOG_ERROR("error : cannot open host directory %s\n", path);
+		return EXT2_ERROR;
+	}
+
+	while ((dirent = readdir(dir)) != NULL)
+	{
+		if (strcmp(dirent->d_name, ".") == 0 || strcmp(dirent->d_name, "..") == 0)
+			continue;
+
+		if (count == size)
+		{
+			IMPORT_ENTRY* grown;
+
+			size = size ? size * 2 : 64;
+			grown = (IMPORT_ENTRY *)realloc(entries, size * sizeof(IMPORT_ENTRY));
+			if (grown == NULL)
+			{
+				LOG_ERROR("error : out of memory\n");
+				goto fail;
+			}
+			entries = grown;
+		}
+		entry = &entries[count];
+		ZeroMemory(entry, sizeof(IMPORT_ENTRY));
+
+		entry->path = (char *)malloc(strlen(path) + strlen(dirent->d_name) + 2);
+		if (entry->path == NULL)
+		{
+			LOG_ERROR("error : out of memory\n");
+			goto fail;
+		}
+		sprintf(entry->path, "%s/%s", path, dirent->d_name);
+
+		if (lstat(entry->path, &entry->st) != 0 || !(S_ISREG(entry->st.st_mode) || S_ISDIR(entry->st.st_mode)))
+		{
+			LOG_WARN("warning : %s skipped, not a regular file or directory\n", entry->path);
+			goto skip;
+		}
+		if (S_ISREG(entry->st.st_mode) && (UINT64)entry->st.st_size > 0xFFFFFFFFULL)
+		{
+			LOG_WARN("warning : %s skipped, larger than 4GB\n", entry->path);
+			goto skip;
+		}
+
+		length = strlen(dirent->d_name);
+		ZeroMemory(name, sizeof(name));
+		if (length < sizeof(name))
+			memcpy(name, dirent->d_name, length);
+		if (length >= sizeof(name) || name[0] == '.' || format_name(ctx->fs, name) != EXT2_SUCCESS)
+		{
+			LOG_WARN("warning : %s skipped, name does not fit the file system\n", entry->path);
+			goto skip;
+		}
+		memcpy(entry->name, name, MAX_ENTRY_NAME_LENGTH);
+		entry->isDir = S_ISDIR(entry->st.st_mode);
+		count++;
+		continue;
+
+skip:
+		free(entry->path);
+		ctx->report->skipped++;
+	}
+	closedir(dir);
+
+	if (count > 1)
+		qsort(entries, count, sizeof(IMPORT_ENTRY), compare_entry);
+
+	for (i = 0, kept = 0; i < count; i++)
+	{	// 빮ڷ ٲٸ  ̸
+		if (kept > 0 && memcmp(entries[kept - 1].name, entries[i].name, MAX_ENTRY_NAME_LENGTH) == 0)
+		{
+			LOG_WARN("warning : %s skipped, same name as %s\n", entries[i].path, entries[kept - 1].path);
+			free(entries[i].path);
+			ctx->report->skipped++;
+			continue;
+		}
+		entries[kept++] = entries[i];
+	}
+
+	*retEntries = entries;
+	*retCount = kept;
+	return EXT2_SUCCESS;
+
+fail:
+	closedir(dir);
+	for (i = 0; i < count; i++)
+		free(entries[i].path);
+	free(entries);
+	return EXT2_ERROR;
+}
+
+/*   Ҵ  run ۿ ٷ о  */
+static int import_file(IMPORT_CONTEXT* ctx, const IMPORT_ENTRY* entry)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	UINT32 blockSize = fs->sb_info.blockSize;
+	UINT32 fileSize = (UINT32)entry->st.st_size;
+	UINT32 blocks = (fileSize + blockSize - 1) / blockSize;
+	UINT32 logical, block, length, done;
+	IMPORT_MAP map;
+	EXT2_INODE* inode = get_table_inode(ctx, entry->inode);
+	BYTE* slot;
+	ssize_t n;
+	int fd;
+
+	fd = open(entry->path, O_RDONLY);
+	if (fd < 0)
+	{
+		LOG_WARN("warning : cannot open %s, imported empty\n", entry->path);
+		return EXT2_SUCCESS;
+	}
+
+	ZeroMemory(&map, sizeof(map));
+	map.inode = inode;
+	for (logical = 0; logical < blocks; logical++)
+	{
+		block = 0;
+		if (map_block(ctx, &map, logical, &block) != EXT2_SUCCESS ||
+			(slot = stage_block(ctx, block)) == NULL)
+			goto fail;
+
+		length = MIN(blockSize, fileSize - logical * blockSize);
+		for (done = 0; done < length; done += n)
+		{
+			n = read(fd, &slot[done], length - done);
+			if (n <= 0)
+				break;
+		}
+		if (done < length)
+			LOG_WARN("warning : %s is shorter than when it was listed\n", entry->path);
+		ZeroMemory(&slot[done], blockSize - done); //    κ
+		inode->blockCount++;
+	}
+	close(fd);
+
+	inode->fileSize = fileSize;
+	ctx->report->files++;
+	ctx->report->bytes += fileSize;
+	ctx->report->dataBlocks += blocks;
+
+	return close_chain(ctx, &map, 0);
+
+fail:
+	close(fd);
+	return EXT2_ERROR;
+}
+
+/* "." "..", Ʈ format create_root,  make_dir   */
+static void set_dot_entries(EXT2_DIR_ENTRY* entry, UINT32 self, UINT32 parent)
+{
+	UINT32 i;
+
+	for (i = 0; i < 2; i++)
+	{
+		entry[i].inode = i == 0 ? self : parent;
+		entry[i].dir2.fileType = EXT2_FT_DIR;
+		if (self == EXT2_ROOT_INO)
+		{
+			entry[i].dir2.nameLength = i + 1;
+			memcpy(entry[i].name, "..", i + 1);
+		}
+		else
+		{
+			memset(entry[i].name, 0x20, MAX_ENTRY_NAME_LENGTH);
+			memcpy(entry[i].name, "..", i + 1);
+		}
+	}
+}
+
+/* ͸    ,  ͸   */
+static int import_dir(IMPORT_CONTEXT* ctx, const char* path, UINT32 self, UINT32 parent)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	UINT32 blockSize = fs->sb_info.blockSize;
+	UINT32 perBlock = blockSize / sizeof(EXT2_DIR_ENTRY);
+	IMPORT_ENTRY* entries = NULL;
+	UINT32 count, blocks, logical, block, slotIndex, i, next;
+	EXT2_DIR_ENTRY* dirEntry;
+	EXT2_INODE* inode;
+	IMPORT_MAP map;
+	int result = EXT2_ERROR;
+
+	if (read_host_dir(ctx, path, &entries, &count) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	for (i = 0; i < count; i++)
+	{
+		if (take_inode(ctx, entries[i].isDir, &entries[i].inode) != EXT2_SUCCESS)
+			goto out;
+		set_host_inode(get_table_inode(ctx, entries[i].inode), &entries[i].st, entries[i].isDir);
+	}
+
+	// Ʈ   ä   Ʈ ڿ no more Ʈ
+	inode = get_table_inode(ctx, self);
+	blocks = (count + 2 + perBlock - 1) / perBlock;
+	ZeroMemory(&map, sizeof(map));
+	map.inode = inode;
+	next = 0;
+	for (logical = 0; logical < blocks; logical++)
+	{
+		block = (self == EXT2_ROOT_INO && logical == 0) ? inode->i_block[0] : 0; // Ʈ format   ״ 
+		if (map_block(ctx, &map, logical, &block) != EXT2_SUCCESS ||
+			(dirEntry = (EXT2_DIR_ENTRY *)stage_block(ctx, block)) == NULL)
+			goto out;
+		ZeroMemory(dirEntry, blockSize);
+
+		slotIndex = 0;
+		if (logical == 0)
+		{
+			set_dot_entries(dirEntry, self, parent);
+			slotIndex = 2;
+		}
+		for (; slotIndex < perBlock && next < count; slotIndex++, next++)
+		{
+			dirEntry[slotIndex].inode = entries[next].inode;
+			dirEntry[slotIndex].recordLength = sizeof(EXT2_DIR_ENTRY);
+			dirEntry[slotIndex].dir2.nameLength = MAX_ENTRY_NAME_LENGTH;
+			dirEntry[slotIndex].dir2.fileType = entries[next].isDir ? EXT2_FT_DIR : EXT2_FT_REG_FILE;
+			memcpy(dirEntry[slotIndex].name, entries[next].name, MAX_ENTRY_NAME_LENGTH);
+		}
+		if (slotIndex < perBlock)
+			dirEntry[slotIndex].dir2.fileType = EXT2_FT_NO_MORE;
+	}
+	inode->blockCount = blocks;
+	ctx->report->dataBlocks += blocks;
+	if (close_chain(ctx, &map, 0) != EXT2_SUCCESS)
+		goto out;
+
+	for (i = 0; i < count; i++)
+	{
+		if (!entries[i].isDir && import_file(ctx, &entries[i]) != EXT2_SUCCESS)
+			goto out;
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (entries[i].isDir)
+		{
+			if (import_dir(ctx, entries[i].path, entries[i].inode, self) != EXT2_SUCCESS)
+				goto out;
+			ctx->report->dirs++;
+		}
+	}
+	result = EXT2_SUCCESS;
+
+out:
+	for (i = 0; i < count; i++)
+		free(entries[i].path);
+	free(entries);
+
+	return result;
+}
+
+/******************************************************************************/
+/* ext2_import                                                                */
+/******************************************************************************/
+
+/* ׷캰 Ʈʰ inode table, ũ ̺    */
+/* block bitmap, inode bitmap, inode table پ Ƿ ׷츶 û ϳ  */
+static int write_metadata(IMPORT_CONTEXT* ctx)
+{
+	EXT2_FILESYSTEM* fs = ctx->fs;
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	EXT2_GROUP_DESC* desc;
+	IMPORT_GROUP* g;
+	UINT32 group, tableBlocks, i;
+	BYTE* slot;
+
+	for (group = 0; group < sb_info->groupCount; group++)
+	{
+		g = &ctx->groups[group];
+		desc = get_desc(ctx, group);
+
+		if (g->takenBlocks > 0)
+		{
+			if ((slot = stage_block(ctx, fs->groupBase[group].blockBitmap)) == NULL)
+				return EXT2_ERROR;
+			memcpy(slot, g->blockBitmap, sb_info->blockSize);
+			ctx->report->metaBlocks++;
+		}
+		if (g->takenInodes > 0)
+		{
+			if ((slot = stage_block(ctx, fs->groupBase[group].inodeBitmap)) == NULL)
+				return EXT2_ERROR;
+			memcpy(slot, g->inodeBitmap, sb_info->blockSize);
+			ctx->report->metaBlocks++;
+		}
+		if (g->inodeTable == NULL)
+			continue;
+
+		tableBlocks = (g->usedInodes + sb_info->inodesPerBlock - 1) / sb_info->inodesPerBlock;
+		for (i = 0; i < tableBlocks; i++)
+		{
+			if ((slot = stage_block(ctx, fs->groupBase[group].inodeTable + i)) == NULL)
+				return EXT2_ERROR;
+			memcpy(slot, &g->inodeTable[(size_t)i * sb_info->blockSize], sb_info->blockSize);
+		}
+		ctx->report->metaBlocks += tableBlocks;
+
+		// ʱȭ  inode table  ϱ ʱȭ  ǥ (init_inode_table  Ģ)
+		if (desc->bg_flags & EXT2_BG_INODE_UNINIT)
+		{
+			desc->bg_itableUnused = sb_info->inodesPerGroup - MIN(tableBlocks * sb_info->inodesPerBlock, sb_info->inodesPerGroup);
+			if (desc->bg_itableUnused == 0)
+			{
+				desc->bg_flags &= ~EXT2_BG_INODE_UNINIT;
+				desc->bg_flags |= EXT2_BG_INODE_ZEROED;
+			}
+		}
+	}
+
+	for (i = 0; i < sb_info->blocksPerDesc; i++)
+	{
+		if ((slot = stage_block(ctx, sb_info->firstDescBlock + i)) == NULL)
+			return EXT2_ERROR;
+		memcpy(slot, &ctx->descs[(size_t)i * sb_info->blockSize], sb_info->blockSize);
+		ctx->report->metaBlocks++;
+	}
+
+	if (drain_runs(ctx) != EXT2_SUCCESS)
+		return EXT2_ERROR;
+
+	return sync_super_block(fs);
+}
+
+static void release_context(IMPORT_CONTEXT* ctx)
+{
+	UINT32 i;
+
+	if (ctx->groups != NULL)
+	{
+		for (i = 0; i < ctx->fs->sb_info.groupCount; i++)
+		{
+			free(ctx->groups[i].blockBitmap);
+			free(ctx->groups[i].inodeBitmap);
+			free(ctx->groups[i].inodeTable);
+		}
+	}
+	free(ctx->groups);
+	free(ctx->descs);
+	for (i = 0; i < 3; i++)
+		free(ctx->index[i]);
+	for (i = 0; i < IMPORT_RUN_DEPTH; i++)
+		free(ctx->runs[i].data);
+}
+
+/* hostPath Ʒ ϰ ͸ root , root format    ý̾  */
+/* ̸ format_name Ģ  빮ڷ ٲ, Ģ  ʴ ̸ Ϲ /͸ ƴ  ǳʶ */
+int ext2_import(EXT2_NODE* root, const char* hostPath, EXT2_IMPORT_REPORT* report)
+{
+	EXT2_FILESYSTEM* fs = root->fs;
+	EXT2_SB_INFO* sb_info = &fs->sb_info;
+	EXT2_SUPER_BLOCK sb = fs->sb;
+	EXT2_SB_INFO saved = *sb_info;
+	IMPORT_CONTEXT ctx;
+	EXT2_INODE* inode;
+	EXT2_DIR_ENTRY* dirEntry;
+	UINT32 rootBlock, i;
+	int result = EXT2_ERROR;
+
+	ZeroMemory(report, sizeof(EXT2_IMPORT_REPORT));
+	ZeroMemory(&ctx, sizeof(ctx));
+	ctx.fs = fs;
+	ctx.report = report;
+	ctx.nextBlock = fs->sb.firstDataBlock;
+	ctx.nextInode = sb_info->firstInode;
+	ctx.runBlocks = IMPORT_RUN_BYTES / sb_info->blockSize;
+
+	if (fs->sb.inodeCount - fs->sb.freeInodeCount > sb_info->firstInode - 1)
+	{
+		LOG_ERROR("error : import needs an empty file system\n");
+		return EXT2_ERROR;
+	}
+
+	ctx.groups = (IMPORT_GROUP *)calloc(sb_info->groupCount, sizeof(IMPORT_GROUP));
+	ctx.descs = (BYTE *)malloc((size_t)sb_info->blocksPerDesc * sb_info->blockSize);
+	for (i = 0; i < 3; i++)
+		ctx.index[i] = (BYTE *)malloc(sb_info->blockSize);
+	for (i = 0; i < IMPORT_RUN_DEPTH; i++)
+	{
+		ctx.runs[i].data = (BYTE *)malloc(IMPORT_RUN_BYTES);
+		ctx.idle[ctx.idleCount++] = &ctx.runs[i];
+	}
+	for (i = 0; i < IMPORT_RUN_DEPTH && ctx.runs[i].data != NULL; i++)
+		;
+	if (ctx.groups == NULL || ctx.descs == NULL || ctx.index[0] == NULL || ctx.index[1] == NULL ||
+		ctx.index[2] == NULL || i < IMPORT_RUN_DEPTH)
+	{
+		LOG_ERROR("error : failed to allocate import buffers\n");
+		goto out;
+	}
+
+	for (i = 0; i < sb_info->blocksPerDesc; i++)
+	{
+		if (read_block(fs, sb_info->firstDescBlock + i, &ctx.descs[(size_t)i * sb_info->blockSize]) != EXT2_SUCCESS)
+			goto out;
+	}
+
+	if (load_inode_table(&ctx, 0) != EXT2_SUCCESS)
+		goto out;
+	inode = get_table_inode(&ctx, EXT2_ROOT_INO);
+	if (inode->blockCount != 1)
+	{
+		LOG_ERROR("error : import needs an empty root directory\n");
+		goto out;
+	}
+
+	rootBlock = inode->i_block[0];
+
+	if (import_dir(&ctx, hostPath, EXT2_ROOT_INO, EXT2_ROOT_INO) != EXT2_SUCCESS)
+	{	// Ʈ ù ϸ ڸ Ƿ  ͸ ǵ
+		drain_runs(&ctx);
+		dirEntry = (EXT2_DIR_ENTRY *)ctx.index[0];
+		ZeroMemory(dirEntry, sb_info->blockSize);
+		set_dot_entries(dirEntry, EXT2_ROOT_INO, EXT2_ROOT_INO);
+		dirEntry[2].dir2.fileType = EXT2_FT_NO_MORE;
+		write_block(fs, rootBlock, (BYTE *)dirEntry);
+		goto out;
+	}
+	result = write_metadata(&ctx);
+
+out:
+	release_context(&ctx);
+	if (result != EXT2_SUCCESS)
+	{	// Ÿ͸   ϸ ũ  ý   ״
+		fs->sb = sb;
+		*sb_info = saved;
+	}
+
+	// ũ  Ƿ  Ʈʰ ĳø ó ٽ 
+	init_bitmap_summary(fs);
+	init_cache(fs);
+
+	return result;
+}
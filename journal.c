@@ -0,0 +1,864 @@
+#include <stdlib.h>
+#include <memory.h>
+#include <time.h>
+#include "ext2.h"
+#include "journal.h"
+
+/*  尡    journal  credit */
+typedef struct journal_handle {
+	EXT2_JOURNAL* journal;		/* NULL :   */
+	UINT32		depth;
+	UINT32		credits;
+} JOURNAL_HANDLE;
+
+static __thread JOURNAL_HANDLE g_handle;
+
+static QWORD now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (QWORD)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static UINT32 hash_block(UINT32 block)
+{
+	return block * 2654435761U;
+}
+
+static UINT32 round_up_pow2(UINT32 number)
+{
+	UINT32 result = 1;
+
+	while (result < number)
+		result <<= 1;
+
+	return result;
+}
+
+/* journal area is addressed in file system blocks */
+static int journal_io(EXT2_JOURNAL* journal, UINT32 block, BYTE* buffer, int write)
+{
+	UINT32 sectorsPerBlock = journal->blockSize / MAX_SECTOR_SIZE;
+	SECTOR sector = (SECTOR)block * sectorsPerBlock;
+	UINT32 i;
+	int result;
+
+	for (i = 0; i < sectorsPerBlock; i++)
+	{
+		if (write)
+			result = journal->disk->write_sector(journal->disk, sector + i, &buffer[i * MAX_SECTOR_SIZE]);
+		else
+			result = journal->disk->read_sector(journal->disk, sector + i, &buffer[i * MAX_SECTOR_SIZE]);
+
+		if (result)
+		{
+			ext2_count_io(journal->ioStats, write, 0, i);
+			LOG_ERROR("error : journal failed to %s block %u\n", write ? "write" : "read", block);
+			return EXT2_ERROR;
+		}
+	}
+	ext2_count_io(journal->ioStats, write, 0, sectorsPerBlock);
+
+	return EXT2_SUCCESS;
+}
+
+static UINT32 journal_checksum(UINT32 checksum, const BYTE* data, UINT32 length)
+{
+	const UINT32* word = (const UINT32 *)data;
+	UINT32 i;
+
+	for (i = 0; i < length / sizeof(UINT32); i++)
+		checksum = ((checksum << 5) | (checksum >> 27)) + word[i];
+
+	return checksum;
+}
+
+/* set of block numbers stored as block + 1, 0 marks an empty slot */
+/* (block 0 holds the superblock when blocks are larger than 1KB) */
+static int set_insert(UINT32* set, UINT32 mask, UINT32 block)
+{
+	UINT32 slot = hash_block(block) & mask;
+
+	while (set[slot] != 0)
+	{
+		if (set[slot] == block + 1)
+			return 0;
+		slot = (slot + 1) & mask;
+	}
+	set[slot] = block + 1;
+
+	return 1;
+}
+
+static int set_contains(const UINT32* set, UINT32 mask, UINT32 block)
+{
+	UINT32 slot = hash_block(block) & mask;
+
+	while (set[slot] != 0)
+	{
+		if (set[slot] == block + 1)
+			return 1;
+		slot = (slot + 1) & mask;
+	}
+
+	return 0;
+}
+
+static int write_journal_super(EXT2_JOURNAL* journal, UINT32 sequence, UINT32 start)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	JOURNAL_SUPER_BLOCK* jsb = (JOURNAL_SUPER_BLOCK *)buffer;
+
+	ZeroMemory(buffer, sizeof(buffer));
+	jsb->header.magic = JOURNAL_MAGIC;
+	jsb->header.blockType = JOURNAL_SUPERBLOCK;
+	jsb->blockSize = journal->blockSize;
+	jsb->maxLen = journal->maxLen;
+	jsb->first = 1;
+	jsb->sequence = sequence;
+	jsb->start = start;
+
+	return journal_io(journal, journal->firstBlock, buffer, 1);
+}
+
+
+/******************************************************************************/
+/* transaction																  */
+/******************************************************************************/
+
+static JOURNAL_TRANSACTION* get_transaction(EXT2_JOURNAL* journal, UINT32 sequence)
+{
+	JOURNAL_TRANSACTION* transaction = journal->freeList;
+
+	if (transaction != NULL)
+		journal->freeList = transaction->next;
+	else
+	{
+		transaction = (JOURNAL_TRANSACTION *)calloc(1, sizeof(JOURNAL_TRANSACTION));
+		if (transaction == NULL)
+			return NULL;
+
+		transaction->blocks = (UINT32 *)malloc(journal->capacity * sizeof(UINT32));
+		transaction->hash = (INT32 *)malloc((journal->hashMask + 1) * sizeof(INT32));
+		if (transaction->blocks == NULL || transaction->hash == NULL)
+		{
+			free(transaction->blocks);
+			free(transaction->hash);
+			free(transaction);
+			return NULL;
+		}
+	}
+
+	memset(transaction->hash, 0xFF, (journal->hashMask + 1) * sizeof(INT32));
+	transaction->sequence = sequence;
+	transaction->state = JOURNAL_T_RUNNING;
+	transaction->count = 0;
+	transaction->startTime = 0;
+	transaction->next = NULL;
+
+	return transaction;
+}
+
+static void free_transaction(JOURNAL_TRANSACTION* transaction)
+{
+	free(transaction->blocks);
+	free(transaction->data);
+	free(transaction->hash);
+	free(transaction);
+}
+
+static int find_block(const EXT2_JOURNAL* journal, const JOURNAL_TRANSACTION* transaction, UINT32 block)
+{
+	UINT32 slot = hash_block(block) & journal->hashMask;
+
+	while (transaction->hash[slot] != -1)
+	{
+		if (transaction->blocks[transaction->hash[slot]] == block)
+			return transaction->hash[slot];
+		slot = (slot + 1) & journal->hashMask;
+	}
+
+	return -1;
+}
+
+static int add_block(EXT2_JOURNAL* journal, JOURNAL_TRANSACTION* transaction, UINT32 block, const BYTE* buffer)
+{
+	UINT32 slot;
+	UINT32 allocated;
+	BYTE* data;
+
+	if (transaction->count == transaction->allocated)
+	{	//  ̹  ʿ ŭ  辿 ø
+		allocated = transaction->allocated ? transaction->allocated * 2 : 16;
+		allocated = MIN(allocated, journal->capacity);
+		data = (BYTE *)realloc(transaction->data, (size_t)allocated * journal->blockSize);
+		if (data == NULL)
+			return EXT2_ERROR;
+		transaction->data = data;
+		transaction->allocated = allocated;
+	}
+
+	if (transaction->count == 0)
+	{	// background 尡 JOURNAL_COMMIT_INTERVAL ڿ commitϵ 
+		transaction->startTime = now_ms();
+		pthread_cond_signal(&journal->wake);
+	}
+
+	slot = hash_block(block) & journal->hashMask;
+	while (transaction->hash[slot] != -1)
+		slot = (slot + 1) & journal->hashMask;
+	transaction->hash[slot] = transaction->count;
+	transaction->blocks[transaction->count] = block;
+	memcpy(&transaction->data[(size_t)transaction->count * journal->blockSize], buffer, journal->blockSize);
+	transaction->count++;
+
+	return EXT2_SUCCESS;
+}
+
+
+/******************************************************************************/
+/* commit / checkpoint														  */
+/******************************************************************************/
+
+static int checkpoint_transactions(EXT2_JOURNAL* journal);
+
+/* running transaction log , journal->lock  · ȣ */
+static int commit_transaction(EXT2_JOURNAL* journal)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	JOURNAL_DESCRIPTOR* descriptor = (JOURNAL_DESCRIPTOR *)buffer;
+	JOURNAL_COMMIT* commit = (JOURNAL_COMMIT *)buffer;
+	JOURNAL_TRANSACTION* transaction;
+	JOURNAL_TRANSACTION* running;
+	UINT32 i, position, checksum = 0;
+	UINT32 blockSize = journal->blockSize;
+	int result = EXT2_SUCCESS;
+
+	while (journal->committing)
+		pthread_cond_wait(&journal->done, &journal->lock);
+
+	if (journal->running->count == 0)
+		return EXT2_SUCCESS;
+	journal->committing = 1;
+
+	// log ڸ  checkpoint log 
+	while (journal->head != 0 && journal->head + journal->running->count + 2 > journal->maxLen)
+		checkpoint_transactions(journal);
+
+	transaction = journal->running;
+	if ((running = get_transaction(journal, transaction->sequence + 1)) == NULL)
+	{
+		journal->committing = 0;
+		pthread_cond_broadcast(&journal->done);
+		LOG_ERROR("error : no memory for journal transaction\n");
+		return EXT2_ERROR;
+	}
+
+	if (journal->head == 0)
+	{	//  ִ log ù transaction
+		if (write_journal_super(journal, transaction->sequence, 1) != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+		journal->head = 1;
+	}
+
+	position = journal->head;
+	journal->head += transaction->count + 2;
+	for (i = 0; i < transaction->count; i++)
+		set_insert(journal->logged, journal->setMask, transaction->blocks[i]);
+
+	transaction->state = JOURNAL_T_COMMIT;
+	running->next = transaction;
+	journal->running = running;
+
+	// transaction   ̻ ٲ Ƿ lock  
+	pthread_mutex_unlock(&journal->lock);
+
+	ZeroMemory(buffer, sizeof(buffer));
+	descriptor->header.magic = JOURNAL_MAGIC;
+	descriptor->header.blockType = JOURNAL_DESCRIPTOR_BLOCK;
+	descriptor->header.sequence = transaction->sequence;
+	descriptor->count = transaction->count;
+	memcpy(descriptor->blocks, transaction->blocks, transaction->count * sizeof(UINT32));
+	if (journal_io(journal, journal->firstBlock + position, buffer, 1) != EXT2_SUCCESS)
+		result = EXT2_ERROR;
+
+	for (i = 0; i < transaction->count; i++)
+	{
+		if (journal_io(journal, journal->firstBlock + position + 1 + i, &transaction->data[(size_t)i * blockSize], 1) != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+		checksum = journal_checksum(checksum, &transaction->data[(size_t)i * blockSize], blockSize);
+	}
+
+	ZeroMemory(buffer, sizeof(buffer));
+	commit->header.magic = JOURNAL_MAGIC;
+	commit->header.blockType = JOURNAL_COMMIT_BLOCK;
+	commit->header.sequence = transaction->sequence;
+	commit->count = transaction->count;
+	commit->checksum = checksum;
+	if (journal_io(journal, journal->firstBlock + position + 1 + transaction->count, buffer, 1) != EXT2_SUCCESS)
+		result = EXT2_ERROR;
+
+	pthread_mutex_lock(&journal->lock);
+
+	transaction->state = JOURNAL_T_CHECKPOINT;
+	journal->committed++;
+	journal->commits++;
+	journal->committing = 0;
+
+	if (journal->head > journal->maxLen / 2) // log  Ѱ  background checkpoint
+		pthread_cond_signal(&journal->wake);
+	pthread_cond_broadcast(&journal->done);
+
+	return result;
+}
+
+/* commit transaction ڸ , journal->lock  · ȣ */
+static int checkpoint_transactions(EXT2_JOURNAL* journal)
+{
+	JOURNAL_TRANSACTION* first;
+	JOURNAL_TRANSACTION* prev;
+	JOURNAL_TRANSACTION* transaction;
+	UINT32 i, count = 0;
+	int result = EXT2_SUCCESS;
+
+	while (journal->checkpointing)
+		pthread_cond_wait(&journal->done, &journal->lock);
+
+	prev = NULL;
+	for (first = journal->running; first != NULL && first->state != JOURNAL_T_CHECKPOINT; first = first->next)
+		prev = first;
+
+	if (first != NULL)
+	{
+		journal->checkpointing = 1;
+		pthread_mutex_unlock(&journal->lock);
+
+		// ֱ transaction ϰ    ̹ ǳʶ
+		memset(journal->written, 0, (journal->setMask + 1) * sizeof(UINT32));
+		for (transaction = first; transaction != NULL; transaction = transaction->next)
+		{
+			for (i = 0; i < transaction->count; i++)
+			{
+				if (!set_insert(journal->written, journal->setMask, transaction->blocks[i]))
+					continue;
+				if (journal_io(journal, transaction->blocks[i], &transaction->data[(size_t)i * journal->blockSize], 1) != EXT2_SUCCESS)
+					result = EXT2_ERROR;
+			}
+		}
+
+		pthread_mutex_lock(&journal->lock);
+
+		//  transaction Ʈ ʿ ߰ǹǷ prev ״
+		prev->next = NULL;
+		while (first != NULL)
+		{
+			transaction = first->next;
+			first->next = journal->freeList;
+			journal->freeList = first;
+			first = transaction;
+			count++;
+		}
+		journal->committed -= count;
+		journal->checkpoints++;
+		journal->checkpointing = 0;
+	}
+
+	//  transaction  log   transaction  log 
+	if (journal->committed == 0 && journal->head != 0)
+	{
+		for (transaction = journal->running; transaction != NULL; transaction = transaction->next)
+		{
+			if (transaction->state == JOURNAL_T_COMMIT)
+				break;
+		}
+
+		if (transaction == NULL)
+		{
+			if (write_journal_super(journal, journal->running->sequence, 0) != EXT2_SUCCESS)
+				result = EXT2_ERROR;
+			journal->head = 0;
+			memset(journal->logged, 0, (journal->setMask + 1) * sizeof(UINT32));
+		}
+	}
+
+	pthread_cond_broadcast(&journal->done);
+
+	return result;
+}
+
+/* log  Ѱ  checkpoint, running transaction JOURNAL_COMMIT_INTERVAL Ǹ commit */
+/*     interval ȿ log ϵǵ */
+static void* checkpoint_thread(void* arg)
+{
+	EXT2_JOURNAL* journal = (EXT2_JOURNAL *)arg;
+	struct timespec until;
+	QWORD age, delay;
+
+	pthread_mutex_lock(&journal->lock);
+	while (!journal->stop)
+	{
+		if (journal->committed > 0 && journal->head > journal->maxLen / 2)
+		{
+			checkpoint_transactions(journal);
+			continue;
+		}
+		if (journal->running->count == 0 || journal->commitPending)
+		{	// ù  ų ̷ commit  ٽ 
+			pthread_cond_wait(&journal->wake, &journal->lock);
+			continue;
+		}
+
+		age = now_ms() - journal->running->startTime;
+		delay = age < JOURNAL_COMMIT_INTERVAL ? JOURNAL_COMMIT_INTERVAL - age : 0;
+		if (delay == 0)
+		{
+			if (journal->updates != 0)
+				journal->commitPending = 1; //  journal_end commit
+			else if (commit_transaction(journal) != EXT2_SUCCESS)
+				delay = JOURNAL_COMMIT_INTERVAL; // ϸ ٷ ٽ õ 
+		}
+		if (delay != 0)
+		{
+			clock_gettime(CLOCK_REALTIME, &until);
+			until.tv_sec += delay / 1000;
+			until.tv_nsec += (delay % 1000) * 1000000;
+			if (until.tv_nsec >= 1000000000)
+			{
+				until.tv_sec++;
+				until.tv_nsec -= 1000000000;
+			}
+			pthread_cond_timedwait(&journal->wake, &journal->lock, &until);
+		}
+	}
+	pthread_mutex_unlock(&journal->lock);
+
+	return NULL;
+}
+
+
+/******************************************************************************/
+/* replay																	  */
+/******************************************************************************/
+
+/* start commit ϱ  ϵ transaction ڸ ٽ  */
+static int replay_journal(EXT2_JOURNAL* journal, const JOURNAL_SUPER_BLOCK* jsb, UINT32* retSequence)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	JOURNAL_DESCRIPTOR* descriptor = (JOURNAL_DESCRIPTOR *)buffer;
+	JOURNAL_COMMIT* commit = (JOURNAL_COMMIT *)buffer;
+	UINT32 blocks[EXT2_MAX_BLOCK_SIZE / sizeof(UINT32)];
+	UINT32 blockSize = journal->blockSize;
+	UINT32 position = jsb->start;
+	UINT32 sequence = jsb->sequence;
+	UINT32 i, count, checksum;
+	BYTE* data;
+
+	if ((data = (BYTE *)malloc((size_t)journal->capacity * blockSize)) == NULL)
+		return EXT2_ERROR;
+
+	while (position + 1 < journal->maxLen)
+	{
+		if (journal_io(journal, journal->firstBlock + position, buffer, 0) != EXT2_SUCCESS)
+			break;
+		if (descriptor->header.magic != JOURNAL_MAGIC || descriptor->header.blockType != JOURNAL_DESCRIPTOR_BLOCK ||
+			descriptor->header.sequence != sequence || descriptor->count == 0 || descriptor->count > journal->capacity ||
+			position + descriptor->count + 1 >= journal->maxLen)
+			break;
+
+		count = descriptor->count;
+		memcpy(blocks, descriptor->blocks, count * sizeof(UINT32));
+
+		checksum = 0;
+		for (i = 0; i < count; i++)
+		{
+			if (journal_io(journal, journal->firstBlock + position + 1 + i, &data[(size_t)i * blockSize], 0) != EXT2_SUCCESS)
+				break;
+			checksum = journal_checksum(checksum, &data[(size_t)i * blockSize], blockSize);
+		}
+		if (i < count)
+			break;
+
+		if (journal_io(journal, journal->firstBlock + position + 1 + count, buffer, 0) != EXT2_SUCCESS)
+			break;
+		if (commit->header.magic != JOURNAL_MAGIC || commit->header.blockType != JOURNAL_COMMIT_BLOCK ||
+			commit->header.sequence != sequence || commit->count != count || commit->checksum != checksum)
+			break; // commit ϱ ϵ  transaction
+
+		for (i = 0; i < count; i++)
+			journal_io(journal, blocks[i], &data[(size_t)i * blockSize], 1);
+
+		journal->replayed++;
+		position += count + 2;
+		sequence++;
+	}
+
+	free(data);
+	*retSequence = sequence;
+
+	return EXT2_SUCCESS;
+}
+
+
+/******************************************************************************/
+/* interface																  */
+/******************************************************************************/
+
+/*  ִ journal  ʱȭ */
+int journal_format(DISK_OPERATIONS* disk, UINT32 blockSize, UINT32 firstBlock, UINT32 blocks)
+{
+	EXT2_JOURNAL journal;
+
+	if (blocks < JOURNAL_MIN_BLOCKS)
+	{
+		LOG_ERROR("error : journal needs at least %u blocks\n", JOURNAL_MIN_BLOCKS);
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(&journal, sizeof(journal));
+	journal.disk = disk;
+	journal.blockSize = blockSize;
+	journal.firstBlock = firstBlock;
+	journal.maxLen = blocks;
+
+	return write_journal_super(&journal, 1, 0);
+}
+
+/* journal  а  ִ transaction replay  checkpoint   */
+int journal_load(DISK_OPERATIONS* disk, UINT32 blockSize, UINT32 firstBlock, UINT32 blocks, EXT2_JOURNAL** retJournal)
+{
+	BYTE buffer[EXT2_MAX_BLOCK_SIZE];
+	JOURNAL_SUPER_BLOCK jsb;
+	EXT2_JOURNAL* journal;
+	UINT32 sequence;
+
+	if ((journal = (EXT2_JOURNAL *)calloc(1, sizeof(EXT2_JOURNAL))) == NULL)
+		return EXT2_ERROR;
+
+	journal->disk = disk;
+	journal->blockSize = blockSize;
+	journal->firstBlock = firstBlock;
+
+	if (journal_io(journal, firstBlock, buffer, 0) != EXT2_SUCCESS)
+		goto fail;
+	memcpy(&jsb, buffer, sizeof(jsb));
+
+	if (jsb.header.magic != JOURNAL_MAGIC || jsb.header.blockType != JOURNAL_SUPERBLOCK ||
+		jsb.blockSize != blockSize || jsb.maxLen < JOURNAL_MIN_BLOCKS || jsb.maxLen > blocks)
+	{
+		LOG_ERROR("error : invalid journal superblock\n");
+		goto fail;
+	}
+
+	journal->maxLen = jsb.maxLen;
+	journal->capacity = MIN((blockSize - sizeof(JOURNAL_DESCRIPTOR)) / sizeof(UINT32), jsb.maxLen - 3);
+	journal->hashMask = round_up_pow2(journal->capacity * 2) - 1;
+	journal->setMask = round_up_pow2(journal->maxLen * 2) - 1;
+	journal->logged = (UINT32 *)calloc(journal->setMask + 1, sizeof(UINT32));
+	journal->written = (UINT32 *)calloc(journal->setMask + 1, sizeof(UINT32));
+	if (journal->logged == NULL || journal->written == NULL)
+		goto fail;
+
+	sequence = jsb.sequence;
+	if (jsb.start != 0)
+	{	//  umount 
+		if (replay_journal(journal, &jsb, &sequence) != EXT2_SUCCESS ||
+			write_journal_super(journal, sequence, 0) != EXT2_SUCCESS)
+		{
+			LOG_ERROR("error : failed to replay journal\n");
+			goto fail;
+		}
+		LOG_INFO("journal : replayed %u transactions\n", journal->replayed);
+	}
+
+	if ((journal->running = get_transaction(journal, sequence)) == NULL)
+		goto fail;
+
+	pthread_mutex_init(&journal->lock, NULL);
+	pthread_cond_init(&journal->wake, NULL);
+	pthread_cond_init(&journal->done, NULL);
+	if (pthread_create(&journal->thread, NULL, checkpoint_thread, journal) != 0)
+	{
+		pthread_mutex_destroy(&journal->lock);
+		pthread_cond_destroy(&journal->wake);
+		pthread_cond_destroy(&journal->done);
+		goto fail;
+	}
+
+	*retJournal = journal;
+
+	return EXT2_SUCCESS;
+
+fail:
+	if (journal->running != NULL)
+		free_transaction(journal->running);
+	free(journal->logged);
+	free(journal->written);
+	free(journal);
+
+	return EXT2_ERROR;
+}
+
+/*  commit, checkpoint   journal  */
+void journal_release(EXT2_JOURNAL* journal)
+{
+	JOURNAL_TRANSACTION* transaction;
+
+	journal_flush(journal);
+
+	pthread_mutex_lock(&journal->lock);
+	journal->stop = 1;
+	pthread_cond_signal(&journal->wake);
+	pthread_mutex_unlock(&journal->lock);
+	pthread_join(journal->thread, NULL);
+
+	while ((transaction = journal->running) != NULL)
+	{
+		journal->running = transaction->next;
+		free_transaction(transaction);
+	}
+	while ((transaction = journal->freeList) != NULL)
+	{
+		journal->freeList = transaction->next;
+		free_transaction(transaction);
+	}
+
+	pthread_mutex_destroy(&journal->lock);
+	pthread_cond_destroy(&journal->wake);
+	pthread_cond_destroy(&journal->done);
+	free(journal->logged);
+	free(journal->written);
+	free(journal);
+}
+
+/*    ȣ, Ǿų   transaction ⼭ commit */
+/*  ߿ commit Ƿ     transaction  */
+/* ٸ    ̸ commit ̷  journal_end  */
+/* commit ̷ ִ ȿ    ʾ Ⱑ  ͵ commit и  */
+/* credits :   running transaction  ߰  ִ  , transaction ڸ   ٸ */
+int journal_begin(EXT2_JOURNAL* journal, UINT32 credits)
+{
+	JOURNAL_TRANSACTION* running;
+	int result = EXT2_SUCCESS;
+
+	credits = MIN(credits, journal->capacity);
+
+	pthread_mutex_lock(&journal->lock);
+	if (g_handle.journal == journal)
+	{	//    ٸ ʰ  ڸŭ  
+		credits = MIN(credits, journal->capacity - journal->running->count - journal->reserved);
+		g_handle.depth++;
+		g_handle.credits += credits;
+		journal->reserved += credits;
+		journal->updates++;
+		pthread_mutex_unlock(&journal->lock);
+		return EXT2_SUCCESS;
+	}
+
+	running = journal->running;
+	if (running->count >= journal->capacity - journal->capacity / 4 ||
+		(running->count != 0 && now_ms() - running->startTime >= JOURNAL_COMMIT_INTERVAL))
+	{
+		if (journal->updates == 0)
+			result = commit_transaction(journal);
+		else
+			journal->commitPending = 1;
+	}
+
+	// ̷ commit ְų     ڸ  ġ     commit ٸ
+	while (result == EXT2_SUCCESS &&
+		(journal->commitPending || journal->running->count + journal->reserved + credits > journal->capacity))
+	{
+		if (journal->updates == 0)
+		{
+			journal->commitPending = 0;
+			result = commit_transaction(journal);
+		}
+		else
+		{
+			journal->commitPending = 1;
+			pthread_cond_wait(&journal->done, &journal->lock);
+		}
+	}
+	if (result != EXT2_SUCCESS) //  transaction  ,  ڸ ް ġ  
+		credits = MIN(credits, journal->capacity - journal->running->count - journal->reserved);
+
+	g_handle.journal = journal;
+	g_handle.depth = 1;
+	g_handle.credits = credits;
+	journal->reserved += credits;
+	journal->updates++;
+	pthread_mutex_unlock(&journal->lock);
+
+	return result;
+}
+
+/*   credit credits   running transaction  ڸ   */
+/* commit ٸ     ,   commit   ʵ */
+/* return : EXT2_ERROR ڸ ,  ϰ    ٽ ؾ  */
+int journal_extend(EXT2_JOURNAL* journal, UINT32 credits)
+{
+	int result = EXT2_SUCCESS;
+
+	if (g_handle.journal != journal || g_handle.credits >= credits)
+		return EXT2_SUCCESS;
+
+	credits = MIN(credits, journal->capacity) - g_handle.credits;
+	pthread_mutex_lock(&journal->lock);
+	if (!journal->commitPending && journal->running->count + journal->reserved + credits <= journal->capacity)
+	{
+		g_handle.credits += credits;
+		journal->reserved += credits;
+	}
+	else
+		result = EXT2_ERROR;
+	pthread_mutex_unlock(&journal->lock);
+
+	return result;
+}
+
+/*   ȣ,   credit  */
+int journal_end(EXT2_JOURNAL* journal)
+{
+	int result = EXT2_SUCCESS;
+
+	pthread_mutex_lock(&journal->lock);
+	if (g_handle.journal == journal && --g_handle.depth == 0)
+	{
+		journal->reserved -= g_handle.credits;
+		g_handle.journal = NULL;
+		g_handle.credits = 0;
+	}
+	if (--journal->updates == 0 && journal->commitPending)
+	{
+		journal->commitPending = 0;
+		result = commit_transaction(journal);
+	}
+	pthread_mutex_unlock(&journal->lock);
+
+	return result;
+}
+
+/*  ڸ ϵ  ̸ journal ̹  */
+/* return : 1 journal , 0 ũ о  */
+int journal_read_block(EXT2_JOURNAL* journal, UINT32 block, BYTE* buffer)
+{
+	JOURNAL_TRANSACTION* transaction;
+	int index;
+
+	pthread_mutex_lock(&journal->lock);
+	for (transaction = journal->running; transaction != NULL; transaction = transaction->next)
+	{
+		if ((index = find_block(journal, transaction, block)) >= 0)
+		{
+			memcpy(buffer, &transaction->data[(size_t)index * journal->blockSize], journal->blockSize);
+			pthread_mutex_unlock(&journal->lock);
+			return 1;
+		}
+
+		if (transaction == journal->running && !set_contains(journal->logged, journal->setMask, block))
+			break; // log  
+	}
+	pthread_mutex_unlock(&journal->lock);
+
+	return 0;
+}
+
+/* Ÿ  running transaction  */
+/*  ϵ log ̹   replay  ʵ journal ħ */
+/*  ߰ϴ     credit ,  ̸   ڸ  */
+/* return : 1 journal , 0 ũ   , -1 transaction ڸ ų ޸  ( ) */
+int journal_write_block(EXT2_JOURNAL* journal, UINT32 block, const BYTE* buffer, int metadata)
+{
+	JOURNAL_TRANSACTION* running;
+	int index, credit;
+
+	pthread_mutex_lock(&journal->lock);
+	running = journal->running;
+	index = find_block(journal, running, block);
+
+	if (index < 0 && !metadata && !set_contains(journal->logged, journal->setMask, block))
+	{
+		pthread_mutex_unlock(&journal->lock);
+		return 0;
+	}
+
+	if (index >= 0)
+	{
+		memcpy(&running->data[(size_t)index * journal->blockSize], buffer, journal->blockSize);
+		pthread_mutex_unlock(&journal->lock);
+		return 1;
+	}
+
+	credit = g_handle.journal == journal && g_handle.credits > 0;
+	if (!credit && running->count + journal->reserved >= journal->capacity)
+	{
+		if (journal->updates != 0)
+		{	//   commitϸ  Ϻθ commitǹǷ з ˸
+			pthread_mutex_unlock(&journal->lock);
+			LOG_ERROR("error : journal transaction is full\n");
+			return -1;
+		}
+
+		//     running transaction   ϰǾ 
+		commit_transaction(journal);
+		running = journal->running;
+		index = find_block(journal, running, block);
+		if (index < 0 && running->count + journal->reserved >= journal->capacity)
+		{
+			pthread_mutex_unlock(&journal->lock);
+			LOG_ERROR("error : journal transaction is full\n");
+			return -1;
+		}
+	}
+
+	if (index >= 0)
+		memcpy(&running->data[(size_t)index * journal->blockSize], buffer, journal->blockSize);
+	else if (add_block(journal, running, block, buffer) != EXT2_SUCCESS)
+	{
+		pthread_mutex_unlock(&journal->lock);
+		LOG_ERROR("error : no memory for journal block\n");
+		return -1;
+	}
+	else if (credit)
+	{
+		g_handle.credits--;
+		journal->reserved--;
+	}
+	pthread_mutex_unlock(&journal->lock);
+
+	return 1;
+}
+
+int journal_commit(EXT2_JOURNAL* journal)
+{
+	int result;
+
+	pthread_mutex_lock(&journal->lock);
+	result = commit_transaction(journal);
+	pthread_mutex_unlock(&journal->lock);
+
+	return result;
+}
+
+/* running transaction commitϰ log   checkpoint */
+int journal_flush(EXT2_JOURNAL* journal)
+{
+	int result;
+
+	pthread_mutex_lock(&journal->lock);
+	result = commit_transaction(journal);
+	while (journal->committed > 0 || journal->head != 0)
+	{
+		if (journal->committed == 0 && journal->committing)
+		{	// ٸ commit ⸦ ٸ
+			pthread_cond_wait(&journal->done, &journal->lock);
+			continue;
+		}
+		if (checkpoint_transactions(journal) != EXT2_SUCCESS)
+			result = EXT2_ERROR;
+	}
+	pthread_mutex_unlock(&journal->lock);
+
+	return result;
+}
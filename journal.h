@@ -0,0 +1,127 @@
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+#include <pthread.h>
+#include "common.h"
+#include "disk.h"
+
+/* metadata write-ahead journal
+ *
+ * Metadata blocks written by many operations are gathered in one running
+ * transaction. A commit writes them sequentially into the journal area as
+ * a descriptor block, the block images and a commit block, then a
+ * background thread checkpoints them to their home locations. The same
+ * thread commits a running transaction once it is JOURNAL_COMMIT_INTERVAL
+ * old, so changes reach the log even when no further operation comes. Until a
+ * block is checkpointed, reads of it are served from the transaction.
+ *
+ * Each operation reserves credits, the number of new blocks it may add to
+ * the running transaction, when it begins. An operation is only admitted
+ * when its credits fit, so a transaction never has to be committed in the
+ * middle of an operation. An operation that needs more calls journal_extend
+ * and, if the transaction has no room left, ends and begins again at a
+ * point where its changes are complete. While a commit waits for running
+ * operations to end, journal_begin holds back new ones. */
+
+#define EXT2_JOURNAL_INO			8		/* reserved inode of the journal file */
+#define JOURNAL_MIN_BLOCKS			16
+
+#define JOURNAL_MAGIC				0xC03B3998
+#define JOURNAL_DESCRIPTOR_BLOCK	1
+#define JOURNAL_COMMIT_BLOCK		2
+#define JOURNAL_SUPERBLOCK			4
+
+#define JOURNAL_COMMIT_INTERVAL		5000	/* ms a running transaction may stay open */
+
+typedef struct journal_header {
+	UINT32		magic;
+	UINT32		blockType;
+	UINT32		sequence;
+} JOURNAL_HEADER;
+
+/* journal block 0 */
+typedef struct journal_super_block {
+	JOURNAL_HEADER header;
+	UINT32		blockSize;
+	UINT32		maxLen;			/* journal length in blocks */
+	UINT32		first;			/* first log block */
+	UINT32		sequence;		/* sequence of the first transaction in the log */
+	UINT32		start;			/* log block of the first transaction, 0 : nothing to replay */
+} JOURNAL_SUPER_BLOCK;
+
+typedef struct journal_descriptor {
+	JOURNAL_HEADER header;
+	UINT32		count;			/* number of block images following */
+	UINT32		blocks[];		/* home block number of each image */
+} JOURNAL_DESCRIPTOR;
+
+typedef struct journal_commit {
+	JOURNAL_HEADER header;
+	UINT32		count;
+	UINT32		checksum;		/* checksum of the block images */
+} JOURNAL_COMMIT;
+
+/* transaction states */
+#define JOURNAL_T_RUNNING			0	/* accepting blocks */
+#define JOURNAL_T_COMMIT			1	/* being written to the log */
+#define JOURNAL_T_CHECKPOINT		2	/* in the log, not yet at home */
+
+typedef struct journal_transaction {
+	UINT32		sequence;
+	UINT32		state;
+	UINT32		count;			/* number of blocks */
+	UINT32		allocated;		/* number of block images data can hold */
+	UINT32*		blocks;			/* home block numbers */
+	BYTE*		data;			/* block images */
+	INT32*		hash;			/* home block -> index, -1 : empty */
+	QWORD		startTime;		/* ms when the first block was added */
+	struct journal_transaction* next;	/* older transaction */
+} JOURNAL_TRANSACTION;
+
+typedef struct ext2_journal {
+	DISK_OPERATIONS* disk;
+	struct ext2_io_stats* ioStats;	/* counts I/O done outside of an operation, NULL : not counted */
+	UINT32		firstBlock;		/* file system block of journal block 0 */
+	UINT32		blockSize;
+	UINT32		maxLen;
+	UINT32		capacity;		/* blocks per transaction */
+	UINT32		hashMask;
+	UINT32		head;			/* next free log block, 0 : log is empty */
+	UINT32		committed;		/* transactions in the log not yet checkpointed */
+	UINT32		committing;
+	UINT32		checkpointing;
+	UINT32		stop;
+	UINT32		updates;		/* operations between journal_begin and journal_end */
+	UINT32		reserved;		/* blocks reserved by running operations and not yet used */
+	UINT32		commitPending;	/* commit deferred until the running operations end, new ones wait */
+
+	JOURNAL_TRANSACTION* running;	/* newest transaction, older ones follow */
+	JOURNAL_TRANSACTION* freeList;
+
+	UINT32*		logged;			/* home blocks written to the log since it was last empty */
+	UINT32*		written;		/* home blocks written by the current checkpoint */
+	UINT32		setMask;
+
+	pthread_mutex_t lock;
+	pthread_cond_t wake;		/* background thread has work : a log to checkpoint or a transaction to time */
+	pthread_cond_t done;		/* commit or checkpoint finished */
+	pthread_t	thread;
+
+	UINT32		commits;
+	UINT32		checkpoints;
+	UINT32		replayed;
+} EXT2_JOURNAL;
+
+int journal_format(DISK_OPERATIONS* disk, UINT32 blockSize, UINT32 firstBlock, UINT32 blocks);
+int journal_load(DISK_OPERATIONS* disk, UINT32 blockSize, UINT32 firstBlock, UINT32 blocks, EXT2_JOURNAL** retJournal);
+void journal_release(EXT2_JOURNAL* journal);
+
+int journal_begin(EXT2_JOURNAL* journal, UINT32 credits);
+int journal_extend(EXT2_JOURNAL* journal, UINT32 credits);
+int journal_end(EXT2_JOURNAL* journal);
+int journal_read_block(EXT2_JOURNAL* journal, UINT32 block, BYTE* buffer);
+int journal_write_block(EXT2_JOURNAL* journal, UINT32 block, const BYTE* buffer, int metadata);
+int journal_commit(EXT2_JOURNAL* journal);
+int journal_flush(EXT2_JOURNAL* journal);
+
+#endif
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ext2.h"
+
+/* latency histograms of the top-level operations
+ *
+ * Every thread records into its own set of histograms, one per operation,
+ * so recording never touches a cache line another thread writes. The sets
+ * are kept in a global list and merged when the statistics are read. The
+ * set of an exited thread stays in the list with its counts and is taken
+ * over by the next new thread, so short lived workers do not grow it.
+ *
+ * Buckets are log-linear like HdrHistogram : values below
+ * LATENCY_SUB_BUCKETS ns have a bucket each, above that every power of two
+ * is split into LATENCY_SUB_BUCKETS buckets, which keeps the relative
+ * error of a reported percentile under 1 / LATENCY_SUB_BUCKETS. */
+
+#define LATENCY_SUB_BITS		5
+#define LATENCY_SUB_BUCKETS		(1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_MAGNITUDE	40		/* 2^41 ns, about 36 minutes, larger values go to the last bucket */
+#define LATENCY_BUCKETS			((LATENCY_MAX_MAGNITUDE - LATENCY_SUB_BITS + 2) * LATENCY_SUB_BUCKETS)
+
+typedef struct latency_set {
+	UINT64		counts[EXT2_OP_COUNT][LATENCY_BUCKETS];
+	UINT64		total[EXT2_OP_COUNT];	/* sum of the values, for the mean */
+	UINT64		max[EXT2_OP_COUNT];
+	int			used;					/* owned by a running thread */
+	struct latency_set* next;
+} LATENCY_SET;
+
+static LATENCY_SET*		g_latencySets;
+static pthread_mutex_t	g_latencyLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t	g_latencyKey;
+static pthread_once_t	g_latencyOnce = PTHREAD_ONCE_INIT;
+static __thread LATENCY_SET* g_latencySet;
+
+/* 尡   尡 ̾  ݳ,   ״  */
+static void release_set(void* arg)
+{
+	LATENCY_SET* set = (LATENCY_SET *)arg;
+
+	pthread_mutex_lock(&g_latencyLock);
+	set->used = 0;
+	pthread_mutex_unlock(&g_latencyLock);
+}
+
+static void create_key(void)
+{
+	pthread_key_create(&g_latencyKey, release_set);
+}
+
+/*   ׷, ó   ݳ  ų  Ҵ */
+static LATENCY_SET* get_set(void)
+{
+	LATENCY_SET* set;
+
+	if (g_latencySet != NULL)
+		return g_latencySet;
+
+	pthread_once(&g_latencyOnce, create_key);
+	pthread_mutex_lock(&g_latencyLock);
+	for (set = g_latencySets; set != NULL && set->used; set = set->next)
+		;
+	if (set == NULL)
+	{
+		set = (LATENCY_SET *)calloc(1, sizeof(LATENCY_SET));
+		if (set != NULL)
+		{
+			set->next = g_latencySets;
+			g_latencySets = set;
+		}
+	}
+	if (set != NULL)
+		set->used = 1;
+	pthread_mutex_unlock(&g_latencyLock);
+
+	if (set != NULL)
+	{
+		pthread_setspecific(g_latencyKey, set);
+		g_latencySet = set;
+	}
+
+	return set;
+}
+
+static UINT32 bucket_of(UINT64 value)
+{
+	UINT32 magnitude;
+
+	if (value < LATENCY_SUB_BUCKETS)
+		return (UINT32)value;
+
+	magnitude = 63 - __builtin_clzll(value);
+	if (magnitude > LATENCY_MAX_MAGNITUDE)
+		return LATENCY_BUCKETS - 1;
+
+	return (magnitude - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS +
+		(UINT32)((value >> (magnitude - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/* Ŷ   ߰ */
+static UINT64 value_of(UINT32 bucket)
+{
+	UINT32 magnitude;
+	UINT64 low;
+
+	if (bucket < LATENCY_SUB_BUCKETS)
+		return bucket;
+
+	magnitude = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+	low = (UINT64)(LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS) << (magnitude - LATENCY_SUB_BITS);
+
+	return low + ((1ULL << (magnitude - LATENCY_SUB_BITS)) >> 1);
+}
+
+/* ٸ 尡 ġ ߿   ֵ relaxed atomic ,   ϳ */
+void ext2_latency_record(int op, UINT64 nanoseconds)
+{
+	LATENCY_SET* set = get_set();
+
+	if (set == NULL || op < 0 || op >= EXT2_OP_COUNT)
+		return;
+
+	__atomic_add_fetch(&set->counts[op][bucket_of(nanoseconds)], 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&set->total[op], nanoseconds, __ATOMIC_RELAXED);
+	if (nanoseconds > __atomic_load_n(&set->max[op], __ATOMIC_RELAXED))
+		__atomic_store_n(&set->max[op], nanoseconds, __ATOMIC_RELAXED);
+}
+
+/*   ׷   ,  ns */
+void ext2_latency_stats(int op, EXT2_LATENCY_STATS* stats)
+{
+	static const UINT32 permille[] = { 500, 900, 990, 999 };
+	UINT64* counts;
+	UINT64* targets[4];
+	UINT64 total = 0, seen = 0, rank;
+	LATENCY_SET* set;
+	UINT32 i, next = 0;
+
+	ZeroMemory(stats, sizeof(EXT2_LATENCY_STATS));
+	if (op < 0 || op >= EXT2_OP_COUNT)
+		return;
+
+	counts = (UINT64 *)calloc(LATENCY_BUCKETS, sizeof(UINT64));
+	if (counts == NULL)
+		return;
+
+	pthread_mutex_lock(&g_latencyLock);
+	for (set = g_latencySets; set != NULL; set = set->next)
+	{
+		for (i = 0; i < LATENCY_BUCKETS; i++)
+			counts[i] += __atomic_load_n(&set->counts[op][i], __ATOMIC_RELAXED);
+		total += __atomic_load_n(&set->total[op], __ATOMIC_RELAXED);
+		if (__atomic_load_n(&set->max[op], __ATOMIC_RELAXED) > stats->max)
+			stats->max = __atomic_load_n(&set->max[op], __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&g_latencyLock);
+
+	for (i = 0; i < LATENCY_BUCKETS; i++)
+		stats->count += counts[i];
+
+	targets[0] = &stats->p50;
+	targets[1] = &stats->p90;
+	targets[2] = &stats->p99;
+	targets[3] = &stats->p999;
+
+	if (stats->count != 0)
+	{
+		stats->mean = total / stats->count;
+		for (i = 0; i < LATENCY_BUCKETS && next < 4; i++)
+		{
+			seen += counts[i];
+			// nearest rank :  count * p ° ̻ Ǵ ù Ŷ
+			while (next < 4)
+			{
+				rank = (stats->count * permille[next] + 999) / 1000;
+				if (seen < (rank ? rank : 1))
+					break;
+				*targets[next++] = value_of(i) < stats->max ? value_of(i) : stats->max;
+			}
+		}
+	}
+
+	free(counts);
+}
+
+void ext2_latency_reset(void)
+{
+	LATENCY_SET* set;
+	int op;
+	UINT32 i;
+
+	pthread_mutex_lock(&g_latencyLock);
+	for (set = g_latencySets; set != NULL; set = set->next)
+	{
+		for (op = 0; op < EXT2_OP_COUNT; op++)
+		{
+			for (i = 0; i < LATENCY_BUCKETS; i++)
+				__atomic_store_n(&set->counts[op][i], 0, __ATOMIC_RELAXED);
+			__atomic_store_n(&set->total[op], 0, __ATOMIC_RELAXED);
+			__atomic_store_n(&set->max[op], 0, __ATOMIC_RELAXED);
+		}
+	}
+	pthread_mutex_unlock(&g_latencyLock);
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ext2.h"
+#include "disk.h"
+#include "diskfile.h"
+
+/* image builder : formats a disk image file and copies a host directory
+ * tree into it with ext2_import, then prints one "key=value" line. The
+ * image is formatted with lazy inode tables and sparse superblocks so that
+ * the format itself writes as little as possible; the import writes the
+ * inode tables it fills. -c runs the consistency checker on the result. */
+
+#define MKIMAGE_SECTOR_SIZE		512
+#define MKIMAGE_DEFAULT_MB		64
+
+typedef struct
+{
+	EXT2_FORMAT_OPTION	format;
+	unsigned int	megaBytes;
+	int		check;
+	const char*	imagePath;
+	const char*	hostPath;
+} MKIMAGE_OPTIONS;
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( double )ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void usage( void )
+{
+	printf( "usage : mkimage [-b 1024|2048|4096] [-m megabytes] [-j journal_blocks] [-t threads] [-c] image directory\n"
+		"  -b size     block size, default : 1024\n"
+		"  -m mb       image size, default : %d\n"
+		"  -j blocks   metadata journal size, default : no journal\n"
+		"  -t threads  threads formatting the block groups\n"
+		"  -c          check the file system after the import\n", MKIMAGE_DEFAULT_MB );
+}
+
+static int parse_options( int argc, char* argv[], MKIMAGE_OPTIONS* options )
+{
+	int opt;
+
+	memset( options, 0, sizeof( MKIMAGE_OPTIONS ) );
+	options->megaBytes = MKIMAGE_DEFAULT_MB;
+	options->format.lazyItableInit = 1;
+	options->format.sparseSuper = 1;
+
+	while( ( opt = getopt( argc, argv, "b:m:j:t:c" ) ) != -1 )
+	{
+		switch( opt )
+		{
+		case 'b':
+			switch( atoi( optarg ) )
+			{
+			case 1024:	options->format.logBlockSize = 0;	break;
+			case 2048:	options->format.logBlockSize = 1;	break;
+			case 4096:	options->format.logBlockSize = 2;	break;
+			default:
+				printf( "error : block size must be 1024, 2048 or 4096\n" );
+				return -1;
+			}
+			break;
+		case 'm':
+			options->megaBytes = ( unsigned int )atoi( optarg );
+			if( options->megaBytes == 0 || options->megaBytes > 0xFFFFFFFFU / ( 1024 * 1024 / MKIMAGE_SECTOR_SIZE ) )
+			{
+				printf( "error : invalid image size %s\n", optarg );
+				return -1;
+			}
+			break;
+		case 'j':
+			options->format.journalBlocks = ( UINT32 )atoi( optarg );
+			break;
+		case 't':
+			options->format.threadCount = ( UINT32 )atoi( optarg );
+			break;
+		case 'c':
+			options->check = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	if( argc - optind != 2 )
+		return -1;
+	options->imagePath = argv[optind];
+	options->hostPath = argv[optind + 1];
+
+	return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+	MKIMAGE_OPTIONS options;
+	DISK_OPERATIONS disk;
+	EXT2_FILESYSTEM fs;
+	EXT2_NODE root;
+	EXT2_IMPORT_REPORT report;
+	EXT2_CHECK_REPORT check;
+	double start, seconds;
+	int result;
+
+	if( parse_options( argc, argv, &options ) < 0 )
+	{
+		usage( );
+		return 1;
+	}
+	g_logLevel = LOG_LEVEL_WARN; /* keep the format summary out of the result line */
+
+	/* start from an empty sparse file, holes read back as zeros */
+	if( truncate( options.imagePath, 0 ) < 0 && access( options.imagePath, F_OK ) == 0 )
+	{
+		printf( "error : cannot truncate %s\n", options.imagePath );
+		return 1;
+	}
+	if( diskfile_init( options.imagePath, ( SECTOR )options.megaBytes * ( 1024 * 1024 / MKIMAGE_SECTOR_SIZE ),
+		MKIMAGE_SECTOR_SIZE, &disk ) < 0 )
+	{
+		printf( "error : cannot create %s\n", options.imagePath );
+		return 1;
+	}
+
+	start = now_ns( );
+	if( ext2_format( &disk, &options.format ) != EXT2_SUCCESS )
+	{
+		printf( "error : format failed\n" );
+		diskfile_uninit( &disk );
+		return 1;
+	}
+
+	memset( &fs, 0, sizeof( fs ) );
+	fs.disk = &disk;
+	if( ext2_read_superblock( &fs, &root ) != EXT2_SUCCESS )
+	{
+		printf( "error : cannot mount the new image\n" );
+		diskfile_uninit( &disk );
+		return 1;
+	}
+
+	result = ext2_import( &root, options.hostPath, &report );
+	seconds = ( now_ns( ) - start ) / 1e9;
+
+	if( result == EXT2_SUCCESS )
+	{
+		printf( "mkimage=%s dir=%s files=%u dirs=%u skipped=%u mb=%.1f data_blocks=%u index_blocks=%u "
+			"meta_blocks=%u requests=%u seconds=%.3f mb_per_s=%.1f",
+			options.imagePath, options.hostPath, report.files, report.dirs, report.skipped,
+			( double )report.bytes / ( 1024 * 1024 ), report.dataBlocks, report.indexBlocks,
+			report.metaBlocks, report.requests, seconds,
+			seconds > 0 ? ( double )report.bytes / ( 1024 * 1024 ) / seconds : 0 );
+
+		if( options.check )
+		{
+			if( ext2_check( &fs, 0, &check ) != EXT2_SUCCESS )
+			{
+				printf( " check_errors=failed" );
+				result = EXT2_ERROR;
+			}
+			else
+			{
+				printf( " check_errors=%u", check.errors );
+				if( check.errors != 0 )
+					result = EXT2_ERROR;
+			}
+		}
+		printf( "\n" );
+	}
+	else
+		printf( "error : import failed\n" );
+
+	ext2_umount( &fs );
+	diskfile_uninit( &disk );
+
+	return result == EXT2_SUCCESS ? 0 : 1;
+}
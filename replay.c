@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "disk.h"
+#include "disksim.h"
+#include "diskfile.h"
+#include "trace.h"
+
+/* trace replay : reads a trace written by ext2_trace_start, sorts the
+ * records by time and issues them against a memory disk of the traced size,
+ * or against a disk image file, then prints one "key=value" line. Disk layer
+ * records are replayed by default, -b replays the block layer records
+ * instead. -t keeps the original spacing of the records, -q issues them
+ * through submit/complete with up to depth requests in flight. */
+
+#define REPLAY_MAX_DEPTH		256
+
+typedef struct
+{
+	int		layer;
+	int		timed;
+	int		depth;
+	const char*	tracePath;
+	const char*	imagePath;
+} REPLAY_OPTIONS;
+
+static double now_ns( void )
+{
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ( double )ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void sleep_until( double deadline )
+{
+	struct timespec ts;
+	double left = deadline - now_ns( );
+
+	if( left <= 0 )
+		return;
+	ts.tv_sec = ( time_t )( left / 1e9 );
+	ts.tv_nsec = ( long )( left - ( double )ts.tv_sec * 1e9 );
+	nanosleep( &ts, NULL );
+}
+
+static int compare_record( const void* a, const void* b )
+{
+	const TRACE_RECORD* x = ( const TRACE_RECORD* )a;
+	const TRACE_RECORD* y = ( const TRACE_RECORD* )b;
+
+	if( x->time != y->time )
+		return x->time < y->time ? -1 : 1;
+	return 0;
+}
+
+/* whole trace in memory, only the records of the wanted layer */
+static TRACE_RECORD* load_trace( const char* path, int layer, TRACE_FILE_HEADER* header, unsigned long* count )
+{
+	TRACE_RECORD* records = NULL;
+	TRACE_RECORD record;
+	unsigned long size = 0;
+	FILE* file;
+
+	*count = 0;
+	file = fopen( path, "rb" );
+	if( file == NULL )
+	{
+		printf( "error : cannot open trace %s\n", path );
+		return NULL;
+	}
+
+	if( fread( header, sizeof( TRACE_FILE_HEADER ), 1, file ) != 1 ||
+		memcmp( header->magic, TRACE_MAGIC, sizeof( header->magic ) ) != 0 ||
+		header->version != TRACE_VERSION || header->recordSize != sizeof( TRACE_RECORD ) )
+	{
+		printf( "error : %s is not a trace file\n", path );
+		fclose( file );
+		return NULL;
+	}
+
+	/* records == 0 : the writer did not finish, read what is there */
+	while( ( header->records == 0 || *count < header->records ) &&
+		fread( &record, sizeof( TRACE_RECORD ), 1, file ) == 1 )
+	{
+		if( record.layer != layer )
+			continue;
+		if( *count == size )
+		{
+			TRACE_RECORD* grown;
+
+			size = size ? size * 2 : 4096;
+			grown = ( TRACE_RECORD* )realloc( records, size * sizeof( TRACE_RECORD ) );
+			if( grown == NULL )
+			{
+				printf( "error : out of memory\n" );
+				free( records );
+				fclose( file );
+				return NULL;
+			}
+			records = grown;
+		}
+		records[( *count )++] = record;
+	}
+	fclose( file );
+
+	/* 0 records is not an error, the trace was just empty */
+	if( records == NULL )
+		records = ( TRACE_RECORD* )malloc( sizeof( TRACE_RECORD ) );
+	qsort( records, *count, sizeof( TRACE_RECORD ), compare_record );
+
+	return records;
+}
+
+/* sector range of a record, block records are scaled by the block size */
+static void record_range( const TRACE_FILE_HEADER* header, const TRACE_RECORD* record, SECTOR* sector, unsigned int* count )
+{
+	unsigned int sectorsPerBlock = 1;
+
+	if( record->layer == TRACE_LAYER_BLOCK && header->blockSize != 0 )
+		sectorsPerBlock = header->blockSize / header->bytesPerSector;
+	*sector = ( SECTOR )( record->address * sectorsPerBlock );
+	*count = record->count * sectorsPerBlock;
+}
+
+static int replay_sync( DISK_OPERATIONS* disk, const TRACE_FILE_HEADER* header, const TRACE_RECORD* records,
+	unsigned long count, int timed, unsigned char* buffer, unsigned long* sectors )
+{
+	double start = now_ns( );
+	unsigned int i, length;
+	unsigned long n;
+	SECTOR sector;
+
+	for( n = 0; n < count; n++ )
+	{
+		if( timed )
+			sleep_until( start + ( double )records[n].time );
+		record_range( header, &records[n], &sector, &length );
+		for( i = 0; i < length; i++ )
+		{
+			if( sector + i >= disk->numberOfSectors )
+				break;
+			if( records[n].opcode == DISK_WRITE )
+			{
+				if( disk->write_sector( disk, sector + i, buffer ) < 0 )
+					return -1;
+				sectors[DISK_WRITE]++;
+			}
+			else
+			{
+				if( disk->read_sector( disk, sector + i, buffer ) < 0 )
+					return -1;
+				sectors[DISK_READ]++;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* up to depth records in flight, each with its own buffer */
+static int replay_queued( DISK_OPERATIONS* disk, const TRACE_FILE_HEADER* header, const TRACE_RECORD* records,
+	unsigned long count, int timed, int depth, unsigned long* sectors )
+{
+	DISK_REQUEST requests[REPLAY_MAX_DEPTH];
+	DISK_REQUEST* idle[REPLAY_MAX_DEPTH];
+	DISK_REQUEST* done[REPLAY_MAX_DEPTH];
+	DISK_REQUEST* request;
+	double start = now_ns( );
+	int idleCount = depth, inflight = 0, finished, i, result = 0;
+	unsigned long n = 0;
+
+	for( i = 0; i < depth; i++ )
+	{
+		requests[i].data = NULL;
+		idle[i] = &requests[i];
+	}
+
+	while( n < count || inflight > 0 )
+	{
+		while( n < count && idleCount > 0 && result == 0 )
+		{
+			if( timed && now_ns( ) < start + ( double )records[n].time )
+			{
+				if( inflight > 0 )
+					break;
+				sleep_until( start + ( double )records[n].time );
+			}
+
+			request = idle[--idleCount];
+			record_range( header, &records[n], &request->sector, &request->count );
+			if( request->sector + request->count > disk->numberOfSectors )
+				request->count = request->sector < disk->numberOfSectors ? ( unsigned int )( disk->numberOfSectors - request->sector ) : 0;
+			n++;
+			if( request->count == 0 )
+			{
+				idle[idleCount++] = request;
+				continue;
+			}
+
+			request->opcode = records[n - 1].opcode == DISK_WRITE ? DISK_WRITE : DISK_READ;
+			request->data = realloc( request->data, ( size_t )request->count * disk->bytesPerSector );
+			if( request->data == NULL )
+			{
+				printf( "error : out of memory\n" );
+				result = -1;
+				break;
+			}
+			memset( request->data, 0, ( size_t )request->count * disk->bytesPerSector );
+
+			if( disk->submit( disk, &request, 1 ) < 0 )
+			{
+				printf( "error : submit failed at record %lu\n", n - 1 );
+				result = -1;
+				break;
+			}
+			inflight++;
+		}
+		if( result != 0 && inflight == 0 )
+			break;
+
+		finished = disk->complete( disk, done, REPLAY_MAX_DEPTH, inflight > 0 );
+		if( finished < 0 )
+		{
+			result = -1;
+			break;
+		}
+		for( i = 0; i < finished; i++ )
+		{
+			if( done[i]->result < 0 )
+				result = -1;
+			else
+				sectors[done[i]->opcode] += done[i]->count;
+			idle[idleCount++] = done[i];
+			inflight--;
+		}
+		if( result != 0 && inflight == 0 )
+			break;
+	}
+
+	for( i = 0; i < depth; i++ )
+		free( requests[i].data );
+
+	return result;
+}
+
+static void usage( void )
+{
+	printf( "usage : replay [-t] [-b] [-q depth] trace [image]\n"
+		"  -t        keep the recorded timing instead of replaying as fast as possible\n"
+		"  -b        replay the block layer records instead of the disk layer ones\n"
+		"  -q depth  issue through submit/complete with up to depth requests in flight\n"
+		"  image     disk image file to replay against, default : a memory disk\n" );
+}
+
+static int parse_options( int argc, char* argv[], REPLAY_OPTIONS* options )
+{
+	int opt;
+
+	memset( options, 0, sizeof( REPLAY_OPTIONS ) );
+	options->layer = TRACE_LAYER_DISK;
+
+	while( ( opt = getopt( argc, argv, "tbq:" ) ) != -1 )
+	{
+		switch( opt )
+		{
+		case 't':
+			options->timed = 1;
+			break;
+		case 'b':
+			options->layer = TRACE_LAYER_BLOCK;
+			break;
+		case 'q':
+			options->depth = atoi( optarg );
+			if( options->depth < 1 || options->depth > REPLAY_MAX_DEPTH )
+			{
+				printf( "error : queue depth must be 1 to %d\n", REPLAY_MAX_DEPTH );
+				return -1;
+			}
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	if( optind >= argc || argc - optind > 2 )
+		return -1;
+	options->tracePath = argv[optind];
+	if( optind + 1 < argc )
+		options->imagePath = argv[optind + 1];
+
+	return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+	REPLAY_OPTIONS options;
+	TRACE_FILE_HEADER header;
+	DISK_OPERATIONS disk;
+	TRACE_RECORD* records;
+	unsigned char* buffer;
+	unsigned long count, sectors[2] = { 0, 0 };
+	double start, seconds;
+	int result;
+
+	if( parse_options( argc, argv, &options ) < 0 )
+	{
+		usage( );
+		return 1;
+	}
+
+	records = load_trace( options.tracePath, options.layer, &header, &count );
+	if( records == NULL )
+		return 1;
+	if( options.layer == TRACE_LAYER_BLOCK && header.blockSize == 0 )
+	{
+		printf( "error : the trace has no block layer records\n" );
+		free( records );
+		return 1;
+	}
+
+	if( options.imagePath != NULL )
+		result = diskfile_init( options.imagePath, ( SECTOR )header.numberOfSectors, header.bytesPerSector, &disk );
+	else
+		result = disksim_init( ( SECTOR )header.numberOfSectors, header.bytesPerSector, &disk );
+	if( result < 0 )
+	{
+		printf( "error : cannot create the replay disk\n" );
+		free( records );
+		return 1;
+	}
+	if( options.depth > 0 && disk.submit == NULL )
+	{
+		printf( "error : the replay disk has no request queue\n" );
+		result = -1;
+	}
+
+	buffer = ( unsigned char* )calloc( 1, header.bytesPerSector );
+	start = now_ns( );
+	if( result < 0 || buffer == NULL )
+		result = -1;
+	else if( options.depth > 0 )
+		result = replay_queued( &disk, &header, records, count, options.timed, options.depth, sectors );
+	else
+		result = replay_sync( &disk, &header, records, count, options.timed, buffer, sectors );
+	seconds = ( now_ns( ) - start ) / 1e9;
+
+	if( result == 0 )
+		printf( "replay=%s layer=%s records=%lu dropped=%llu sector_reads=%lu sector_writes=%lu "
+			"seconds=%.3f ops_per_s=%.0f mb_per_s=%.1f\n",
+			options.tracePath, options.layer == TRACE_LAYER_BLOCK ? "block" : "disk", count,
+			( unsigned long long )header.dropped, sectors[DISK_READ], sectors[DISK_WRITE], seconds,
+			seconds > 0 ? count / seconds : 0,
+			seconds > 0 ? ( double )( sectors[DISK_READ] + sectors[DISK_WRITE] ) * header.bytesPerSector / seconds / ( 1024 * 1024 ) : 0 );
+	else
+		printf( "error : replay failed\n" );
+
+	free( buffer );
+	free( records );
+	if( options.imagePath != NULL )
+		diskfile_uninit( &disk );
+	else
+		disksim_uninit( &disk );
+
+	return result == 0 ? 0 : 1;
+}
@@ -1,11 +1,17 @@
+#ifdef _MSC_VER
 #pragma warning(disable : 4995)
+#endif
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <memory.h>
+#include <time.h>
+#include <unistd.h>
 #include "shell.h"
 #include "disksim.h"
+#include "diskfile.h"
 
 #define SECTOR_SIZE				512
 #define NUMBER_OF_SECTORS		1048576
@@ -20,10 +26,22 @@ typedef struct
 	char	conditions;
 } COMMAND;
 
+/* batch mode totals of one command */
+typedef struct
+{
+	unsigned long	count;
+	unsigned long	failed;
+	double			totalMs;
+	double			maxMs;
+	unsigned long	sectorReads;
+	unsigned long	sectorWrites;
+} BATCH_STATS;
+
 extern void shell_register_filesystem(SHELL_FILESYSTEM*);
 
-void do_shell(void);
+void do_shell(FILE* input);
 void unknown_command(void);
+void batch_summary(void);
 int seperate_string(char* buf, char* ptrs[]);
 
 int shell_cmd_cd(int argc, char* argv[]);
@@ -40,6 +58,11 @@ int shell_cmd_mkdir(int argc, char* argv[]);
 int shell_cmd_rmdir(int argc, char* argv[]);
 int shell_cmd_mkdirst(int argc, char* argv[]);
 int shell_cmd_cat(int argc, char* argv[]);
+int shell_cmd_fsck(int argc, char* argv[]);
+int shell_cmd_du(int argc, char* argv[]);
+int shell_cmd_find(int argc, char* argv[]);
+int shell_cmd_stats(int argc, char* argv[]);
+int shell_cmd_trace(int argc, char* argv[]);
 
 int shell_cmd_dumpsuperblock(int argc, char * argv[]);
 int shell_cmd_dumpgd(int argc, char * argv[]);
@@ -67,6 +90,11 @@ static COMMAND g_commands[] =
 	{ "rmdir",	shell_cmd_rmdir,	COND_MOUNT	},
 	{ "mkdirst",shell_cmd_mkdirst,	COND_MOUNT	},
 	{ "cat",	shell_cmd_cat,		COND_MOUNT	},
+	{ "fsck",	shell_cmd_fsck,		COND_MOUNT	},
+	{ "du",		shell_cmd_du,		COND_MOUNT	},
+	{ "find",	shell_cmd_find,		COND_MOUNT	},
+	{ "stats",	shell_cmd_stats,	COND_MOUNT	},
+	{ "trace",	shell_cmd_trace,	COND_MOUNT	},
 	{ "dumpdata",	shell_cmd_dumpdata, COND_MOUNT },
 	{ "dumpsuperblock" , shell_cmd_dumpsuperblock, COND_MOUNT },
 	{ "dumpgd" , shell_cmd_dumpgd , COND_MOUNT },
@@ -85,19 +113,106 @@ static DISK_OPERATIONS		g_disk; 		/* disk operation */
 
 int g_commandsCount = sizeof(g_commands) / sizeof(COMMAND);
 int g_isMounted;
+int g_isDiskImage;		/* disk is backed by an image file */
+
+/* batch mode : commands come from a script or a pipe, no prompt, and each
+ * command is followed by a line with its wall time and sector I/O. with -q
+ * the output of the commands themselves goes to /dev/null so the debug
+ * prints of the file system do not distort the timings */
+static int				g_isBatch;
+static FILE*			g_report;		/* timing lines and the summary */
+static BATCH_STATS		g_batchStats[sizeof(g_commands) / sizeof(COMMAND)];
+static BATCH_STATS		g_batchTotal;
+static unsigned long	g_sectorReads;
+static unsigned long	g_sectorWrites;
+static int				(*g_readSector)(DISK_OPERATIONS*, SECTOR, void*);
+static int				(*g_writeSector)(DISK_OPERATIONS*, SECTOR, const void*);
+
+static int count_read(DISK_OPERATIONS* disk, SECTOR sector, void* data)
+{
+	__atomic_fetch_add(&g_sectorReads, 1, __ATOMIC_RELAXED);
+	return g_readSector(disk, sector, data);
+}
+
+static int count_write(DISK_OPERATIONS* disk, SECTOR sector, const void* data)
+{
+	__atomic_fetch_add(&g_sectorWrites, 1, __ATOMIC_RELAXED);
+	return g_writeSector(disk, sector, data);
+}
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
 
 int main(int argc, char* argv[])
 {
+	const char* script = NULL;
+	const char* image = NULL;
+	FILE* input = stdin;
+	int quiet = 0;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			script = argv[++i];
+		else if (strcmp(argv[i], "-q") == 0)
+			quiet = 1;
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+			g_logLevel = atoi(argv[++i]); /* 0 : none ... 4 : debug, if compiled in */
+		else if (argv[i][0] != '-' && image == NULL)
+			image = argv[i];
+		else
+		{
+			printf("usage : %s [-f script] [-q] [-l log level] [disk image]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	if (script != NULL && (input = fopen(script, "r")) == NULL)
+	{
+		printf("script %s cannot be opened\n", script);
+		return -1;
+	}
+	g_isBatch = script != NULL || !isatty(fileno(stdin));
+
 	/* disk operation initialization */
-	if (disksim_init(NUMBER_OF_SECTORS, SECTOR_SIZE, &g_disk) < 0)
+	if (image != NULL)
+	{	/* a new image gets NUMBER_OF_SECTORS, an existing one keeps its size in g_disk.numberOfSectors */
+		if (diskfile_init(image, NUMBER_OF_SECTORS, SECTOR_SIZE, &g_disk) < 0)
+		{
+			printf("disk image %s cannot be opened\n", image);
+			return -1;
+		}
+		g_isDiskImage = 1;
+	}
+	else if (disksim_init(NUMBER_OF_SECTORS, SECTOR_SIZE, &g_disk) < 0)
 	{
 		printf("disk simulator initialization has been failed\n");
 		return -1;
 	}
 
+	g_report = stdout;
+	if (g_isBatch)
+	{
+		g_readSector = g_disk.read_sector;
+		g_writeSector = g_disk.write_sector;
+		g_disk.read_sector = count_read;
+		g_disk.write_sector = count_write;
+
+		if (quiet && (g_report = fdopen(dup(fileno(stdout)), "w")) != NULL)
+			freopen("/dev/null", "w", stdout);
+		else
+			g_report = stdout;
+	}
+
 	shell_register_filesystem(&g_fs); /* register filesystem to shell */
 
-	do_shell(); /* input and operate command */
+	do_shell(input); /* input and operate command */
 
 	return 0;
 }
@@ -119,20 +234,74 @@ int check_conditions(int conditions)
 	return 0;
 }
 
-void do_shell(void)
+/* timing line of one batch command, added to the totals of the command */
+static void batch_report(int line, int index, int result, double ms, unsigned long reads, unsigned long writes)
+{
+	BATCH_STATS* stats[2] = { &g_batchStats[index], &g_batchTotal };
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		stats[i]->count++;
+		stats[i]->failed += result != 0;
+		stats[i]->totalMs += ms;
+		if (ms > stats[i]->maxMs)
+			stats[i]->maxMs = ms;
+		stats[i]->sectorReads += reads;
+		stats[i]->sectorWrites += writes;
+	}
+
+	fflush(stdout);
+	fprintf(g_report, "batch line=%d cmd=%s result=%s ms=%.3f sector_reads=%lu sector_writes=%lu\n",
+		line, g_commands[index].name, result ? "fail" : "ok", ms, reads, writes);
+	fflush(g_report);
+}
+
+void batch_summary(void)
+{
+	int i;
+
+	fflush(stdout);
+	fprintf(g_report, "\n%-16s %8s %8s %12s %10s %10s %12s %12s\n",
+		"command", "count", "failed", "total(ms)", "avg(ms)", "max(ms)", "sect reads", "sect writes");
+	for (i = 0; i < g_commandsCount; i++)
+	{
+		if (g_batchStats[i].count == 0)
+			continue;
+		fprintf(g_report, "%-16s %8lu %8lu %12.3f %10.3f %10.3f %12lu %12lu\n", g_commands[i].name,
+			g_batchStats[i].count, g_batchStats[i].failed, g_batchStats[i].totalMs,
+			g_batchStats[i].totalMs / g_batchStats[i].count, g_batchStats[i].maxMs,
+			g_batchStats[i].sectorReads, g_batchStats[i].sectorWrites);
+	}
+	fprintf(g_report, "batch commands=%lu failed=%lu ms=%.3f sector_reads=%lu sector_writes=%lu\n",
+		g_batchTotal.count, g_batchTotal.failed, g_batchTotal.totalMs, g_batchTotal.sectorReads, g_batchTotal.sectorWrites);
+	fflush(g_report);
+}
+
+void do_shell(FILE* input)
 {
 	char buf[1000];
-	char command[100];
 	char* argv[100];
+	unsigned long reads, writes;
+	double start;
 	int argc;
+	int line = 0;
+	int result;
 	int i;
 
-	printf("%s File system shell\n", g_fs.name);
+	if (!g_isBatch)
+		printf("%s File system shell\n", g_fs.name);
 
 	while (-1)
 	{
-		printf("[%s/]# ", g_currentDir.name);
-		fgets(buf, 1000, stdin);
+		if (!g_isBatch)
+			printf("[%s/]# ", g_currentDir.name);
+		if (fgets(buf, 1000, input) == NULL)
+			shell_cmd_exit(0, NULL); /* end of the script or of the pipe */
+		line++;
+
+		if (g_isBatch && buf[0] == '#') /* comment line of a script */
+			continue;
 
 		argc = seperate_string(buf, argv);
 
@@ -143,9 +312,18 @@ void do_shell(void)
 		{
 			if (strcmp(g_commands[i].name, argv[0]) == 0)
 			{
-				if (check_conditions(g_commands[i].conditions) == 0)
+				if (g_isBatch && g_commands[i].handler == shell_cmd_exit)
 					g_commands[i].handler(argc, argv);
 
+				reads = g_sectorReads;
+				writes = g_sectorWrites;
+				start = now_ms();
+				result = -1;
+				if (check_conditions(g_commands[i].conditions) == 0)
+					result = g_commands[i].handler(argc, argv);
+
+				if (g_isBatch)
+					batch_report(line, i, result, now_ms() - start, g_sectorReads - reads, g_sectorWrites - writes);
 				break;
 			}
 		}
@@ -286,7 +464,7 @@ int shell_cmd_dumpinodetable(int argc, char * argv[])
 
 int shell_cmd_dumpdata(int argc, char * argv[])
 {
-	int result, blockNum;
+	int result;
 
 	if (argc != 2)
 	{
@@ -307,7 +485,7 @@ int shell_cmd_dumpdata(int argc, char * argv[])
 
 int shell_cmd_dumpfile(int argc, char * argv[])
 {
-	int result, fileNum;
+	int result;
 
 	if (argc != 2)
 	{
@@ -379,7 +557,16 @@ int shell_cmd_cd(int argc, char* argv[])
 
 int shell_cmd_exit(int argc, char* argv[])
 {
-	disksim_uninit(&g_disk);
+	if (g_isMounted) /* commits the journal and writes the file system back before the disk goes away */
+		shell_cmd_umount(0, NULL);
+	if (g_isBatch)
+		batch_summary();
+	fflush(NULL); /* _exit does not flush, output to a pipe would be lost */
+
+	if (g_isDiskImage)
+		diskfile_uninit(&g_disk);
+	else
+		disksim_uninit(&g_disk);
 	_exit(0);
 
 	return 0;
@@ -446,29 +633,66 @@ int shell_cmd_touch(int argc, char* argv[])
 	return 0;
 }
 
+#define FILL_PATTERN		"Can you see? "
+#define FILL_PATTERN_LENGTH	13
+
+/* fill_fd generator : the pattern repeated from the start of the fill */
+static void fill_pattern(void* arg, unsigned long long offset, char* buffer, unsigned int length)
+{
+	unsigned int phase = (unsigned int)(offset % FILL_PATTERN_LENGTH);
+	unsigned int i, copied;
+
+	for (i = 0; i < length && i < FILL_PATTERN_LENGTH; i++)
+		buffer[i] = FILL_PATTERN[(phase + i) % FILL_PATTERN_LENGTH];
+	/* the filled part is whole periods, doubling it keeps the pattern */
+	for (; i < length; i += copied)
+	{
+		copied = MIN(i, length - i);
+		memcpy(&buffer[i], buffer, copied);
+	}
+}
+
 int shell_cmd_fill(int argc, char* argv[])
 {
 	SHELL_ENTRY	entry;
-	char*		buffer;
-	char*		tmp;
-	int			size;
-	int			result;
-	char opt[3] = { 0, };
+	unsigned long long size, written = 0;
+	unsigned long chunkSize = 0;
+	unsigned long offset;
 	const char CREATE[3] = "-c";
 	const char APPEND[3] = "-a";
-	unsigned long offset;
+	double start, seconds;
+	char*		end;
+	int			result;
+	int			fd;
 
-	if (argc != 4)
+	if (argc != 4 && argc != 5)
 	{
-		printf("usage : fill [file] [size] [option]\n");
-		return 0;
+		printf("usage : fill [file] [size] [-c|-a] [chunk size]\n");
+		return -1;
 	}
 
-	sscanf(argv[2], "%d", &size);
-	sscanf(argv[3], "%s", opt);
-
+	size = strtoull(argv[2], &end, 10);
+	if (*end != 0 || argv[2][0] == '-')
+	{
+		printf("invalid size %s\n", argv[2]);
+		return -1;
+	}
+	if (argc == 5)
+	{
+		chunkSize = strtoul(argv[4], &end, 10);
+		if (*end != 0 || argv[4][0] == '-' || chunkSize == 0)
+		{
+			printf("invalid chunk size %s\n", argv[4]);
+			return -1;
+		}
+		if (chunkSize > SHELL_FILL_MAX_CHUNK)
+		{
+			printf("chunk size capped at %u\n", SHELL_FILL_MAX_CHUNK);
+			chunkSize = SHELL_FILL_MAX_CHUNK;
+		}
+	}
 
-	if (strcmp(opt, CREATE) == 0)
+	if (strcmp(argv[3], CREATE) == 0)
 	{
 		result = g_fsOprs.fileOprs->create(&g_disk, &g_fsOprs, &g_currentDir, argv[1], &entry);
 		if (result)
@@ -478,22 +702,48 @@ int shell_cmd_fill(int argc, char* argv[])
 		}
 		offset = 0;
 	}
-
-	if (strcmp(opt, APPEND) == 0) {
-		g_fsOprs.lookup(&g_disk, &g_fsOprs, &g_currentDir, &entry, argv[1]);
+	else if (strcmp(argv[3], APPEND) == 0)
+	{
+		if (g_fsOprs.lookup(&g_disk, &g_fsOprs, &g_currentDir, &entry, argv[1]))
+		{
+			printf("%s lookup failed\n", argv[1]);
+			return -1;
+		}
 		offset = entry.size;
 	}
+	else
+	{
+		printf("unknown option %s\n", argv[3]);
+		return -1;
+	}
+
+	if (offset + size > 0xFFFFFFFFULL)
+	{
+		printf("fill would grow the file past 4 GB\n");
+		return -1;
+	}
 
-	buffer = (char*)malloc(size + 13);
-	tmp = buffer;
-	while (tmp < buffer + size)
+	fd = g_fsOprs.fileOprs->open(&g_disk, &g_fsOprs, &g_currentDir, &entry);
+	if (fd < 0)
 	{
-		memcpy(tmp, "Can you see? ", 13);
-		tmp += 13;
+		printf("open failed\n");
+		return -1;
 	}
 
-	g_fsOprs.fileOprs->write(&g_disk, &g_fsOprs, &g_currentDir, &entry, offset, size, buffer);
-	free(buffer);
+	/* the data is generated and written chunk by chunk, never as a whole */
+	start = now_ms();
+	g_fsOprs.fileOprs->seek(&g_disk, &g_fsOprs, fd, offset);
+	result = g_fsOprs.fileOprs->fill_fd(&g_disk, &g_fsOprs, fd, size, chunkSize, fill_pattern, NULL, &written);
+	g_fsOprs.fileOprs->close(&g_disk, &g_fsOprs, fd);
+	seconds = (now_ms() - start) / 1000;
+
+	printf("wrote %llu bytes in %.3f s, %.1f MB/s\n", written, seconds,
+		seconds > 0 ? (double)written / (1024 * 1024) / seconds : 0);
+	if (result)
+	{
+		printf("fill failed\n");
+		return -1;
+	}
 
 	return 0;
 }
@@ -527,12 +777,24 @@ int shell_cmd_format(int argc, char* argv[])
 	int		result;
 	char*	param = NULL;
 
-	if (argc > 1)
+	char	options[256] = { 0, };
+	int		i;
+
+	for (i = 1; i < argc; i++)
 	{
-		printf("Usage : format [No argument]\n");
-		return -1;
+		if (strlen(options) + strlen(argv[i]) + 2 > sizeof(options))
+		{
+			printf("Usage : format [-l] [-s] [-t threads] [-b 1024|2048|4096] [-j journal_blocks]\n");
+			return -1;
+		}
+		if (i > 1)
+			strcat(options, " ");
+		strcat(options, argv[i]);
 	}
-	result = g_fs.format(&g_disk, g_fs.name);
+	if (argc > 1)
+		param = options;
+
+	result = g_fs.format(&g_disk, param);
 
 	if (result < 0)
 	{
@@ -552,7 +814,6 @@ double get_percentage(unsigned int number, unsigned int total)
 int shell_cmd_df(int argc, char* argv[])
 {
 	unsigned int used, total;
-	int result;
 
 	g_fsOprs.stat(&g_disk, &g_fsOprs, &total, &used);
 
@@ -563,6 +824,148 @@ int shell_cmd_df(int argc, char* argv[])
 	return 0;
 }
 
+int shell_cmd_stats(int argc, char* argv[])
+{
+	int reset = 0;
+
+	if (argc == 2 && strcmp(argv[1], "-r") == 0)
+		reset = 1;
+	else if (argc != 1)
+	{
+		printf("usage : %s [-r]\n", argv[0]);
+		return 0;
+	}
+
+	g_fsOprs.stats(&g_disk, &g_fsOprs, reset);
+
+	return 0;
+}
+
+int shell_cmd_trace(int argc, char* argv[])
+{
+	if (argc > 2)
+	{
+		printf("usage : %s [file]\n", argv[0]);
+		return 0;
+	}
+
+	g_fsOprs.trace(&g_disk, &g_fsOprs, argc == 2 ? argv[1] : NULL);
+
+	return 0;
+}
+
+int shell_cmd_fsck(int argc, char* argv[])
+{
+	unsigned int threadCount = 1;
+
+	if (argc == 3 && strcmp(argv[1], "-t") == 0)
+		threadCount = atoi(argv[2]);
+	else if (argc != 1)
+	{
+		printf("usage : %s [-t threads]\n", argv[0]);
+		return 0;
+	}
+
+	if (g_fsOprs.check(&g_disk, &g_fsOprs, threadCount))
+		printf("file system has errors\n");
+	else
+		printf("file system is clean\n");
+
+	return 0;
+}
+
+/* name of the current directory, "." for the current directory itself */
+static int lookup_directory(const char* name, SHELL_ENTRY* dir)
+{
+	if (strcmp(name, ".") == 0)
+	{
+		*dir = g_currentDir;
+		return 0;
+	}
+
+	if (g_fsOprs.lookup(&g_disk, &g_fsOprs, &g_currentDir, dir, name))
+	{
+		printf("%s not found\n", name);
+		return -1;
+	}
+	if (!dir->isDirectory)
+	{
+		printf("%s is not a directory\n", name);
+		return -1;
+	}
+
+	return 0;
+}
+
+int shell_cmd_du(int argc, char* argv[])
+{
+	SHELL_ENTRY	dir;
+	unsigned int threadCount = 0;
+	char*		path = ".";
+	int			i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threadCount = atoi(argv[++i]);
+		else if (argv[i][0] != '-' && strcmp(path, ".") == 0)
+			path = argv[i];
+		else
+		{
+			printf("usage : %s [-t threads] [directory]\n", argv[0]);
+			return 0;
+		}
+	}
+
+	if (lookup_directory(path, &dir))
+		return -1;
+
+	if (g_fsOprs.du(&g_disk, &g_fsOprs, &dir, path, threadCount))
+	{
+		printf("cannot walk %s\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+int shell_cmd_find(int argc, char* argv[])
+{
+	SHELL_ENTRY	dir;
+	unsigned int threadCount = 0;
+	char*		path = ".";
+	char*		pattern = NULL;
+	int			i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-name") == 0 && i + 1 < argc)
+			pattern = argv[++i];
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			threadCount = atoi(argv[++i]);
+		else if (argv[i][0] != '-' && i == 1)
+			path = argv[i];
+		else
+			break;
+	}
+	if (i < argc || pattern == NULL)
+	{
+		printf("usage : %s [directory] -name pattern [-t threads]\n", argv[0]);
+		return 0;
+	}
+
+	if (lookup_directory(path, &dir))
+		return -1;
+
+	if (g_fsOprs.find(&g_disk, &g_fsOprs, &dir, path, pattern, threadCount))
+	{
+		printf("cannot walk %s\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
 int shell_cmd_mkdir(int argc, char* argv[])
 {
 	SHELL_ENTRY	entry;
@@ -610,7 +1013,7 @@ int shell_cmd_mkdirst(int argc, char* argv[])
 {
 	SHELL_ENTRY	entry;
 	int		result, i, count;
-	char	buf[10];
+	char	buf[12];
 
 	if (argc != 2)
 	{
@@ -639,7 +1042,7 @@ int shell_cmd_cat(int argc, char* argv[])
 	SHELL_ENTRY	entry;
 	char		buf[1024] = { 0, };
 	int			result;
-	unsigned long	offset = 0;
+	int			fd;
 
 	if (argc != 2)
 	{
@@ -654,19 +1057,29 @@ int shell_cmd_cat(int argc, char* argv[])
 		return -1;
 	}
 
-	while (g_fsOprs.fileOprs->read(&g_disk, &g_fsOprs, &g_currentDir, &entry, offset, 1024, buf) > 0)
+	fd = g_fsOprs.fileOprs->open(&g_disk, &g_fsOprs, &g_currentDir, &entry);
+	if (fd < 0)
+	{
+		printf("%s open failed\n", argv[1]);
+		return -1;
+	}
+
+	while (g_fsOprs.fileOprs->read_fd(&g_disk, &g_fsOprs, fd, sizeof(buf) - 1, buf) > 0)
 	{
 		printf("%s", buf);
-		offset += 1024;
 		memset(buf, 0, sizeof(buf));
 	}
 	printf("\n");
+	g_fsOprs.fileOprs->close(&g_disk, &g_fsOprs, fd);
+
+	return 0;
 }
 
 int shell_cmd_ls(int argc, char* argv[])
 {
 	SHELL_ENTRY_LIST		list;
 	SHELL_ENTRY_LIST_ITEM*	current;
+	unsigned int			i;
 
 	if (argc > 2)
 	{
@@ -681,14 +1094,12 @@ int shell_cmd_ls(int argc, char* argv[])
 		return -1;
 	}
 
-	current = list.first;
-
 	printf("[      File names      ] [D] [File sizes]\n");
-	while (current)
+	for (i = 0; i < list.count; i++)
 	{
-		printf("%-24s  %1d  %12d\n",
-			current->entry.name, current->entry.isDirectory, current->entry.size);
-		current = current->next;
+		current = &list.items[i];
+		printf("%-24s  %1d  %12u\n",
+			entry_list_name(&list, current), current->isDirectory, current->size);
 	}
 	printf("\n");
 
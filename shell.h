@@ -29,21 +29,38 @@ typedef struct SHELL_ENTRY
 	char				pdata[1024];
 } SHELL_ENTRY;
 
+/* one entry of a directory listing, 16 bytes. the name is kept in the
+ * list's name arena, see entry_list_name */
 typedef struct SHELL_ENTRY_LIST_ITEM
 {
-	struct SHELL_ENTRY				entry;
-	struct SHELL_ENTRY_LIST_ITEM*	next;
+	unsigned int		inode;
+	unsigned int		size;
+	unsigned int		nameOffset;
+	unsigned char		nameLength;
+	unsigned char		isDirectory;
 } SHELL_ENTRY_LIST_ITEM;
 
+/* directory listing : the entries are one contiguous array and their names
+ * are bump allocated from one buffer, both grown by doubling. releasing the
+ * list frees the two buffers whatever the number of entries */
 typedef struct
 {
 	unsigned int					count;
-	SHELL_ENTRY_LIST_ITEM*			first;
-	SHELL_ENTRY_LIST_ITEM*			last;
+	unsigned int					capacity;
+	SHELL_ENTRY_LIST_ITEM*			items;
+	char*							names;		/* NUL terminated names */
+	unsigned int					namesUsed;
+	unsigned int					namesSize;
 } SHELL_ENTRY_LIST;
 
 struct SHELL_FILE_OPERATIONS;
 
+/* largest chunk size of fill_fd, the file system's own limit (EXT2_FILL_MAX_CHUNK for ext2) */
+#define SHELL_FILL_MAX_CHUNK	( 64 * 1024 * 1024 )
+
+/* generator of fill_fd : fills buffer with the length bytes that go at offset from the start of the fill */
+typedef void ( *SHELL_FILL_GENERATE )( void* arg, unsigned long long offset, char* buffer, unsigned int length );
+
 typedef struct SHELL_FS_OPERATIONS
 {
 	int	( *read_dir )( DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, SHELL_ENTRY_LIST* );
@@ -53,6 +70,11 @@ typedef struct SHELL_FS_OPERATIONS
 	int ( *lookup )( DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, SHELL_ENTRY*, const char* );
 	int ( *dump )(DISK_OPERATIONS*, int, int, int);
 	int ( *dumpdata )(DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, const char*);
+	int ( *check )( DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, unsigned int );
+	int ( *du )( DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, const char*, unsigned int );
+	int ( *find )( DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, const char*, const char*, unsigned int );
+	int ( *stats )( DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, int );
+	int ( *trace )( DISK_OPERATIONS*, struct SHELL_FS_OPERATIONS*, const char* );
 
 	struct SHELL_FILE_OPERATIONS*	fileOprs;
 	void*	pdata;
@@ -64,6 +86,14 @@ typedef struct SHELL_FILE_OPERATIONS
 	int ( *remove )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, const char* );
 	int	( *read )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, SHELL_ENTRY*, unsigned long, unsigned long, char* );
 	int	( *write )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, SHELL_ENTRY*, unsigned long, unsigned long, const char* );
+	/* handle based I/O : open returns a handle that keeps the position and the file's in-core inode */
+	int	( *open )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, const SHELL_ENTRY*, SHELL_ENTRY* );
+	int	( *close )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, int );
+	int	( *read_fd )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, int, unsigned long, char* );
+	int	( *write_fd )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, int, unsigned long, const char* );
+	int	( *seek )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, int, unsigned long );
+	/* streaming write : generates and writes length bytes in chunks of the given size, *written gets the bytes written */
+	int	( *fill_fd )( DISK_OPERATIONS*, SHELL_FS_OPERATIONS*, int, unsigned long long, unsigned int, SHELL_FILL_GENERATE, void*, unsigned long long* );
 } SHELL_FILE_OPERATIONS;
 
 typedef struct
@@ -75,7 +105,8 @@ typedef struct
 } SHELL_FILESYSTEM;
 
 int		init_entry_list( SHELL_ENTRY_LIST* list );
-int		add_entry_list( SHELL_ENTRY_LIST*, SHELL_ENTRY* );
+int		add_entry_list( SHELL_ENTRY_LIST*, const char* name, unsigned int nameLength, unsigned int inode, unsigned int size, int isDirectory );
+const char*	entry_list_name( const SHELL_ENTRY_LIST*, const SHELL_ENTRY_LIST_ITEM* );
 void	release_entry_list( SHELL_ENTRY_LIST* );
 
 #endif
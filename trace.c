@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "ext2.h"
+#include "trace.h"
+
+/* binary I/O trace writer
+ *
+ * The disk hook and the block hook of the file system append a record to
+ * a ring buffer owned by the calling thread : one producer per ring, so
+ * appending needs no lock, only a release store of the ring head. A
+ * flusher thread drains all rings into the trace file every
+ * TRACE_FLUSH_MS or when a ring is half full. A record that finds its
+ * ring full is dropped and counted rather than stalling the I/O path.
+ * The ring of an exited thread is handed to the next new thread. Only one
+ * trace runs at a time; see trace.h for the file format. */
+
+#define TRACE_FLUSH_MS			10
+
+typedef struct trace_ring {
+	TRACE_RECORD	records[EXT2_TRACE_RING_SIZE];
+	UINT64		head;				/* next record to fill, written by the owner */
+	BYTE		pad[64];
+	UINT64		tail;				/* next record to flush, written by the flusher */
+	UINT32		index;
+	int			used;				/* owned by a running thread */
+} TRACE_RING;
+
+typedef struct trace_writer {
+	FILE*		file;
+	DISK_OPERATIONS* disk;
+	EXT2_FILESYSTEM* fs;
+	EXT2_TRACE	blockTrace;			/* hook given to ext2_set_trace */
+	TRACE_FILE_HEADER header;
+	UINT32		generation;			/* changes with every start, stale thread rings are ignored */
+	int			active;
+	int			stop;				/* hooks must not touch the rings any more */
+	int			callers;			/* hooks currently running */
+	int			flusherStop;
+	UINT64		dropped;
+	TRACE_RING*	rings[EXT2_TRACE_MAX_THREADS];
+	UINT32		ringCount;
+	pthread_t	flusher;
+	pthread_mutex_t lock;			/* ring allocation and hand over */
+	pthread_cond_t wake;
+} TRACE_WRITER;
+
+/* 尡    ݳϱ   */
+typedef struct trace_token {
+	UINT32		generation;
+	TRACE_RING*	ring;
+} TRACE_TOKEN;
+
+static TRACE_WRITER		g_writer = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+static pthread_mutex_t	g_traceLock = PTHREAD_MUTEX_INITIALIZER;	/* start/stop */
+static pthread_key_t	g_traceKey;
+static pthread_once_t	g_traceOnce = PTHREAD_ONCE_INIT;
+static __thread TRACE_RING* g_traceRing;
+static __thread UINT32	g_traceGeneration;
+
+static void release_ring(void* arg)
+{
+	TRACE_TOKEN* token = (TRACE_TOKEN *)arg;
+
+	pthread_mutex_lock(&g_writer.lock);
+	if (g_writer.active && g_writer.generation == token->generation)
+		token->ring->used = 0;
+	pthread_mutex_unlock(&g_writer.lock);
+	free(token);
+}
+
+static void create_key(void)
+{
+	pthread_key_create(&g_traceKey, release_ring);
+}
+
+/*   , ó̸ ݳ  ްų  Ҵ */
+static TRACE_RING* get_ring(TRACE_WRITER* writer)
+{
+	TRACE_TOKEN* token;
+	TRACE_RING* ring = NULL;
+	UINT32 i;
+
+	if (g_traceRing != NULL && g_traceGeneration == writer->generation)
+		return g_traceRing;
+
+	pthread_mutex_lock(&writer->lock);
+	for (i = 0; i < writer->ringCount; i++)
+	{
+		if (!writer->rings[i]->used)
+		{
+			ring = writer->rings[i];
+			break;
+		}
+	}
+	if (ring == NULL && writer->ringCount < EXT2_TRACE_MAX_THREADS)
+	{
+		ring = (TRACE_RING *)calloc(1, sizeof(TRACE_RING));
+		if (ring != NULL)
+		{
+			ring->index = writer->ringCount;
+			writer->rings[writer->ringCount] = ring;
+			__atomic_store_n(&writer->ringCount, writer->ringCount + 1, __ATOMIC_RELEASE);
+		}
+	}
+	if (ring != NULL)
+		ring->used = 1;
+	pthread_mutex_unlock(&writer->lock);
+
+	if (ring == NULL)
+		return NULL;
+
+	token = (TRACE_TOKEN *)pthread_getspecific(g_traceKey);
+	if (token == NULL)
+	{
+		token = (TRACE_TOKEN *)malloc(sizeof(TRACE_TOKEN));
+		if (token != NULL)
+			pthread_setspecific(g_traceKey, token);
+	}
+	if (token != NULL)
+	{	// token  尡   ݳ  
+		token->generation = writer->generation;
+		token->ring = ring;
+	}
+
+	g_traceRing = ring;
+	g_traceGeneration = writer->generation;
+
+	return ring;
+}
+
+static void append_record(int layer, int opcode, UINT64 address, UINT32 count, int origin, UINT64 time)
+{
+	TRACE_WRITER* writer = &g_writer;
+	TRACE_RECORD* record;
+	TRACE_RING* ring;
+	UINT64 head;
+
+	__atomic_add_fetch(&writer->callers, 1, __ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&writer->stop, __ATOMIC_SEQ_CST))
+	{
+		__atomic_sub_fetch(&writer->callers, 1, __ATOMIC_RELEASE);
+		return;
+	}
+
+	ring = get_ring(writer);
+	head = ring != NULL ? ring->head : 0;
+	if (ring == NULL || head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= EXT2_TRACE_RING_SIZE)
+		__atomic_add_fetch(&writer->dropped, 1, __ATOMIC_RELAXED);
+	else
+	{
+		record = &ring->records[head & (EXT2_TRACE_RING_SIZE - 1)];
+		record->time = time - writer->header.startTime;
+		record->address = address;
+		record->count = count;
+		record->thread = (UINT16)ring->index;
+		record->layer = (BYTE)layer;
+		record->opcode = (BYTE)opcode;
+		record->origin = (BYTE)origin;
+		ZeroMemory(record->reserved, sizeof(record->reserved));
+		__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+		if (((head + 1) & (EXT2_TRACE_RING_SIZE / 2 - 1)) == 0) //   flusher 
+			pthread_cond_signal(&writer->wake);
+	}
+
+	__atomic_sub_fetch(&writer->callers, 1, __ATOMIC_RELEASE);
+}
+
+static void trace_disk(DISK_OPERATIONS* disk, int opcode, SECTOR sector, unsigned int count)
+{
+	append_record(TRACE_LAYER_DISK, opcode, sector, count, ext2_current_op(), ext2_time_ns());
+}
+
+static void trace_block(void* param, const EXT2_TRACE_EVENT* event)
+{
+	append_record(TRACE_LAYER_BLOCK, event->opcode, event->block, event->count, event->origin, event->time);
+}
+
+/*   ڵ带 Ϸ, flusher  Ǵ stop ȣ */
+static int drain_rings(TRACE_WRITER* writer)
+{
+	UINT32 i, ringCount = __atomic_load_n(&writer->ringCount, __ATOMIC_ACQUIRE);
+	UINT64 head, tail, length;
+	TRACE_RING* ring;
+	int result = EXT2_SUCCESS;
+
+	for (i = 0; i < ringCount; i++)
+	{
+		ring = writer->rings[i];
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		tail = ring->tail;
+		while (tail != head)
+		{	//    ӵ  
+			length = EXT2_TRACE_RING_SIZE - (tail & (EXT2_TRACE_RING_SIZE - 1));
+			if (length > head - tail)
+				length = head - tail;
+			if (fwrite(&ring->records[tail & (EXT2_TRACE_RING_SIZE - 1)], sizeof(TRACE_RECORD), length, writer->file) != length)
+				result = EXT2_ERROR;
+			writer->header.records += length;
+			tail += length;
+			__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+		}
+	}
+
+	return result;
+}
+
+static void* flush_thread(void* arg)
+{
+	TRACE_WRITER* writer = (TRACE_WRITER *)arg;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&writer->lock);
+	while (!writer->flusherStop)
+	{
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += TRACE_FLUSH_MS * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&writer->wake, &writer->lock, &deadline);
+
+		pthread_mutex_unlock(&writer->lock);
+		drain_rings(writer);
+		pthread_mutex_lock(&writer->lock);
+	}
+	pthread_mutex_unlock(&writer->lock);
+
+	return NULL;
+}
+
+/* disk fs I/O path  ,   ϳ NULL̾  */
+int ext2_trace_start(const char* path, DISK_OPERATIONS* disk, EXT2_FILESYSTEM* fs)
+{
+	TRACE_WRITER* writer = &g_writer;
+
+	if (disk == NULL && fs != NULL)
+		disk = fs->disk;
+
+	pthread_once(&g_traceOnce, create_key);
+	pthread_mutex_lock(&g_traceLock);
+	if (writer->active)
+	{
+		pthread_mutex_unlock(&g_traceLock);
+		LOG_ERROR("error : a trace is already running\n");
+		return EXT2_ERROR;
+	}
+
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL)
+	{
+		pthread_mutex_unlock(&g_traceLock);
+		LOG_ERROR("error : cannot create trace file %s\n", path);
+		return EXT2_ERROR;
+	}
+
+	ZeroMemory(&writer->header, sizeof(TRACE_FILE_HEADER));
+	memcpy(writer->header.magic, TRACE_MAGIC, sizeof(writer->header.magic));
+	writer->header.version = TRACE_VERSION;
+	writer->header.recordSize = sizeof(TRACE_RECORD);
+	if (disk != NULL)
+	{
+		writer->header.bytesPerSector = disk->bytesPerSector;
+		writer->header.numberOfSectors = disk->numberOfSectors;
+	}
+	if (fs != NULL)
+		writer->header.blockSize = fs->sb_info.blockSize;
+	writer->header.startTime = ext2_time_ns();
+	fwrite(&writer->header, sizeof(TRACE_FILE_HEADER), 1, writer->file);
+
+	writer->disk = disk;
+	writer->fs = fs;
+	writer->generation++;
+	writer->ringCount = 0;
+	writer->dropped = 0;
+	writer->flusherStop = 0;
+	__atomic_store_n(&writer->stop, 0, __ATOMIC_SEQ_CST);
+	writer->active = 1;
+
+	if (pthread_create(&writer->flusher, NULL, flush_thread, writer) != 0)
+	{
+		writer->active = 0;
+		fclose(writer->file);
+		pthread_mutex_unlock(&g_traceLock);
+		LOG_ERROR("error : cannot start the trace flusher\n");
+		return EXT2_ERROR;
+	}
+
+	if (disk != NULL)
+	{
+		disk->traceParam = writer;
+		__atomic_store_n(&disk->trace, trace_disk, __ATOMIC_RELEASE);
+	}
+	if (fs != NULL)
+	{
+		writer->blockTrace.hook = trace_block;
+		writer->blockTrace.param = writer;
+		ext2_set_trace(fs, &writer->blockTrace);
+	}
+	pthread_mutex_unlock(&g_traceLock);
+
+	return EXT2_SUCCESS;
+}
+
+/* hook   ڵ带      */
+int ext2_trace_stop(UINT64* records, UINT64* dropped)
+{
+	TRACE_WRITER* writer = &g_writer;
+	int result;
+	UINT32 i;
+
+	pthread_mutex_lock(&g_traceLock);
+	if (!writer->active)
+	{
+		pthread_mutex_unlock(&g_traceLock);
+		LOG_ERROR("error : no trace is running\n");
+		return EXT2_ERROR;
+	}
+
+	if (writer->disk != NULL)
+		__atomic_store_n(&writer->disk->trace, NULL, __ATOMIC_RELEASE);
+	if (writer->fs != NULL)
+		ext2_set_trace(writer->fs, NULL);
+
+	// hook ̹  ȣ stop   ǵ帮 
+	__atomic_store_n(&writer->stop, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&writer->callers, __ATOMIC_SEQ_CST) != 0)
+		sched_yield();
+
+	pthread_mutex_lock(&writer->lock);
+	writer->flusherStop = 1;
+	pthread_cond_signal(&writer->wake);
+	pthread_mutex_unlock(&writer->lock);
+	pthread_join(writer->flusher, NULL);
+
+	result = drain_rings(writer);
+	writer->header.dropped = writer->dropped;
+	if (fseek(writer->file, 0, SEEK_SET) != 0 ||
+		fwrite(&writer->header, sizeof(TRACE_FILE_HEADER), 1, writer->file) != 1)
+		result = EXT2_ERROR;
+	if (fclose(writer->file) != 0)
+		result = EXT2_ERROR;
+
+	pthread_mutex_lock(&writer->lock);
+	for (i = 0; i < writer->ringCount; i++)
+		free(writer->rings[i]);
+	writer->ringCount = 0;
+	writer->active = 0;
+	pthread_mutex_unlock(&writer->lock);
+
+	if (records != NULL)
+		*records = writer->header.records;
+	if (dropped != NULL)
+		*dropped = writer->header.dropped;
+	pthread_mutex_unlock(&g_traceLock);
+
+	return result;
+}
@@ -0,0 +1,46 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "common.h"
+
+/* binary I/O trace file
+ *
+ * A TRACE_FILE_HEADER followed by fixed size TRACE_RECORDs in native byte
+ * order. Records of one thread are in time order, records of different
+ * threads are interleaved in the order their buffers were flushed, so a
+ * reader sorts by time. records and dropped are filled in when the trace
+ * is stopped, a trace of a crashed process has records == 0 and is read
+ * up to the end of the file. */
+
+#define TRACE_MAGIC				"EXT2TRCE"
+#define TRACE_VERSION			1
+
+#define TRACE_LAYER_DISK		0		/* sector transfer done by the disk backend */
+#define TRACE_LAYER_BLOCK		1		/* read_block/write_block of the file system */
+
+typedef struct TRACE_FILE_HEADER
+{
+	char	magic[8];
+	UINT32	version;
+	UINT32	recordSize;
+	UINT32	bytesPerSector;
+	UINT32	blockSize;			/* 0 : no file system was traced */
+	UINT64	numberOfSectors;
+	UINT64	records;
+	UINT64	dropped;			/* events lost to full buffers */
+	UINT64	startTime;			/* CLOCK_MONOTONIC ns the record times are relative to */
+} TRACE_FILE_HEADER;
+
+typedef struct TRACE_RECORD
+{
+	UINT64	time;				/* ns since startTime */
+	UINT64	address;			/* sector or block number */
+	UINT32	count;				/* sectors or blocks */
+	UINT16	thread;				/* buffer the record came from */
+	BYTE	layer;				/* TRACE_LAYER_* */
+	BYTE	opcode;				/* DISK_READ, DISK_WRITE */
+	BYTE	origin;				/* EXT2_OP_* of the operation that caused it */
+	BYTE	reserved[7];
+} TRACE_RECORD;
+
+#endif
@@ -0,0 +1,403 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "ext2.h"
+
+/* parallel tree walker
+ *
+ * Every worker owns a deque of directories still to be scanned. A worker
+ * pushes the subdirectories it finds to the bottom of its own deque and
+ * takes its next directory from there, so it walks depth first. A worker
+ * whose deque is empty steals the oldest directory from the top of
+ * another worker's deque; those sit near the root and carry the most work.
+ * A directory is the unit of work, one directory is always scanned by a
+ * single worker. Workers with nothing to steal sleep until a directory is
+ * queued or the walk ends. The visitor is called from all workers at once and must
+ * not modify the file system. */
+
+typedef struct walk_item {
+	EXT2_NODE	dir;
+	UINT32		depth;				/* depth of the entries of dir */
+	char		path[];				/* path of dir below the start, "" : start */
+} WALK_ITEM;
+
+typedef struct walk_deque {
+	WALK_ITEM**	items;				/* ring buffer */
+	UINT32		top;				/* oldest item, taken by thieves */
+	UINT32		count;
+	UINT32		size;				/* power of 2 */
+	pthread_mutex_t lock;
+} WALK_DEQUE;
+
+typedef struct walk_context {
+	EXT2_WALK_VISIT	visit;
+	void*		arg;
+	UINT32		threadCount;
+	WALK_DEQUE*	deques;				/* one per worker */
+	UINT32		pending;			/* directories queued or being scanned */
+	UINT32		stop;				/* visitor or scan failed */
+	UINT32		idle;				/* workers sleeping on wake */
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+} WALK_CONTEXT;
+
+typedef struct walk_worker {
+	WALK_CONTEXT*	ctx;
+	UINT32		id;
+	WALK_ITEM*	current;			/* directory being scanned */
+	char*		path;				/* path of the entry being visited */
+	UINT32		pathSize;
+	int			result;
+} WALK_WORKER;
+
+static int push_bottom(WALK_DEQUE* deque, WALK_ITEM* item)
+{
+	WALK_ITEM** grown;
+	UINT32 i, size;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->count == deque->size)
+	{
+		size = deque->size ? deque->size * 2 : 64;
+		grown = (WALK_ITEM **)malloc(sizeof(WALK_ITEM *) * size);
+		if (grown == NULL)
+		{
+			pthread_mutex_unlock(&deque->lock);
+			return EXT2_ERROR;
+		}
+		for (i = 0; i < deque->count; i++)
+			grown[i] = deque->items[(deque->top + i) & (deque->size - 1)];
+		free(deque->items);
+		deque->items = grown;
+		deque->top = 0;
+		deque->size = size;
+	}
+	deque->items[(deque->top + deque->count) & (deque->size - 1)] = item;
+	__atomic_add_fetch(&deque->count, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&deque->lock);
+
+	return EXT2_SUCCESS;
+}
+
+/* ڱ deque  ֱٿ  ͸ */
+static WALK_ITEM* pop_bottom(WALK_DEQUE* deque)
+{
+	WALK_ITEM* item = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->count > 0)
+		item = deque->items[(deque->top + __atomic_sub_fetch(&deque->count, 1, __ATOMIC_SEQ_CST)) & (deque->size - 1)];
+	pthread_mutex_unlock(&deque->lock);
+
+	return item;
+}
+
+/* ٸ worker deque   ͸ */
+static WALK_ITEM* pop_top(WALK_DEQUE* deque)
+{
+	WALK_ITEM* item = NULL;
+
+	if (__atomic_load_n(&deque->count, __ATOMIC_RELAXED) == 0) //  deque lock  ǳʶ
+		return NULL;
+
+	pthread_mutex_lock(&deque->lock);
+	if (deque->count > 0)
+	{
+		item = deque->items[deque->top];
+		deque->top = (deque->top + 1) & (deque->size - 1);
+		__atomic_sub_fetch(&deque->count, 1, __ATOMIC_SEQ_CST);
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return item;
+}
+
+/* ĥ ͸ ų walk    */
+static void wait_work(WALK_CONTEXT* ctx)
+{
+	UINT32 i;
+
+	pthread_mutex_lock(&ctx->lock);
+	__atomic_add_fetch(&ctx->idle, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&ctx->pending, __ATOMIC_SEQ_CST) != 0 && !__atomic_load_n(&ctx->stop, __ATOMIC_SEQ_CST))
+	{
+		for (i = 0; i < ctx->threadCount; i++)
+		{
+			if (__atomic_load_n(&ctx->deques[i].count, __ATOMIC_SEQ_CST) != 0)
+				break;
+		}
+		if (i < ctx->threadCount)
+			break;
+		pthread_cond_wait(&ctx->wake, &ctx->lock);
+	}
+	__atomic_sub_fetch(&ctx->idle, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+/* deque  ڳ walk   ȣ, ڴ worker  lock   */
+static void wake_workers(WALK_CONTEXT* ctx, int all)
+{
+	if (__atomic_load_n(&ctx->idle, __ATOMIC_SEQ_CST) == 0)
+		return;
+
+	pthread_mutex_lock(&ctx->lock);
+	if (all)
+		pthread_cond_broadcast(&ctx->wake);
+	else
+		pthread_cond_signal(&ctx->wake);
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+static WALK_ITEM* steal(WALK_WORKER* worker)
+{
+	WALK_CONTEXT* ctx = worker->ctx;
+	WALK_ITEM* item;
+	UINT32 i;
+
+	for (i = 1; i < ctx->threadCount; i++)
+	{
+		item = pop_top(&ctx->deques[(worker->id + i) % ctx->threadCount]);
+		if (item != NULL)
+			return item;
+	}
+
+	return NULL;
+}
+
+/*  ä Ʈ ̸ "NAME.EXT" · */
+static UINT32 get_entry_name(const EXT2_DIR_ENTRY* entry, char* name)
+{
+	UINT32 length = 0;
+	int i, end;
+
+	for (end = MAX_ENTRY_NAME_LENGTH - 3; end > 0 && entry->name[end - 1] == 0x20; end--)
+		;
+	for (i = 0; i < end; i++)
+		name[length++] = entry->name[i];
+
+	for (end = MAX_ENTRY_NAME_LENGTH; end > MAX_ENTRY_NAME_LENGTH - 3 && entry->name[end - 1] == 0x20; end--)
+		;
+	if (end > MAX_ENTRY_NAME_LENGTH - 3)
+	{
+		name[length++] = '.';
+		for (i = MAX_ENTRY_NAME_LENGTH - 3; i < end; i++)
+			name[length++] = entry->name[i];
+	}
+	name[length] = 0;
+
+	return length;
+}
+
+/* ".", "..", Ʈ ͸ format  0, mkdir  ̸ ä */
+static int is_dot_entry(const EXT2_DIR_ENTRY* entry)
+{
+	const BYTE* name = entry->name;
+
+	if (name[0] != '.')
+		return 0;
+	if (name[1] == '.')
+		name++;
+
+	return name[1] == 0 || name[1] == 0x20;
+}
+
+/* ext2_read_dir ͸ Ʈ ȣ */
+static int visit_entry(EXT2_FILESYSTEM* fs, void* list, EXT2_NODE* node)
+{
+	WALK_WORKER* worker = (WALK_WORKER *)list;
+	WALK_CONTEXT* ctx = worker->ctx;
+	WALK_ITEM* parent = worker->current;
+	WALK_ITEM* item;
+	EXT2_WALK_ENTRY entry;
+	char name[MAX_ENTRY_NAME_LENGTH + 2];
+	UINT32 prefix, length, size;
+	char* grown;
+
+	if (__atomic_load_n(&ctx->stop, __ATOMIC_RELAXED) || is_dot_entry(&node->entry))
+		return EXT2_SUCCESS;
+
+	length = get_entry_name(&node->entry, name);
+	prefix = strlen(parent->path);
+	size = prefix + length + 2;
+	if (size > worker->pathSize)
+	{
+		grown = (char *)realloc(worker->path, size * 2);
+		if (grown == NULL)
+			goto fail;
+		worker->path = grown;
+		worker->pathSize = size * 2;
+	}
+	memcpy(worker->path, parent->path, prefix);
+	if (prefix > 0)
+		worker->path[prefix++] = '/';
+	memcpy(&worker->path[prefix], name, length + 1);
+
+	ZeroMemory(&entry, sizeof(entry));
+	entry.node.fs = fs;
+	entry.node.entry = node->entry;
+	entry.name = name;
+	entry.path = worker->path;
+	entry.depth = parent->depth;
+	entry.worker = worker->id;
+	if (get_inode(fs, node->entry.inode, (BYTE *)&entry.inode) != EXT2_SUCCESS)
+		goto fail;
+
+	if (ctx->visit(&entry, ctx->arg) != EXT2_SUCCESS)
+		goto fail;
+
+	if (node->entry.dir2.fileType != EXT2_FT_DIR)
+		return EXT2_SUCCESS;
+
+	item = (WALK_ITEM *)malloc(sizeof(WALK_ITEM) + prefix + length + 1);
+	if (item == NULL)
+		goto fail;
+	item->dir = entry.node;
+	item->depth = parent->depth + 1;
+	memcpy(item->path, worker->path, prefix + length + 1);
+
+	__atomic_add_fetch(&ctx->pending, 1, __ATOMIC_RELAXED); // deque ֱ   ٸ worker ٰ Ǵ 
+	if (push_bottom(&ctx->deques[worker->id], item) != EXT2_SUCCESS)
+	{
+		__atomic_sub_fetch(&ctx->pending, 1, __ATOMIC_RELAXED);
+		free(item);
+		goto fail;
+	}
+	wake_workers(ctx, 0);
+
+	return EXT2_SUCCESS;
+
+fail:
+	worker->result = EXT2_ERROR;
+	__atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+	return EXT2_ERROR;
+}
+
+static void* walk_worker(void* arg)
+{
+	WALK_WORKER* worker = (WALK_WORKER *)arg;
+	WALK_CONTEXT* ctx = worker->ctx;
+	WALK_ITEM* item;
+
+	while (!__atomic_load_n(&ctx->stop, __ATOMIC_RELAXED))
+	{
+		item = pop_bottom(&ctx->deques[worker->id]);
+		if (item == NULL)
+			item = steal(worker);
+		if (item == NULL)
+		{
+			if (__atomic_load_n(&ctx->pending, __ATOMIC_ACQUIRE) == 0) // ť  д  ͸ 
+				break;
+			wait_work(ctx);
+			continue;
+		}
+
+		worker->current = item;
+		if (ext2_read_dir(&item->dir, visit_entry, worker) != EXT2_SUCCESS)
+		{
+			worker->result = EXT2_ERROR;
+			__atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+		}
+		free(item);
+		if (__atomic_sub_fetch(&ctx->pending, 1, __ATOMIC_SEQ_CST) == 0 || __atomic_load_n(&ctx->stop, __ATOMIC_RELAXED))
+			wake_workers(ctx, 1);
+	}
+
+	return NULL;
+}
+
+/* dir Ʒ  Ʈ  visit ȣ, threadCount 0̸ CPU ŭ   */
+/* return : EXT2_SUCCESS  湮, EXT2_ERROR visit ߴ߰ų б  */
+int ext2_walk(EXT2_NODE* dir, UINT32 threadCount, EXT2_WALK_VISIT visit, void* arg)
+{
+	WALK_CONTEXT ctx;
+	WALK_WORKER* workers;
+	WALK_ITEM* item;
+	pthread_t* threads;
+	UINT32 i, started;
+	int result = EXT2_ERROR;
+
+	if (threadCount == 0)
+		threadCount = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+	if (threadCount > EXT2_WALK_MAX_THREADS)
+		threadCount = EXT2_WALK_MAX_THREADS;
+
+	ZeroMemory(&ctx, sizeof(ctx));
+	ctx.visit = visit;
+	ctx.arg = arg;
+	ctx.threadCount = threadCount;
+	pthread_mutex_init(&ctx.lock, NULL);
+	pthread_cond_init(&ctx.wake, NULL);
+	ctx.deques = (WALK_DEQUE *)calloc(threadCount, sizeof(WALK_DEQUE));
+	workers = (WALK_WORKER *)calloc(threadCount, sizeof(WALK_WORKER));
+	threads = (pthread_t *)malloc(sizeof(pthread_t) * threadCount);
+	item = (WALK_ITEM *)malloc(sizeof(WALK_ITEM) + 1);
+	if (ctx.deques == NULL || workers == NULL || threads == NULL || item == NULL)
+	{
+		LOG_ERROR("error : failed to allocate walker\n");
+		free(ctx.deques);
+		free(workers);
+		free(threads);
+		free(item);
+		pthread_mutex_destroy(&ctx.lock);
+		pthread_cond_destroy(&ctx.wake);
+		return EXT2_ERROR;
+	}
+
+	for (i = 0; i < threadCount; i++)
+	{
+		pthread_mutex_init(&ctx.deques[i].lock, NULL);
+		workers[i].ctx = &ctx;
+		workers[i].id = i;
+		workers[i].result = EXT2_SUCCESS;
+	}
+
+	item->dir = *dir;
+	item->depth = 1;
+	item->path[0] = 0;
+	ctx.pending = 1;
+	push_bottom(&ctx.deques[0], item);
+
+	if (threadCount == 1)
+	{
+		walk_worker(&workers[0]);
+		started = 1;
+	}
+	else
+	{
+		for (started = 0; started < threadCount; started++)
+		{
+			if (pthread_create(&threads[started], NULL, walk_worker, &workers[started]) != 0)
+				break;
+		}
+		if (started == 0) // 带  ϸ ȣ 忡 
+		{
+			walk_worker(&workers[0]);
+			started = 1;
+		}
+		else
+		{
+			for (i = 0; i < started; i++)
+				pthread_join(threads[i], NULL);
+		}
+	}
+
+	result = ctx.stop ? EXT2_ERROR : EXT2_SUCCESS;
+
+	for (i = 0; i < threadCount; i++)
+	{
+		while ((item = pop_bottom(&ctx.deques[i])) != NULL) // ߴܵǾ  ͸
+			free(item);
+		free(ctx.deques[i].items);
+		pthread_mutex_destroy(&ctx.deques[i].lock);
+		free(workers[i].path);
+	}
+	free(ctx.deques);
+	free(workers);
+	free(threads);
+	pthread_mutex_destroy(&ctx.lock);
+	pthread_cond_destroy(&ctx.wake);
+
+	return result;
+}